@@ -20,6 +20,8 @@
 #include <asm/byteorder.h>
 #include <linux/libfdt.h>
 #include <mapmem.h>
+#include <serial.h>
+#include <tracepoint.h>
 #include <fdt_support.h>
 #include <asm/bootm.h>
 #include <asm/secure.h>
@@ -104,6 +106,12 @@ static void announce_and_cleanup(int fake)
 
 	board_quiesce_devices();
 
+	tracepoint_export();
+	bootstage_bloblist_add_report();
+
+	/* Send any buffered console output before the OS takes over */
+	serial_flush();
+
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
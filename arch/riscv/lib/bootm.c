@@ -11,6 +11,8 @@
 #include <dm.h>
 #include <dm/root.h>
 #include <image.h>
+#include <serial.h>
+#include <tracepoint.h>
 #include <asm/byteorder.h>
 #include <asm/csr.h>
 #include <dm/device.h>
@@ -51,6 +53,12 @@ static void announce_and_cleanup(int fake)
 
 	board_quiesce_devices();
 
+	tracepoint_export();
+	bootstage_bloblist_add_report();
+
+	/* Send any buffered console output before the OS takes over */
+	serial_flush();
+
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
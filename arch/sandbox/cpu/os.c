@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <pthread.h>
 #include <setjmp.h>
 #include <stdio.h>
 #include <stdint.h>
@@ -776,6 +777,48 @@ void os_abort(void)
 	abort();
 }
 
+struct os_parallel {
+	void (*func)(void *ctx, int index);
+	void *ctx;
+	int count;
+	int next;
+};
+
+static void *os_parallel_thread(void *arg)
+{
+	struct os_parallel *par = arg;
+	int index;
+
+	while ((index = __atomic_fetch_add(&par->next, 1, __ATOMIC_RELAXED)) <
+	       par->count)
+		par->func(par->ctx, index);
+
+	return NULL;
+}
+
+int os_run_parallel(int count, int max_threads,
+		    void (*func)(void *ctx, int index), void *ctx)
+{
+	struct os_parallel par = { func, ctx, count, 0 };
+	pthread_t threads[max_threads];
+	int started, i;
+
+	if (max_threads > count)
+		max_threads = count;
+	for (started = 0; started < max_threads; started++) {
+		if (pthread_create(&threads[started], NULL,
+				   os_parallel_thread, &par))
+			break;
+	}
+
+	/* Run anything left over here, if no threads could be started */
+	os_parallel_thread(&par);
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	return started;
+}
+
 int os_mprotect_allow(void *start, size_t len)
 {
 	int page_size = getpagesize();
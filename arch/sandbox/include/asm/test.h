@@ -161,4 +161,62 @@ int sandbox_get_setup_called(struct udevice *dev);
  */
 int sandbox_get_sound_sum(struct udevice *dev);
 
+/**
+ * sandbox_serial_set_fifo() - Set how the serial port takes output
+ *
+ * @dev:	Serial device
+ * @fifo_size:	Most characters taken by each puts() call, 0 for no limit
+ * @busy:	true to take nothing, as if the FIFO were full
+ */
+void sandbox_serial_set_fifo(struct udevice *dev, int fifo_size, bool busy);
+
+/**
+ * sandbox_serial_get_written() - Get the output written with puts()
+ *
+ * @dev:	Serial device
+ * @puts_callsp: Returns the number of puts() calls which wrote something
+ * @return number of characters written with puts()
+ */
+int sandbox_serial_get_written(struct udevice *dev, int *puts_callsp);
+
+/**
+ * sandbox_usb_get_streams() - Get the number of bulk streams sent
+ *
+ * @bus:	USB controller
+ * @xfersp:	Returns the total number of transfers in those streams
+ * @return number of calls to the bulk_stream() method
+ */
+int sandbox_usb_get_streams(struct udevice *bus, int *xfersp);
+
+/**
+ * sandbox_usb_get_max_resetting() - Get the most ports reset at once
+ *
+ * This counts the ports which were reset, with the device on them not yet
+ * given an address. It also resets the count, ready for the next check.
+ *
+ * @bus:	USB controller
+ * @return largest number of ports between reset and address assignment at
+ * once since the last call
+ */
+int sandbox_usb_get_max_resetting(struct udevice *bus);
+
+/**
+ * sandbox_usb_uas_get_max_queued() - Get the most UAS commands queued at once
+ *
+ * This also resets the count, ready for the next check.
+ *
+ * @dev:	UAS emulator
+ * @return largest number of commands which were queued on the emulator at
+ * once since the last call
+ */
+int sandbox_usb_uas_get_max_queued(struct udevice *dev);
+
+/**
+ * sandbox_decomp_get_threads() - Get the threads used to decompress blocks
+ *
+ * @return number of host threads used by the last call to
+ * arch_decomp_blocks(), or 0 if the blocks were decompressed in turn
+ */
+int sandbox_decomp_get_threads(void);
+
 #endif
@@ -5,7 +5,12 @@
  */
 
 #include <common.h>
+#include <bootm.h>
+#include <image.h>
+#include <os.h>
+#include <serial.h>
 #include <asm/io.h>
+#include <asm/test.h>
 
 #define	LINUX_ARM_ZIMAGE_MAGIC	0x016f2818
 
@@ -48,14 +53,82 @@ int bootz_setup(ulong image, ulong *start, ulong *end)
 	return ret;
 }
 
-int do_bootm_linux(int flag, int argc, char *argv[], bootm_headers_t *images)
+int do_bootm_linux(int flag, int argc, char * const argv[],
+		   bootm_headers_t *images)
 {
 	if (flag & (BOOTM_STATE_OS_GO | BOOTM_STATE_OS_FAKE_GO)) {
 		bootstage_mark(BOOTSTAGE_ID_RUN_OS);
 		printf("## Transferring control to Linux (at address %08lx)...\n",
 		       images->ep);
 		printf("sandbox: continuing, as we cannot run Linux\n");
+
+		/* Send any buffered console output before the OS takes over */
+		serial_flush();
+	}
+
+	return 0;
+}
+
+#ifdef CONFIG_FIT_COMP_BLOCKS
+/* Number of host threads used to decompress the blocks of an image */
+#define SANDBOX_DECOMP_THREADS	4
+
+static int sandbox_decomp_threads;
+
+int sandbox_decomp_get_threads(void)
+{
+	return sandbox_decomp_threads;
+}
+
+struct sandbox_decomp {
+	int comp;
+	struct bootm_decomp_block *blocks;
+};
+
+static void sandbox_decomp_one(void *ctx, int index)
+{
+	struct sandbox_decomp *decomp = ctx;
+
+	bootm_decomp_block(decomp->comp, &decomp->blocks[index]);
+}
+
+/*
+ * Decompress the blocks on host threads, standing in for secondary CPUs.
+ * The gzip, bzip2 and lzma decompressors use malloc(), which is not
+ * thread-safe, so those are done in turn.
+ */
+int arch_decomp_blocks(int comp, struct bootm_decomp_block *blocks, int count)
+{
+	struct sandbox_decomp decomp = { comp, blocks };
+	int ret;
+	int i;
+
+	sandbox_decomp_threads = 0;
+	switch (comp) {
+	case IH_COMP_NONE:
+#ifdef CONFIG_LZ4
+	case IH_COMP_LZ4:
+#endif
+#ifdef CONFIG_LZO
+	case IH_COMP_LZO:
+#endif
+		break;
+	default:
+		for (i = 0; i < count; i++) {
+			ret = bootm_decomp_block(comp, &blocks[i]);
+			if (ret)
+				return ret;
+		}
+		return 0;
+	}
+
+	sandbox_decomp_threads = os_run_parallel(count, SANDBOX_DECOMP_THREADS,
+						 sandbox_decomp_one, &decomp);
+	for (i = 0; i < count; i++) {
+		if (blocks[i].ret)
+			return -EIO;
 	}
 
 	return 0;
 }
+#endif
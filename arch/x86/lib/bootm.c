@@ -14,6 +14,8 @@
 #include <errno.h>
 #include <fdt_support.h>
 #include <image.h>
+#include <serial.h>
+#include <tracepoint.h>
 #include <u-boot/zlib.h>
 #include <asm/bootparam.h>
 #include <asm/cpu.h>
@@ -39,6 +41,12 @@ void bootm_announce_and_cleanup(void)
 	bootstage_report();
 #endif
 
+	tracepoint_export();
+	bootstage_bloblist_add_report();
+
+	/* Send any buffered console output before the OS takes over */
+	serial_flush();
+
 	/*
 	 * Call remove function of all devices with a removal flag set.
 	 * This may be useful for last-stage operations, like cancelling
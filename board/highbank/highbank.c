@@ -96,17 +96,17 @@ int dram_init(void)
 }
 
 #if defined(CONFIG_OF_BOARD_SETUP)
-int ft_board_setup(void *fdt, bd_t *bd)
+int ft_board_setup_fixup(struct fdt_fixup *fix, bd_t *bd)
 {
 	static const char disabled[] = "disabled";
 	u32 reg = readl(HB_SREG_A9_PWRDOM_STAT);
 
 	if (!(reg & PWRDOM_STAT_SATA))
-		do_fixup_by_compat(fdt, "calxeda,hb-ahci", "status",
+		fdt_fixup_by_compat(fix, "calxeda,hb-ahci", "status",
 			disabled, sizeof(disabled), 1);
 
 	if (!(reg & PWRDOM_STAT_EMMC))
-		do_fixup_by_compat(fdt, "calxeda,hb-sdhci", "status",
+		fdt_fixup_by_compat(fix, "calxeda,hb-sdhci", "status",
 			disabled, sizeof(disabled), 1);
 
 	return 0;
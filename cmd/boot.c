@@ -10,6 +10,7 @@
 #include <common.h>
 #include <command.h>
 #include <net.h>
+#include <serial.h>
 
 #ifdef CONFIG_CMD_GO
 
@@ -33,6 +34,9 @@ static int do_go(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 
 	printf ("## Starting application at 0x%08lX ...\n", addr);
 
+	/* Send any buffered console output before the application runs */
+	serial_flush();
+
 	/*
 	 * pass address parameter as argv[0] (aka command name),
 	 * and all remaining args
@@ -12,6 +12,7 @@
 #include <command.h>
 #include <environment.h>
 #include <errno.h>
+#include <fs.h>
 #include <image.h>
 #include <malloc.h>
 #include <nand.h>
@@ -195,6 +196,51 @@ U_BOOT_CMD(
 	"boot application image from memory", bootm_help_text
 );
 
+#ifdef CONFIG_CMD_FITLOAD
+/*******************************************************************/
+/* fitload - load the parts of a FIT needed by one configuration */
+/*******************************************************************/
+static int do_fitload(cmd_tbl_t *cmdtp, int flag, int argc,
+		      char * const argv[])
+{
+	const char *conf_uname = NULL;
+	loff_t bytes_read;
+	ulong addr, size;
+	ulong time;
+	int ret;
+
+	if (argc != 5)
+		return CMD_RET_USAGE;
+
+	if (!fit_parse_conf(argv[3], load_addr, &addr, &conf_uname))
+		addr = simple_strtoul(argv[3], NULL, 16);
+
+	time = get_timer(0);
+	ret = fit_load_file(argv[1], argv[2], FS_TYPE_ANY, argv[4], addr,
+			    conf_uname, &size, &bytes_read);
+	time = get_timer(time);
+	if (ret) {
+		printf("Failed to load FIT (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+
+	printf("%llu bytes read in %lu ms\n", bytes_read, time);
+	env_set_hex("fileaddr", addr);
+	env_set_hex("filesize", size);
+
+	return 0;
+}
+
+U_BOOT_CMD(
+	fitload,	5,	0,	do_fitload,
+	"load the parts of a FIT needed by a configuration",
+	"<interface> <dev[:part]> <addr>[#conf] <filename>\n"
+	"    - read the FIT structure from 'filename' to 'addr', then read\n"
+	"      the external data of only those images used by configuration\n"
+	"      'conf' (or the default). Boot it with 'bootm addr#conf'."
+);
+#endif
+
 /*******************************************************************/
 /* bootd - boot default image */
 /*******************************************************************/
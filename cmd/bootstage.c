@@ -4,6 +4,8 @@
  */
 
 #include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
 
 static int do_bootstage_report(cmd_tbl_t *cmdtp, int flag, int argc,
 			       char * const argv[])
@@ -57,10 +59,48 @@ static int do_bootstage_stash(cmd_tbl_t *cmdtp, int flag, int argc,
 	return 0;
 }
 
+static int do_bootstage_json(cmd_tbl_t *cmdtp, int flag, int argc,
+			     char * const argv[])
+{
+	ulong addr, size;
+	char *buf;
+	int len;
+
+	if (argc < 2) {
+		len = bootstage_json(NULL, 0);
+		buf = malloc(len + 1);
+		if (!buf) {
+			printf("Out of memory\n");
+			return CMD_RET_FAILURE;
+		}
+		bootstage_json(buf, len + 1);
+		puts(buf);
+		putc('\n');
+		free(buf);
+
+		return 0;
+	}
+	if (argc < 3)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[1], NULL, 16);
+	size = simple_strtoul(argv[2], NULL, 16);
+	buf = map_sysmem(addr, size);
+	len = bootstage_json(buf, size);
+	unmap_sysmem(buf);
+	if (len >= size) {
+		printf("Not enough space (need %x bytes)\n", len + 1);
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", len);
+
+	return 0;
+}
+
 static cmd_tbl_t cmd_bootstage_sub[] = {
 	U_BOOT_CMD_MKENT(report, 2, 1, do_bootstage_report, "", ""),
 	U_BOOT_CMD_MKENT(stash, 4, 0, do_bootstage_stash, "", ""),
 	U_BOOT_CMD_MKENT(unstash, 4, 0, do_bootstage_stash, "", ""),
+	U_BOOT_CMD_MKENT(json, 3, 0, do_bootstage_json, "", ""),
 };
 
 /*
@@ -90,5 +130,7 @@ U_BOOT_CMD(bootstage, 4, 1, do_boostage,
 	" - check boot progress and timing\n"
 	"report                      - Print a report\n"
 	"stash [<start> [<size>]]    - Stash data into memory\n"
-	"unstash [<start> [<size>]]  - Unstash data from memory"
+	"unstash [<start> [<size>]]  - Unstash data from memory\n"
+	"json [<addr> <size>]        - Print the data as JSON, or write it to\n"
+	"                              memory setting 'filesize'"
 );
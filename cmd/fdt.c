@@ -626,8 +626,16 @@ static int do_fdt(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 #ifdef CONFIG_OF_BOARD_SETUP
 	/* Call the board-specific fixup routine */
 	else if (strncmp(argv[1], "boa", 3) == 0) {
-		int err = ft_board_setup(working_fdt, gd->bd);
+		struct fdt_fixup fix;
+		int err;
 
+		fdt_fixup_start(&fix, working_fdt);
+		err = ft_board_setup_fixup(&fix, gd->bd);
+		if (err && !fix.err)
+			fix.err = err;
+		err = fdt_fixup_apply(&fix);
+		if (!err)
+			err = ft_board_setup(working_fdt, gd->bd);
 		if (err) {
 			printf("Failed to update board information in FDT: %s\n",
 			       fdt_strerror(err));
@@ -0,0 +1,56 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Show how the malloc() heap is used
+ */
+
+#include <common.h>
+#include <command.h>
+#include <malloc.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static int do_malloc_stats(cmd_tbl_t *cmdtp, int flag, int argc,
+			   char * const argv[])
+{
+#if CONFIG_VAL(SYS_MALLOC_F_LEN)
+	printf("pre-reloc: %lx of %x bytes used\n", gd->malloc_ptr,
+	       CONFIG_VAL(SYS_MALLOC_F_LEN));
+#endif
+	printf("heap:      %08lx-%08lx, %lx bytes\n", mem_malloc_start,
+	       mem_malloc_end, mem_malloc_end - mem_malloc_start);
+	printf("top:       %lx bytes used\n", mem_malloc_brk - mem_malloc_start);
+#ifdef CONFIG_SYS_MALLOC_SLAB
+	malloc_slab_stats();
+#endif
+
+	return 0;
+}
+
+static cmd_tbl_t malloc_sub[] = {
+	U_BOOT_CMD_MKENT(stats, 1, 1, do_malloc_stats, "", ""),
+};
+
+static int do_malloc(cmd_tbl_t *cmdtp, int flag, int argc,
+		     char * const argv[])
+{
+	cmd_tbl_t *cp;
+
+	if (argc < 2)
+		return CMD_RET_USAGE;
+
+	/* drop initial "malloc" arg */
+	argc--;
+	argv++;
+
+	cp = find_cmd_tbl(argv[0], malloc_sub, ARRAY_SIZE(malloc_sub));
+	if (cp)
+		return cp->cmd(cmdtp, flag, argc, argv);
+
+	return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(
+	malloc, 2, 1, do_malloc,
+	"malloc() heap information",
+	"stats - show heap usage, and slab usage for each block size"
+);
@@ -0,0 +1,99 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Commands for tracepoint records
+ */
+
+#include <common.h>
+#include <command.h>
+#include <mapmem.h>
+#include <tracepoint.h>
+
+static int do_tracepoint_show(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	tracepoint_report();
+
+	return 0;
+}
+
+static int do_tracepoint_mask(cmd_tbl_t *cmdtp, int flag, int argc,
+			      char * const argv[])
+{
+	if (argc < 2) {
+		printf("%x\n", gd->tracepoint_mask);
+		return 0;
+	}
+	if (tracepoint_set_mask(simple_strtoul(argv[1], NULL, 16))) {
+		printf("No tracepoint buffer\n");
+		return CMD_RET_FAILURE;
+	}
+
+	return 0;
+}
+
+static int do_tracepoint_clear(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	tracepoint_clear();
+
+	return 0;
+}
+
+static int do_tracepoint_stash(cmd_tbl_t *cmdtp, int flag, int argc,
+			       char * const argv[])
+{
+	ulong addr, size;
+	void *buf;
+	int ret;
+
+	if (argc < 3)
+		return CMD_RET_USAGE;
+	addr = simple_strtoul(argv[1], NULL, 16);
+	size = simple_strtoul(argv[2], NULL, 16);
+	buf = map_sysmem(addr, size);
+	ret = tracepoint_stash(buf, size);
+	unmap_sysmem(buf);
+	if (ret < 0) {
+		printf("Not enough space (err=%d)\n", ret);
+		return CMD_RET_FAILURE;
+	}
+	env_set_hex("filesize", ret);
+
+	return 0;
+}
+
+static cmd_tbl_t cmd_tracepoint_sub[] = {
+	U_BOOT_CMD_MKENT(show, 1, 1, do_tracepoint_show, "", ""),
+	U_BOOT_CMD_MKENT(mask, 2, 1, do_tracepoint_mask, "", ""),
+	U_BOOT_CMD_MKENT(clear, 1, 1, do_tracepoint_clear, "", ""),
+	U_BOOT_CMD_MKENT(stash, 3, 0, do_tracepoint_stash, "", ""),
+};
+
+static int do_tracepoint(cmd_tbl_t *cmdtp, int flag, int argc,
+			 char * const argv[])
+{
+	cmd_tbl_t *c;
+
+	if (argc < 2)
+		return do_tracepoint_show(cmdtp, flag, argc, argv);
+
+	/* Strip off leading 'tracepoint' command argument */
+	argc--;
+	argv++;
+
+	c = find_cmd_tbl(argv[0], cmd_tracepoint_sub,
+			 ARRAY_SIZE(cmd_tracepoint_sub));
+	if (c)
+		return c->cmd(cmdtp, flag, argc, argv);
+	else
+		return CMD_RET_USAGE;
+}
+
+U_BOOT_CMD(tracepoint, 4, 1, do_tracepoint,
+	"I/O and probe tracepoints",
+	"[show]               - Print the records\n"
+	"tracepoint mask [<mask>]        - Show or set the events to record\n"
+	"tracepoint clear                - Drop all records\n"
+	"tracepoint stash <addr> <size>  - Write the records in binary form,\n"
+	"                                  setting 'filesize'"
+);
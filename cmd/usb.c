@@ -13,6 +13,7 @@
 #include <common.h>
 #include <command.h>
 #include <console.h>
+#include <div64.h>
 #include <dm.h>
 #include <dm/uclass-internal.h>
 #include <memalign.h>
@@ -628,6 +629,31 @@ static void usb_show_info(struct usb_device *udev)
 }
 #endif
 
+#ifdef CONFIG_DM_USB
+static void usb_show_stats(void)
+{
+	struct usb_bus_priv *priv;
+	struct udevice *bus;
+	struct uclass *uc;
+	ulong ms;
+
+	if (uclass_get(UCLASS_USB, &uc))
+		return;
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+		priv = dev_get_uclass_priv(bus);
+		ms = lldiv(priv->bulk_us, 1000);
+		printf("%s: %llu bytes in %lu ms", bus->name, priv->bulk_bytes,
+		       ms);
+		if (ms)
+			printf(", %llu KiB/s",
+			       lldiv((priv->bulk_bytes * 1000) >> 10, ms));
+		printf("\n");
+	}
+}
+#endif
+
 /******************************************************************************
  * usb command intepreter
  */
@@ -720,6 +746,12 @@ static int do_usb(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 		i = simple_strtoul(argv[3], NULL, 10);
 		return usb_test(udev, i, argv[4]);
 	}
+#ifdef CONFIG_DM_USB
+	if (strcmp(argv[1], "stats") == 0) {
+		usb_show_stats();
+		return 0;
+	}
+#endif
 #ifdef CONFIG_USB_STORAGE
 	if (strncmp(argv[1], "stor", 4) == 0)
 		return usb_stor_info();
@@ -741,6 +773,9 @@ U_BOOT_CMD(
 	"usb test [dev] [port] [mode] - set USB 2.0 test mode\n"
 	"    (specify port 0 to indicate the device's upstream port)\n"
 	"    Available modes: J, K, S[E0_NAK], P[acket], F[orce_Enable]\n"
+#ifdef CONFIG_DM_USB
+	"usb stats - show bulk transfer throughput of each controller\n"
+#endif
 #ifdef CONFIG_USB_STORAGE
 	"usb storage - show details of USB storage devices\n"
 	"usb dev [dev] - show or set current USB storage device\n"
@@ -39,6 +39,7 @@
 #include <stdio_dev.h>
 #include <timer.h>
 #include <trace.h>
+#include <tracepoint.h>
 #include <watchdog.h>
 #ifdef CONFIG_ADDR_MAP
 #include <asm/mmu.h>
@@ -153,6 +154,10 @@ static int initr_reloc_global_data(void)
 	 */
 	gd->fdt_blob += gd->reloc_off;
 #endif
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+	/* The cache is in pre-relocation malloc() space, so start again */
+	gd->fdt_cache = NULL;
+#endif
 #ifdef CONFIG_EFI_LOADER
 	efi_runtime_relocate(gd->relocaddr, NULL);
 #endif
@@ -281,6 +286,9 @@ static int initr_dm(void)
 	/* Save the pre-reloc driver model and start a new one */
 	gd->dm_root_f = gd->dm_root;
 	gd->dm_root = NULL;
+	gd->dm_compat_index = NULL;
+	gd->dm_lookup = NULL;
+	gd->dm_arena = NULL;
 #ifdef CONFIG_TIMER
 	gd->timer = NULL;
 #endif
@@ -299,6 +307,14 @@ static int initr_dm(void)
 }
 #endif
 
+#ifdef CONFIG_DM_PROBE_ASYNC
+static int initr_dm_probe_async(void)
+{
+	/* Start slow devices now so that they are ready when first used */
+	return dm_probe_async();
+}
+#endif
+
 static int initr_bootstage(void)
 {
 	bootstage_mark_name(BOOTSTAGE_ID_START_UBOOT_R, "board_init_r");
@@ -659,6 +675,9 @@ static init_fnc_t init_sequence_r[] = {
 	initr_malloc,
 	log_init,
 	initr_bootstage,	/* Needs malloc() but has its own timer */
+#ifdef CONFIG_TRACEPOINT
+	tracepoint_init,
+#endif
 	initr_console_record,
 #ifdef CONFIG_SYS_NONCACHED_MEMORY
 	initr_noncached,
@@ -673,6 +692,9 @@ static init_fnc_t init_sequence_r[] = {
 #if defined(CONFIG_ARM) || defined(CONFIG_NDS32) || defined(CONFIG_RISCV) || \
 	defined(CONFIG_SANDBOX)
 	board_init,	/* Setup chipselects */
+#endif
+#ifdef CONFIG_DM_PROBE_ASYNC
+	initr_dm_probe_async,
 #endif
 	/*
 	 * TODO: printing of the clock inforamtion of the board is now
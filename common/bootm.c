@@ -14,6 +14,7 @@
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/unaligned.h>
 #include <linux/lzo.h>
 #include <lzma/LzmaTypes.h>
 #include <lzma/LzmaDec.h>
@@ -70,6 +71,10 @@ static inline void boot_start_lmb(bootm_headers_t *images) { }
 static int bootm_start(cmd_tbl_t *cmdtp, int flag, int argc,
 		       char * const argv[])
 {
+#ifdef CONFIG_LMB
+	/* Free the regions of an earlier attempt before forgetting them */
+	lmb_release(&images.lmb);
+#endif
 	memset((void *)&images, 0, sizeof(images));
 	images.verify = env_get_yesno("verify");
 
@@ -352,23 +357,22 @@ static int handle_decomp_error(int comp_type, size_t uncomp_size,
 	return BOOTM_ERR_RESET;
 }
 
-int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
-		       void *load_buf, void *image_buf, ulong image_len,
-		       uint unc_len, ulong *load_end)
+int bootm_decomp_block(int comp, struct bootm_decomp_block *blk)
 {
+	ulong image_len = blk->src_len;
+	ulong unc_len = blk->dst_len;
+	void *load_buf = blk->dst;
+	void *image_buf = blk->src;
 	int ret = 0;
 
-	*load_end = load;
-	print_decomp_msg(comp, type, load == image_start);
-
 	/*
-	 * Load the image to the right place, decompressing if needed. After
+	 * Load the block to the right place, decompressing if needed. After
 	 * this, image_len will be set to the number of uncompressed bytes
 	 * loaded, ret will be non-zero on error.
 	 */
 	switch (comp) {
 	case IH_COMP_NONE:
-		if (load == image_start)
+		if (load_buf == image_buf)
 			break;
 		if (image_len <= unc_len)
 			memmove_wd(load_buf, image_buf, image_len, CHUNKSZ);
@@ -426,13 +430,38 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 	}
 #endif /* CONFIG_LZ4 */
 	default:
+		return -EPROTONOSUPPORT;
+	}
+
+	blk->dst_len = image_len;
+	blk->ret = ret;
+
+	return ret ? -EIO : 0;
+}
+
+int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
+		       void *load_buf, void *image_buf, ulong image_len,
+		       uint unc_len, ulong *load_end)
+{
+	struct bootm_decomp_block blk = {
+		.src = image_buf,
+		.src_len = image_len,
+		.dst = load_buf,
+		.dst_len = unc_len,
+	};
+	int ret;
+
+	*load_end = load;
+	print_decomp_msg(comp, type, load == image_start);
+
+	ret = bootm_decomp_block(comp, &blk);
+	if (ret == -EPROTONOSUPPORT) {
 		printf("Unimplemented compression type %d\n", comp);
 		return BOOTM_ERR_UNIMPLEMENTED;
 	}
-
 	if (ret)
-		return handle_decomp_error(comp, image_len, unc_len, ret);
-	*load_end = load + image_len;
+		return handle_decomp_error(comp, blk.dst_len, unc_len, blk.ret);
+	*load_end = load + blk.dst_len;
 
 	puts("OK\n");
 
@@ -440,6 +469,251 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 }
 
 #ifndef USE_HOSTCC
+#ifdef CONFIG_FIT_COMP_BLOCKS
+__weak int arch_decomp_blocks(int comp, struct bootm_decomp_block *blocks,
+			      int count)
+{
+	int ret;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		ret = bootm_decomp_block(comp, &blocks[i]);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int bootm_decomp_blocks(int comp, ulong load, ulong image_start, int type,
+			void *load_buf, void *image_buf, ulong image_len,
+			ulong block_size, const fdt32_t *offsets, int count,
+			uint unc_len, ulong *load_end)
+{
+	struct bootm_decomp_block *blocks;
+	ulong start, end, out_len, total;
+	int ret;
+	int i;
+
+	*load_end = load;
+	print_decomp_msg(comp, type, false);
+
+	if (!count || !block_size ||
+	    count > DIV_ROUND_UP((ulong)unc_len, block_size)) {
+		printf("Invalid compression block table: %d blocks of 0x%lx bytes\n",
+		       count, block_size);
+		return BOOTM_ERR_RESET;
+	}
+	out_len = min((ulong)count * block_size, (ulong)unc_len);
+
+	/*
+	 * Blocks may be decompressed in any order, so the output must not
+	 * overwrite any of the compressed data
+	 */
+	if (load < image_start + image_len && load + out_len > image_start) {
+		puts("ERROR: block-compressed image overlaps its load address\n");
+		return -EINVAL;
+	}
+
+	blocks = calloc(count, sizeof(*blocks));
+	if (!blocks) {
+		printf("Cannot allocate %d compression blocks\n", count);
+		return BOOTM_ERR_RESET;
+	}
+	for (i = 0; i < count; i++) {
+		start = fdt32_to_cpu(offsets[i]);
+		end = i + 1 < count ? fdt32_to_cpu(offsets[i + 1]) : image_len;
+		if (start >= end || end > image_len) {
+			printf("Invalid compression block %d\n", i);
+			ret = BOOTM_ERR_RESET;
+			goto out;
+		}
+		blocks[i].src = image_buf + start;
+		blocks[i].src_len = end - start;
+		blocks[i].dst = load_buf + i * block_size;
+		blocks[i].dst_len = min(block_size, out_len - i * block_size);
+	}
+
+	ret = arch_decomp_blocks(comp, blocks, count);
+	if (ret == -EPROTONOSUPPORT) {
+		printf("Unimplemented compression type %d\n", comp);
+		ret = BOOTM_ERR_UNIMPLEMENTED;
+		goto out;
+	}
+
+	/* Every block but the last must fill its space, so there are no gaps */
+	for (i = 0, total = 0; i < count; i++) {
+		total += blocks[i].dst_len;
+		if (!blocks[i].ret && i + 1 < count &&
+		    blocks[i].dst_len != block_size)
+			printf("Compression block %d is short\n", i);
+		if (blocks[i].ret ||
+		    (i + 1 < count && blocks[i].dst_len != block_size)) {
+			ret = handle_decomp_error(comp, total, unc_len,
+						  blocks[i].ret);
+			goto out;
+		}
+	}
+	if (ret) {
+		ret = handle_decomp_error(comp, total, unc_len, ret);
+		goto out;
+	}
+	*load_end = load + total;
+	debug("   %d blocks of 0x%lx bytes\n", count, block_size);
+	puts("OK\n");
+
+out:
+	free(blocks);
+
+	return ret;
+}
+
+/**
+ * bootm_get_comp_blocks() - get the block layout of the OS image, if any
+ *
+ * @images:	Images information
+ * @block_size:	Returns the uncompressed size of each block
+ * @offsets:	Returns the offset of each block
+ * @count:	Returns the number of blocks
+ * @return true if the OS image is block-compressed, false if not
+ */
+static bool bootm_get_comp_blocks(bootm_headers_t *images, ulong *block_size,
+				  const fdt32_t **offsets, int *count)
+{
+	if (!images->fit_hdr_os)
+		return false;
+
+	return !fit_image_get_comp_blocks(images->fit_hdr_os,
+					  images->fit_noffset_os, block_size,
+					  offsets, count);
+}
+#else
+static inline bool bootm_get_comp_blocks(bootm_headers_t *images,
+					 ulong *block_size,
+					 const fdt32_t **offsets, int *count)
+{
+	return false;
+}
+#endif /* CONFIG_FIT_COMP_BLOCKS */
+
+#if defined(CONFIG_LZ4) || defined(CONFIG_LZMA)
+#define LZ4F_MAGIC		0x184d2204
+#define LZ4F_FLG_CONTENT_SIZE	0x08
+
+/**
+ * bootm_get_unc_size() - get the decompressed size recorded in an image
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @image_buf:	Compressed data
+ * @image_len:	Number of bytes of compressed data
+ * @return decompressed size, -ENOENT if it is not recorded, -E2BIG if it is
+ *	larger than CONFIG_SYS_BOOTM_LEN
+ */
+static long bootm_get_unc_size(int comp, const u8 *image_buf, ulong image_len)
+{
+	u64 size;
+
+	switch (comp) {
+	case IH_COMP_LZ4:
+		/* An lz4 frame only has this if created with --content-size */
+		if (image_len < 14 || get_unaligned_le32(image_buf) !=
+		    LZ4F_MAGIC || !(image_buf[4] & LZ4F_FLG_CONTENT_SIZE))
+			return -ENOENT;
+		size = get_unaligned_le64(image_buf + 6);
+		break;
+	case IH_COMP_LZMA:
+		if (image_len < 13)
+			return -ENOENT;
+		size = get_unaligned_le64(image_buf + 5);
+		if (size == -1ULL)
+			return -ENOENT;
+		break;
+	default:
+		return -ENOENT;
+	}
+	if (size > CONFIG_SYS_BOOTM_LEN)
+		return -E2BIG;
+
+	return size;
+}
+
+/* Check whether two regions overlap, either of which may be empty */
+static bool bootm_overlaps(ulong start1, ulong end1, ulong start2, ulong end2)
+{
+	return start1 < end1 && start2 < end2 && start1 < end2 && start2 < end1;
+}
+
+int bootm_prep_in_place(struct lmb *lmb, int comp, ulong load,
+			ulong blob_start, ulong blob_end, ulong *image_startp,
+			ulong image_len)
+{
+	ulong image_start = *image_startp;
+	ulong image_end = image_start + image_len;
+	ulong new_start = image_start;
+	ulong end, margin;
+	void *image_buf;
+	long unc_len;
+
+	image_buf = map_sysmem(image_start, image_len);
+	unc_len = bootm_get_unc_size(comp, image_buf, image_len);
+	if (unc_len < 0)
+		return unc_len;
+
+	/* Nothing to do unless the output overwrites the image */
+	if (!bootm_overlaps(load, load + unc_len, min(blob_start, image_start),
+			    max(blob_end, image_end)))
+		return -ENOENT;
+
+	/*
+	 * The decompressor must never catch up with the data it has not yet
+	 * read, so the compressed data must end this far beyond the output.
+	 * For lz4 this covers the worst-case expansion of each block, plus
+	 * block headers and checksums. For lzma it is the bound used by the
+	 * Linux x86 boot wrapper, which also decompresses in place.
+	 */
+	if (comp == IH_COMP_LZ4)
+		margin = (unc_len >> 7) + 64;
+	else
+		margin = (unc_len >> 8) + 0x10000;
+
+	/* Move the compressed data to the end of the region, if needed */
+	end = load + unc_len + margin;
+	if (load <= image_start && image_end >= end) {
+		end = image_end;
+	} else {
+		if (end - load < image_len)
+			return -EINVAL;
+		new_start = end - image_len;
+	}
+
+	/* The rest of the containing image (e.g. a FIT) must be preserved */
+	if (bootm_overlaps(load, end, blob_start, min(blob_end, image_start)) ||
+	    bootm_overlaps(load, end, max(blob_start, image_end), blob_end))
+		return -EBUSY;
+
+	/* ...and nothing else may be using the memory */
+	if (lmb && lmb_get_free_size(lmb, load) < end - load)
+		return -ENOSPC;
+
+	if (new_start != image_start) {
+		debug("   moving image from 0x%08lx to 0x%08lx\n", image_start,
+		      new_start);
+		memmove_wd(map_sysmem(new_start, image_len), image_buf,
+			   image_len, CHUNKSZ);
+		*image_startp = new_start;
+	}
+
+	return 0;
+}
+#else
+int bootm_prep_in_place(struct lmb *lmb, int comp, ulong load,
+			ulong blob_start, ulong blob_end, ulong *image_startp,
+			ulong image_len)
+{
+	return -ENOENT;
+}
+#endif /* CONFIG_LZ4 || CONFIG_LZMA */
+
 static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 {
 	image_info_t os = images->os;
@@ -447,19 +721,49 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	ulong load_end;
 	ulong blob_start = os.start;
 	ulong blob_end = os.end;
+	ulong keep_start;
 	ulong image_start = os.image_start;
 	ulong image_len = os.image_len;
 	ulong flush_start = ALIGN_DOWN(load, ARCH_DMA_MINALIGN);
 	ulong flush_len;
-	bool no_overlap;
+	bool no_overlap, in_place, blocks;
 	void *load_buf, *image_buf;
+	const fdt32_t *offsets;
+	ulong block_size;
+	int count;
+	int span;
 	int err;
 
+	blocks = bootm_get_comp_blocks(images, &block_size, &offsets, &count);
+
+	/*
+	 * A legacy header has already been copied, so only the other images
+	 * in a multi-file image need to survive decompression
+	 */
+	keep_start = blob_start;
+	if (images->legacy_hdr_valid &&
+	    image_get_type(&images->legacy_hdr_os_copy) != IH_TYPE_MULTI)
+		keep_start = image_start;
+	in_place = !blocks &&
+		   !bootm_prep_in_place(&images->lmb, os.comp, load,
+					keep_start, blob_end, &image_start,
+					image_len);
+
 	load_buf = map_sysmem(load, 0);
-	image_buf = map_sysmem(os.image_start, image_len);
-	err = bootm_decomp_image(os.comp, load, os.image_start, os.type,
-				 load_buf, image_buf, image_len,
-				 CONFIG_SYS_BOOTM_LEN, &load_end);
+	image_buf = map_sysmem(image_start, image_len);
+	span = bootstage_span_begin("decompress", genimg_get_comp_name(os.comp));
+	if (blocks)
+		err = bootm_decomp_blocks(os.comp, load, image_start,
+					  os.type, load_buf, image_buf,
+					  image_len, block_size, offsets,
+					  count, CONFIG_SYS_BOOTM_LEN,
+					  &load_end);
+	else
+		err = bootm_decomp_image(os.comp, load, image_start,
+					 os.type, load_buf, image_buf,
+					 image_len, CONFIG_SYS_BOOTM_LEN,
+					 &load_end);
+	bootstage_span_end(span);
 	if (err) {
 		bootstage_error(BOOTSTAGE_ID_DECOMP_IMAGE);
 		return err;
@@ -474,7 +778,8 @@ static int bootm_load_os(bootm_headers_t *images, int boot_progress)
 	debug("   kernel loaded at 0x%08lx, end = 0x%08lx\n", load, load_end);
 	bootstage_mark(BOOTSTAGE_ID_KERNEL_LOADED);
 
-	no_overlap = (os.comp == IH_COMP_NONE && load == image_start);
+	no_overlap = in_place ||
+		     (os.comp == IH_COMP_NONE && load == image_start);
 
 	if (!no_overlap && load < blob_end && load_end > blob_start) {
 		debug("images.os.start = 0x%lX, images.os.end = 0x%lx\n",
@@ -599,37 +904,15 @@ static void fixup_silent_linux(void)
 }
 #endif /* CONFIG_SILENT_CONSOLE */
 
-/**
- * Execute selected states of the bootm command.
- *
- * Note the arguments to this state must be the first argument, Any 'bootm'
- * or sub-command arguments must have already been taken.
- *
- * Note that if states contains more than one flag it MUST contain
- * BOOTM_STATE_START, since this handles and consumes the command line args.
- *
- * Also note that aside from boot_os_fn functions and bootm_load_os no other
- * functions we store the return value of in 'ret' may use a negative return
- * value, without special handling.
- *
- * @param cmdtp		Pointer to bootm command table entry
- * @param flag		Command flags (CMD_FLAG_...)
- * @param argc		Number of subcommand arguments (0 = no arguments)
- * @param argv		Arguments
- * @param states	Mask containing states to run (BOOTM_STATE_...)
- * @param images	Image header information
- * @param boot_progress 1 to show boot progress, 0 to not do this
- * @return 0 if ok, something else on error. Some errors will cause this
- *	function to perform a reboot! If states contains BOOTM_STATE_OS_GO
- *	then the intent is to boot an OS, so this function will not return
- *	unless the image type is standalone.
- */
-int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
-		    int states, bootm_headers_t *images, int boot_progress)
+/* Execute selected states of the bootm command, see do_bootm_states() */
+static int bootm_run_states(cmd_tbl_t *cmdtp, int flag, int argc,
+			    char * const argv[], int states,
+			    bootm_headers_t *images, int boot_progress)
 {
 	boot_os_fn *boot_fn;
 	ulong iflag = 0;
 	int ret = 0, need_boot_fn;
+	int span;
 
 	images->state |= states;
 
@@ -640,16 +923,24 @@ int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
 	if (states & BOOTM_STATE_START)
 		ret = bootm_start(cmdtp, flag, argc, argv);
 
-	if (!ret && (states & BOOTM_STATE_FINDOS))
+	if (!ret && (states & BOOTM_STATE_FINDOS)) {
+		span = bootstage_span_begin("find", "os");
 		ret = bootm_find_os(cmdtp, flag, argc, argv);
+		bootstage_span_end(span);
+	}
 
-	if (!ret && (states & BOOTM_STATE_FINDOTHER))
+	if (!ret && (states & BOOTM_STATE_FINDOTHER)) {
+		span = bootstage_span_begin("find", "other");
 		ret = bootm_find_other(cmdtp, flag, argc, argv);
+		bootstage_span_end(span);
+	}
 
 	/* Load the OS */
 	if (!ret && (states & BOOTM_STATE_LOADOS)) {
 		iflag = bootm_disable_interrupts();
+		span = bootstage_span_begin("load", "os");
 		ret = bootm_load_os(images, 0);
+		bootstage_span_end(span);
 		if (ret && ret != BOOTM_ERR_OVERLAP)
 			goto err;
 		else if (ret == BOOTM_ERR_OVERLAP)
@@ -743,6 +1034,45 @@ err:
 	return ret;
 }
 
+/**
+ * Execute selected states of the bootm command.
+ *
+ * Note the arguments to this state must be the first argument, Any 'bootm'
+ * or sub-command arguments must have already been taken.
+ *
+ * Note that if states contains more than one flag it MUST contain
+ * BOOTM_STATE_START, since this handles and consumes the command line args.
+ *
+ * Also note that aside from boot_os_fn functions and bootm_load_os no other
+ * functions we store the return value of in 'ret' may use a negative return
+ * value, without special handling.
+ *
+ * @param cmdtp		Pointer to bootm command table entry
+ * @param flag		Command flags (CMD_FLAG_...)
+ * @param argc		Number of subcommand arguments (0 = no arguments)
+ * @param argv		Arguments
+ * @param states	Mask containing states to run (BOOTM_STATE_...)
+ * @param images	Image header information
+ * @param boot_progress 1 to show boot progress, 0 to not do this
+ * @return 0 if ok, something else on error. Some errors will cause this
+ *	function to perform a reboot! If states contains BOOTM_STATE_OS_GO
+ *	then the intent is to boot an OS, so this function will not return
+ *	unless the image type is standalone.
+ */
+int do_bootm_states(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[],
+		    int states, bootm_headers_t *images, int boot_progress)
+{
+	int span;
+	int ret;
+
+	span = bootstage_span_begin("bootm", "bootm");
+	ret = bootm_run_states(cmdtp, flag, argc, argv, states, images,
+			       boot_progress);
+	bootstage_span_end(span);
+
+	return ret;
+}
+
 #if defined(CONFIG_IMAGE_FORMAT_LEGACY)
 /**
  * image_get_kernel - verify legacy format kernel image
@@ -777,8 +1107,14 @@ static image_header_t *image_get_kernel(ulong img_addr, int verify)
 	image_print_contents(hdr);
 
 	if (verify) {
+		int span;
+		int ok;
+
 		puts("   Verifying Checksum ... ");
-		if (!image_check_dcrc(hdr)) {
+		span = bootstage_span_begin("verify", image_get_name(hdr));
+		ok = image_check_dcrc(hdr);
+		bootstage_span_end(span);
+		if (!ok) {
 			printf("Bad Data CRC\n");
 			bootstage_error(BOOTSTAGE_ID_CHECK_CHECKSUM);
 			return NULL;
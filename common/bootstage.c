@@ -10,6 +10,7 @@
  */
 
 #include <common.h>
+#include <bloblist.h>
 #include <linux/libfdt.h>
 #include <malloc.h>
 #include <linux/compiler.h>
@@ -18,6 +19,9 @@ DECLARE_GLOBAL_DATA_PTR;
 
 enum {
 	RECORD_COUNT = CONFIG_VAL(BOOTSTAGE_RECORD_COUNT),
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	SPAN_COUNT = CONFIG_BOOTSTAGE_SPAN_COUNT,
+#endif
 };
 
 struct bootstage_record {
@@ -32,12 +36,19 @@ struct bootstage_data {
 	uint rec_count;
 	uint next_id;
 	struct bootstage_record record[RECORD_COUNT];
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	struct bootstage_span *span;	/* Allocated after relocation */
+	int span_count;
+	int span_cur;		/* Innermost open span, or -1 if none */
+	uint span_dropped;	/* Spans not recorded due to lack of space */
+#endif
 };
 
 enum {
 	BOOTSTAGE_VERSION	= 0,
 	BOOTSTAGE_MAGIC		= 0xb00757a3,
 	BOOTSTAGE_DIGITS	= 9,
+	JSON_SLACK		= 64,	/* Extra space for JSON output */
 };
 
 struct bootstage_hdr {
@@ -60,6 +71,13 @@ int bootstage_relocate(void)
 	for (i = 0; i < data->rec_count; i++)
 		data->record[i].name = strdup(data->record[i].name);
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	/* Spans are only recorded from now on, when there is space for them */
+	data->span = calloc(SPAN_COUNT, sizeof(*data->span));
+	data->span_count = 0;
+	data->span_cur = -1;
+#endif
+
 	return 0;
 }
 
@@ -195,6 +213,213 @@ uint32_t bootstage_accum(enum bootstage_id id)
 	return duration;
 }
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+int bootstage_span_begin(const char *cat, const char *name)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_span *span;
+	int id;
+
+	if (!data || !data->span)
+		return -ENOSYS;
+	if (data->span_count == SPAN_COUNT) {
+		data->span_dropped++;
+		return -ENOSPC;
+	}
+	id = data->span_count++;
+	span = &data->span[id];
+	span->start_us = timer_get_boot_us();
+	span->duration_us = 0;
+	span->bytes = 0;
+	span->cat = cat;
+	span->parent = data->span_cur;
+	span->depth = span->parent < 0 ? 0 : data->span[span->parent].depth + 1;
+	span->open = true;
+	/* The name may not be terminated, e.g. in a legacy image header */
+	strncpy(span->name, name, sizeof(span->name) - 1);
+	span->name[sizeof(span->name) - 1] = '\0';
+	data->span_cur = id;
+
+	return id;
+}
+
+static void span_close(struct bootstage_span *span, uint32_t now)
+{
+	span->duration_us = now - span->start_us;
+	span->open = false;
+}
+
+void bootstage_span_end(int id)
+{
+	struct bootstage_data *data = gd->bootstage;
+	uint32_t now;
+	int cur;
+
+	if (id < 0 || !data || id >= data->span_count || !data->span[id].open)
+		return;
+
+	/* The open spans are the current one and those it is inside */
+	now = timer_get_boot_us();
+	for (cur = data->span_cur; cur != id; cur = data->span[cur].parent)
+		span_close(&data->span[cur], now);
+	span_close(&data->span[id], now);
+	data->span_cur = data->span[id].parent;
+}
+
+void bootstage_span_add_bytes(ulong bytes)
+{
+	struct bootstage_data *data = gd->bootstage;
+	int cur;
+
+	if (!data || !data->span)
+		return;
+	for (cur = data->span_cur; cur >= 0; cur = data->span[cur].parent)
+		data->span[cur].bytes += bytes;
+}
+
+const struct bootstage_span *bootstage_span_get(int id)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (id < 0 || !data || id >= data->span_count)
+		return NULL;
+
+	return &data->span[id];
+}
+
+void bootstage_span_clear(void)
+{
+	struct bootstage_data *data = gd->bootstage;
+
+	if (data) {
+		data->span_count = 0;
+		data->span_cur = -1;
+		data->span_dropped = 0;
+	}
+}
+
+/* Get the duration of a span, up to now if it is still open */
+static uint32_t span_duration(const struct bootstage_span *span, uint32_t now)
+{
+	return span->open ? now - span->start_us : span->duration_us;
+}
+
+static int h_compare_u32(const void *v1, const void *v2)
+{
+	uint32_t val1 = *(uint32_t *)v1, val2 = *(uint32_t *)v2;
+
+	return val1 < val2 ? -1 : val1 > val2;
+}
+
+/**
+ * struct span_stats - statistics for the spans in a category
+ *
+ * @count: Number of spans
+ * @total_us: Total duration
+ * @pct_us: 50th, 90th and 99th percentile durations
+ * @max_us: Longest duration
+ */
+struct span_stats {
+	uint count;
+	ulong total_us;
+	uint32_t pct_us[3];
+	uint32_t max_us;
+};
+
+static const int span_pct[] = {50, 90, 99};
+
+/**
+ * get_span_stats() - Get statistics for the spans in a category
+ *
+ * @data:	Bootstage data
+ * @first:	Index of the first span in the category
+ * @now:	Current time, for spans which are still open
+ * @stats:	Returns the statistics
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+static int get_span_stats(struct bootstage_data *data, int first,
+			  uint32_t now, struct span_stats *stats)
+{
+	const char *cat = data->span[first].cat;
+	uint32_t *dur;
+	int i, n;
+
+	dur = malloc((data->span_count - first) * sizeof(*dur));
+	if (!dur)
+		return -ENOMEM;
+	memset(stats, '\0', sizeof(*stats));
+	for (i = first, n = 0; i < data->span_count; i++) {
+		if (!strcmp(data->span[i].cat, cat)) {
+			dur[n] = span_duration(&data->span[i], now);
+			stats->total_us += dur[n++];
+		}
+	}
+	qsort(dur, n, sizeof(*dur), h_compare_u32);
+	stats->count = n;
+	for (i = 0; i < ARRAY_SIZE(span_pct); i++)
+		stats->pct_us[i] = dur[(n - 1) * span_pct[i] / 100];
+	stats->max_us = dur[n - 1];
+	free(dur);
+
+	return 0;
+}
+
+/* Check if a span is the first in its category */
+static bool span_first_in_cat(struct bootstage_data *data, int id)
+{
+	int i;
+
+	for (i = 0; i < id; i++) {
+		if (!strcmp(data->span[i].cat, data->span[id].cat))
+			return false;
+	}
+
+	return true;
+}
+
+static void span_report(struct bootstage_data *data)
+{
+	struct bootstage_span *span;
+	struct span_stats stats;
+	uint32_t now;
+	int i;
+
+	if (!data->span)
+		return;
+	now = timer_get_boot_us();
+	printf("\nSpans (%d records, %u dropped):\n", data->span_count,
+	       data->span_dropped);
+	printf("%11s%11s%11s  %s\n", "Start", "Elapsed", "Bytes", "Span");
+	for (i = 0, span = data->span; i < data->span_count; i++, span++) {
+		print_grouped_ull(span->start_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(span_duration(span, now), BOOTSTAGE_DIGITS);
+		print_grouped_ull(span->bytes, BOOTSTAGE_DIGITS);
+		printf("  %*s%s: %s%s\n", span->depth * 2, "", span->cat,
+		       span->name, span->open ? " (open)" : "");
+	}
+
+	printf("\nSpan statistics:\n");
+	printf("%6s%11s%11s%11s%11s%11s  %s\n", "Count", "Total", "p50", "p90",
+	       "p99", "Max", "Category");
+	for (i = 0; i < data->span_count; i++) {
+		if (!span_first_in_cat(data, i) ||
+		    get_span_stats(data, i, now, &stats))
+			continue;
+		printf("%6u", stats.count);
+		print_grouped_ull(stats.total_us, BOOTSTAGE_DIGITS);
+		print_grouped_ull(stats.pct_us[0], BOOTSTAGE_DIGITS);
+		print_grouped_ull(stats.pct_us[1], BOOTSTAGE_DIGITS);
+		print_grouped_ull(stats.pct_us[2], BOOTSTAGE_DIGITS);
+		print_grouped_ull(stats.max_us, BOOTSTAGE_DIGITS);
+		printf("  %s\n", data->span[i].cat);
+	}
+}
+#else
+static inline void span_report(struct bootstage_data *data)
+{
+}
+#endif /* BOOTSTAGE_SPANS */
+
 /**
  * Get a record name as a printable string
  *
@@ -292,6 +517,21 @@ static int add_bootstages_devicetree(struct fdt_header *blob)
 			return -EINVAL;
 	}
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	/* The spans do not fit the format above, so add them as JSON */
+	if (data->span) {
+		char *json;
+		int len;
+
+		len = bootstage_json(NULL, 0) + JSON_SLACK;
+		json = malloc(len);
+		if (json && bootstage_json(json, len) < len &&
+		    fdt_setprop_string(blob, bootstage, "json", json))
+			debug("%s: No space for bootstage JSON\n", __func__);
+		free(json);
+	}
+#endif
+
 	return 0;
 }
 
@@ -334,7 +574,161 @@ void bootstage_report(void)
 		if (rec->start_us)
 			prev = print_time_record(rec, -1);
 	}
+	span_report(data);
+}
+
+#ifndef CONFIG_SPL_BUILD
+/**
+ * json_add() - Add formatted text to a JSON buffer
+ *
+ * Like append_data(), this writes the text if there is space and always
+ * moves the pointer on.
+ *
+ * @ptrp:	Pointer to buffer, updated by this function
+ * @end:	Pointer to end of buffer
+ * @fmt:	printf() format string
+ */
+static void json_add(char **ptrp, char *end, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = vsnprintf(*ptrp, *ptrp < end ? end - *ptrp : 0, fmt, args);
+	va_end(args);
+	*ptrp += len;
+}
+
+/* Add a JSON string, escaping characters as needed */
+static void json_add_str(char **ptrp, char *end, const char *str)
+{
+	json_add(ptrp, end, "\"");
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			json_add(ptrp, end, "\\%c", *str);
+		else if ((uchar)*str < ' ')
+			json_add(ptrp, end, "\\u%04x", *str);
+		else
+			json_add(ptrp, end, "%c", *str);
+	}
+	json_add(ptrp, end, "\"");
+}
+
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+/*
+ * Add the spans as a tree, using the depth of each to tell when to start
+ * and finish the list of children of the span before it
+ */
+static void json_add_spans(char **ptrp, char *end,
+			   struct bootstage_data *data, uint32_t now)
+{
+	struct bootstage_span *span;
+	struct span_stats stats;
+	int i, depth = -1;
+
+	json_add(ptrp, end, ",\"spans_dropped\":%u,\"spans\":[",
+		 data->span_dropped);
+	for (i = 0, span = data->span; i < data->span_count; i++, span++) {
+		if (span->depth > depth) {
+			if (depth >= 0)
+				json_add(ptrp, end, ",\"children\":[");
+		} else {
+			json_add(ptrp, end, "}");
+			for (; depth > span->depth; depth--)
+				json_add(ptrp, end, "]}");
+			json_add(ptrp, end, ",");
+		}
+		depth = span->depth;
+		json_add(ptrp, end, "{\"name\":");
+		json_add_str(ptrp, end, span->name);
+		json_add(ptrp, end, ",\"cat\":");
+		json_add_str(ptrp, end, span->cat);
+		json_add(ptrp, end,
+			 ",\"start_us\":%u,\"duration_us\":%u,\"bytes\":%lu",
+			 span->start_us, span_duration(span, now), span->bytes);
+		if (span->open)
+			json_add(ptrp, end, ",\"open\":true");
+	}
+	if (depth >= 0) {
+		json_add(ptrp, end, "}");
+		for (; depth > 0; depth--)
+			json_add(ptrp, end, "]}");
+	}
+	json_add(ptrp, end, "],\"span_stats\":{");
+	for (i = 0, depth = 0; i < data->span_count; i++) {
+		if (!span_first_in_cat(data, i) ||
+		    get_span_stats(data, i, now, &stats))
+			continue;
+		json_add(ptrp, end, "%s", depth++ ? "," : "");
+		json_add_str(ptrp, end, data->span[i].cat);
+		json_add(ptrp, end,
+			 ":{\"count\":%u,\"total_us\":%lu,\"p50_us\":%u,\"p90_us\":%u,\"p99_us\":%u,\"max_us\":%u}",
+			 stats.count, stats.total_us, stats.pct_us[0],
+			 stats.pct_us[1], stats.pct_us[2], stats.max_us);
+	}
+	json_add(ptrp, end, "}");
+}
+#endif
+
+int bootstage_json(char *buf, int size)
+{
+	struct bootstage_data *data = gd->bootstage;
+	struct bootstage_record *rec;
+	char *ptr = buf, *end = buf + size;
+	uint32_t now = timer_get_boot_us();
+	char name[20];
+	int accum, i, count;
+
+	json_add(&ptr, end, "{\"version\":1,\"time_us\":%u", now);
+	for (accum = 0; accum < 2; accum++) {
+		json_add(&ptr, end, accum ? ",\"accum\":[" : ",\"marks\":[");
+		for (i = 0, count = 0, rec = data->record; i < data->rec_count;
+		     i++, rec++) {
+			if (!!rec->start_us != accum ||
+			    (rec->id != BOOTSTAGE_ID_AWAKE && !rec->time_us))
+				continue;
+			json_add(&ptr, end, "%s{\"id\":%d,\"name\":",
+				 count++ ? "," : "", rec->id);
+			json_add_str(&ptr, end,
+				     get_record_name(name, sizeof(name), rec));
+			json_add(&ptr, end, ",\"time_us\":%lu}", rec->time_us);
+		}
+		json_add(&ptr, end, "]");
+	}
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+	if (data->span)
+		json_add_spans(&ptr, end, data, now);
+#endif
+	json_add(&ptr, end, "}");
+
+	return ptr - buf;
+}
+
+int bootstage_bloblist_add_report(void)
+{
+#if CONFIG_IS_ENABLED(BLOBLIST)
+	char *buf;
+	int len, ret;
+
+	if (!gd->bloblist)
+		return 0;
+	/* Allow for the times getting longer before the second call */
+	len = bootstage_json(NULL, 0) + JSON_SLACK;
+	ret = bloblist_ensure_size(BLOBLISTT_BOOTSTAGE_JSON, len,
+				   (void **)&buf);
+	if (ret) {
+		debug("Cannot add bootstage to bloblist (err=%d)\n", ret);
+		return ret;
+	}
+	if (bootstage_json(buf, len) >= len)
+		return -ENOSPC;
+
+	return bloblist_finish();
+#else
+	return 0;
+#endif
 }
+#endif /* !CONFIG_SPL_BUILD */
 
 /**
  * Append data to a memory buffer
@@ -134,8 +134,15 @@ int do_run(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 			return 1;
 		}
 
+#if CONFIG_IS_ENABLED(HUSH_SCRIPT_CACHE)
+		if (parse_script_outer(argv[i], arg, FLAG_PARSE_SEMICOLON |
+				       FLAG_EXIT_FROM_LOOP |
+				       FLAG_CONT_ON_NEWLINE) != 0)
+			return 1;
+#else
 		if (run_command(arg, flag | CMD_FLAG_ENV) != 0)
 			return 1;
+#endif
 	}
 	return 0;
 }
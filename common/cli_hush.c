@@ -83,6 +83,8 @@
 #include <cli.h>
 #include <cli_hush.h>
 #include <command.h>        /* find_cmd */
+#include <environment.h>
+#include <linux/list.h>
 #ifndef CONFIG_SYS_PROMPT_HUSH_PS2
 #define CONFIG_SYS_PROMPT_HUSH_PS2	"> "
 #endif
@@ -1588,6 +1590,9 @@ static int run_pipe_real(struct pipe *pi)
 #endif
 		return rcode;
 	} else if (pi->num_progs == 1 && pi->progs[0].argv != NULL) {
+		/* The pipe may be run again, so leave child->sp alone */
+		int sp = child->sp;
+
 		for (i=0; is_assignment(child->argv[i]); i++) { /* nothing */ }
 		if (i!=0 && child->argv[i]==NULL) {
 			/* assignments, but no command: set the local environment */
@@ -1626,11 +1631,11 @@ static int run_pipe_real(struct pipe *pi)
 			set_local_var(p, 0);
 #endif
 			if (p != child->argv[i]) {
-				child->sp--;
+				sp--;
 				free(p);
 			}
 		}
-		if (child->sp) {
+		if (sp) {
 			char * str = NULL;
 
 			str = make_string(child->argv + i,
@@ -1763,6 +1768,7 @@ static int run_list_real(struct pipe *pi)
 	char *save_name = NULL;
 	char **list = NULL;
 	char **save_list = NULL;
+	struct pipe *for_pi = NULL;
 	struct pipe *rpipe;
 	int flag_rep = 0;
 #ifndef __U_BOOT__
@@ -1802,7 +1808,8 @@ static int run_list_real(struct pipe *pi)
 				/* check Ctrl-C */
 				ctrlc();
 				if ((had_ctrlc())) {
-					return 1;
+					rcode = 1;
+					goto out;
 				}
 #endif
 				flag_restore = 0;
@@ -1831,6 +1838,7 @@ static int run_list_real(struct pipe *pi)
 				list = make_list_in(pi->next->progs->argv,
 					pi->progs->argv[0]);
 				save_list = list;
+				for_pi = pi;
 				save_name = pi->progs->argv[0];
 				pi->progs->argv[0] = NULL;
 				flag_rep = 1;
@@ -1902,7 +1910,8 @@ static int run_list_real(struct pipe *pi)
 #else
 		if (rcode < -1) {
 			last_return_code = -rcode - 2;
-			return -2;	/* exit */
+			rcode = -2;	/* exit */
+			goto out;
 		}
 		last_return_code=(rcode == 0) ? 0 : 1;
 #endif
@@ -1922,6 +1931,17 @@ static int run_list_real(struct pipe *pi)
 		checkjobs(NULL);
 #endif
 	}
+#ifdef __U_BOOT__
+out:
+	/* Put back the loop variable if we left a "for" loop early */
+	if (list) {
+		while (*list)
+			free(*list++);
+		free(for_pi->progs->argv[0]);
+		free(save_list);
+		for_pi->progs->argv[0] = save_name;
+	}
+#endif
 	return rcode;
 }
 
@@ -3283,6 +3303,223 @@ int parse_string_outer(const char *s, int flag)
 #endif
 }
 
+#if CONFIG_IS_ENABLED(HUSH_SCRIPT_CACHE)
+/* Number of scripts kept, dropping the least recently run */
+#define SCRIPT_CACHE_SIZE	32
+
+/**
+ * struct script - Commands parsed from an environment variable
+ *
+ * @sibling: Node in script_cache, the most recently run first
+ * @name: Name of the variable
+ * @text: Commands as they were when parsed
+ * @len: Length of @text
+ * @hash: Hash of @text
+ * @flag: Flags the commands were parsed with (FLAG_...)
+ * @list: Parsed commands
+ * @users: Number of runs of @list in progress
+ * @stale: true if the variable has changed, so the script is freed as soon as
+ *	it is no longer running
+ */
+struct script {
+	struct list_head sibling;
+	char *name;
+	char *text;
+	int len;
+	uint hash;
+	int flag;
+	struct pipe *list;
+	int users;
+	bool stale;
+};
+
+static LIST_HEAD(script_cache);
+static int script_count;
+static uint script_parses;
+
+/* FNV-1a, as used for the environment's hash table */
+static uint script_hash(const char *s, int len)
+{
+	uint hash = 2166136261U;
+
+	while (len--)
+		hash = (hash ^ (uchar)*s++) * 16777619;
+
+	return hash;
+}
+
+static void script_free(struct script *scr)
+{
+	list_del(&scr->sibling);
+	script_count--;
+	free_pipe_list(scr->list, 0);
+	free(scr->name);
+	free(scr->text);
+	free(scr);
+}
+
+/* Drop a script from the cache, once any runs of it have finished */
+static void script_drop(struct script *scr)
+{
+	if (scr->users)
+		scr->stale = true;
+	else
+		script_free(scr);
+}
+
+static struct script *script_find(const char *name)
+{
+	struct script *scr;
+
+	list_for_each_entry(scr, &script_cache, sibling) {
+		if (!scr->stale && !strcmp(scr->name, name))
+			return scr;
+	}
+
+	return NULL;
+}
+
+/*
+ * Parse the commands in @s as parse_stream_outer() would, but without running
+ * them. Returns 0 if OK, 1 on a syntax error
+ */
+static int script_parse(const char *s, int flag, struct pipe **listp)
+{
+	struct p_context ctx;
+	o_string temp = NULL_O_STRING;
+	struct in_str input;
+	char *p;
+	int rcode;
+
+	script_parses++;
+	if (!(p = strchr(s, '\n')) || *++p) {
+		p = xmalloc(strlen(s) + 2);
+		strcpy(p, s);
+		strcat(p, "\n");
+		setup_string_in_str(&input, p);
+	} else {
+		p = NULL;
+		setup_string_in_str(&input, s);
+	}
+	ctx.type = flag;
+	initialize_context(&ctx);
+	update_ifs_map();
+	if (!(flag & FLAG_PARSE_SEMICOLON) || (flag & FLAG_REPARSING))
+		mapset((uchar *)";$&|", 0);
+	input.promptmode = 1;
+	rcode = parse_stream(&temp, &ctx, &input,
+			     flag & FLAG_CONT_ON_NEWLINE ? -1 : '\n');
+	if (rcode != 1 && ctx.old_flag != 0)
+		syntax();
+	if (rcode != 1 && ctx.old_flag == 0) {
+		done_word(&temp, &ctx);
+		done_pipe(&ctx, PIPE_SEQ);
+		*listp = ctx.list_head;
+		rcode = 0;
+	} else {
+		flag_repeat = 0;
+		if (ctx.old_flag != 0)
+			free(ctx.stack);
+		free_pipe_list(ctx.list_head, 0);
+		rcode = 1;
+	}
+	b_free(&temp);
+	free(p);
+
+	return rcode;
+}
+
+/* Tell the cache when a script it holds is changed or deleted */
+static int on_script(const char *name, const char *value, enum env_op op,
+		     int flags)
+{
+	struct script *scr = script_find(name);
+
+	if (scr)
+		script_drop(scr);
+
+	return 0;
+}
+U_BOOT_ENV_CALLBACK(script, on_script);
+
+int parse_script_outer(const char *name, const char *s, int flag)
+{
+	struct script *scr, *old;
+	struct pipe *list;
+	int len, code;
+	uint hash;
+
+	if (!*s)
+		return 0;
+	len = strlen(s);
+	hash = script_hash(s, len);
+	scr = script_find(name);
+	if (scr && (scr->hash != hash || scr->len != len ||
+		    scr->flag != flag || memcmp(scr->text, s, len))) {
+		script_drop(scr);
+		scr = NULL;
+	}
+
+	/* A script which runs itself needs its own copy of the commands */
+	if (scr && scr->users) {
+		script_parses++;
+		return parse_string_outer(s, flag);
+	}
+
+	if (scr) {
+		list_move(&scr->sibling, &script_cache);
+	} else {
+		if (script_parse(s, flag, &list))
+			return 1;
+		scr = xmalloc(sizeof(*scr));
+		memset(scr, '\0', sizeof(*scr));
+		scr->name = xstrdup(name);
+		scr->text = xstrdup(s);
+		scr->len = len;
+		scr->hash = hash;
+		scr->flag = flag;
+		scr->list = list;
+		list_add(&scr->sibling, &script_cache);
+		if (++script_count > SCRIPT_CACHE_SIZE) {
+			list_for_each_entry_reverse(old, &script_cache,
+						    sibling) {
+				if (old != scr && !old->users) {
+					script_free(old);
+					break;
+				}
+			}
+		}
+		/* Hear of changes, unless the variable has another callback */
+		env_callback_attach(name, "script");
+	}
+
+	scr->users++;
+	code = run_list_real(scr->list);
+	if (!--scr->users && scr->stale)
+		script_free(scr);
+
+	if (code == -2)		/* exit */
+		code = 0;
+	if (code == -1)
+		flag_repeat = 0;
+
+	return (code != 0) ? 1 : 0;
+}
+
+void parse_script_flush(void)
+{
+	struct script *scr, *next;
+
+	list_for_each_entry_safe(scr, next, &script_cache, sibling)
+		script_drop(scr);
+}
+
+uint parse_script_count(void)
+{
+	return script_parses;
+}
+#endif /* HUSH_SCRIPT_CACHE */
+
 #ifndef __U_BOOT__
 static int parse_file_outer(FILE *f)
 #else
@@ -488,6 +488,28 @@ static inline void pre_console_puts(const char *s) {}
 static inline void print_pre_console_buffer(int flushpoint) {}
 #endif
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE)
+/*
+ * Add the time taken to send console output to the bootstage report. This is
+ * only done for whole strings, since timing each character would cost more
+ * than sending it.
+ */
+static void console_time_start(void)
+{
+	if (gd->bootstage)
+		bootstage_start(BOOTSTAGE_ID_ACCUM_CONSOLE, "console_out");
+}
+
+static void console_time_end(void)
+{
+	if (gd->bootstage)
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_CONSOLE);
+}
+#else
+static inline void console_time_start(void) {}
+static inline void console_time_end(void) {}
+#endif
+
 void putc(const char c)
 {
 #ifdef CONFIG_SANDBOX
@@ -573,7 +595,9 @@ void puts(const char *s)
 
 	if (gd->flags & GD_FLG_DEVINIT) {
 		/* Send to the standard output */
+		console_time_start();
 		fputs(stdout, s);
+		console_time_end();
 	} else {
 		/* Send directly to the handler */
 		pre_console_puts(s);
@@ -357,6 +357,13 @@ nextchunk-> +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
 #define MALLOC_ALIGN_MASK      (MALLOC_ALIGNMENT - 1)
 #define MINSIZE                (sizeof(struct malloc_chunk))
 
+/* memalign() splits the chunk it is given, so must not be given a slab block */
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+#define MEMALIGN_MIN           ((size_t)MALLOC_SLAB_MAX + 1)
+#else
+#define MEMALIGN_MIN           ((size_t)0)
+#endif
+
 /* conversion from malloc headers to user pointers, and back */
 
 #define chunk2mem(p)   ((Void_t*)((char*)(p) + 2*SIZE_SZ))
@@ -1267,6 +1274,15 @@ Void_t* mALLOc(bytes) size_t bytes;
 
   if ((long)bytes < 0) return NULL;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	if (bytes <= MALLOC_SLAB_MAX) {
+		Void_t *mem = malloc_slab(bytes);
+
+		if (mem)
+			return mem;
+	}
+#endif
+
   nb = request2size(bytes);  /* padded request size; */
 
   /* Check for exact match in a bin */
@@ -1523,14 +1539,25 @@ void fREe(mem) Void_t* mem;
   int       islr;      /* track whether merging with last_remainder */
 
 #if CONFIG_VAL(SYS_MALLOC_F_LEN)
-	/* free() is a no-op - all the memory will be freed on relocation */
-	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT)) {
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+		free_simple(mem);
+#endif
+		/* otherwise all the memory will be freed on relocation */
 		return;
+	}
 #endif
 
   if (mem == NULL)                              /* free(0) has no effect */
     return;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	if (malloc_slab_owns(mem)) {
+		free_slab(mem);
+		return;
+	}
+#endif
+
   p = mem2chunk(mem);
   hd = p->size;
 
@@ -1689,6 +1716,20 @@ Void_t* rEALLOc(oldmem, bytes) Void_t* oldmem; size_t bytes;
 	}
 #endif
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	if (malloc_slab_owns(oldmem)) {
+		oldsize = malloc_slab_usable_size(oldmem);
+		if (bytes <= oldsize)
+			return oldmem;
+		newmem = mALLOc(bytes);
+		if (!newmem)
+			return NULL;
+		memcpy(newmem, oldmem, oldsize);
+		free_slab(oldmem);
+		return newmem;
+	}
+#endif
+
   newp    = oldp    = mem2chunk(oldmem);
   newsize = oldsize = chunksize(oldp);
 
@@ -1909,7 +1950,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
   /* Call malloc with worst case padding to hit alignment. */
 
   nb = request2size(bytes);
-  m  = (char*)(mALLOc(nb + alignment + MINSIZE));
+  m  = (char*)(mALLOc(max(nb + alignment + MINSIZE, MEMALIGN_MIN)));
 
   /*
   * The attempt to over-allocate (with a size large enough to guarantee the
@@ -1925,7 +1966,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
      * Use bytes not nb, since mALLOc internally calls request2size too, and
      * each call increases the size to allocate, to account for the header.
      */
-    m  = (char*)(mALLOc(bytes));
+    m  = (char*)(mALLOc(max(bytes, MEMALIGN_MIN)));
     /* Aligned -> return it */
     if ((((unsigned long)(m)) % alignment) == 0)
       return m;
@@ -1936,7 +1977,7 @@ Void_t* mEMALIGn(alignment, bytes) size_t alignment; size_t bytes;
     fREe(m);
     /* Add in extra bytes to match misalignment of unexpanded allocation */
     extra = alignment - (((unsigned long)(m)) % alignment);
-    m  = (char*)(mALLOc(bytes + extra));
+    m  = (char*)(mALLOc(max(bytes + extra, MEMALIGN_MIN)));
     /*
      * m might not be the same as before. Validate that the previous value of
      * extra still works for the current value of m.
@@ -2090,6 +2131,12 @@ Void_t* cALLOc(n, elem_size) size_t n; size_t elem_size;
 		MALLOC_ZERO(mem, sz);
 		return mem;
 	}
+#endif
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+	if (malloc_slab_owns(mem)) {
+		memset(mem, '\0', sz);
+		return mem;
+	}
 #endif
     p = mem2chunk(mem);
 
@@ -2238,6 +2285,10 @@ size_t malloc_usable_size(mem) Void_t* mem;
   mchunkptr p;
   if (mem == NULL)
     return 0;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  else if (malloc_slab_owns(mem))
+    return malloc_slab_usable_size(mem);
+#endif
   else
   {
     p = mem2chunk(mem);
@@ -2337,8 +2388,14 @@ void malloc_stats()
 #ifdef DEBUG
 struct mallinfo mALLINFo()
 {
+  struct mallinfo info;
+
   malloc_update_mallinfo();
-  return current_mallinfo;
+  info = current_mallinfo;
+#if CONFIG_IS_ENABLED(SYS_MALLOC_SLAB)
+  malloc_slab_adjust_info(&info);
+#endif
+  return info;
 }
 #endif	/* DEBUG */
 
@@ -2390,6 +2447,7 @@ int initf_malloc(void)
 	assert(gd->malloc_base);	/* Set up by crt0.S */
 	gd->malloc_limit = CONFIG_VAL(SYS_MALLOC_F_LEN);
 	gd->malloc_ptr = 0;
+	gd->malloc_free = 0;
 #endif
 
 	return 0;
@@ -7,6 +7,7 @@
  */
 
 #include <common.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <stdio_dev.h>
 #include <linux/ctype.h>
@@ -302,6 +303,309 @@ int fdt_chosen(void *fdt)
 	return fdt_fixup_stdout(fdt, nodeoffset);
 }
 
+void fdt_fixup_start(struct fdt_fixup *fix, void *blob)
+{
+	memset(fix, '\0', sizeof(*fix));
+	fix->blob = blob;
+}
+
+int fdt_fixup_setprop(struct fdt_fixup *fix, int node, const char *name,
+		      const void *val, int len)
+{
+	struct fdt_fixup_prop *prop, *props;
+	const struct fdt_property *old;
+	int oldlen, grow;
+
+	if (fix->err)
+		return fix->err;
+	if (fix->count == fix->max) {
+		props = realloc(fix->props,
+				sizeof(*props) * (fix->max * 2 + 8));
+		if (!props)
+			goto nomem;
+		fix->props = props;
+		fix->max = fix->max * 2 + 8;
+	}
+	prop = &fix->props[fix->count];
+	prop->val = malloc(len);
+	if (!prop->val)
+		goto nomem;
+	memcpy(prop->val, val, len);
+	prop->node = node;
+	prop->seq = fix->count++;
+	prop->name = name;
+	prop->len = len;
+
+	/* Allow for the name being added to the strings, if it is new */
+	old = fdt_get_property(fix->blob, node, name, &oldlen);
+	if (old) {
+		grow = ALIGN(len, FDT_TAGSIZE) - ALIGN(oldlen, FDT_TAGSIZE);
+		if (grow > 0)
+			fix->space += grow;
+	} else {
+		fix->space += sizeof(*old) + ALIGN(len, FDT_TAGSIZE) +
+			strlen(name) + 1;
+	}
+
+	return 0;
+nomem:
+	fix->err = -FDT_ERR_NOSPACE;
+
+	return fix->err;
+}
+
+int fdt_fixup_by_path(struct fdt_fixup *fix, const char *path,
+		      const char *prop, const void *val, int len, int create)
+{
+	int node;
+
+	if (fix->err)
+		return fix->err;
+	node = fdt_path_offset(fix->blob, path);
+	if (node < 0)
+		return node;
+	if (!create && !fdt_get_property(fix->blob, node, prop, NULL))
+		return 0;
+
+	return fdt_fixup_setprop(fix, node, prop, val, len);
+}
+
+int fdt_fixup_by_compat(struct fdt_fixup *fix, const char *compat,
+			const char *prop, const void *val, int len, int create)
+{
+	int node, ret;
+
+	for (node = fdt_node_offset_by_compatible(fix->blob, -1, compat);
+	     node >= 0;
+	     node = fdt_node_offset_by_compatible(fix->blob, node, compat)) {
+		if (!create && !fdt_get_property(fix->blob, node, prop, NULL))
+			continue;
+		ret = fdt_fixup_setprop(fix, node, prop, val, len);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Order changes as their nodes appear in the tree, otherwise as added */
+static int fdt_fixup_cmp(const void *a, const void *b)
+{
+	const struct fdt_fixup_prop *pa = a, *pb = b;
+
+	if (pa->node != pb->node)
+		return pa->node - pb->node;
+
+	return pa->seq - pb->seq;
+}
+
+/* Find a name in the strings block being built, adding it if needed */
+static int fdt_fixup_string(char *strings, int *size, const char *name)
+{
+	int len = strlen(name) + 1;
+	const char *p;
+
+	for (p = strings; p < strings + *size; p += strlen(p) + 1) {
+		if (!strcmp(p, name))
+			return p - strings;
+	}
+	memcpy(strings + *size, name, len);
+	*size += len;
+
+	return *size - len;
+}
+
+static char *fdt_fixup_emit(char *p, int nameoff, const void *val, int len)
+{
+	struct fdt_property *prop = (struct fdt_property *)p;
+
+	prop->tag = cpu_to_fdt32(FDT_PROP);
+	prop->len = cpu_to_fdt32(len);
+	prop->nameoff = cpu_to_fdt32(nameoff);
+	memcpy(prop->data, val, len);
+	memset(prop->data + len, '\0', ALIGN(len, FDT_TAGSIZE) - len);
+
+	return p + sizeof(*prop) + ALIGN(len, FDT_TAGSIZE);
+}
+
+/*
+ * Find the last change to property @name among @count changes to a node,
+ * marking all the changes to it as done
+ */
+static struct fdt_fixup_prop *fdt_fixup_find(struct fdt_fixup_prop *props,
+					     int count, const char *name)
+{
+	struct fdt_fixup_prop *found = NULL;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (props[i].name && !strcmp(props[i].name, name)) {
+			found = &props[i];
+			props[i].name = NULL;
+		}
+	}
+
+	return found;
+}
+
+/* Add the properties which a node does not have yet */
+static char *fdt_fixup_add(char *p, struct fdt_fixup_prop *props, int count,
+			   char *strings, int *strings_size)
+{
+	struct fdt_fixup_prop *prop;
+	const char *name;
+	int nameoff, i;
+
+	for (i = 0; i < count; i++) {
+		name = props[i].name;
+		if (!name)
+			continue;
+		prop = fdt_fixup_find(props + i, count - i, name);
+		nameoff = fdt_fixup_string(strings, strings_size, name);
+		p = fdt_fixup_emit(p, nameoff, prop->val, prop->len);
+	}
+
+	return p;
+}
+
+/*
+ * Make the changes with fdt_setprop(), for when they need no more space or
+ * there is only one. Nodes are changed from the end of the tree back, so that
+ * changing one does not move those still waiting.
+ */
+static int fdt_fixup_apply_inplace(struct fdt_fixup *fix)
+{
+	struct fdt_fixup_prop *props = fix->props, *prop;
+	int first, last, ret;
+
+	for (last = fix->count; last > 0; last = first) {
+		for (first = last - 1;
+		     first && props[first - 1].node == props[last - 1].node;
+		     first--)
+			;
+		for (prop = props + first; prop < props + last; prop++) {
+			ret = fdt_setprop(fix->blob, prop->node, prop->name,
+					  prop->val, prop->len);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+int fdt_fixup_apply(struct fdt_fixup *fix)
+{
+	struct fdt_fixup_prop *props = fix->props, *end = props + fix->count;
+	struct fdt_fixup_prop *node_props = NULL, *prop;
+	const struct fdt_property *old;
+	int hdr_size, rsv_size, struct_size, strings_size, size;
+	int offset, next, node_count = 0, i;
+	void *blob = fix->blob;
+	char *buf, *p, *strings;
+	int ret = fix->err;
+	uint32_t tag;
+
+	if (ret || !fix->count)
+		goto out;
+	ret = fdt_check_header(blob);
+	if (ret)
+		goto out;
+	if (fdt_version(blob) < 17) {
+		ret = -FDT_ERR_BADVERSION;
+		goto out;
+	}
+	qsort(props, fix->count, sizeof(*prop), fdt_fixup_cmp);
+	if (!fix->space || fix->count == 1) {
+		ret = fdt_fixup_apply_inplace(fix);
+		goto out;
+	}
+
+	/* Build the new tree in one pass, copying whatever is not changed */
+	hdr_size = ALIGN(sizeof(struct fdt_header), 8);
+	rsv_size = (fdt_num_mem_rsv(blob) + 1) * sizeof(struct fdt_reserve_entry);
+	struct_size = fdt_size_dt_struct(blob) + fix->space;
+	strings_size = fdt_size_dt_strings(blob);
+	buf = malloc(hdr_size + rsv_size + struct_size + strings_size +
+		     fix->space);
+	if (!buf) {
+		ret = -FDT_ERR_NOSPACE;
+		goto out;
+	}
+	memcpy(buf, blob, sizeof(struct fdt_header));
+	memcpy(buf + hdr_size, blob + fdt_off_mem_rsvmap(blob), rsv_size);
+	strings = buf + hdr_size + rsv_size + struct_size;
+	memcpy(strings, blob + fdt_off_dt_strings(blob), strings_size);
+
+	p = buf + hdr_size + rsv_size;
+	offset = 0;
+	do {
+		tag = fdt_next_tag(blob, offset, &next);
+		if (next < 0) {
+			ret = next;
+			break;
+		}
+
+		/* New properties go after the ones a node already has */
+		if (node_props && tag != FDT_PROP && tag != FDT_NOP) {
+			p = fdt_fixup_add(p, node_props, node_count, strings,
+					  &strings_size);
+			node_props = NULL;
+		}
+		prop = NULL;
+		if (tag == FDT_BEGIN_NODE) {
+			while (props < end && props->node < offset)
+				props++;
+			for (node_count = 0; props + node_count < end &&
+			     props[node_count].node == offset; node_count++)
+				;
+			if (node_count)
+				node_props = props;
+		} else if (tag == FDT_PROP && node_props) {
+			old = fdt_offset_ptr(blob, offset, sizeof(*old));
+			prop = fdt_fixup_find(node_props, node_count,
+					      fdt_string(blob,
+							 fdt32_to_cpu(old->nameoff)));
+		}
+		if (prop) {
+			p = fdt_fixup_emit(p, fdt32_to_cpu(old->nameoff),
+					   prop->val, prop->len);
+		} else {
+			memcpy(p, fdt_offset_ptr(blob, offset, next - offset),
+			       next - offset);
+			p += next - offset;
+		}
+		offset = next;
+	} while (tag != FDT_END);
+
+	if (!ret) {
+		/* As with fdt_setprop(), do not write past the end of the tree */
+		struct_size = p - (buf + hdr_size + rsv_size);
+		size = hdr_size + rsv_size + struct_size + strings_size;
+		if (size > fdt_totalsize(blob))
+			ret = -FDT_ERR_NOSPACE;
+	}
+	if (!ret) {
+		/* Close up the gap between the structure and the strings */
+		memmove(p, strings, strings_size);
+		fdt_set_off_mem_rsvmap(buf, hdr_size);
+		fdt_set_off_dt_struct(buf, hdr_size + rsv_size);
+		fdt_set_size_dt_struct(buf, struct_size);
+		fdt_set_off_dt_strings(buf, hdr_size + rsv_size + struct_size);
+		fdt_set_size_dt_strings(buf, strings_size);
+		fdt_set_totalsize(buf, fdt_totalsize(blob));
+		memcpy(blob, buf, size);
+	}
+	free(buf);
+out:
+	for (i = 0; i < fix->count; i++)
+		free(fix->props[i].val);
+	free(fix->props);
+	fdt_fixup_start(fix, blob);
+
+	return ret;
+}
+
 void do_fixup_by_path(void *fdt, const char *path, const char *prop,
 		      const void *val, int len, int create)
 {
@@ -479,37 +783,29 @@ int fdt_fixup_memory(void *blob, u64 start, u64 size)
 	return fdt_fixup_memory_banks(blob, &start, &size, 1);
 }
 
-void fdt_fixup_ethernet(void *fdt)
+void fdt_fixup_add_ethernet(struct fdt_fixup *fix)
 {
 	int i = 0, j, prop;
 	char *tmp, *end;
 	char mac[16];
 	const char *path;
 	unsigned char mac_addr[ARP_HLEN];
-	int offset;
+	void *fdt = fix->blob;
+	int aliases, ret;
 #ifdef FDT_SEQ_MACADDR_FROM_ENV
 	int nodeoff;
 	const struct fdt_property *fdt_prop;
 #endif
 
-	if (fdt_path_offset(fdt, "/aliases") < 0)
+	aliases = fdt_path_offset(fdt, "/aliases");
+	if (aliases < 0)
 		return;
 
-	/* Cycle through all aliases */
-	for (prop = 0; ; prop++) {
+	/* Nothing is changed until all the aliases have been looked at */
+	fdt_for_each_property_offset(prop, fdt, aliases) {
 		const char *name;
 
-		/* FDT might have been edited, recompute the offset */
-		offset = fdt_first_property_offset(fdt,
-			fdt_path_offset(fdt, "/aliases"));
-		/* Select property number 'prop' */
-		for (j = 0; j < prop; j++)
-			offset = fdt_next_property_offset(fdt, offset);
-
-		if (offset < 0)
-			break;
-
-		path = fdt_getprop_by_offset(fdt, offset, &name, NULL);
+		path = fdt_getprop_by_offset(fdt, prop, &name, NULL);
 		if (!strncmp(name, "ethernet", 8)) {
 			/* Treat plain "ethernet" same as "ethernet0". */
 			if (!strcmp(name, "ethernet")
@@ -549,14 +845,32 @@ void fdt_fixup_ethernet(void *fdt)
 					tmp = (*end) ? end + 1 : end;
 			}
 
-			do_fixup_by_path(fdt, path, "mac-address",
-					 &mac_addr, 6, 0);
-			do_fixup_by_path(fdt, path, "local-mac-address",
-					 &mac_addr, 6, 1);
+			ret = fdt_fixup_by_path(fix, path, "mac-address",
+						&mac_addr, 6, 0);
+			if (!ret)
+				ret = fdt_fixup_by_path(fix, path,
+							"local-mac-address",
+							&mac_addr, 6, 1);
+			if (ret)
+				printf("Unable to update property %s:%s, err=%s\n",
+				       path, "mac-address", fdt_strerror(ret));
 		}
 	}
 }
 
+void fdt_fixup_ethernet(void *fdt)
+{
+	struct fdt_fixup fix;
+	int ret;
+
+	fdt_fixup_start(&fix, fdt);
+	fdt_fixup_add_ethernet(&fix);
+	ret = fdt_fixup_apply(&fix);
+	if (ret)
+		printf("Unable to update MAC addresses, err=%s\n",
+		       fdt_strerror(ret));
+}
+
 int fdt_record_loadable(void *blob, u32 index, const char *name,
 			uintptr_t load_addr, u32 size, uintptr_t entry_point,
 			const char *type, const char *os)
@@ -1752,4 +2066,30 @@ int fdt_overlay_apply_verbose(void *fdt, void *fdto)
 	}
 	return err;
 }
+
+/**
+ * fdt_overlay_apply_index_verbose - Apply an overlay to an indexed tree with
+ * verbose error reporting
+ *
+ * @idx: index of the device tree
+ * @fdto: ptr to device tree overlay
+ *
+ * Convenience function to apply an overlay using an index of the base tree,
+ * and display helpful messages in the case of an error
+ */
+int fdt_overlay_apply_index_verbose(struct fdt_overlay_index *idx, void *fdto)
+{
+	int err;
+
+	err = fdt_overlay_apply_index(idx, fdto);
+	if (err < 0) {
+		printf("failed on fdt_overlay_apply_index(): %s\n",
+		       fdt_strerror(err));
+		if (idx->symbols_node < 0) {
+			printf("base fdt does did not have a /__symbols__ node\n");
+			printf("make sure you've compiled with -@\n");
+		}
+	}
+	return err;
+}
 #endif
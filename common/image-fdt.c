@@ -520,11 +520,22 @@ __weak int arch_fixup_fdt(void *blob)
 	return 0;
 }
 
+__weak int ft_board_setup_fixup(struct fdt_fixup *fix, bd_t *bd)
+{
+	return 0;
+}
+
+__weak int ft_board_setup(void *blob, bd_t *bd)
+{
+	return 0;
+}
+
 int image_setup_libfdt(bootm_headers_t *images, void *blob,
 		       int of_size, struct lmb *lmb)
 {
 	ulong *initrd_start = &images->initrd_start;
 	ulong *initrd_end = &images->initrd_end;
+	struct fdt_fixup fix;
 	int ret = -EPERM;
 	int fdt_ret;
 
@@ -540,8 +551,21 @@ int image_setup_libfdt(bootm_headers_t *images, void *blob,
 		printf("ERROR: arch-specific fdt fixup failed\n");
 		goto err;
 	}
-	/* Update ethernet nodes */
-	fdt_fixup_ethernet(blob);
+	/* Update ethernet nodes and board properties together */
+	fdt_fixup_start(&fix, blob);
+	fdt_fixup_add_ethernet(&fix);
+	if (IMAGE_OF_BOARD_SETUP) {
+		fdt_ret = ft_board_setup_fixup(&fix, gd->bd);
+		/* Then nothing in the batch is changed, but it is freed */
+		if (fdt_ret && !fix.err)
+			fix.err = fdt_ret;
+	}
+	fdt_ret = fdt_fixup_apply(&fix);
+	if (fdt_ret) {
+		printf("ERROR: fdt property fixup failed: %s\n",
+		       fdt_strerror(fdt_ret));
+		goto err;
+	}
 	if (IMAGE_OF_BOARD_SETUP) {
 		fdt_ret = ft_board_setup(blob, gd->bd);
 		if (fdt_ret) {
@@ -17,6 +17,7 @@
 #include <common.h>
 #include <errno.h>
 #include <mapmem.h>
+#include <fs.h>
 #include <asm/io.h>
 #include <malloc.h>
 DECLARE_GLOBAL_DATA_PTR;
@@ -448,10 +449,12 @@ void fit_image_print(const void *fit, int image_noffset, const char *p)
 	char *desc;
 	uint8_t type, arch, os, comp;
 	size_t size;
-	ulong load, entry;
+	ulong load, entry, block_size;
+	const fdt32_t *offsets;
 	const void *data;
 	int noffset;
 	int ndepth;
+	int count;
 	int ret;
 
 	/* Mandatory properties */
@@ -478,6 +481,9 @@ void fit_image_print(const void *fit, int image_noffset, const char *p)
 
 	fit_image_get_comp(fit, image_noffset, &comp);
 	printf("%s  Compression:  %s\n", p, genimg_get_comp_name(comp));
+	if (!fit_image_get_comp_blocks(fit, image_noffset, &block_size,
+				       &offsets, &count))
+		printf("%s  Comp Blocks:  %d x 0x%lx\n", p, count, block_size);
 
 	ret = fit_image_get_data_and_size(fit, image_noffset, &data, &size);
 
@@ -993,6 +999,29 @@ int fit_image_get_data_and_size(const void *fit, int noffset,
 	return ret;
 }
 
+int fit_image_get_comp_blocks(const void *fit, int noffset, ulong *block_size,
+			      const fdt32_t **offsets, int *count)
+{
+	const fdt32_t *val;
+	int len;
+
+	val = fdt_getprop(fit, noffset, FIT_COMP_BLOCK_SIZE_PROP, &len);
+	if (!val)
+		return -ENOENT;
+	if (len != sizeof(*val) || !fdt32_to_cpu(*val))
+		return -EINVAL;
+	*block_size = fdt32_to_cpu(*val);
+
+	*offsets = fdt_getprop(fit, noffset, FIT_COMP_BLOCKS_PROP, &len);
+	if (!*offsets)
+		return -ENOENT;
+	if (!len || len % sizeof(fdt32_t))
+		return -EINVAL;
+	*count = len / sizeof(fdt32_t);
+
+	return 0;
+}
+
 /**
  * fit_image_hash_get_algo - get hash algorithm name
  * @fit: pointer to the FIT format image header
@@ -1289,6 +1318,8 @@ int fit_image_verify(const void *fit, int image_noffset)
 	size_t		size;
 	int		noffset = 0;
 	char		*err_msg = "";
+	int		span;
+	int		ret;
 
 	/* Get image data and data length */
 	if (fit_image_get_data_and_size(fit, image_noffset, &data, &size)) {
@@ -1299,7 +1330,12 @@ int fit_image_verify(const void *fit, int image_noffset)
 		return 0;
 	}
 
-	return fit_image_verify_with_data(fit, image_noffset, data, size);
+	span = bootstage_span_begin("verify",
+				    fit_get_name(fit, image_noffset, NULL));
+	ret = fit_image_verify_with_data(fit, image_noffset, data, size);
+	bootstage_span_end(span);
+
+	return ret;
 }
 
 /**
@@ -1851,8 +1887,14 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 			images->fit_uname_cfg = fit_base_uname_config;
 
 		if (IMAGE_ENABLE_VERIFY && images->verify) {
+			int span;
+
 			puts("   Verifying Hash Integrity ... ");
-			if (fit_config_verify(fit, cfg_noffset)) {
+			span = bootstage_span_begin("verify",
+						    fit_base_uname_config);
+			ret = fit_config_verify(fit, cfg_noffset);
+			bootstage_span_end(span);
+			if (ret) {
 				puts("Bad Data Hash\n");
 				bootstage_error(bootstage_id +
 					BOOTSTAGE_SUB_HASH);
@@ -2048,6 +2090,8 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 	ulong ovload, ovlen;
 	const char *uconfig;
 	const char *uname;
+	struct fdt_overlay_index idx;
+	bool indexed = false;
 	void *base, *ov;
 	int i, err, noffset, ov_noffset;
 #endif
@@ -2101,8 +2145,6 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 		goto out;
 	}
 
-	base = map_sysmem(load, len);
-
 	/* apply extra configs in FIT first, followed by args */
 	for (i = 1; ; i++) {
 		if (i < count) {
@@ -2135,19 +2177,36 @@ int boot_get_fdt_fit(bootm_headers_t *images, ulong addr,
 				uname, ovload, ovlen);
 		ov = map_sysmem(ovload, ovlen);
 
-		base = map_sysmem(load, len + ovlen);
-		err = fdt_open_into(base, base, len + ovlen);
+		/*
+		 * Apply each overlay before loading the next, since they may
+		 * share a load address. The base tree grows in place, so the
+		 * index of it is built only once.
+		 */
+		len += ovlen;
+		base = map_sysmem(load, len);
+		if (indexed) {
+			err = fdt_overlay_index_resize(&idx, len);
+		} else {
+			err = fdt_open_into(base, base, len);
+			if (!err) {
+				err = fdt_overlay_index_init(&idx, base);
+				indexed = !err;
+			}
+		}
 		if (err < 0) {
 			printf("failed on fdt_open_into\n");
 			fdt_noffset = err;
 			goto out;
 		}
 		/* the verbose method prints out messages on error */
-		err = fdt_overlay_apply_verbose(base, ov);
+		err = fdt_overlay_apply_index_verbose(&idx, ov);
 		if (err < 0) {
 			fdt_noffset = err;
 			goto out;
 		}
+	}
+	if (indexed) {
+		base = map_sysmem(load, len);
 		fdt_pack(base);
 		len = fdt_totalsize(base);
 	}
@@ -2168,6 +2227,189 @@ out:
 
 	if (fit_uname_config_copy)
 		free(fit_uname_config_copy);
+#ifdef CONFIG_OF_LIBFDT_OVERLAY
+	if (indexed)
+		fdt_overlay_index_free(&idx);
+#endif
 	return fdt_noffset;
 }
 #endif
+
+#if !defined(USE_HOSTCC) && defined(CONFIG_CMD_FITLOAD)
+/* Configuration properties which refer to images */
+static const char *const fit_image_ref_props[] = {
+	FIT_KERNEL_PROP,
+	FIT_RAMDISK_PROP,
+	FIT_FDT_PROP,
+	FIT_LOADABLE_PROP,
+	FIT_SETUP_PROP,
+	FIT_FPGA_PROP,
+	FIT_FIRMWARE_PROP,
+	FIT_STANDALONE_PROP,
+};
+
+/**
+ * struct fit_file - a FIT being read from a filesystem
+ *
+ * @ifname:	Interface name (e.g. "mmc")
+ * @dev_part:	Device and partition (e.g. "0:1")
+ * @fstype:	Filesystem type (FS_TYPE_...)
+ * @filename:	Name of the file holding the FIT
+ * @size:	Size of the file in bytes
+ * @bytes_read:	Total number of bytes read so far
+ */
+struct fit_file {
+	const char *ifname;
+	const char *dev_part;
+	int fstype;
+	const char *filename;
+	loff_t size;
+	loff_t bytes_read;
+};
+
+/*
+ * Read part of the file, making sure that it is really in the file and that
+ * it does not overwrite reserved memory
+ */
+static int fit_file_read(struct fit_file *file, ulong addr, loff_t offset,
+			 loff_t len)
+{
+	loff_t actread;
+#ifdef CONFIG_LMB
+	struct lmb lmb;
+	bool ok;
+#endif
+
+	if (offset < 0 || len < 0 || offset + len > file->size) {
+		printf("%s: %#llx bytes at offset %#llx are beyond the end of the file\n",
+		       file->filename, (unsigned long long)len,
+		       (unsigned long long)offset);
+		return -EINVAL;
+	}
+#ifdef CONFIG_LMB
+	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
+	ok = lmb_alloc_addr(&lmb, addr, len) == addr;
+	lmb_release(&lmb);
+	if (!ok) {
+		printf("** Reading file would overwrite reserved memory **\n");
+		return -ENOSPC;
+	}
+#endif
+
+	/* The filesystem is closed after each operation */
+	if (fs_set_blk_dev(file->ifname, file->dev_part, file->fstype))
+		return -ENODEV;
+	if (fs_read(file->filename, addr, offset, len, &actread))
+		return -EIO;
+	file->bytes_read += actread;
+	if (actread != len) {
+		printf("%s: short read at offset %#llx\n", file->filename,
+		       (unsigned long long)offset);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int fit_load_file(const char *ifname, const char *dev_part, int fstype,
+		  const char *filename, ulong addr, const char *conf_uname,
+		  ulong *sizep, loff_t *bytes_readp)
+{
+	struct fit_file file = {
+		.ifname = ifname,
+		.dev_part = dev_part,
+		.fstype = fstype,
+		.filename = filename,
+	};
+	int images_noffset, conf_noffset, noffset;
+	int offset, len;
+	const char *uname;
+	ulong size, end;
+	void *fit;
+	int ret;
+	int i, j;
+
+	if (fs_set_blk_dev(ifname, dev_part, fstype))
+		return -ENODEV;
+	if (fs_size(filename, &file.size)) {
+		printf("%s: cannot find file\n", filename);
+		return -ENOENT;
+	}
+
+	/* Read the header first, to find the size of the FIT structure */
+	fit = map_sysmem(addr, 0);
+	ret = fit_file_read(&file, addr, 0, sizeof(struct fdt_header));
+	if (ret)
+		return ret;
+	if (fdt_check_header(fit)) {
+		printf("%s: not a FIT image\n", filename);
+		return -EINVAL;
+	}
+	size = fdt_totalsize(fit);
+	if (size < sizeof(struct fdt_header)) {
+		printf("%s: not a FIT image\n", filename);
+		return -EINVAL;
+	}
+	ret = fit_file_read(&file, addr + sizeof(struct fdt_header),
+			    sizeof(struct fdt_header),
+			    size - sizeof(struct fdt_header));
+	if (ret)
+		return ret;
+	if (!fit_check_format(fit)) {
+		puts("Bad FIT image format!\n");
+		return -EINVAL;
+	}
+
+	conf_noffset = fit_conf_get_node(fit, conf_uname);
+	if (conf_noffset < 0) {
+		puts("Could not find configuration node\n");
+		return -ENOENT;
+	}
+	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images_noffset < 0) {
+		printf("Can't find images parent node '%s' (%s)\n",
+		       FIT_IMAGES_PATH, fdt_strerror(images_noffset));
+		return -ENOENT;
+	}
+
+	/*
+	 * Read the external data of each image used by the configuration to
+	 * the place it would be if the whole file were loaded
+	 */
+	end = size;
+	for (i = 0; i < ARRAY_SIZE(fit_image_ref_props); i++) {
+		for (j = 0;
+		     (uname = fdt_stringlist_get(fit, conf_noffset,
+						 fit_image_ref_props[i], j,
+						 NULL));
+		     j++) {
+			noffset = fdt_subnode_offset(fit, images_noffset,
+						     uname);
+			if (noffset < 0)
+				continue;
+			if (fit_image_get_data_position(fit, noffset,
+							&offset)) {
+				/* Skip images with data inside the FIT */
+				if (fit_image_get_data_offset(fit, noffset,
+							      &offset))
+					continue;
+				offset += ALIGN(size, 4);
+			}
+			if (fit_image_get_data_size(fit, noffset, &len) ||
+			    !len)
+				continue;
+
+			debug("   reading '%s': %#x bytes at %#x\n", uname,
+			      len, offset);
+			ret = fit_file_read(&file, addr + offset, offset, len);
+			if (ret)
+				return ret;
+			end = max(end, (ulong)offset + len);
+		}
+	}
+	*sizep = end;
+	*bytes_readp = file.bytes_read;
+
+	return 0;
+}
+#endif /* CONFIG_CMD_FITLOAD */
@@ -14,6 +14,7 @@ DECLARE_GLOBAL_DATA_PTR;
 #include <image.h>
 #include <u-boot/rsa.h>
 #include <u-boot/rsa-checksum.h>
+#include <u-boot/ecdsa.h>
 
 #define IMAGE_MAX_HASHED_NODES		100
 
@@ -67,7 +68,23 @@ struct crypto_algo crypto_algos[] = {
 		.sign = rsa_sign,
 		.add_verify_data = rsa_add_verify_data,
 		.verify = rsa_verify,
-	}
+	},
+#if IMAGE_ENABLE_ECDSA
+	{
+		.name = "ecdsa256",
+		.key_len = ECDSA256_BYTES,
+		.sign = ecdsa_sign,
+		.add_verify_data = ecdsa_add_verify_data,
+		.verify = ecdsa_verify,
+	},
+	{
+		.name = "ecdsa384",
+		.key_len = ECDSA384_BYTES,
+		.sign = ecdsa_sign,
+		.add_verify_data = ecdsa_add_verify_data,
+		.verify = ecdsa_verify,
+	},
+#endif /* IMAGE_ENABLE_ECDSA */
 
 };
 
@@ -14,12 +14,113 @@
 
 DECLARE_GLOBAL_DATA_PTR;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+/**
+ * struct simple_hdr - Header before each block, so that it can be freed
+ *
+ * Freed blocks are kept in a list, each holding the offset of the next one
+ * from gd->malloc_base in its first word, with the offset of the first in
+ * gd->malloc_free. All offsets are those of the block after its header.
+ *
+ * @start: Value of gd->malloc_ptr before the block was allocated
+ * @size: Number of bytes in the block
+ */
+struct simple_hdr {
+	u32 start;
+	u32 size;
+};
+
+static struct simple_hdr *simple_hdr(ulong offset)
+{
+	return map_sysmem(gd->malloc_base + offset - sizeof(struct simple_hdr),
+			  sizeof(struct simple_hdr));
+}
+
+static u32 *simple_link(ulong offset)
+{
+	return map_sysmem(gd->malloc_base + offset, sizeof(u32));
+}
+
+/* Remove a freed block from the list, given the one before it (0 if none) */
+static void simple_unlink(ulong prev, ulong offset)
+{
+	ulong next = *simple_link(offset);
+
+	if (prev)
+		*simple_link(prev) = next;
+	else
+		gd->malloc_free = next;
+}
+
+/* Reuse the first freed block which is large enough and suitably aligned */
+static void *alloc_simple_freed(size_t bytes, int align)
+{
+	ulong prev, offset;
+
+	for (prev = 0, offset = gd->malloc_free; offset;
+	     prev = offset, offset = *simple_link(offset)) {
+		if (simple_hdr(offset)->size >= bytes &&
+		    IS_ALIGNED(gd->malloc_base + offset, align)) {
+			simple_unlink(prev, offset);
+			/* The caller finishes the line with the address */
+			log_debug("size=%zx, reused freed block at %lx, size=%x: ",
+				  bytes, offset, simple_hdr(offset)->size);
+			return map_sysmem(gd->malloc_base + offset, bytes);
+		}
+	}
+
+	return NULL;
+}
+
+void free_simple(void *ptr)
+{
+	struct simple_hdr *hdr;
+	ulong prev, offset;
+
+	if (!ptr)
+		return;
+	offset = map_to_sysmem(ptr) - gd->malloc_base;
+	hdr = simple_hdr(offset);
+	if (offset + hdr->size != gd->malloc_ptr) {
+		*simple_link(offset) = gd->malloc_free;
+		gd->malloc_free = offset;
+		return;
+	}
+
+	/* Give back the space, along with any freed blocks now at the end */
+	gd->malloc_ptr = hdr->start;
+	for (prev = 0, offset = gd->malloc_free; offset;) {
+		hdr = simple_hdr(offset);
+		if (offset + hdr->size == gd->malloc_ptr) {
+			simple_unlink(prev, offset);
+			gd->malloc_ptr = hdr->start;
+			prev = 0;
+			offset = gd->malloc_free;
+		} else {
+			prev = offset;
+			offset = *simple_link(offset);
+		}
+	}
+}
+#endif
+
 static void *alloc_simple(size_t bytes, int align)
 {
 	ulong addr, new_ptr;
 	void *ptr;
 
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	struct simple_hdr *hdr;
+
+	/* A freed block must have room for the link to the next one */
+	bytes = max_t(size_t, bytes, sizeof(u32));
+	ptr = alloc_simple_freed(bytes, align);
+	if (ptr)
+		return ptr;
+	addr = ALIGN(gd->malloc_base + gd->malloc_ptr + sizeof(*hdr), align);
+#else
 	addr = ALIGN(gd->malloc_base + gd->malloc_ptr, align);
+#endif
 	new_ptr = addr + bytes - gd->malloc_base;
 	log_debug("size=%zx, ptr=%lx, limit=%lx: ", bytes, new_ptr,
 		  gd->malloc_limit);
@@ -29,7 +130,13 @@ static void *alloc_simple(size_t bytes, int align)
 	}
 
 	ptr = map_sysmem(addr, bytes);
-	gd->malloc_ptr = ALIGN(new_ptr, sizeof(new_ptr));
+	new_ptr = ALIGN(new_ptr, sizeof(new_ptr));
+#if CONFIG_IS_ENABLED(SYS_MALLOC_F_FREE)
+	hdr = simple_hdr(addr - gd->malloc_base);
+	hdr->start = gd->malloc_ptr;
+	hdr->size = new_ptr - (addr - gd->malloc_base);
+#endif
+	gd->malloc_ptr = new_ptr;
 
 	return ptr;
 }
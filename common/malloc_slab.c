@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Slab front-end for small malloc() blocks
+ *
+ * Small blocks are taken from 4KiB slabs, each holding blocks of a single
+ * size class, rather than from the dlmalloc bins. The slabs come from one
+ * area of the heap, so a block can be recognised by its address and its slab
+ * found by rounding the address down.
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <linux/list.h>
+
+#define SLAB_SIZE	4096
+
+/**
+ * struct slab - Header at the start of each slab
+ *
+ * @sibling: Node in the size class's list of slabs with free blocks, or in
+ *	the list of unused slabs
+ * @free: First free block, each holding a pointer to the next, or NULL
+ * @class: Index of the size class
+ * @used: Number of blocks allocated
+ * @fresh: Number of blocks which have never been allocated, at the end of
+ *	the slab
+ */
+struct slab {
+	struct list_head sibling;
+	void *free;
+	u16 class;
+	u16 used;
+	u16 fresh;
+};
+
+#define SLAB_DATA	ALIGN(sizeof(struct slab), 16)
+
+/**
+ * struct slab_class - Slabs holding blocks of one size
+ *
+ * @size: Size of each block in bytes
+ * @partial: Slabs with at least one free block
+ * @slabs: Number of slabs in use
+ * @used: Number of blocks allocated
+ * @allocs: Number of allocations made
+ * @misses: Number of allocations passed to dlmalloc as no slab was free
+ */
+struct slab_class {
+	uint size;
+	struct list_head partial;
+	ulong slabs;
+	ulong used;
+	ulong allocs;
+	ulong misses;
+};
+
+/* Block sizes are multiples of 16, so all blocks are aligned for any type */
+static struct slab_class slab_classes[] = {
+	{ 16 }, { 32 }, { 48 }, { 64 }, { 96 }, { 128 }, { 192 },
+	{ MALLOC_SLAB_MAX },
+};
+
+static LIST_HEAD(slab_unused);
+static ulong slab_start, slab_end;
+static bool slab_failed;
+
+static int malloc_slab_init(void)
+{
+	struct slab *slab;
+	ulong addr;
+	int i;
+
+	slab_start = (ulong)memalign(SLAB_SIZE, CONFIG_SYS_MALLOC_SLAB_SIZE);
+	if (!slab_start) {
+		slab_failed = true;
+		return -ENOMEM;
+	}
+	slab_end = slab_start + CONFIG_SYS_MALLOC_SLAB_SIZE;
+	for (i = 0; i < ARRAY_SIZE(slab_classes); i++)
+		INIT_LIST_HEAD(&slab_classes[i].partial);
+	for (addr = slab_start; addr < slab_end; addr += SLAB_SIZE) {
+		slab = (struct slab *)addr;
+		list_add_tail(&slab->sibling, &slab_unused);
+	}
+
+	return 0;
+}
+
+static int slab_class_of(size_t bytes)
+{
+	int i;
+
+	for (i = 0; slab_classes[i].size < bytes; i++)
+		;
+
+	return i;
+}
+
+void *malloc_slab(size_t bytes)
+{
+	struct slab_class *cls;
+	struct slab *slab;
+	void *ptr;
+
+	if (!slab_start && (slab_failed || malloc_slab_init()))
+		return NULL;
+
+	cls = &slab_classes[slab_class_of(bytes)];
+	cls->allocs++;
+	if (list_empty(&cls->partial)) {
+		if (list_empty(&slab_unused)) {
+			cls->misses++;
+			return NULL;
+		}
+		slab = list_first_entry(&slab_unused, struct slab, sibling);
+		list_move(&slab->sibling, &cls->partial);
+		slab->free = NULL;
+		slab->class = cls - slab_classes;
+		slab->used = 0;
+		slab->fresh = (SLAB_SIZE - SLAB_DATA) / cls->size;
+		cls->slabs++;
+	}
+	slab = list_first_entry(&cls->partial, struct slab, sibling);
+
+	if (slab->free) {
+		ptr = slab->free;
+		slab->free = *(void **)ptr;
+	} else {
+		ptr = (void *)slab + SLAB_SIZE - slab->fresh * cls->size;
+		slab->fresh--;
+	}
+	slab->used++;
+	cls->used++;
+	if (!slab->free && !slab->fresh)
+		list_del(&slab->sibling);
+
+	return ptr;
+}
+
+int malloc_slab_owns(const void *ptr)
+{
+	return (ulong)ptr >= slab_start && (ulong)ptr < slab_end;
+}
+
+static struct slab *slab_of(const void *ptr)
+{
+	return (struct slab *)((ulong)ptr & ~(SLAB_SIZE - 1));
+}
+
+void free_slab(void *ptr)
+{
+	struct slab *slab = slab_of(ptr);
+	struct slab_class *cls = &slab_classes[slab->class];
+
+	/* A full slab is on no list */
+	if (!slab->free && !slab->fresh)
+		list_add(&slab->sibling, &cls->partial);
+	*(void **)ptr = slab->free;
+	slab->free = ptr;
+	slab->used--;
+	cls->used--;
+
+	/* Give an empty slab back for any size class to use */
+	if (!slab->used) {
+		list_move(&slab->sibling, &slab_unused);
+		cls->slabs--;
+	}
+}
+
+size_t malloc_slab_usable_size(const void *ptr)
+{
+	return slab_classes[slab_of(ptr)->class].size;
+}
+
+void malloc_slab_adjust_info(struct mallinfo *info)
+{
+	ulong used = 0;
+	int i;
+
+	if (!slab_start)
+		return;
+	for (i = 0; i < ARRAY_SIZE(slab_classes); i++)
+		used += slab_classes[i].used * slab_classes[i].size;
+
+	/* Count the blocks in use rather than the whole slab area */
+	info->uordblks += used - CONFIG_SYS_MALLOC_SLAB_SIZE;
+	info->fordblks += CONFIG_SYS_MALLOC_SLAB_SIZE - used;
+}
+
+void malloc_slab_stats(void)
+{
+	struct slab_class *cls;
+	ulong slabs = 0;
+
+	printf("slabs at %08lx-%08lx\n", slab_start, slab_end);
+	printf(" size  slabs   in use      allocs      misses\n");
+	for (cls = slab_classes; cls < slab_classes + ARRAY_SIZE(slab_classes);
+	     cls++) {
+		printf("%5u %6lu %8lu %11lu %11lu\n", cls->size, cls->slabs,
+		       cls->used, cls->allocs, cls->misses);
+		slabs += cls->slabs;
+	}
+	printf("%lu of %lu slabs in use\n", slabs,
+	       (ulong)CONFIG_SYS_MALLOC_SLAB_SIZE / SLAB_SIZE);
+}
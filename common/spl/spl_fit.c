@@ -5,6 +5,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <errno.h>
 #include <fpga.h>
 #include <image.h>
@@ -179,10 +180,12 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 	void *src;
 	ulong overhead;
 	int nr_sectors;
+	ulong count;
 	int align_len = ARCH_DMA_MINALIGN - 1;
 	uint8_t image_comp = -1, type = -1;
 	const void *data;
 	bool external_data = false;
+	__maybe_unused bool verified;
 
 	if (IS_ENABLED(CONFIG_SPL_FPGA_SUPPORT) ||
 	    (IS_ENABLED(CONFIG_SPL_OS_BOOT) && IS_ENABLED(CONFIG_SPL_GZIP))) {
@@ -220,9 +223,12 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 		overhead = get_aligned_image_overhead(info, offset);
 		nr_sectors = get_aligned_image_size(info, length, offset);
 
-		if (info->read(info,
-			       sector + get_aligned_image_offset(info, offset),
-			       nr_sectors, (void *)load_ptr) != nr_sectors)
+		bootstage_start(BOOTSTAGE_ID_ACCUM_SPL_READ, "spl_read");
+		count = info->read(info,
+				   sector + get_aligned_image_offset(info, offset),
+				   nr_sectors, (void *)load_ptr);
+		bootstage_accum(BOOTSTAGE_ID_ACCUM_SPL_READ);
+		if (count != nr_sectors)
 			return -EIO;
 
 		debug("External data: dst=%lx, offset=%x, size=%lx\n",
@@ -242,8 +248,10 @@ static int spl_load_fit_image(struct spl_load_info *info, ulong sector,
 #ifdef CONFIG_SPL_FIT_SIGNATURE
 	printf("## Checking hash(es) for Image %s ... ",
 	       fit_get_name(fit, node, NULL));
-	if (!fit_image_verify_with_data(fit, node,
-					 src, length))
+	bootstage_start(BOOTSTAGE_ID_ACCUM_SPL_HASH, "spl_hash");
+	verified = fit_image_verify_with_data(fit, node, src, length);
+	bootstage_accum(BOOTSTAGE_ID_ACCUM_SPL_HASH);
+	if (!verified)
 		return -EPERM;
 	puts("OK\n");
 #endif
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tracepoints: binary records of I/O and probe events in a ring buffer
+ */
+
+#include <common.h>
+#include <bloblist.h>
+#include <malloc.h>
+#include <tracepoint.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#define RECORD_COUNT	CONFIG_TRACEPOINT_RECORD_COUNT
+
+/**
+ * struct tracepoint_data - tracepoint records
+ *
+ * @next: Total number of records added. The next record goes in
+ *	rec[next % RECORD_COUNT], replacing the oldest once the buffer is full
+ * @rec: Records
+ */
+struct tracepoint_data {
+	uint next;
+	struct tracepoint_rec rec[RECORD_COUNT];
+};
+
+static const char *const tracepoint_name[TP_COUNT] = {
+	"probe",
+	"blk_read",
+	"blk_write",
+	"mmc_cmd",
+	"net_send",
+	"net_recv",
+	"fs_read",
+	"fs_write",
+};
+
+void tracepoint_add(enum tracepoint_id id, ulong start_us, const char *name,
+		    ulong arg0, ulong arg1)
+{
+	struct tracepoint_data *data = gd->tracepoint;
+	struct tracepoint_rec *rec;
+	const char *base;
+
+	rec = &data->rec[data->next++ % RECORD_COUNT];
+	rec->start_us = start_us;
+	rec->duration_us = timer_get_boot_us() - start_us;
+	rec->id = id;
+	rec->spare = 0;
+	rec->arg[0] = arg0;
+	rec->arg[1] = arg1;
+	base = strrchr(name, '/');
+	strncpy(rec->name, base ? base + 1 : name, TRACEPOINT_NAME_LEN);
+}
+
+int tracepoint_set_mask(u32 mask)
+{
+	if (!gd->tracepoint)
+		return -ENOSPC;
+	gd->tracepoint_mask = mask;
+
+	return 0;
+}
+
+void tracepoint_clear(void)
+{
+	if (gd->tracepoint)
+		gd->tracepoint->next = 0;
+}
+
+/* Get the number of records held and the index of the oldest */
+static uint tracepoint_get_range(struct tracepoint_data *data, uint *firstp)
+{
+	if (data->next <= RECORD_COUNT) {
+		*firstp = 0;
+		return data->next;
+	}
+	*firstp = data->next % RECORD_COUNT;
+
+	return RECORD_COUNT;
+}
+
+int tracepoint_stash(void *buf, int size)
+{
+	struct tracepoint_data *data = gd->tracepoint;
+	struct tracepoint_hdr *hdr = buf;
+	struct tracepoint_rec *rec;
+	uint count, first, i;
+
+	count = data ? tracepoint_get_range(data, &first) : 0;
+	if (size < sizeof(*hdr) + count * sizeof(*rec))
+		return -ENOSPC;
+	hdr->magic = TRACEPOINT_MAGIC;
+	hdr->version = TRACEPOINT_VERSION;
+	hdr->rec_size = sizeof(*rec);
+	hdr->count = count;
+	hdr->dropped = data ? data->next - count : 0;
+	rec = (struct tracepoint_rec *)(hdr + 1);
+	for (i = 0; i < count; i++)
+		rec[i] = data->rec[(first + i) % RECORD_COUNT];
+
+	return sizeof(*hdr) + count * sizeof(*rec);
+}
+
+int tracepoint_export(void)
+{
+#if CONFIG_IS_ENABLED(BLOBLIST)
+	struct tracepoint_data *data = gd->tracepoint;
+	uint count, first;
+	void *blob;
+	int size;
+	int ret;
+
+	if (!data || !gd->bloblist)
+		return 0;
+
+	/* Don't record anything while the records are being copied */
+	gd->tracepoint_mask = 0;
+	count = tracepoint_get_range(data, &first);
+	size = sizeof(struct tracepoint_hdr) +
+		count * sizeof(struct tracepoint_rec);
+	ret = bloblist_ensure_size(BLOBLISTT_TRACEPOINT, size, &blob);
+	if (ret) {
+		debug("Cannot add tracepoint records to bloblist (err=%d)\n",
+		      ret);
+		return ret;
+	}
+	tracepoint_stash(blob, size);
+
+	return bloblist_finish();
+#else
+	return 0;
+#endif
+}
+
+void tracepoint_report(void)
+{
+	struct tracepoint_data *data = gd->tracepoint;
+	struct tracepoint_rec *rec;
+	uint count, first, i;
+
+	if (!data) {
+		printf("No tracepoint buffer\n");
+		return;
+	}
+	count = tracepoint_get_range(data, &first);
+	printf("Tracepoints: mask %x, %u records, %u dropped\n",
+	       gd->tracepoint_mask, count, data->next - count);
+	printf("%11s  %11s  %-9s  %-12s  %10s  %10s\n", "Start", "Duration",
+	       "Event", "Name", "Arg0", "Arg1");
+	for (i = 0; i < count; i++) {
+		rec = &data->rec[(first + i) % RECORD_COUNT];
+		printf("%11u  %11u  %-9s  %-12.*s  %10x  %10x\n", rec->start_us,
+		       rec->duration_us,
+		       rec->id < TP_COUNT ? tracepoint_name[rec->id] : "?",
+		       TRACEPOINT_NAME_LEN, rec->name, rec->arg[0],
+		       rec->arg[1]);
+	}
+}
+
+int tracepoint_init(void)
+{
+	struct tracepoint_data *data;
+
+	data = calloc(1, sizeof(*data));
+	if (!data)
+		return -ENOMEM;
+	gd->tracepoint = data;
+	gd->tracepoint_mask = CONFIG_TRACEPOINT_MASK;
+
+	return 0;
+}
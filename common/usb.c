@@ -281,6 +281,42 @@ int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 		return -EIO;
 }
 
+/*-------------------------------------------------------------------
+ * submits a sequence of bulk messages on one pipe, and waits for them all
+ * to complete. The controller may queue each message while the one before
+ * is in flight; otherwise they are sent one at a time. Stops at the first
+ * message which fails; a short IN message is not a failure. The status and
+ * act_len of each message are updated and dev->status is that of the last
+ * one sent. returns 0 if Ok or negative if Error.
+ * synchronous behavior
+ */
+int usb_bulk_stream(struct usb_device *dev, unsigned int pipe,
+		    struct usb_bulk_xfer *xfer, int count, int timeout)
+{
+	int ret, i;
+
+	for (i = 0; i < count; i++) {
+		if (xfer[i].length < 0)
+			return -EINVAL;
+		xfer[i].status = USB_ST_NOT_PROC;
+		xfer[i].act_len = 0;
+	}
+#if CONFIG_IS_ENABLED(DM_USB)
+	ret = submit_bulk_stream(dev, pipe, xfer, count);
+	if (ret != -ENOSYS)
+		return ret ? -EIO : 0;
+#endif
+	for (i = 0; i < count; i++) {
+		ret = usb_bulk_msg(dev, pipe, xfer[i].buffer, xfer[i].length,
+				   &xfer[i].act_len, timeout);
+		xfer[i].status = dev->status;
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 
 /*-------------------------------------------------------------------
  * Max Packet stuff
@@ -22,6 +22,7 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <command.h>
 #include <dm.h>
 #include <errno.h>
@@ -45,14 +46,32 @@
 
 #define PORT_OVERCURRENT_MAX_SCAN_COUNT		3
 
+/*
+ * States of a port on the scanning list. All ports of all hubs are stepped
+ * through these together, so that the power-on and reset delays overlap.
+ * Only one port per bus may be between reset and address assignment, since
+ * the device there answers on the default address.
+ */
+enum usb_scan_state {
+	USB_SCAN_WAIT_CONNECT,		/* Waiting for a device to connect */
+	USB_SCAN_CONNECTED,		/* Waiting for the bus to be free */
+	USB_SCAN_RESET,			/* Waiting for the port reset to end */
+};
+
 struct usb_device_scan {
 	struct usb_device *dev;		/* USB hub device to scan */
 	struct usb_hub_device *hub;	/* USB hub struct */
 	int port;			/* USB port to scan */
+	enum usb_scan_state state;	/* Current state of the port */
+	ulong timeout;			/* Time to check the port reset, in ms */
+	int tries;			/* Number of port resets done */
+	unsigned short portstatus;	/* Port status when it connected */
+	unsigned short portchange;	/* Port change when it connected */
 	struct list_head list;
 };
 
 static LIST_HEAD(usb_scan_list);
+static int usb_scan_running;
 
 __weak void usb_hub_reset_devices(struct usb_hub_device *hub, int port)
 {
@@ -255,6 +274,72 @@ static inline char *portspeed(int portstatus)
 	return speed_str;
 }
 
+/* Get the timer value after a delay, ignoring delays if sandbox skips them */
+static ulong usb_hub_deadline(int delay)
+{
+#ifdef CONFIG_SANDBOX
+	if (state_get_skip_delays())
+		return 0;
+#endif
+
+	return get_timer(0) + delay;
+}
+
+/**
+ * usb_hub_port_reset_check() - check whether a port reset has finished
+ *
+ * @dev:	USB hub device
+ * @port:	Port number (note ports are numbered from 0 here)
+ * @portstat:	Returns port status, if the port is enabled
+ * @return 0 if the port is enabled, -EAGAIN if not, other -ve on error
+ */
+static int usb_hub_port_reset_check(struct usb_device *dev, int port,
+				    unsigned short *portstat)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
+	unsigned short portstatus, portchange;
+
+	if (usb_get_port_status(dev, port + 1, portsts) < 0) {
+		debug("get_port_status failed status %lX\n", dev->status);
+		return -EIO;
+	}
+	portstatus = le16_to_cpu(portsts->wPortStatus);
+	portchange = le16_to_cpu(portsts->wPortChange);
+
+	debug("portstatus %x, change %x, %s\n", portstatus, portchange,
+	      portspeed(portstatus));
+
+	debug("STAT_C_CONNECTION = %d STAT_CONNECTION = %d" \
+	      "  USB_PORT_STAT_ENABLE %d\n",
+	      (portchange & USB_PORT_STAT_C_CONNECTION) ? 1 : 0,
+	      (portstatus & USB_PORT_STAT_CONNECTION) ? 1 : 0,
+	      (portstatus & USB_PORT_STAT_ENABLE) ? 1 : 0);
+
+	/*
+	 * Perhaps we should check for the following here:
+	 * - C_CONNECTION hasn't been set.
+	 * - CONNECTION is still set.
+	 *
+	 * Doing so would ensure that the device is still connected
+	 * to the bus, and hasn't been unplugged or replaced while the
+	 * USB bus reset was going on.
+	 *
+	 * However, if we do that, then (at least) a San Disk Ultra
+	 * USB 3.0 16GB device fails to reset on (at least) an NVIDIA
+	 * Tegra Jetson TK1 board. For some reason, the device appears
+	 * to briefly drop off the bus when this second bus reset is
+	 * executed, yet if we retry this loop, it'll eventually come
+	 * back after another reset or two.
+	 */
+	if (!(portstatus & USB_PORT_STAT_ENABLE))
+		return -EAGAIN;
+
+	usb_clear_port_feature(dev, port + 1, USB_PORT_FEAT_C_RESET);
+	*portstat = portstatus;
+
+	return 0;
+}
+
 /**
  * usb_hub_port_reset() - reset a port given its usb_device pointer
  *
@@ -269,8 +354,6 @@ static int usb_hub_port_reset(struct usb_device *dev, int port,
 			      unsigned short *portstat)
 {
 	int err, tries;
-	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
-	unsigned short portstatus, portchange;
 	int delay = HUB_SHORT_RESET_TIME; /* start with short reset delay */
 
 #if CONFIG_IS_ENABLED(DM_USB)
@@ -286,64 +369,36 @@ static int usb_hub_port_reset(struct usb_device *dev, int port,
 
 		mdelay(delay);
 
-		if (usb_get_port_status(dev, port + 1, portsts) < 0) {
-			debug("get_port_status failed status %lX\n",
-			      dev->status);
-			return -1;
-		}
-		portstatus = le16_to_cpu(portsts->wPortStatus);
-		portchange = le16_to_cpu(portsts->wPortChange);
-
-		debug("portstatus %x, change %x, %s\n", portstatus, portchange,
-							portspeed(portstatus));
-
-		debug("STAT_C_CONNECTION = %d STAT_CONNECTION = %d" \
-		      "  USB_PORT_STAT_ENABLE %d\n",
-		      (portchange & USB_PORT_STAT_C_CONNECTION) ? 1 : 0,
-		      (portstatus & USB_PORT_STAT_CONNECTION) ? 1 : 0,
-		      (portstatus & USB_PORT_STAT_ENABLE) ? 1 : 0);
-
-		/*
-		 * Perhaps we should check for the following here:
-		 * - C_CONNECTION hasn't been set.
-		 * - CONNECTION is still set.
-		 *
-		 * Doing so would ensure that the device is still connected
-		 * to the bus, and hasn't been unplugged or replaced while the
-		 * USB bus reset was going on.
-		 *
-		 * However, if we do that, then (at least) a San Disk Ultra
-		 * USB 3.0 16GB device fails to reset on (at least) an NVIDIA
-		 * Tegra Jetson TK1 board. For some reason, the device appears
-		 * to briefly drop off the bus when this second bus reset is
-		 * executed, yet if we retry this loop, it'll eventually come
-		 * back after another reset or two.
-		 */
-
-		if (portstatus & USB_PORT_STAT_ENABLE)
-			break;
+		err = usb_hub_port_reset_check(dev, port, portstat);
+		if (err != -EAGAIN)
+			return err ? -1 : 0;
 
 		/* Switch to long reset delay for the next round */
 		delay = HUB_LONG_RESET_TIME;
 	}
 
-	if (tries == MAX_TRIES) {
-		debug("Cannot enable port %i after %i retries, " \
-		      "disabling port.\n", port + 1, MAX_TRIES);
-		debug("Maybe the USB cable is bad?\n");
-		return -1;
-	}
+	debug("Cannot enable port %i after %i retries, " \
+	      "disabling port.\n", port + 1, MAX_TRIES);
+	debug("Maybe the USB cable is bad?\n");
 
-	usb_clear_port_feature(dev, port + 1, USB_PORT_FEAT_C_RESET);
-	*portstat = portstatus;
-	return 0;
+	return -1;
 }
 
-int usb_hub_port_connect_change(struct usb_device *dev, int port)
+/**
+ * usb_hub_port_check_connect() - check a port before resetting it
+ *
+ * This clears the connection change and checks that a device is still
+ * connected.
+ *
+ * @dev:	USB hub device
+ * @port:	Port number (note ports are numbered from 0 here)
+ * @return 0 if a device is connected, -ENOTCONN if not, other -ve on error
+ */
+static int usb_hub_port_check_connect(struct usb_device *dev, int port)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
 	unsigned short portstatus;
-	int ret, speed;
+	int ret;
 
 	/* Check status */
 	ret = usb_get_port_status(dev, port + 1, portsts);
@@ -371,13 +426,24 @@ int usb_hub_port_connect_change(struct usb_device *dev, int port)
 			return -ENOTCONN;
 	}
 
-	/* Reset the port */
-	ret = usb_hub_port_reset(dev, port, &portstatus);
-	if (ret < 0) {
-		if (ret != -ENXIO)
-			printf("cannot reset port %i!?\n", port + 1);
-		return ret;
-	}
+	return 0;
+}
+
+/**
+ * usb_hub_port_enumerate() - set up the device on a port which was reset
+ *
+ * This assigns the device an address and finds a driver for it. The port is
+ * disabled if this fails.
+ *
+ * @dev:	USB hub device
+ * @port:	Port number (note ports are numbered from 0 here)
+ * @portstatus:	Port status after the reset
+ * @return 0 if OK, -ve on error
+ */
+static int usb_hub_port_enumerate(struct usb_device *dev, int port,
+				  unsigned short portstatus)
+{
+	int ret, speed;
 
 	switch (portstatus & USB_PORT_STAT_SPEED_MASK) {
 	case USB_PORT_STAT_SUPER_SPEED:
@@ -427,7 +493,55 @@ int usb_hub_port_connect_change(struct usb_device *dev, int port)
 	return ret;
 }
 
-static int usb_scan_port(struct usb_device_scan *usb_scan)
+int usb_hub_port_connect_change(struct usb_device *dev, int port)
+{
+	unsigned short portstatus;
+	int ret;
+
+	ret = usb_hub_port_check_connect(dev, port);
+	if (ret)
+		return ret;
+
+	/* Reset the port */
+	ret = usb_hub_port_reset(dev, port, &portstatus);
+	if (ret < 0) {
+		if (ret != -ENXIO)
+			printf("cannot reset port %i!?\n", port + 1);
+		return ret;
+	}
+
+	return usb_hub_port_enumerate(dev, port, portstatus);
+}
+
+/* Check whether a port on the same bus is between reset and enumeration */
+static bool usb_scan_bus_busy(struct usb_device_scan *usb_scan)
+{
+	struct usb_device_scan *other;
+
+	list_for_each_entry(other, &usb_scan_list, list) {
+		if (other->state != USB_SCAN_RESET)
+			continue;
+#if CONFIG_IS_ENABLED(DM_USB)
+		if (other->dev->controller_dev == usb_scan->dev->controller_dev)
+			return true;
+#else
+		if (other->dev->controller == usb_scan->dev->controller)
+			return true;
+#endif
+	}
+
+	return false;
+}
+
+/* Remove a port from the scanning list */
+static void usb_scan_port_done(struct usb_device_scan *usb_scan)
+{
+	list_del(&usb_scan->list);
+	free(usb_scan);
+}
+
+/* Wait for a device to connect to a port, returning true when one has */
+static bool usb_scan_port_connect(struct usb_device_scan *usb_scan)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(struct usb_port_status, portsts, 1);
 	unsigned short portstatus;
@@ -446,7 +560,7 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 	 * This is needed for voltages to stabalize.
 	 */
 	if (get_timer(0) < hub->query_delay)
-		return 0;
+		return false;
 
 	ret = usb_get_port_status(dev, i + 1, portsts);
 	if (ret < 0) {
@@ -455,11 +569,9 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 			debug("devnum=%d port=%d: timeout\n",
 			      dev->devnum, i + 1);
 			/* Remove this device from scanning list */
-			list_del(&usb_scan->list);
-			free(usb_scan);
-			return 0;
+			usb_scan_port_done(usb_scan);
 		}
-		return 0;
+		return false;
 	}
 
 	portstatus = le16_to_cpu(portsts->wPortStatus);
@@ -479,11 +591,9 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 			debug("devnum=%d port=%d: timeout\n",
 			      dev->devnum, i + 1);
 			/* Remove this device from scanning list */
-			list_del(&usb_scan->list);
-			free(usb_scan);
-			return 0;
+			usb_scan_port_done(usb_scan);
 		}
-		return 0;
+		return false;
 	}
 
 	if (portchange & USB_PORT_STAT_C_RESET) {
@@ -499,8 +609,20 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 
 	/* A new USB device is ready at this point */
 	debug("devnum=%d port=%d: USB dev found\n", dev->devnum, i + 1);
+	usb_scan->portstatus = portstatus;
+	usb_scan->portchange = portchange;
 
-	usb_hub_port_connect_change(dev, i);
+	return true;
+}
+
+/* Handle the other port changes once the device on a port is set up */
+static void usb_scan_port_finish(struct usb_device_scan *usb_scan)
+{
+	unsigned short portstatus = usb_scan->portstatus;
+	unsigned short portchange = usb_scan->portchange;
+	struct usb_device *dev = usb_scan->dev;
+	struct usb_hub_device *hub = usb_scan->hub;
+	int i = usb_scan->port;
 
 	if (portchange & USB_PORT_STAT_C_ENABLE) {
 		debug("port %d enable change, status %x\n", i + 1, portstatus);
@@ -513,14 +635,19 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 		/*
 		 * EM interference sometimes causes bad shielded USB
 		 * devices to be shutdown by the hub, this hack enables
-		 * them again. Works at least with mouse driver
+		 * them again. Works at least with mouse driver.
+		 *
+		 * The port goes back through the reset states, so that it
+		 * waits for any other port on the bus being set up.
 		 */
 		if (!(portstatus & USB_PORT_STAT_ENABLE) &&
 		    (portstatus & USB_PORT_STAT_CONNECTION) &&
 		    usb_device_has_child_on_port(dev, i)) {
 			debug("already running port %i disabled by hub (EMI?), re-enabling...\n",
 			      i + 1);
-			usb_hub_port_connect_change(dev, i);
+			usb_scan->portchange &= ~USB_PORT_STAT_C_ENABLE;
+			usb_scan->state = USB_SCAN_CONNECTED;
+			return;
 		}
 #endif
 	}
@@ -539,12 +666,14 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 		hub->overcurrent_count[i]++;
 
 		/*
-		 * If the max-scan-count is not reached, return without removing
-		 * the device from scan-list. This will re-issue a new scan.
+		 * If the max-scan-count is not reached, leave the device on
+		 * the scan-list. This will re-issue a new scan.
 		 */
 		if (hub->overcurrent_count[i] <=
-		    PORT_OVERCURRENT_MAX_SCAN_COUNT)
-			return 0;
+		    PORT_OVERCURRENT_MAX_SCAN_COUNT) {
+			usb_scan->state = USB_SCAN_WAIT_CONNECT;
+			return;
+		}
 
 		/* Otherwise the device will get removed */
 		printf("Port %d over-current occurred %d times\n", i + 1,
@@ -555,8 +684,74 @@ static int usb_scan_port(struct usb_device_scan *usb_scan)
 	 * We're done with this device, so let's remove this device from
 	 * scanning list
 	 */
-	list_del(&usb_scan->list);
-	free(usb_scan);
+	usb_scan_port_done(usb_scan);
+}
+
+/**
+ * usb_scan_port() - move a port on the scanning list along
+ *
+ * This never waits. Ports which are waiting for a delay to expire are left
+ * for the next time around the list.
+ *
+ * @usb_scan:	Port to scan, which is removed from the list once it is done
+ * @return 0 (ports with errors are just removed from the list)
+ */
+static int usb_scan_port(struct usb_device_scan *usb_scan)
+{
+	struct usb_device *dev = usb_scan->dev;
+	unsigned short portstatus;
+	int i = usb_scan->port;
+	int ret;
+
+	switch (usb_scan->state) {
+	case USB_SCAN_WAIT_CONNECT:
+		if (!usb_scan_port_connect(usb_scan))
+			return 0;
+		usb_scan->state = USB_SCAN_CONNECTED;
+		/* fall through */
+	case USB_SCAN_CONNECTED:
+		if (usb_scan_bus_busy(usb_scan))
+			return 0;
+		ret = usb_hub_port_check_connect(dev, i);
+		if (!ret) {
+			debug("%s: resetting port %d...\n", __func__, i + 1);
+			ret = usb_set_port_feature(dev, i + 1,
+						   USB_PORT_FEAT_RESET);
+		}
+		if (ret < 0)
+			break;
+		usb_scan->state = USB_SCAN_RESET;
+		usb_scan->timeout = usb_hub_deadline(HUB_SHORT_RESET_TIME);
+		usb_scan->tries = 1;
+		/* fall through */
+	case USB_SCAN_RESET:
+		if (get_timer(0) < usb_scan->timeout)
+			return 0;
+		ret = usb_hub_port_reset_check(dev, i, &portstatus);
+		if (ret == -EAGAIN && usb_scan->tries < MAX_TRIES) {
+			/* Try again with the long reset delay */
+			ret = usb_set_port_feature(dev, i + 1,
+						   USB_PORT_FEAT_RESET);
+			if (!ret) {
+				usb_scan->timeout =
+					usb_hub_deadline(HUB_LONG_RESET_TIME);
+				usb_scan->tries++;
+				return 0;
+			}
+		}
+		if (ret) {
+			debug("Cannot enable port %i after %i tries\n", i + 1,
+			      usb_scan->tries);
+			if (ret != -ENXIO)
+				printf("cannot reset port %i!?\n", i + 1);
+			break;
+		}
+
+		/* This sets the address, so the bus is free again after it */
+		usb_hub_port_enumerate(dev, i, portstatus);
+		break;
+	}
+	usb_scan_port_finish(usb_scan);
 
 	return 0;
 }
@@ -565,14 +760,15 @@ static int usb_device_list_scan(void)
 {
 	struct usb_device_scan *usb_scan;
 	struct usb_device_scan *tmp;
-	static int running;
 	int ret = 0;
+	int span;
 
 	/* Only run this loop once for each controller */
-	if (running)
+	if (usb_scan_running)
 		return 0;
 
-	running = 1;
+	usb_scan_running = 1;
+	span = bootstage_span_begin("usb", "scan");
 
 	while (1) {
 		/* We're done, once the list is empty again */
@@ -590,12 +786,14 @@ static int usb_device_list_scan(void)
 	}
 
 out:
+	bootstage_span_end(span);
+
 	/*
 	 * This USB controller has finished scanning all its connected
 	 * USB devices. Set "running" back to 0, so that other USB controllers
 	 * will scan their devices too.
 	 */
-	running = 0;
+	usb_scan_running = 0;
 
 	return ret;
 }
@@ -938,6 +1136,18 @@ int usb_hub_scan(struct udevice *hub)
 	return usb_hub_configure(udev);
 }
 
+void usb_hub_scan_begin(void)
+{
+	usb_scan_running = 1;
+}
+
+int usb_hub_scan_end(void)
+{
+	usb_scan_running = 0;
+
+	return usb_device_list_scan();
+}
+
 static int usb_hub_post_probe(struct udevice *dev)
 {
 	debug("%s\n", __func__);
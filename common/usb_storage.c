@@ -42,6 +42,7 @@
 #include <asm/processor.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <linux/usb/uas.h>
 
 #include <part.h>
 #include <usb.h>
@@ -83,6 +84,8 @@ struct us_data {
 	unsigned char	ep_in;			/* in endpoint */
 	unsigned char	ep_out;			/* out ....... */
 	unsigned char	ep_int;			/* interrupt . */
+	unsigned char	ep_cmd;			/* UAS command */
+	unsigned char	ep_status;		/* UAS status */
 	unsigned char	subclass;		/* as in overview */
 	unsigned char	protocol;		/* .............. */
 	unsigned char	attention_done;		/* force attn on first cmd */
@@ -171,6 +174,10 @@ static unsigned int usb_get_max_lun(struct us_data *us)
 {
 	int len;
 	ALLOC_CACHE_ALIGN_BUFFER(unsigned char, result, 1);
+
+	/* UAS has no Get Max LUN request, so only LUN 0 is used */
+	if (us->protocol == US_PR_UAS)
+		return 0;
 	len = usb_control_msg(us->pusb_dev,
 			      usb_rcvctrlpipe(us->pusb_dev, 0),
 			      US_BBB_GET_MAX_LUN,
@@ -733,13 +740,29 @@ static int usb_stor_BBB_transport(struct scsi_cmd *srb, struct us_data *us)
 	if (srb->datalen == 0)
 		goto st;
 	debug("DATA phase\n");
-	if (dir_in)
-		pipe = pipein;
-	else
-		pipe = pipeout;
+	if (dir_in) {
+		struct usb_bulk_xfer xfer[2] = {
+			{ .buffer = srb->pdata, .length = srb->datalen },
+			{ .buffer = csw, .length = UMASS_BBB_CSW_SIZE },
+		};
 
-	result = usb_bulk_msg(us->pusb_dev, pipe, srb->pdata, srb->datalen,
-			      &data_actlen, USB_CNTL_TIMEOUT * 5);
+		/*
+		 * Queue the STATUS phase behind the data, so the controller
+		 * can read the CSW as soon as the data is in
+		 */
+		result = usb_bulk_stream(us->pusb_dev, pipein, xfer, 2,
+					 USB_CNTL_TIMEOUT * 5);
+		data_actlen = xfer[0].act_len;
+		if (!xfer[0].status) {
+			retry = 0;
+			actlen = xfer[1].act_len;
+			goto st_done;
+		}
+	} else {
+		result = usb_bulk_msg(us->pusb_dev, pipeout, srb->pdata,
+				      srb->datalen, &data_actlen,
+				      USB_CNTL_TIMEOUT * 5);
+	}
 	/* special handling of STALL in DATA phase */
 	if ((result < 0) && (us->pusb_dev->status & USB_ST_STALLED)) {
 		debug("DATA:stall\n");
@@ -768,7 +791,7 @@ again:
 	debug("STATUS phase\n");
 	result = usb_bulk_msg(us->pusb_dev, pipein, csw, UMASS_BBB_CSW_SIZE,
 				&actlen, USB_CNTL_TIMEOUT*5);
-
+st_done:
 	/* special handling of STALL in STATUS phase */
 	if ((result < 0) && (retry < 1) &&
 	    (us->pusb_dev->status & USB_ST_STALLED)) {
@@ -996,6 +1019,9 @@ static int usb_request_sense(struct scsi_cmd *srb, struct us_data *ss)
 {
 	char *ptr;
 
+	/* UAS returns the sense data along with the status of each command */
+	if (ss->protocol == US_PR_UAS)
+		return 0;
 	ptr = (char *)srb->pdata;
 	memset(&srb->cmd[0], 0, 12);
 	srb->cmd[0] = SCSI_REQ_SENSE;
@@ -1061,11 +1087,11 @@ static int usb_read_capacity(struct scsi_cmd *srb, struct us_data *ss)
 	return -1;
 }
 
-static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
-		       unsigned long start, unsigned short blocks)
+static void usb_setup_rw_10(struct scsi_cmd *srb, unsigned char opcode,
+			    unsigned long start, unsigned short blocks)
 {
 	memset(&srb->cmd[0], 0, 12);
-	srb->cmd[0] = SCSI_READ10;
+	srb->cmd[0] = opcode;
 	srb->cmd[1] = srb->lun << 5;
 	srb->cmd[2] = ((unsigned char) (start >> 24)) & 0xff;
 	srb->cmd[3] = ((unsigned char) (start >> 16)) & 0xff;
@@ -1074,6 +1100,12 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 	srb->cmd[7] = ((unsigned char) (blocks >> 8)) & 0xff;
 	srb->cmd[8] = (unsigned char) blocks & 0xff;
 	srb->cmdlen = 12;
+}
+
+static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
+		       unsigned long start, unsigned short blocks)
+{
+	usb_setup_rw_10(srb, SCSI_READ10, start, blocks);
 	debug("read10: start %lx blocks %x\n", start, blocks);
 	return ss->transport(srb, ss);
 }
@@ -1081,20 +1113,344 @@ static int usb_read_10(struct scsi_cmd *srb, struct us_data *ss,
 static int usb_write_10(struct scsi_cmd *srb, struct us_data *ss,
 			unsigned long start, unsigned short blocks)
 {
-	memset(&srb->cmd[0], 0, 12);
-	srb->cmd[0] = SCSI_WRITE10;
-	srb->cmd[1] = srb->lun << 5;
-	srb->cmd[2] = ((unsigned char) (start >> 24)) & 0xff;
-	srb->cmd[3] = ((unsigned char) (start >> 16)) & 0xff;
-	srb->cmd[4] = ((unsigned char) (start >> 8)) & 0xff;
-	srb->cmd[5] = ((unsigned char) (start)) & 0xff;
-	srb->cmd[7] = ((unsigned char) (blocks >> 8)) & 0xff;
-	srb->cmd[8] = (unsigned char) blocks & 0xff;
-	srb->cmdlen = 12;
+	usb_setup_rw_10(srb, SCSI_WRITE10, start, blocks);
 	debug("write10: start %lx blocks %x\n", start, blocks);
 	return ss->transport(srb, ss);
 }
 
+#ifdef CONFIG_USB_UAS
+/* Commands for usb_stor_uas_rw(), with tags 1 to CONFIG_USB_UAS_QUEUE_DEPTH */
+static struct scsi_cmd uas_ccb[CONFIG_USB_UAS_QUEUE_DEPTH]
+	__aligned(ARCH_DMA_MINALIGN);
+
+/* Tag used for task management, which never clashes with a command */
+#define UAS_TMF_TAG	(CONFIG_USB_UAS_QUEUE_DEPTH + 1)
+
+static int usb_stor_uas_reset(struct us_data *us)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct task_mgmt_iu, tmf, 1);
+	ALLOC_CACHE_ALIGN_BUFFER(struct sense_iu, iu, 1);
+	struct usb_device *udev = us->pusb_dev;
+	struct response_iu *resp = (struct response_iu *)iu;
+	int actlen, ret, i;
+
+	debug("UAS reset\n");
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_cmd));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_status));
+	usb_clear_halt(udev, usb_rcvbulkpipe(udev, us->ep_in));
+	usb_clear_halt(udev, usb_sndbulkpipe(udev, us->ep_out));
+
+	memset(tmf, '\0', sizeof(*tmf));
+	tmf->iu_id = IU_ID_TASK_MGMT;
+	tmf->tag = cpu_to_be16(UAS_TMF_TAG);
+	tmf->function = TMF_LOGICAL_UNIT_RESET;
+	ret = usb_bulk_msg(udev, usb_sndbulkpipe(udev, us->ep_cmd), tmf,
+			   sizeof(*tmf), &actlen, USB_CNTL_TIMEOUT * 5);
+	if (ret)
+		return ret;
+
+	/* Skip the status of any commands which were still queued */
+	for (i = 0; i <= CONFIG_USB_UAS_QUEUE_DEPTH; i++) {
+		ret = usb_bulk_msg(udev, usb_rcvbulkpipe(udev, us->ep_status),
+				   iu, sizeof(*iu), &actlen,
+				   USB_CNTL_TIMEOUT * 5);
+		if (ret)
+			return ret;
+		if (resp->iu_id == IU_ID_RESPONSE &&
+		    be16_to_cpu(resp->tag) == UAS_TMF_TAG)
+			break;
+	}
+	if (i > CONFIG_USB_UAS_QUEUE_DEPTH ||
+	    (resp->response_code != RC_TMF_COMPLETE &&
+	     resp->response_code != RC_TMF_SUCCEEDED)) {
+		debug("UAS reset failed\n");
+		return -EIO;
+	}
+
+	return 0;
+}
+
+static int usb_stor_uas_send_cmd(struct scsi_cmd *srb, struct us_data *us,
+				 int tag)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct command_iu, iu, 1);
+	struct usb_device *udev = us->pusb_dev;
+	int actlen;
+
+	memset(iu, '\0', sizeof(*iu));
+	iu->iu_id = IU_ID_COMMAND;
+	iu->tag = cpu_to_be16(tag);
+	iu->prio_attr = UAS_SIMPLE_TAG;
+	iu->lun[1] = srb->lun;
+	memcpy(iu->cdb, srb->cmd, min_t(int, srb->cmdlen, sizeof(iu->cdb)));
+
+	return usb_bulk_msg(udev, usb_sndbulkpipe(udev, us->ep_cmd), iu,
+			    sizeof(*iu), &actlen, USB_CNTL_TIMEOUT * 5);
+}
+
+/**
+ * usb_stor_uas_run() - Run SCSI commands on a UAS device
+ *
+ * All the commands are queued on the device before any status is read, each
+ * tagged with its position in @srb plus one. The device then says which
+ * command it is ready to move data for, so the data phases may happen in any
+ * order. The SCSI status of each command is returned in its status field,
+ * with the sense data in sense_buf and the number of bytes moved in
+ * trans_bytes.
+ *
+ * @srb:	Commands to run
+ * @count:	Number of commands (at most CONFIG_USB_UAS_QUEUE_DEPTH)
+ * @us:		Device to run them on
+ * @return USB_STOR_TRANSPORT_GOOD if all commands completed, whatever their
+ * SCSI status, else USB_STOR_TRANSPORT_FAILED
+ */
+static int usb_stor_uas_run(struct scsi_cmd *srb, int count,
+			    struct us_data *us)
+{
+	ALLOC_CACHE_ALIGN_BUFFER(struct sense_iu, iu, 1);
+	struct usb_device *udev = us->pusb_dev;
+	struct scsi_cmd *cmd;
+	int pending, actlen, tag, len, pipe, dir_in, i;
+
+	for (i = 0; i < count; i++) {
+		srb[i].status = S_ILLEGAL;
+		srb[i].trans_bytes = 0;
+		if (usb_stor_uas_send_cmd(&srb[i], us, i + 1))
+			goto err;
+	}
+
+	for (pending = count; pending;) {
+		if (usb_bulk_msg(udev, usb_rcvbulkpipe(udev, us->ep_status),
+				 iu, sizeof(*iu), &actlen,
+				 USB_CNTL_TIMEOUT * 5) ||
+		    actlen < sizeof(struct iu))
+			goto err;
+		tag = be16_to_cpu(iu->tag);
+		if (tag < 1 || tag > count || srb[tag - 1].status != S_ILLEGAL)
+			goto err;
+		cmd = &srb[tag - 1];
+		switch (iu->iu_id) {
+		case IU_ID_READ_READY:
+		case IU_ID_WRITE_READY:
+			dir_in = iu->iu_id == IU_ID_READ_READY;
+			if (dir_in != US_DIRECTION(cmd->cmd[0]))
+				goto err;
+			if (dir_in)
+				pipe = usb_rcvbulkpipe(udev, us->ep_in);
+			else
+				pipe = usb_sndbulkpipe(udev, us->ep_out);
+			if (usb_bulk_msg(udev, pipe, cmd->pdata, cmd->datalen,
+					 &actlen, USB_CNTL_TIMEOUT * 5))
+				goto err;
+			cmd->trans_bytes = actlen;
+			break;
+		case IU_ID_STATUS:
+			len = actlen - offsetof(struct sense_iu, sense);
+			len = min_t(int, len, be16_to_cpu(iu->len));
+			len = clamp_t(int, len, 0, sizeof(cmd->sense_buf));
+			memset(cmd->sense_buf, '\0', sizeof(cmd->sense_buf));
+			memcpy(cmd->sense_buf, iu->sense, len);
+			cmd->status = iu->status;
+			pending--;
+			break;
+		default:
+			/* e.g. a Response IU saying that the command was bad */
+			debug("UAS: IU %x for tag %d\n", iu->iu_id, tag);
+			goto err;
+		}
+	}
+
+	return USB_STOR_TRANSPORT_GOOD;
+err:
+	debug("UAS transfer failed, status %lx\n", udev->status);
+	usb_stor_uas_reset(us);
+
+	return USB_STOR_TRANSPORT_FAILED;
+}
+
+static int usb_stor_uas_transport(struct scsi_cmd *srb, struct us_data *us)
+{
+	int result;
+
+	result = usb_stor_uas_run(srb, 1, us);
+	if (result != USB_STOR_TRANSPORT_GOOD)
+		return result;
+	if (srb->status != S_GOOD) {
+		debug("cmd %02x status %02x sense %02x %02x %02x\n",
+		      srb->cmd[0], srb->status, srb->sense_buf[2],
+		      srb->sense_buf[12], srb->sense_buf[13]);
+		return USB_STOR_TRANSPORT_FAILED;
+	}
+
+	return USB_STOR_TRANSPORT_GOOD;
+}
+
+/**
+ * usb_stor_uas_rw() - Read or write blocks with several commands queued
+ *
+ * @ss:		Device to use
+ * @block_dev:	Block device (LUN) to use
+ * @opcode:	SCSI_READ10 or SCSI_WRITE10
+ * @start:	First block to transfer
+ * @blkcnt:	Number of blocks to transfer
+ * @buf_addr:	Address of buffer
+ * @return number of blocks transferred
+ */
+static lbaint_t usb_stor_uas_rw(struct us_data *ss, struct blk_desc *block_dev,
+				unsigned char opcode, lbaint_t start,
+				lbaint_t blkcnt, uintptr_t buf_addr)
+{
+	lbaint_t done, todo, blks;
+	struct scsi_cmd *srb;
+	int count, retry, ret, i;
+
+	retry = 2;
+	for (done = 0; done < blkcnt;) {
+		todo = done;
+		for (count = 0; count < CONFIG_USB_UAS_QUEUE_DEPTH &&
+		     todo < blkcnt; count++) {
+			srb = &uas_ccb[count];
+			blks = min(blkcnt - todo, (lbaint_t)ss->max_xfer_blk);
+			if (blks == ss->max_xfer_blk)
+				usb_show_progress();
+			srb->lun = block_dev->lun;
+			srb->pdata = (unsigned char *)buf_addr +
+					todo * block_dev->blksz;
+			srb->datalen = block_dev->blksz * blks;
+			usb_setup_rw_10(srb, opcode, start + todo, blks);
+			todo += blks;
+		}
+		ret = usb_stor_uas_run(uas_ccb, count, ss);
+
+		/* Count the blocks of the leading commands which succeeded */
+		for (i = 0; i < count && !ret; i++) {
+			srb = &uas_ccb[i];
+			if (srb->status != S_GOOD ||
+			    srb->trans_bytes != srb->datalen)
+				break;
+			done += srb->datalen / block_dev->blksz;
+		}
+		if (ret || i < count) {
+			debug("%s ERROR\n", opcode == SCSI_READ10 ? "Read" :
+			      "Write");
+			if (!retry--)
+				break;
+		}
+	}
+
+	return done;
+}
+
+/*
+ * Find the UAS alternate setting of an interface and its pipes. The pipe
+ * usage descriptors are dropped by usb_parse_config(), so this reads the
+ * configuration descriptor again.
+ */
+static int usb_stor_uas_find(struct usb_device *dev, int ifnum,
+			     struct us_data *ss)
+{
+	struct usb_interface_descriptor *idesc;
+	struct usb_pipe_usage_descriptor *pdesc;
+	struct usb_descriptor_header *head;
+	unsigned char ep[DATA_OUT_PIPE_ID + 1];
+	int len, pos, alt, found = -ENOENT;
+	unsigned char *buf;
+	bool dir_in;
+	u8 addr = 0;
+
+	len = usb_get_configuration_len(dev, dev->configno);
+	if (len < 0)
+		return len;
+	buf = malloc_cache_aligned(len);
+	if (!buf)
+		return -ENOMEM;
+	len = usb_get_configuration_no(dev, dev->configno, buf, len);
+
+	alt = -1;
+	for (pos = 0; pos + 2 <= len && found < 0; pos += head->bLength) {
+		head = (struct usb_descriptor_header *)&buf[pos];
+		if (head->bLength < 2)
+			break;
+		switch (head->bDescriptorType) {
+		case USB_DT_INTERFACE:
+			idesc = (struct usb_interface_descriptor *)head;
+			alt = -1;
+			if (head->bLength >= USB_DT_INTERFACE_SIZE &&
+			    idesc->bInterfaceNumber == ifnum &&
+			    idesc->bInterfaceClass == USB_CLASS_MASS_STORAGE &&
+			    idesc->bInterfaceSubClass == US_SC_SCSI &&
+			    idesc->bInterfaceProtocol == US_PR_UAS)
+				alt = idesc->bAlternateSetting;
+			memset(ep, '\0', sizeof(ep));
+			break;
+		case USB_DT_ENDPOINT:
+			addr = ((struct usb_endpoint_descriptor *)head)->
+				bEndpointAddress;
+			break;
+		case USB_DT_PIPE_USAGE:
+			pdesc = (struct usb_pipe_usage_descriptor *)head;
+			if (alt < 0 || head->bLength < sizeof(*pdesc) ||
+			    pdesc->bPipeID < CMD_PIPE_ID ||
+			    pdesc->bPipeID > DATA_OUT_PIPE_ID)
+				break;
+			dir_in = pdesc->bPipeID == STATUS_PIPE_ID ||
+				pdesc->bPipeID == DATA_IN_PIPE_ID;
+			if (dir_in == !!(addr & USB_DIR_IN))
+				ep[pdesc->bPipeID] = addr &
+					USB_ENDPOINT_NUMBER_MASK;
+			if (ep[CMD_PIPE_ID] && ep[STATUS_PIPE_ID] &&
+			    ep[DATA_IN_PIPE_ID] && ep[DATA_OUT_PIPE_ID])
+				found = alt;
+			break;
+		}
+	}
+	free(buf);
+	if (found < 0)
+		return found;
+
+	ss->ep_cmd = ep[CMD_PIPE_ID];
+	ss->ep_status = ep[STATUS_PIPE_ID];
+	ss->ep_in = ep[DATA_IN_PIPE_ID];
+	ss->ep_out = ep[DATA_OUT_PIPE_ID];
+	debug("UAS alt %d, endpoints Cmd %d Status %d In %d Out %d\n", found,
+	      ss->ep_cmd, ss->ep_status, ss->ep_in, ss->ep_out);
+
+	return found;
+}
+
+/* Set up a device to use UAS if it supports it, returning 0 if so */
+static int usb_stor_uas_probe(struct usb_device *dev,
+			      struct usb_interface *iface, struct us_data *ss)
+{
+	int ifnum = iface->desc.bInterfaceNumber;
+	int alt;
+
+	/* At SuperSpeed, UAS needs streams, which are not supported */
+	if (dev->speed >= USB_SPEED_SUPER)
+		return -ENOTSUPP;
+	alt = usb_stor_uas_find(dev, ifnum, ss);
+	if (alt < 0)
+		return alt;
+	if (usb_set_interface(dev, ifnum, alt)) {
+		debug("Cannot select UAS\n");
+		return -EIO;
+	}
+	debug("UAS\n");
+	ss->subclass = US_SC_SCSI;
+	ss->protocol = US_PR_UAS;
+	ss->transport = usb_stor_uas_transport;
+	ss->transport_reset = usb_stor_uas_reset;
+
+	return 0;
+}
+#else
+static int usb_stor_uas_probe(struct usb_device *dev,
+			      struct usb_interface *iface, struct us_data *ss)
+{
+	return -ENOSYS;
+}
+#endif
+
 
 #ifdef CONFIG_USB_BIN_FIXUP
 /*
@@ -1164,6 +1520,14 @@ static unsigned long usb_stor_read(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_read: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
+#ifdef CONFIG_USB_UAS
+	if (ss->protocol == US_PR_UAS) {
+		blkcnt = usb_stor_uas_rw(ss, block_dev, SCSI_READ10, start,
+					 blks, buf_addr);
+		usb_disable_asynch(0); /* asynch transfer allowed */
+		return blkcnt;
+	}
+#endif
 	do {
 		/* XXX need some comment here */
 		retry = 2;
@@ -1247,6 +1611,14 @@ static unsigned long usb_stor_write(struct blk_desc *block_dev, lbaint_t blknr,
 	debug("\nusb_write: dev %d startblk " LBAF ", blccnt " LBAF " buffer %lx\n",
 	      block_dev->devnum, start, blks, buf_addr);
 
+#ifdef CONFIG_USB_UAS
+	if (ss->protocol == US_PR_UAS) {
+		blkcnt = usb_stor_uas_rw(ss, block_dev, SCSI_WRITE10, start,
+					 blks, buf_addr);
+		usb_disable_asynch(0); /* asynch transfer allowed */
+		return blkcnt;
+	}
+#endif
 	do {
 		/* If write fails retry for max retry count else
 		 * return with number of blocks written successfully.
@@ -1320,6 +1692,10 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 	ss->subclass = iface->desc.bInterfaceSubClass;
 	ss->protocol = iface->desc.bInterfaceProtocol;
 
+	/* Use UAS if the device has it, else the protocol of alternate 0 */
+	if (!usb_stor_uas_probe(dev, iface, ss))
+		goto check_subclass;
+
 	/* set the handler pointers based on the protocol */
 	debug("Transport: ");
 	switch (ss->protocol) {
@@ -1382,6 +1758,7 @@ int usb_storage_probe(struct usb_device *dev, unsigned int ifnum,
 		debug("Problems with device\n");
 		return 0;
 	}
+check_subclass:
 	/* set class specific stuff */
 	/* We only handle certain protocols.  Currently, these are
 	 * the only ones.
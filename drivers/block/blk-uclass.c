@@ -10,6 +10,8 @@
 #include <dm/device-internal.h>
 #include <dm/lists.h>
 #include <dm/uclass-internal.h>
+#include <linux/err.h>
+#include <tracepoint.h>
 
 static const char *if_typename_str[IF_TYPE_COUNT] = {
 	[IF_TYPE_IDE]		= "ide",
@@ -432,6 +434,7 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
 	ulong blks_read;
+	ulong tp;
 
 	if (!ops->read)
 		return -ENOSYS;
@@ -439,7 +442,11 @@ unsigned long blk_dread(struct blk_desc *block_dev, lbaint_t start,
 	if (blkcache_read(block_dev->if_type, block_dev->devnum,
 			  start, blkcnt, block_dev->blksz, buffer))
 		return blkcnt;
+	tp = tracepoint_start(TP_BLK_READ);
 	blks_read = ops->read(dev, start, blkcnt, buffer);
+	tracepoint_end(TP_BLK_READ, tp, dev->name, start, blks_read);
+	if (!IS_ERR_VALUE(blks_read))
+		bootstage_span_add_bytes(blks_read * block_dev->blksz);
 	if (blks_read == blkcnt)
 		blkcache_fill(block_dev->if_type, block_dev->devnum,
 			      start, blkcnt, block_dev->blksz, buffer);
@@ -452,12 +459,18 @@ unsigned long blk_dwrite(struct blk_desc *block_dev, lbaint_t start,
 {
 	struct udevice *dev = block_dev->bdev;
 	const struct blk_ops *ops = blk_get_ops(dev);
+	ulong blks_written;
+	ulong tp;
 
 	if (!ops->write)
 		return -ENOSYS;
 
 	blkcache_invalidate(block_dev->if_type, block_dev->devnum);
-	return ops->write(dev, start, blkcnt, buffer);
+	tp = tracepoint_start(TP_BLK_WRITE);
+	blks_written = ops->write(dev, start, blkcnt, buffer);
+	tracepoint_end(TP_BLK_WRITE, tp, dev->name, start, blks_written);
+
+	return blks_written;
 }
 
 unsigned long blk_derase(struct blk_desc *block_dev, lbaint_t start,
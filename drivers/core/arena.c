@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Arena for allocating devices and their data in a few large blocks
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/platdata.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static struct dm_arena_chunk *dm_arena_new_chunk(ulong size)
+{
+	struct dm_arena_chunk *chunk;
+
+	chunk = calloc(1, sizeof(*chunk) + size);
+	if (!chunk)
+		return NULL;
+	chunk->size = size;
+
+	return chunk;
+}
+
+/* Free all but the first chunk allocated, leaving the arena empty */
+static void dm_arena_reset(struct dm_arena *arena)
+{
+	struct dm_arena_chunk *chunk;
+
+	while (arena->chunks->next) {
+		chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	arena->chunks->used = 0;
+}
+
+/* Count the devices which might be bound, to size the arena */
+static int dm_arena_count_devices(void)
+{
+	int count = ll_entry_count(struct driver_info, driver_info);
+
+#if CONFIG_IS_ENABLED(OF_CONTROL) && !CONFIG_IS_ENABLED(OF_PLATDATA)
+	/* A live tree is built from this, perhaps only partly so far */
+	if (gd->fdt_blob) {
+		int offset;
+
+		for (offset = 0; offset >= 0;
+		     offset = fdt_next_node(gd->fdt_blob, offset, NULL))
+			count++;
+	}
+#endif
+
+	return count;
+}
+
+int dm_arena_init(void)
+{
+	struct dm_arena *arena = gd->dm_arena;
+
+	/* malloc_simple() has no overhead, so there is nothing to gain */
+	if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+		return 0;
+
+	/* Devices from an earlier driver model may still use the old arena */
+	if (arena && !arena->live) {
+		dm_arena_reset(arena);
+		arena->open = true;
+		return 0;
+	}
+	if (arena)
+		arena->open = false;
+
+	arena = calloc(1, sizeof(*arena));
+	if (!arena)
+		return -ENOMEM;
+	arena->chunks = dm_arena_new_chunk(dm_arena_count_devices() *
+					   DM_ARENA_DEV_SIZE);
+	if (!arena->chunks) {
+		free(arena);
+		return -ENOMEM;
+	}
+	arena->prev = gd->dm_arena;
+	arena->open = true;
+	gd->dm_arena = arena;
+
+	return 0;
+}
+
+void dm_arena_close(void)
+{
+	if (gd->dm_arena)
+		gd->dm_arena->open = false;
+}
+
+void *dm_arena_alloc(ulong size)
+{
+	struct dm_arena *arena = gd->dm_arena;
+	struct dm_arena_chunk *chunk;
+	void *ptr;
+
+	if (!arena || !arena->open)
+		return NULL;
+	size = ALIGN(size, DM_ARENA_ALIGN);
+	chunk = arena->chunks;
+	if (chunk->used + size > chunk->size) {
+		chunk = dm_arena_new_chunk(max_t(ulong, size,
+						 DM_ARENA_CHUNK_SIZE));
+		if (!chunk)
+			return NULL;
+		chunk->next = arena->chunks;
+		arena->chunks = chunk;
+	}
+	ptr = chunk->data + chunk->used;
+	chunk->used += size;
+	chunk->live++;
+	/* The space may have been used by an earlier driver model */
+	memset(ptr, '\0', size);
+	arena->live++;
+	arena->allocs++;
+
+	return ptr;
+}
+
+/**
+ * dm_arena_find() - Find the arena holding a pointer
+ *
+ * @ptr: Pointer to look up
+ * @newerp: Returns the next newer arena, or NULL if the arena is the current
+ * @chunkp: Returns the chunk holding @ptr
+ * @prevp: Returns the next newer chunk in the arena, or NULL if none
+ * @return arena holding @ptr, or NULL if none
+ */
+static struct dm_arena *dm_arena_find(const void *ptr, struct dm_arena **newerp,
+				      struct dm_arena_chunk **chunkp,
+				      struct dm_arena_chunk **prevp)
+{
+	struct dm_arena_chunk *chunk;
+	struct dm_arena *arena;
+
+	*newerp = NULL;
+	for (arena = gd->dm_arena; arena; *newerp = arena, arena = arena->prev) {
+		*prevp = NULL;
+		for (chunk = arena->chunks; chunk;
+		     *prevp = chunk, chunk = chunk->next) {
+			if ((ulong)ptr >= (ulong)chunk->data &&
+			    (ulong)ptr < (ulong)chunk->data + chunk->used) {
+				*chunkp = chunk;
+				return arena;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+bool dm_arena_owns(const void *ptr)
+{
+	struct dm_arena_chunk *chunk, *prev;
+	struct dm_arena *newer;
+
+	return ptr && dm_arena_find(ptr, &newer, &chunk, &prev);
+}
+
+void dm_arena_free(void *ptr)
+{
+	struct dm_arena_chunk *chunk, *prev;
+	struct dm_arena *arena, *newer;
+
+	arena = ptr ? dm_arena_find(ptr, &newer, &chunk, &prev) : NULL;
+	if (!arena) {
+		free(ptr);
+		return;
+	}
+	chunk->live--;
+	if (--arena->live) {
+		/* Give back chunks added when the arena filled up */
+		if (!chunk->live && chunk->next) {
+			if (prev)
+				prev->next = chunk->next;
+			else
+				arena->chunks = chunk->next;
+			free(chunk);
+		}
+		return;
+	}
+
+	/* The space is reused once every block in the arena is freed */
+	if (arena == gd->dm_arena) {
+		dm_arena_reset(arena);
+		return;
+	}
+	newer->prev = arena->prev;
+	while (arena->chunks) {
+		chunk = arena->chunks;
+		arena->chunks = chunk->next;
+		free(chunk);
+	}
+	free(arena);
+}
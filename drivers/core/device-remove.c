@@ -84,21 +84,22 @@ int device_unbind(struct udevice *dev)
 		return ret;
 
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		dm_arena_free_data(dev->platdata);
 		dev->platdata = NULL;
 	}
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		dm_arena_free_data(dev->uclass_platdata);
 		dev->uclass_platdata = NULL;
 	}
 	if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-		free(dev->parent_platdata);
+		dm_arena_free_data(dev->parent_platdata);
 		dev->parent_platdata = NULL;
 	}
 	ret = uclass_unbind_device(dev);
 	if (ret)
 		return ret;
 
+	dm_lookup_remove_dev(dev);
 	if (dev->parent)
 		list_del(&dev->sibling_node);
 
@@ -106,7 +107,7 @@ int device_unbind(struct udevice *dev)
 
 	if (dev->flags & DM_FLAG_NAME_ALLOCED)
 		free((char *)dev->name);
-	free(dev);
+	dm_arena_free(dev);
 
 	return 0;
 }
@@ -120,12 +121,12 @@ void device_free(struct udevice *dev)
 	int size;
 
 	if (dev->driver->priv_auto_alloc_size) {
-		free(dev->priv);
+		dm_arena_free_data(dev->priv);
 		dev->priv = NULL;
 	}
 	size = dev->uclass->uc_drv->per_device_auto_alloc_size;
 	if (size) {
-		free(dev->uclass_priv);
+		dm_arena_free_data(dev->uclass_priv);
 		dev->uclass_priv = NULL;
 	}
 	if (dev->parent) {
@@ -135,7 +136,7 @@ void device_free(struct udevice *dev)
 					per_child_auto_alloc_size;
 		}
 		if (size) {
-			free(dev->parent_priv);
+			dm_arena_free_data(dev->parent_priv);
 			dev->parent_priv = NULL;
 		}
 	}
@@ -160,6 +161,10 @@ int device_remove(struct udevice *dev, uint flags)
 	if (!dev)
 		return -EINVAL;
 
+	/* Let an unfinished probe complete, or fail, before removing */
+	if (dev->flags & DM_FLAG_PROBE_STARTED)
+		device_probe(dev);
+
 	if (!(dev->flags & DM_FLAG_ACTIVATED))
 		return 0;
 
@@ -27,9 +27,105 @@
 #include <linux/err.h>
 #include <linux/list.h>
 #include <power-domain.h>
+#include <tracepoint.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
+/**
+ * struct device_arena_layout - Where a device's data goes in its arena block
+ *
+ * A device allocated from the arena has space for its private data just
+ * after the struct udevice, so that probing it again does not allocate more
+ * memory. Its platform data follows this.
+ *
+ * @priv: Offset of the private data, or 0 if none
+ * @uclass_priv: Offset of the uclass private data, or 0 if none
+ * @parent_priv: Offset of the parent private data, or 0 if none
+ * @size: Size of the block up to the end of the private data
+ */
+struct device_arena_layout {
+	int priv;
+	int uclass_priv;
+	int parent_priv;
+	int size;
+};
+
+static int device_arena_add(struct device_arena_layout *layout, int size,
+			    uint flags)
+{
+	int offset = layout->size;
+
+	/* DMA-aligned data must not share cache lines with anything else */
+	if (!size || (flags & DM_FLAG_ALLOC_PRIV_DMA))
+		return 0;
+	layout->size += ALIGN(size, DM_ARENA_ALIGN);
+
+	return offset;
+}
+
+static void device_arena_layout(const struct driver *drv, struct uclass *uc,
+				struct udevice *parent,
+				struct device_arena_layout *layout)
+{
+	int size = 0;
+
+	layout->size = ALIGN(sizeof(struct udevice), DM_ARENA_ALIGN);
+	layout->priv = device_arena_add(layout, drv->priv_auto_alloc_size,
+					drv->flags);
+	layout->uclass_priv = device_arena_add(layout,
+			uc->uc_drv->per_device_auto_alloc_size,
+			uc->uc_drv->flags);
+	if (parent) {
+		size = parent->driver->per_child_auto_alloc_size;
+		if (!size)
+			size = parent->uclass->uc_drv->per_child_auto_alloc_size;
+	}
+	layout->parent_priv = device_arena_add(layout, size, drv->flags);
+}
+
+/* Allocate a device from the arena, with room for all its data */
+static struct udevice *device_arena_alloc(const struct driver *drv,
+					  struct uclass *uc,
+					  struct udevice *parent, int *posp)
+{
+	struct device_arena_layout layout;
+	struct udevice *dev;
+	int size;
+
+	device_arena_layout(drv, uc, parent, &layout);
+	size = layout.size;
+	size += ALIGN(drv->platdata_auto_alloc_size, DM_ARENA_ALIGN);
+	size += ALIGN(uc->uc_drv->per_device_platdata_auto_alloc_size,
+		      DM_ARENA_ALIGN);
+	if (parent) {
+		size += ALIGN(max(parent->driver->
+				  per_child_platdata_auto_alloc_size,
+				  parent->uclass->uc_drv->
+				  per_child_platdata_auto_alloc_size),
+			      DM_ARENA_ALIGN);
+	}
+	dev = dm_arena_alloc(size);
+	if (!dev)
+		return NULL;
+	dev->flags = DM_FLAG_ARENA;
+	*posp = layout.size;
+
+	return dev;
+}
+
+/* Allocate zeroed data for a device, from its arena block if it has one */
+static void *device_alloc_data(struct udevice *dev, int *posp, int size)
+{
+	void *ptr;
+
+	if (!(dev->flags & DM_FLAG_ARENA))
+		return calloc(1, size);
+	ptr = (void *)dev + *posp;
+	*posp += ALIGN(size, DM_ARENA_ALIGN);
+
+	return ptr;
+}
+
 static int device_bind_common(struct udevice *parent, const struct driver *drv,
 			      const char *name, void *platdata,
 			      ulong driver_data, ofnode node,
@@ -38,6 +134,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	struct udevice *dev;
 	struct uclass *uc;
 	int size, ret = 0;
+	int pos = 0;
 
 	if (devp)
 		*devp = NULL;
@@ -50,7 +147,11 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		return ret;
 	}
 
-	dev = calloc(1, sizeof(struct udevice));
+	dev = NULL;
+	if (CONFIG_IS_ENABLED(DM_ARENA))
+		dev = device_arena_alloc(drv, uc, parent, &pos);
+	if (!dev)
+		dev = calloc(1, sizeof(struct udevice));
 	if (!dev)
 		return -ENOMEM;
 
@@ -100,8 +201,8 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (alloc) {
 			dev->flags |= DM_FLAG_ALLOC_PDATA;
-			dev->platdata = calloc(1,
-					       drv->platdata_auto_alloc_size);
+			dev->platdata = device_alloc_data(dev, &pos,
+					drv->platdata_auto_alloc_size);
 			if (!dev->platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc1;
@@ -116,7 +217,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	size = uc->uc_drv->per_device_platdata_auto_alloc_size;
 	if (size) {
 		dev->flags |= DM_FLAG_ALLOC_UCLASS_PDATA;
-		dev->uclass_platdata = calloc(1, size);
+		dev->uclass_platdata = device_alloc_data(dev, &pos, size);
 		if (!dev->uclass_platdata) {
 			ret = -ENOMEM;
 			goto fail_alloc2;
@@ -131,7 +232,8 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 		}
 		if (size) {
 			dev->flags |= DM_FLAG_ALLOC_PARENT_PDATA;
-			dev->parent_platdata = calloc(1, size);
+			dev->parent_platdata = device_alloc_data(dev, &pos,
+								 size);
 			if (!dev->parent_platdata) {
 				ret = -ENOMEM;
 				goto fail_alloc3;
@@ -146,6 +248,7 @@ static int device_bind_common(struct udevice *parent, const struct driver *drv,
 	ret = uclass_bind_device(dev);
 	if (ret)
 		goto fail_uclass_bind;
+	dm_lookup_add_dev(dev);
 
 	/* if we fail to bind we remove device from successors and free it */
 	if (drv->bind) {
@@ -184,6 +287,7 @@ fail_child_post_bind:
 	}
 
 fail_bind:
+	dm_lookup_remove_dev(dev);
 	if (CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)) {
 		if (uclass_unbind_device(dev)) {
 			dm_warn("Failed to unbind dev '%s' on error path\n",
@@ -194,24 +298,24 @@ fail_uclass_bind:
 	if (CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)) {
 		list_del(&dev->sibling_node);
 		if (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA) {
-			free(dev->parent_platdata);
+			dm_arena_free_data(dev->parent_platdata);
 			dev->parent_platdata = NULL;
 		}
 	}
 fail_alloc3:
 	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA) {
-		free(dev->uclass_platdata);
+		dm_arena_free_data(dev->uclass_platdata);
 		dev->uclass_platdata = NULL;
 	}
 fail_alloc2:
 	if (dev->flags & DM_FLAG_ALLOC_PDATA) {
-		free(dev->platdata);
+		dm_arena_free_data(dev->platdata);
 		dev->platdata = NULL;
 	}
 fail_alloc1:
 	devres_release_all(dev);
 
-	free(dev);
+	dm_arena_free(dev);
 
 	return ret;
 }
@@ -305,8 +409,41 @@ static void *alloc_priv(int size, uint flags)
 	return priv;
 }
 
-int device_probe(struct udevice *dev)
+/* Get private data for a device, using its arena block if there is room */
+static void *device_alloc_priv(struct udevice *dev, int offset, int size,
+			       uint flags)
+{
+	void *priv;
+
+	if (!offset)
+		return alloc_priv(size, flags);
+	priv = (void *)dev + offset;
+	memset(priv, '\0', size);
+
+	return priv;
+}
+
+/**
+ * device_probe_wait() - Wait for the driver to finish probing a device
+ *
+ * @dev: Device whose probe() method has been called
+ * @return 0 if OK, -ve on error
+ */
+static int device_probe_wait(struct udevice *dev)
+{
+	int ret;
+
+	do {
+		ret = dev->driver->probe_wait(dev);
+	} while (ret == -EBUSY);
+	dev->flags &= ~DM_FLAG_PROBE_STARTED;
+
+	return ret;
+}
+
+static int device_probe_common(struct udevice *dev, bool start_only)
 {
+	struct device_arena_layout layout;
 	struct power_domain pd;
 	const struct driver *drv;
 	int size = 0;
@@ -316,15 +453,25 @@ int device_probe(struct udevice *dev)
 	if (!dev)
 		return -EINVAL;
 
-	if (dev->flags & DM_FLAG_ACTIVATED)
-		return 0;
-
 	drv = dev->driver;
 	assert(drv);
 
+	if (dev->flags & DM_FLAG_ACTIVATED) {
+		if (!(dev->flags & DM_FLAG_PROBE_STARTED) || start_only)
+			return 0;
+		goto finish;
+	}
+
+	if (dev->flags & DM_FLAG_ARENA)
+		device_arena_layout(drv, dev->uclass, dev->parent, &layout);
+	else
+		memset(&layout, '\0', sizeof(layout));
+
 	/* Allocate private data if requested and not reentered */
 	if (drv->priv_auto_alloc_size && !dev->priv) {
-		dev->priv = alloc_priv(drv->priv_auto_alloc_size, drv->flags);
+		dev->priv = device_alloc_priv(dev, layout.priv,
+					      drv->priv_auto_alloc_size,
+					      drv->flags);
 		if (!dev->priv) {
 			ret = -ENOMEM;
 			goto fail;
@@ -333,8 +480,8 @@ int device_probe(struct udevice *dev)
 	/* Allocate private data if requested and not reentered */
 	size = dev->uclass->uc_drv->per_device_auto_alloc_size;
 	if (size && !dev->uclass_priv) {
-		dev->uclass_priv = alloc_priv(size,
-					      dev->uclass->uc_drv->flags);
+		dev->uclass_priv = device_alloc_priv(dev, layout.uclass_priv,
+				size, dev->uclass->uc_drv->flags);
 		if (!dev->uclass_priv) {
 			ret = -ENOMEM;
 			goto fail;
@@ -349,7 +496,8 @@ int device_probe(struct udevice *dev)
 					per_child_auto_alloc_size;
 		}
 		if (size && !dev->parent_priv) {
-			dev->parent_priv = alloc_priv(size, drv->flags);
+			dev->parent_priv = device_alloc_priv(dev,
+					layout.parent_priv, size, drv->flags);
 			if (!dev->parent_priv) {
 				ret = -ENOMEM;
 				goto fail;
@@ -422,6 +570,18 @@ int device_probe(struct udevice *dev)
 		}
 	}
 
+	if (drv->probe_wait) {
+		dev->flags |= DM_FLAG_PROBE_STARTED;
+		if (start_only)
+			return 0;
+	}
+finish:
+	if (dev->flags & DM_FLAG_PROBE_STARTED) {
+		ret = device_probe_wait(dev);
+		if (ret)
+			goto fail;
+	}
+
 	ret = uclass_post_probe_device(dev);
 	if (ret)
 		goto fail_uclass;
@@ -444,6 +604,31 @@ fail:
 	return ret;
 }
 
+int device_probe(struct udevice *dev)
+{
+	int span, ret;
+	ulong tp;
+
+	/* Only record devices which are probed here */
+	if (!dev || (dev->flags & DM_FLAG_ACTIVATED &&
+		     !(dev->flags & DM_FLAG_PROBE_STARTED)))
+		return device_probe_common(dev, false);
+
+	tp = tracepoint_start(TP_DM_PROBE);
+	span = bootstage_span_begin("probe", dev->name);
+	ret = device_probe_common(dev, false);
+	bootstage_span_end(span);
+	tracepoint_end(TP_DM_PROBE, tp, dev->name, dev->uclass->uc_drv->id,
+		       ret);
+
+	return ret;
+}
+
+int device_probe_start(struct udevice *dev)
+{
+	return device_probe_common(dev, true);
+}
+
 void *dev_get_platdata(const struct udevice *dev)
 {
 	if (!dev) {
@@ -534,6 +719,8 @@ static int device_find_by_ofnode(ofnode node, struct udevice **devp)
 	struct udevice *dev;
 	int ret;
 
+	if (!dm_lookup_find_by_ofnode(node, UCLASS_INVALID, devp))
+		return 0;
 	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
 		ret = uclass_find_device_by_ofnode(uc->uc_drv->id, node,
 						   &dev);
@@ -624,6 +811,13 @@ int device_get_child_by_of_offset(struct udevice *parent, int node,
 	return device_get_device_tail(dev, ret, devp);
 }
 
+void dev_set_ofnode(struct udevice *dev, ofnode node)
+{
+	dm_lookup_remove_dev(dev);
+	dev->node = node;
+	dm_lookup_add_dev(dev);
+}
+
 static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 						     ofnode ofnode)
 {
@@ -643,6 +837,8 @@ static struct udevice *_device_find_global_by_ofnode(struct udevice *parent,
 
 int device_find_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
+	if (!dm_lookup_find_by_ofnode(ofnode, UCLASS_INVALID, devp))
+		return 0;
 	*devp = _device_find_global_by_ofnode(gd->dm_root, ofnode);
 
 	return *devp ? 0 : -ENOENT;
@@ -652,7 +848,8 @@ int device_get_global_by_ofnode(ofnode ofnode, struct udevice **devp)
 {
 	struct udevice *dev;
 
-	dev = _device_find_global_by_ofnode(gd->dm_root, ofnode);
+	if (device_find_global_by_ofnode(ofnode, &dev))
+		dev = NULL;
 	return device_get_device_tail(dev, dev ? 0 : -ENOENT, devp);
 }
 
@@ -691,7 +888,7 @@ int device_find_first_inactive_child(struct udevice *parent,
 
 	*devp = NULL;
 	list_for_each_entry(dev, &parent->child_head, sibling_node) {
-		if (!device_active(dev) &&
+		if (!(dev->flags & DM_FLAG_ACTIVATED) &&
 		    device_get_uclass_id(dev) == uclass_id) {
 			*devp = dev;
 			return 0;
@@ -778,7 +975,8 @@ bool device_has_active_children(struct udevice *dev)
 	for (device_find_first_child(dev, &child);
 	     child;
 	     device_find_next_child(&child)) {
-		if (device_active(child))
+		/* A child whose probe is still pending counts as active */
+		if (child->flags & DM_FLAG_ACTIVATED)
 			return true;
 	}
 
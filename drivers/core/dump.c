@@ -6,10 +6,13 @@
 #include <common.h>
 #include <dm.h>
 #include <mapmem.h>
+#include <dm/device-internal.h>
 #include <dm/root.h>
 #include <dm/util.h>
 #include <dm/uclass-internal.h>
 
+DECLARE_GLOBAL_DATA_PTR;
+
 static void show_devices(struct udevice *dev, int depth, int last_flag)
 {
 	int i, is_last;
@@ -96,3 +99,104 @@ void dm_dump_uclass(void)
 		puts("\n");
 	}
 }
+
+void dm_dump_stats(void)
+{
+	struct dm_lookup *lookup = gd->dm_lookup;
+
+	if (!CONFIG_IS_ENABLED(DM_LOOKUP_TABLES) || !lookup) {
+		puts("No lookup tables\n");
+		return;
+	}
+	printf("uclass lookups:  %lu\n", lookup->uclass_lookups);
+	printf("ofnode lookups:  %lu\n", lookup->node_lookups);
+	printf("   from table:   %lu\n", lookup->node_hits);
+	printf("   list search:  %lu\n",
+	       lookup->node_lookups - lookup->node_hits);
+}
+
+/* Work out how much memory a device's platform data and private data use */
+static void dm_dev_mem(struct udevice *dev, int *platdatap, int *privp)
+{
+	struct uclass_driver *uc_drv = dev->uclass->uc_drv;
+	struct udevice *parent = dev->parent;
+	int platdata = 0, priv = 0;
+	int size;
+
+	if (dev->flags & DM_FLAG_ALLOC_PDATA)
+		platdata += dev->driver->platdata_auto_alloc_size;
+	if (dev->flags & DM_FLAG_ALLOC_UCLASS_PDATA)
+		platdata += uc_drv->per_device_platdata_auto_alloc_size;
+	if (parent && (dev->flags & DM_FLAG_ALLOC_PARENT_PDATA)) {
+		size = parent->driver->per_child_platdata_auto_alloc_size;
+		if (!size)
+			size = parent->uclass->uc_drv->
+					per_child_platdata_auto_alloc_size;
+		platdata += size;
+	}
+	if (dev->priv)
+		priv += dev->driver->priv_auto_alloc_size;
+	if (dev->uclass_priv)
+		priv += uc_drv->per_device_auto_alloc_size;
+	if (parent && dev->parent_priv) {
+		size = parent->driver->per_child_auto_alloc_size;
+		if (!size)
+			size = parent->uclass->uc_drv->per_child_auto_alloc_size;
+		priv += size;
+	}
+	*platdatap = platdata;
+	*privp = priv;
+}
+
+void dm_dump_mem(void)
+{
+	ulong total_devs = 0, total_bytes = 0;
+	struct dm_arena_chunk *chunk;
+	struct dm_arena *arena;
+	struct udevice *dev;
+	struct uclass *uc;
+	int id;
+
+	printf("Uclass           Devs  Arena  Platdata  Priv   Total\n");
+	for (id = 0; id < UCLASS_COUNT; id++) {
+		int devs = 0, in_arena = 0;
+		ulong platdata = 0, priv = 0, bytes;
+
+		uc = uclass_find(id);
+		if (!uc || list_empty(&uc->dev_head))
+			continue;
+		uclass_foreach_dev(dev, uc) {
+			int dev_platdata, dev_priv;
+
+			dm_dev_mem(dev, &dev_platdata, &dev_priv);
+			devs++;
+			if (dev->flags & DM_FLAG_ARENA)
+				in_arena++;
+			platdata += dev_platdata;
+			priv += dev_priv;
+		}
+		bytes = devs * sizeof(struct udevice) + platdata + priv;
+		printf("%-15.15s  %4d  %5d  %8lu  %5lu  %6lu\n",
+		       uc->uc_drv->name, devs, in_arena, platdata, priv, bytes);
+		total_devs += devs;
+		total_bytes += bytes;
+	}
+	printf("%lu devices, %lu bytes\n", total_devs, total_bytes);
+
+	for (arena = gd->dm_arena; CONFIG_IS_ENABLED(DM_ARENA) && arena;
+	     arena = arena->prev) {
+		ulong size = 0, used = 0;
+		int chunks = 0;
+
+		for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+			chunks++;
+			size += chunk->size;
+			used += chunk->used;
+		}
+		printf("Arena%s: %lu of %lu bytes used in %d chunk%s, ",
+		       arena == gd->dm_arena ? "" : " (old)", used, size,
+		       chunks, chunks == 1 ? "" : "s");
+		printf("%u of %lu blocks in use\n", arena->live,
+		       arena->allocs);
+	}
+}
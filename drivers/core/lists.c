@@ -15,7 +15,11 @@
 #include <dm/uclass.h>
 #include <dm/util.h>
 #include <fdtdec.h>
+#include <malloc.h>
 #include <linux/compiler.h>
+#include <linux/log2.h>
+
+DECLARE_GLOBAL_DATA_PTR;
 
 struct driver *lists_driver_lookup_name(const char *name)
 {
@@ -122,19 +126,170 @@ static int driver_check_compatible(const struct udevice_id *of_match,
 	return -ENOENT;
 }
 
-int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
-		   bool pre_reloc_only)
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+/* Marks an unused slot in the compatible-string index */
+#define COMPAT_SLOT_EMPTY	0xffff
+
+/**
+ * struct lists_compat_slot - an entry in the compatible-string index
+ *
+ * @drv:	Index of the driver in the driver linker list
+ * @id:		Index of the compatible string in the driver's of_match table
+ */
+struct lists_compat_slot {
+	u16 drv;
+	u16 id;
+};
+
+/**
+ * struct lists_compat_index - hash index of drivers by compatible string
+ *
+ * A string which hashes to a slot already in use goes in the next free slot.
+ * There are at least twice as many slots as strings, so that the searches
+ * stay short. Only the first driver in the linker list with each string is
+ * recorded, which is the one a linear search would find.
+ *
+ * @drivers:	Start of the driver linker list
+ * @mask:	Number of slots - 1 (the number of slots is a power of two)
+ * @slot:	Slots, each either empty or referring to a driver's string
+ */
+struct lists_compat_index {
+	struct driver *drivers;
+	uint mask;
+	struct lists_compat_slot slot[];
+};
+
+static uint lists_compat_hash(const char *str)
+{
+	uint hash = 2166136261U;
+
+	/* FNV-1a */
+	while (*str) {
+		hash ^= (u8)*str++;
+		hash *= 16777619;
+	}
+
+	return hash;
+}
+
+/**
+ * lists_compat_find() - Find the slot for a compatible string
+ *
+ * @index:	Index to search
+ * @compat:	Compatible string to look up
+ * @return the slot holding @compat, or the empty slot where it would go
+ */
+static struct lists_compat_slot *
+lists_compat_find(struct lists_compat_index *index, const char *compat)
+{
+	struct lists_compat_slot *slot;
+	struct driver *drv;
+	uint i;
+
+	/* There is always an empty slot, so this terminates */
+	for (i = lists_compat_hash(compat) & index->mask;;
+	     i = (i + 1) & index->mask) {
+		slot = &index->slot[i];
+		if (slot->drv == COMPAT_SLOT_EMPTY)
+			return slot;
+		drv = &index->drivers[slot->drv];
+		if (!strcmp(drv->of_match[slot->id].compatible, compat))
+			return slot;
+	}
+}
+
+/**
+ * lists_compat_index_get() - Get the compatible-string index
+ *
+ * This builds the index on first use. It is held in global_data, so it is
+ * built once before relocation and once after.
+ *
+ * @return index, or NULL if there is not enough memory
+ */
+static struct lists_compat_index *lists_compat_index_get(void)
 {
 	struct driver *driver = ll_entry_start(struct driver, driver);
 	const int n_ents = ll_entry_count(struct driver, driver);
-	const struct udevice_id *id;
+	struct lists_compat_index *index = gd->dm_compat_index;
+	const struct udevice_id *of_match;
+	struct lists_compat_slot *slot;
+	uint count = 0, size;
 	struct driver *entry;
-	struct udevice *dev;
-	bool found = false;
-	const char *name, *compat_list, *compat;
-	int compat_length, i;
-	int result = 0;
-	int ret = 0;
+	int drv, id;
+
+	if (index)
+		return index;
+	if (n_ents >= COMPAT_SLOT_EMPTY)
+		return NULL;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++)
+			count++;
+	}
+	size = roundup_pow_of_two(max(count * 2, 2U));
+	index = malloc(sizeof(*index) + size * sizeof(*slot));
+	if (!index)
+		return NULL;
+	index->drivers = driver;
+	index->mask = size - 1;
+	memset(index->slot, '\xff', size * sizeof(*slot));
+
+	for (entry = driver, drv = 0; entry != driver + n_ents;
+	     entry++, drv++) {
+		of_match = entry->of_match;
+		for (id = 0; of_match && of_match[id].compatible; id++) {
+			slot = lists_compat_find(index,
+						 of_match[id].compatible);
+			if (slot->drv == COMPAT_SLOT_EMPTY) {
+				slot->drv = drv;
+				slot->id = id;
+			}
+		}
+	}
+	gd->dm_compat_index = index;
+
+	return index;
+}
+#endif
+
+int lists_driver_lookup_compat(const char *compat, struct driver **drvp,
+			       const struct udevice_id **of_idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	struct driver *entry;
+#if CONFIG_IS_ENABLED(DM_COMPAT_INDEX)
+	struct lists_compat_index *index = lists_compat_index_get();
+	struct lists_compat_slot *slot;
+
+	if (index) {
+		slot = lists_compat_find(index, compat);
+		if (slot->drv == COMPAT_SLOT_EMPTY)
+			return -ENOENT;
+		entry = &index->drivers[slot->drv];
+		*drvp = entry;
+		*of_idp = &entry->of_match[slot->id];
+
+		return 0;
+	}
+#endif
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		if (!driver_check_compatible(entry->of_match, of_idp, compat)) {
+			*drvp = entry;
+			return 0;
+		}
+	}
+
+	return -ENOENT;
+}
+
+int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
+		   bool pre_reloc_only)
+{
+	const char *name, *compat_list;
+	int compat_length;
 
 	if (devp)
 		*devp = NULL;
@@ -153,6 +308,27 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		return compat_length;
 	}
 
+	return lists_bind_fdt_compat(parent, node, name, compat_list,
+				     compat_length, devp, pre_reloc_only);
+}
+
+int lists_bind_fdt_compat(struct udevice *parent, ofnode node,
+			  const char *name, const char *compat_list,
+			  int compat_length, struct udevice **devp,
+			  bool pre_reloc_only)
+{
+	const struct udevice_id *id;
+	struct driver *entry;
+	struct udevice *dev;
+	bool found = false;
+	const char *compat;
+	int result = 0;
+	int ret = 0;
+	int i;
+
+	if (devp)
+		*devp = NULL;
+
 	/*
 	 * Walk through the compatible string list, attempting to match each
 	 * compatible string in order such that we match in order of priority
@@ -163,13 +339,8 @@ int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		pr_debug("   - attempt to match compatible string '%s'\n",
 			 compat);
 
-		for (entry = driver; entry != driver + n_ents; entry++) {
-			ret = driver_check_compatible(entry->of_match, &id,
-						      compat);
-			if (!ret)
-				break;
-		}
-		if (entry == driver + n_ents)
+		ret = lists_driver_lookup_compat(compat, &entry, &id);
+		if (ret)
 			continue;
 
 		if (pre_reloc_only) {
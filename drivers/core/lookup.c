@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tables for finding uclasses and devices without searching lists
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/uclass-internal.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static uint dm_lookup_hash(ofnode node)
+{
+	u32 key;
+
+	/* Both node pointers and offsets have low bits which rarely differ */
+	if (ofnode_is_np(node))
+		key = (ulong)ofnode_to_np(node);
+	else
+		key = ofnode_to_offset(node);
+
+	return (key * 0x9e3779b1) >> (32 - DM_LOOKUP_NODE_BITS);
+}
+
+int dm_lookup_init(void)
+{
+	struct dm_lookup *lookup = gd->dm_lookup;
+
+	if (!lookup) {
+		/* The tables are too large for the simple pre-relocation malloc */
+		if (!(gd->flags & GD_FLG_FULL_MALLOC_INIT))
+			return 0;
+		lookup = calloc(1, sizeof(*lookup));
+		if (!lookup)
+			return -ENOMEM;
+		gd->dm_lookup = lookup;
+	}
+	memset(lookup->uclass, '\0', sizeof(lookup->uclass));
+	memset(lookup->node_head, '\0', sizeof(lookup->node_head));
+
+	return 0;
+}
+
+void dm_lookup_add_uclass(struct uclass *uc)
+{
+	struct dm_lookup *lookup = gd->dm_lookup;
+	enum uclass_id id = uc->uc_drv->id;
+
+	if (lookup && id >= 0 && id < UCLASS_COUNT)
+		lookup->uclass[id] = uc;
+}
+
+void dm_lookup_remove_uclass(struct uclass *uc)
+{
+	struct dm_lookup *lookup = gd->dm_lookup;
+	enum uclass_id id = uc->uc_drv->id;
+
+	if (lookup && id >= 0 && id < UCLASS_COUNT && lookup->uclass[id] == uc)
+		lookup->uclass[id] = NULL;
+}
+
+void dm_lookup_add_dev(struct udevice *dev)
+{
+	struct dm_lookup *lookup = gd->dm_lookup;
+
+	if (!lookup || !ofnode_valid(dev->node))
+		return;
+	hlist_add_head(&dev->node_map,
+		       &lookup->node_head[dm_lookup_hash(dev->node)]);
+}
+
+void dm_lookup_remove_dev(struct udevice *dev)
+{
+	hlist_del_init(&dev->node_map);
+}
+
+int dm_lookup_find_by_ofnode(ofnode node, enum uclass_id id,
+			     struct udevice **devp)
+{
+	struct dm_lookup *lookup = gd->dm_lookup;
+	struct udevice *dev, *found = NULL;
+	struct hlist_node *pos;
+
+	if (!lookup || !ofnode_valid(node))
+		return -EAGAIN;
+	lookup->node_lookups++;
+	hlist_for_each(pos, &lookup->node_head[dm_lookup_hash(node)]) {
+		dev = hlist_entry(pos, struct udevice, node_map);
+		if (!ofnode_equal(dev->node, node))
+			continue;
+		if (id != UCLASS_INVALID && dev->uclass->uc_drv->id != id)
+			continue;
+		/* Let the caller decide which of several devices to use */
+		if (found)
+			return -EAGAIN;
+		found = dev;
+	}
+	if (!found)
+		return -EAGAIN;
+	lookup->node_hits++;
+	*devp = found;
+
+	return 0;
+}
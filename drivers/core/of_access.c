@@ -20,7 +20,9 @@
  */
 
 #include <common.h>
+#include <fdtdec.h>
 #include <linux/libfdt.h>
+#include <of_live.h>
 #include <dm/of_access.h>
 #include <linux/ctype.h>
 #include <linux/err.h>
@@ -127,7 +129,7 @@ struct property *of_find_property(const struct device_node *np,
 	if (!np)
 		return NULL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
+	for (pp = of_node_properties(np); pp; pp = pp->next) {
 		if (strcmp(pp->name, name) == 0) {
 			if (lenp)
 				*lenp = pp->length;
@@ -146,7 +148,7 @@ struct device_node *of_find_all_nodes(struct device_node *prev)
 
 	if (!prev) {
 		np = gd->of_root;
-	} else if (prev->child) {
+	} else if (of_node_child(prev)) {
 		np = prev->child;
 	} else {
 		/*
@@ -266,7 +268,7 @@ static struct device_node *__of_get_next_child(const struct device_node *node,
 	if (!node)
 		return NULL;
 
-	next = prev ? prev->sibling : node->child;
+	next = prev ? prev->sibling : of_node_child(node);
 	/*
 	 * coverity[dead_error_line : FALSE]
 	 * Dead code here since our current implementation of of_node_get()
@@ -305,7 +307,7 @@ static struct device_node *__of_find_node_by_path(struct device_node *parent,
 }
 
 #define for_each_property_of_node(dn, pp) \
-	for (pp = dn->properties; pp != NULL; pp = pp->next)
+	for (pp = of_node_properties(dn); pp != NULL; pp = pp->next)
 
 struct device_node *of_find_node_opts_by_path(const char *path,
 					      const char **opts)
@@ -410,6 +412,15 @@ struct device_node *of_find_node_by_phandle(phandle handle)
 	if (!handle)
 		return NULL;
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	/* Avoid building the whole tree just to search it */
+	if (gd->of_root && gd->of_root->fdt) {
+		np = of_live_find_offset(gd->of_root,
+				fdtdec_node_offset_by_phandle(gd->of_root->fdt,
+							      handle));
+		return of_node_get(np);
+	}
+#endif
 	for_each_of_allnodes(np)
 		if (np->phandle == handle)
 			break;
@@ -144,7 +144,7 @@ ofnode ofnode_find_subnode(ofnode node, const char *subnode_name)
 	if (ofnode_is_np(node)) {
 		const struct device_node *np = ofnode_to_np(node);
 
-		for (np = np->child; np; np = np->sibling) {
+		for (np = of_node_child(np); np; np = np->sibling) {
 			if (!strcmp(subnode_name, np->name))
 				break;
 		}
@@ -180,7 +180,7 @@ ofnode ofnode_first_subnode(ofnode node)
 {
 	assert(ofnode_valid(node));
 	if (ofnode_is_np(node))
-		return np_to_ofnode(node.np->child);
+		return np_to_ofnode(of_node_child(node.np));
 
 	return offset_to_ofnode(
 		fdt_first_subnode(gd->fdt_blob, ofnode_to_offset(node)));
@@ -226,8 +226,8 @@ ofnode ofnode_get_by_phandle(uint phandle)
 	if (of_live_active())
 		node = np_to_ofnode(of_find_node_by_phandle(phandle));
 	else
-		node.of_offset = fdt_node_offset_by_phandle(gd->fdt_blob,
-							    phandle);
+		node.of_offset = fdtdec_node_offset_by_phandle(gd->fdt_blob,
+							       phandle);
 
 	return node;
 }
@@ -403,7 +403,7 @@ ofnode ofnode_path(const char *path)
 	if (of_live_active())
 		return np_to_ofnode(of_find_node_by_path(path));
 	else
-		return offset_to_ofnode(fdt_path_offset(gd->fdt_blob, path));
+		return offset_to_ofnode(fdtdec_path_offset(gd->fdt_blob, path));
 }
 
 const char *ofnode_get_chosen_prop(const char *name)
@@ -815,7 +815,7 @@ int ofnode_write_prop(ofnode node, const char *propname, int len,
 	if (!np)
 		return -EINVAL;
 
-	for (pp = np->properties; pp; pp = pp->next) {
+	for (pp = of_node_properties(np); pp; pp = pp->next) {
 		if (strcmp(pp->name, propname) == 0) {
 			/* Property exists -> change value */
 			pp->value = (void *)value;
@@ -0,0 +1,194 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Start probing slow devices early, so that they can come up in parallel
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/device-internal.h>
+#include <dm/of.h>
+#include <dm/root.h>
+#include <dm/uclass-internal.h>
+#include <dm/util.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/* Properties listing the devices that a device needs before it can probe */
+static const struct {
+	const char *list_name;
+	const char *cells_name;
+} probe_async_deps[] = {
+	{ "clocks", "#clock-cells" },
+	{ "resets", "#reset-cells" },
+	{ "power-domains", "#power-domain-cells" },
+	{ "phys", "#phy-cells" },
+};
+
+/* Check if a device is slow to probe and has not finished probing yet */
+static bool probe_async_pending(struct udevice *dev)
+{
+	if (dev->flags & DM_FLAG_PROBE_STARTED)
+		return true;
+
+	return !device_active(dev) &&
+		(dev->driver->flags & DM_FLAG_PROBE_ASYNC);
+}
+
+static struct udevice *probe_async_supply(struct udevice *dev,
+					  const char *name)
+{
+	struct udevice *supply;
+	int len = strlen(name);
+	u32 phandle;
+
+	if (len < 7 || strcmp(name + len - 7, "-supply"))
+		return NULL;
+	if (dev_read_u32(dev, name, &phandle))
+		return NULL;
+	if (device_find_global_by_ofnode(ofnode_get_by_phandle(phandle),
+					 &supply))
+		return NULL;
+
+	return probe_async_pending(supply) ? supply : NULL;
+}
+
+/* Find a regulator supply of the device which has not finished probing */
+static struct udevice *probe_async_supply_blocker(struct udevice *dev)
+{
+	ofnode node = dev_ofnode(dev);
+	struct udevice *supply = NULL;
+	const char *name;
+	int offset;
+
+	if (ofnode_is_np(node)) {
+		const struct property *pp;
+
+		for (pp = of_node_properties(ofnode_to_np(node));
+		     pp && !supply; pp = pp->next)
+			supply = probe_async_supply(dev, pp->name);
+	} else {
+		fdt_for_each_property_offset(offset, gd->fdt_blob,
+					     ofnode_to_offset(node)) {
+			fdt_getprop_by_offset(gd->fdt_blob, offset, &name,
+					      NULL);
+			supply = probe_async_supply(dev, name);
+			if (supply)
+				break;
+		}
+	}
+
+	return supply;
+}
+
+/**
+ * probe_async_blocker() - Find a device which must finish probing first
+ *
+ * @dev: Device to check
+ * @return a slow device that @dev depends on which has not finished probing,
+ *	or NULL if there is none
+ */
+static struct udevice *probe_async_blocker(struct udevice *dev)
+{
+	struct ofnode_phandle_args args;
+	struct udevice *dep;
+	int i, j;
+
+	if (dev->parent && probe_async_pending(dev->parent))
+		return dev->parent;
+	if (!dev_has_of_node(dev))
+		return NULL;
+
+	for (i = 0; i < ARRAY_SIZE(probe_async_deps); i++) {
+		for (j = 0; !dev_read_phandle_with_args(dev,
+				probe_async_deps[i].list_name,
+				probe_async_deps[i].cells_name, 0, j, &args);
+		     j++) {
+			if (device_find_global_by_ofnode(args.node, &dep))
+				continue;
+			if (dep != dev && probe_async_pending(dep))
+				return dep;
+		}
+	}
+
+	return probe_async_supply_blocker(dev);
+}
+
+static void probe_async_start(struct udevice *dev)
+{
+	int ret;
+
+	ret = device_probe_start(dev);
+	if (ret)
+		dm_warn("%s: Device '%s' failed to start probing (err=%d)\n",
+			__func__, dev->name, ret);
+}
+
+int dm_probe_async(void)
+{
+	struct udevice **pending, *dev, *dep;
+	struct uclass *uc;
+	int count = 0;
+	int total, i;
+	bool started;
+
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		uclass_foreach_dev(dev, uc) {
+			if (probe_async_pending(dev))
+				count++;
+		}
+	}
+	if (!count)
+		return 0;
+
+	pending = calloc(count, sizeof(*pending));
+	if (!pending)
+		return -ENOMEM;
+	total = 0;
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		uclass_foreach_dev(dev, uc) {
+			if (probe_async_pending(dev) && total < count)
+				pending[total++] = dev;
+		}
+	}
+	count = total;
+
+	while (count) {
+		/* Start every device whose dependencies are ready */
+		started = false;
+		for (i = 0; i < total; i++) {
+			dev = pending[i];
+			if (!dev || probe_async_blocker(dev))
+				continue;
+			probe_async_start(dev);
+			pending[i] = NULL;
+			count--;
+			started = true;
+		}
+		if (started)
+			continue;
+
+		/* Everything left is waiting, so finish a dependency */
+		for (i = 0, dep = NULL; i < total && !dep; i++) {
+			if (!pending[i])
+				continue;
+			dep = probe_async_blocker(pending[i]);
+			if (dep && !(dep->flags & DM_FLAG_PROBE_STARTED))
+				dep = NULL;
+		}
+		if (dep) {
+			device_probe(dep);
+			continue;
+		}
+
+		/* The dependencies form a loop, so just start a device */
+		for (i = 0; !pending[i]; i++)
+			;
+		probe_async_start(pending[i]);
+		pending[i] = NULL;
+		count--;
+	}
+	free(pending);
+
+	return 0;
+}
@@ -158,6 +158,12 @@ int dm_init(bool of_live)
 		return -EINVAL;
 	}
 	INIT_LIST_HEAD(&DM_UCLASS_ROOT_NON_CONST);
+	ret = dm_lookup_init();
+	if (ret)
+		return ret;
+	ret = dm_arena_init();
+	if (ret)
+		return ret;
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 	fix_drivers();
@@ -171,10 +177,10 @@ int dm_init(bool of_live)
 #if CONFIG_IS_ENABLED(OF_CONTROL)
 # if CONFIG_IS_ENABLED(OF_LIVE)
 	if (of_live)
-		DM_ROOT_NON_CONST->node = np_to_ofnode(gd->of_root);
+		dev_set_ofnode(DM_ROOT_NON_CONST, np_to_ofnode(gd->of_root));
 	else
 #endif
-		DM_ROOT_NON_CONST->node = offset_to_ofnode(0);
+		dev_set_ofnode(DM_ROOT_NON_CONST, offset_to_ofnode(0));
 #endif
 	ret = device_probe(DM_ROOT_NON_CONST);
 	if (ret)
@@ -222,7 +228,7 @@ static int dm_scan_fdt_live(struct udevice *parent,
 	struct device_node *np;
 	int ret = 0, err;
 
-	for (np = node_parent->child; np; np = np->sibling) {
+	for (np = of_node_child(node_parent); np; np = np->sibling) {
 		/* "chosen" node isn't a device itself but may contain some: */
 		if (!strcmp(np->name, "chosen")) {
 			pr_debug("parsing subnodes of \"chosen\"\n");
@@ -309,6 +315,88 @@ static int dm_scan_fdt_node(struct udevice *parent, const void *blob,
 	return ret;
 }
 
+#if CONFIG_IS_ENABLED(OF_PREBIND)
+/*
+ * Bind a node to the driver which dtoc found for it, without looking it up.
+ * This returns -ENOENT if that driver is not built, does not match the node
+ * or refuses to bind, so that the caller can look up a driver as usual.
+ */
+static int dm_bind_prebind(const struct dm_prebind *entry, bool pre_reloc_only)
+{
+	struct driver *drv = entry->driver;
+	const struct udevice_id *id;
+	const char *compat;
+	int ret, i;
+
+	if (!drv)
+		return -ENOENT;
+
+	/* The first compatible string that the driver has chooses the data */
+	for (i = 0; i < entry->compat_len; i += strlen(compat) + 1) {
+		compat = entry->compat + i;
+		for (id = drv->of_match; id && id->compatible; id++) {
+			if (!strcmp(id->compatible, compat))
+				goto found;
+		}
+	}
+
+	return -ENOENT;
+found:
+	if (pre_reloc_only && !entry->pre_reloc &&
+	    !(drv->flags & DM_FLAG_PRE_RELOC))
+		return 0;
+	ret = device_bind_with_driver_data(gd->dm_root, drv, entry->name,
+					   id->data,
+					   offset_to_ofnode(entry->offset),
+					   NULL);
+	if (ret == -ENODEV)
+		return -ENOENT;
+	if (ret)
+		dm_warn("Error binding driver '%s': %d\n", drv->name, ret);
+
+	return ret;
+}
+
+int dm_scan_prebind(const void *blob, const struct dm_prebind_table *table,
+		    bool pre_reloc_only)
+{
+	const struct dm_prebind *entry;
+	const char *name;
+	int ret = 0, err, i;
+
+	if (fdt_totalsize(blob) != table->totalsize ||
+	    fdt_size_dt_struct(blob) != table->size_dt_struct ||
+	    fdt_size_dt_strings(blob) != table->size_dt_strings)
+		return -EAGAIN;
+
+	/* Check every node before binding anything, so we can fall back */
+	for (i = 0, entry = table->entries; i < table->count; i++, entry++) {
+		name = fdt_get_name(blob, entry->offset, NULL);
+		if (!name || strcmp(name, entry->name))
+			return -EAGAIN;
+	}
+
+	for (i = 0, entry = table->entries; i < table->count; i++, entry++) {
+		err = dm_bind_prebind(entry, pre_reloc_only);
+		if (err == -ENOENT)
+			err = lists_bind_fdt_compat(gd->dm_root,
+					offset_to_ofnode(entry->offset),
+					entry->name, entry->compat,
+					entry->compat_len, NULL,
+					pre_reloc_only);
+		if (err && !ret) {
+			ret = err;
+			debug("%s: ret=%d\n", entry->name, ret);
+		}
+	}
+
+	if (ret)
+		dm_warn("Some drivers failed to bind\n");
+
+	return ret;
+}
+#endif
+
 int dm_scan_fdt_dev(struct udevice *dev)
 {
 	if (!dev_of_valid(dev))
@@ -331,6 +419,16 @@ int dm_scan_fdt(const void *blob, bool pre_reloc_only)
 		return dm_scan_fdt_live(gd->dm_root, gd->of_root,
 					pre_reloc_only);
 	else
+#endif
+#if CONFIG_IS_ENABLED(OF_PREBIND)
+	{
+		int ret;
+
+		ret = dm_scan_prebind(blob, &dm_prebind_table, pre_reloc_only);
+		if (ret != -EAGAIN)
+			return ret;
+		debug("Device tree does not match the prebind table\n");
+	}
 #endif
 	return dm_scan_fdt_node(gd->dm_root, blob, 0, pre_reloc_only);
 }
@@ -412,6 +510,7 @@ int dm_init_and_scan(bool pre_reloc_only)
 	ret = dm_scan_other(pre_reloc_only);
 	if (ret)
 		return ret;
+	dm_arena_close();
 
 	return 0;
 }
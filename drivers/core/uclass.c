@@ -25,11 +25,11 @@ struct uclass *uclass_find(enum uclass_id key)
 
 	if (!gd->dm_root)
 		return NULL;
-	/*
-	 * TODO(sjg@chromium.org): Optimise this, perhaps moving the found
-	 * node to the start of the list, or creating a linear array mapping
-	 * id to node.
-	 */
+	if (CONFIG_IS_ENABLED(DM_LOOKUP_TABLES) && gd->dm_lookup &&
+	    key >= 0 && key < UCLASS_COUNT) {
+		gd->dm_lookup->uclass_lookups++;
+		return gd->dm_lookup->uclass[key];
+	}
 	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
 		if (uc->uc_drv->id == key)
 			return uc;
@@ -79,6 +79,7 @@ static int uclass_add(enum uclass_id id, struct uclass **ucp)
 	INIT_LIST_HEAD(&uc->sibling_node);
 	INIT_LIST_HEAD(&uc->dev_head);
 	list_add(&uc->sibling_node, &DM_UCLASS_ROOT_NON_CONST);
+	dm_lookup_add_uclass(uc);
 
 	if (uc_drv->init) {
 		ret = uc_drv->init(uc);
@@ -94,6 +95,7 @@ fail:
 		free(uc->priv);
 		uc->priv = NULL;
 	}
+	dm_lookup_remove_uclass(uc);
 	list_del(&uc->sibling_node);
 fail_mem:
 	free(uc);
@@ -127,6 +129,7 @@ int uclass_destroy(struct uclass *uc)
 	uc_drv = uc->uc_drv;
 	if (uc_drv->destroy)
 		uc_drv->destroy(uc);
+	dm_lookup_remove_uclass(uc);
 	list_del(&uc->sibling_node);
 	if (uc_drv->priv_auto_alloc_size)
 		free(uc->priv);
@@ -361,6 +364,8 @@ int uclass_find_device_by_ofnode(enum uclass_id id, ofnode node,
 	if (ret)
 		return ret;
 
+	if (!dm_lookup_find_by_ofnode(node, id, devp))
+		goto done;
 	uclass_foreach_dev(dev, uc) {
 		log(LOGC_DM, LOGL_DEBUG_CONTENT, "      - checking %s\n",
 		    dev->name);
@@ -394,6 +399,10 @@ int uclass_find_device_by_phandle(enum uclass_id id, struct udevice *parent,
 	if (ret)
 		return ret;
 
+	if (CONFIG_IS_ENABLED(DM_LOOKUP_TABLES) &&
+	    !dm_lookup_find_by_ofnode(ofnode_get_by_phandle(find_phandle), id,
+				      devp))
+		return 0;
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -521,6 +530,10 @@ int uclass_get_device_by_phandle_id(enum uclass_id id, uint phandle_id,
 	if (ret)
 		return ret;
 
+	if (CONFIG_IS_ENABLED(DM_LOOKUP_TABLES) &&
+	    !dm_lookup_find_by_ofnode(ofnode_get_by_phandle(phandle_id), id,
+				      &dev))
+		return uclass_get_device_tail(dev, 0, devp);
 	uclass_foreach_dev(dev, uc) {
 		uint phandle;
 
@@ -9,6 +9,7 @@
 #include <dm.h>
 #include <dm/device-internal.h>
 #include <dm/lists.h>
+#include <tracepoint.h>
 #include "mmc_private.h"
 
 int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
@@ -16,13 +17,16 @@ int dm_mmc_send_cmd(struct udevice *dev, struct mmc_cmd *cmd,
 {
 	struct mmc *mmc = mmc_get_mmc_dev(dev);
 	struct dm_mmc_ops *ops = mmc_get_ops(dev);
+	ulong tp;
 	int ret;
 
 	mmmc_trace_before_send(mmc, cmd);
+	tp = tracepoint_start(TP_MMC_CMD);
 	if (ops->send_cmd)
 		ret = ops->send_cmd(dev, cmd, data);
 	else
 		ret = -ENOSYS;
+	tracepoint_end(TP_MMC_CMD, tp, dev->name, cmd->cmdidx, ret);
 	mmmc_trace_after_send(mmc, cmd, ret);
 
 	return ret;
@@ -19,6 +19,7 @@
 #include <memalign.h>
 #include <linux/list.h>
 #include <div64.h>
+#include <tracepoint.h>
 #include "mmc_private.h"
 
 static int mmc_set_signal_voltage(struct mmc *mmc, uint signal_voltage);
@@ -196,10 +197,13 @@ static int mmc_select_mode(struct mmc *mmc, enum bus_mode mode)
 #if !CONFIG_IS_ENABLED(DM_MMC)
 int mmc_send_cmd(struct mmc *mmc, struct mmc_cmd *cmd, struct mmc_data *data)
 {
+	ulong tp;
 	int ret;
 
 	mmmc_trace_before_send(mmc, cmd);
+	tp = tracepoint_start(TP_MMC_CMD);
 	ret = mmc->cfg->ops->send_cmd(mmc, cmd, data);
+	tracepoint_end(TP_MMC_CMD, tp, mmc->cfg->name, cmd->cmdidx, ret);
 	mmmc_trace_after_send(mmc, cmd, ret);
 
 	return ret;
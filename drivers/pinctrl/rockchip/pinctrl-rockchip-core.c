@@ -591,7 +591,7 @@ static int rockchip_pinctrl_set_state(struct udevice *dev,
 			return -ENODEV;
 #ifdef CONFIG_OF_LIVE
 		np = ofnode_to_np(node);
-		for (pp = np->properties; pp; pp = pp->next) {
+		for (pp = of_node_properties(np); pp; pp = pp->next) {
 			prop_name = pp->name;
 			prop_len = pp->length;
 			value = pp->value;
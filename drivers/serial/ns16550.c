@@ -20,6 +20,8 @@ DECLARE_GLOBAL_DATA_PTR;
 #define UART_LCRVAL UART_LCR_8N1		/* 8 data, 1 stop, no parity */
 #define UART_MCRVAL (UART_MCR_DTR | \
 		     UART_MCR_RTS)		/* RTS/DTR */
+/* TX FIFO size of the 16550A, unless the device tree gives another */
+#define NS16550_FIFO_SIZE	16
 
 #ifndef CONFIG_DM_SERIAL
 #ifdef CONFIG_SYS_NS16550_PORT_MAPPED
@@ -322,6 +324,28 @@ static int ns16550_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+static int ns16550_serial_puts(struct udevice *dev, const char *s, int len)
+{
+	struct NS16550 *const com_port = dev_get_priv(dev);
+	struct ns16550_platdata *plat = com_port->plat;
+	int i;
+
+	/* With the FIFO enabled, THRE means that the whole FIFO is empty */
+	if (!(serial_in(&com_port->lsr) & UART_LSR_THRE))
+		return -EAGAIN;
+	if (plat->fcr & UART_FCR_FIFO_EN)
+		len = min(len, max(plat->fifo_size, 1));
+	else
+		len = 1;
+	for (i = 0; i < len; i++)
+		serial_out(s[i], &com_port->thr);
+
+	/* As in putc(), since this may be called with a whole environment */
+	WATCHDOG_RESET();
+
+	return len;
+}
+
 static int ns16550_serial_pending(struct udevice *dev, bool input)
 {
 	struct NS16550 *const com_port = dev_get_priv(dev);
@@ -504,6 +528,8 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 	plat->fcr = UART_FCR_DEFVAL;
 	if (port_type == PORT_JZ4780)
 		plat->fcr |= UART_FCR_UME;
+	plat->fifo_size = dev_read_u32_default(dev, "fifo-size",
+					       NS16550_FIFO_SIZE);
 
 	return 0;
 }
@@ -511,6 +537,7 @@ int ns16550_serial_ofdata_to_platdata(struct udevice *dev)
 
 const struct dm_serial_ops ns16550_serial_ops = {
 	.putc = ns16550_serial_putc,
+	.puts = ns16550_serial_puts,
 	.pending = ns16550_serial_pending,
 	.getc = ns16550_serial_getc,
 	.setbrg = ns16550_serial_setbrg,
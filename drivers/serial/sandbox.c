@@ -19,6 +19,7 @@
 #include <video.h>
 #include <linux/compiler.h>
 #include <asm/state.h>
+#include <asm/test.h>
 
 DECLARE_GLOBAL_DATA_PTR;
 
@@ -41,8 +42,21 @@ struct sandbox_serial_platdata {
 	int colour;	/* Text colour to use for output, -1 for none */
 };
 
+/**
+ * struct sandbox_serial_priv - private data for the sandbox serial port
+ *
+ * @start_of_line: true if the next character starts a line
+ * @fifo_size: Most characters that puts() takes at once, or 0 for no limit
+ * @busy: true if puts() should act as if the FIFO were full
+ * @written: Number of characters written by puts()
+ * @puts_calls: Number of puts() calls which wrote something
+ */
 struct sandbox_serial_priv {
 	bool start_of_line;
+	int fifo_size;
+	bool busy;
+	int written;
+	int puts_calls;
 };
 
 /**
@@ -105,6 +119,50 @@ static int sandbox_serial_putc(struct udevice *dev, const char ch)
 	return 0;
 }
 
+static int sandbox_serial_puts(struct udevice *dev, const char *s, int len)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+	struct sandbox_serial_platdata *plat = dev->platdata;
+	const char *nl;
+
+	if (priv->busy)
+		return -EAGAIN;
+	if (priv->fifo_size)
+		len = min(len, priv->fifo_size);
+
+	if (plat->colour != -1) {
+		/* Stop after a newline so the next line starts with colour */
+		nl = memchr(s, '\n', len);
+		if (nl)
+			len = nl - s + 1;
+		if (priv->start_of_line)
+			output_ansi_colour(plat->colour);
+	}
+	os_write(1, s, len);
+	priv->start_of_line = s[len - 1] == '\n';
+	priv->written += len;
+	priv->puts_calls++;
+
+	return len;
+}
+
+void sandbox_serial_set_fifo(struct udevice *dev, int fifo_size, bool busy)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+
+	priv->fifo_size = fifo_size;
+	priv->busy = busy;
+}
+
+int sandbox_serial_get_written(struct udevice *dev, int *puts_callsp)
+{
+	struct sandbox_serial_priv *priv = dev_get_priv(dev);
+
+	*puts_callsp = priv->puts_calls;
+
+	return priv->written;
+}
+
 static unsigned int increment_buffer_index(unsigned int index)
 {
 	return (index + 1) % ARRAY_SIZE(serial_buf);
@@ -237,6 +295,7 @@ static int sandbox_serial_ofdata_to_platdata(struct udevice *dev)
 
 static const struct dm_serial_ops sandbox_serial_ops = {
 	.putc = sandbox_serial_putc,
+	.puts = sandbox_serial_puts,
 	.pending = sandbox_serial_pending,
 	.getc = sandbox_serial_getc,
 	.getconfig = sandbox_serial_getconfig,
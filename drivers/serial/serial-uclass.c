@@ -170,11 +170,136 @@ void serial_initialize(void)
 	serial_init();
 }
 
+/*
+ * Write up to @len characters without waiting, using puts() if the driver
+ * has it. Returns the number written, or -EAGAIN if the UART is busy.
+ */
+static int serial_write(struct udevice *dev, const char *str, int len)
+{
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	int err;
+
+	if (ops->puts)
+		return ops->puts(dev, str, len);
+	err = ops->putc(dev, *str);
+
+	return err ? err : 1;
+}
+
+/* Write @len characters, waiting for the UART as needed */
+static void serial_write_all(struct udevice *dev, const char *str, int len)
+{
+	int ret;
+
+	while (len) {
+		ret = serial_write(dev, str, len);
+		if (ret == -EAGAIN)
+			continue;
+		if (ret < 0)
+			return;
+		str += ret;
+		len -= ret;
+	}
+}
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+#define TX_BUF_SIZE	CONFIG_SERIAL_TX_BUFFER_SIZE
+
+/* Send as much buffered output as the UART will take without waiting */
+static int serial_tx_push(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	int len, ret;
+
+	while (upriv->tx_rd != upriv->tx_wr) {
+		if (upriv->tx_wr > upriv->tx_rd)
+			len = upriv->tx_wr - upriv->tx_rd;
+		else
+			len = TX_BUF_SIZE - upriv->tx_rd;
+		ret = serial_write(dev, upriv->tx_buf + upriv->tx_rd, len);
+		if (ret < 0)
+			return ret;
+		upriv->tx_rd = (upriv->tx_rd + ret) % TX_BUF_SIZE;
+	}
+
+	return 0;
+}
+
+/* Wait until all buffered output has been taken by the UART */
+static void serial_tx_flush(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	if (upriv->tx_buf) {
+		while (serial_tx_push(dev) == -EAGAIN)
+			;
+	}
+}
+
+static void serial_tx_add(struct udevice *dev, char ch)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	int next = (upriv->tx_wr + 1) % TX_BUF_SIZE;
+	int ret;
+
+	/* If the buffer is full, wait for the UART to take something */
+	while (next == upriv->tx_rd) {
+		ret = serial_tx_push(dev);
+		if (ret && ret != -EAGAIN) {
+			/* The UART has failed, so drop the output */
+			upriv->tx_rd = upriv->tx_wr;
+			break;
+		}
+	}
+	upriv->tx_buf[upriv->tx_wr] = ch;
+	upriv->tx_wr = next;
+}
+
+static bool serial_tx_buffered(struct udevice *dev)
+{
+	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+
+	return upriv->tx_buf;
+}
+
+void serial_flush(void)
+{
+	if (gd->cur_serial_dev)
+		serial_tx_flush(gd->cur_serial_dev);
+}
+#else
+static inline int serial_tx_push(struct udevice *dev)
+{
+	return 0;
+}
+
+static inline void serial_tx_flush(struct udevice *dev)
+{
+}
+
+static inline void serial_tx_add(struct udevice *dev, char ch)
+{
+}
+
+static inline bool serial_tx_buffered(struct udevice *dev)
+{
+	return false;
+}
+#endif /* CONFIG_IS_ENABLED(SERIAL_TX_BUFFER) */
+
 static void _serial_putc(struct udevice *dev, char ch)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 	int err;
 
+	if (serial_tx_buffered(dev)) {
+		if (ch == '\n')
+			serial_tx_add(dev, '\r');
+		serial_tx_add(dev, ch);
+		serial_tx_push(dev);
+		return;
+	}
+
 	if (ch == '\n')
 		_serial_putc(dev, '\r');
 
@@ -185,8 +310,34 @@ static void _serial_putc(struct udevice *dev, char ch)
 
 static void _serial_puts(struct udevice *dev, const char *str)
 {
-	while (*str)
-		_serial_putc(dev, *str++);
+	struct dm_serial_ops *ops = serial_get_ops(dev);
+	const char *end;
+
+	if (serial_tx_buffered(dev)) {
+		for (; *str; str++) {
+			if (*str == '\n')
+				serial_tx_add(dev, '\r');
+			serial_tx_add(dev, *str);
+		}
+		serial_tx_push(dev);
+		return;
+	}
+
+	if (!ops->puts) {
+		while (*str)
+			_serial_putc(dev, *str++);
+		return;
+	}
+
+	/* Send each line in bursts, then its \r\n */
+	while (*str) {
+		end = strchrnul(str, '\n');
+		serial_write_all(dev, str, end - str);
+		if (!*end)
+			break;
+		serial_write_all(dev, "\r\n", 2);
+		str = end + 1;
+	}
 }
 
 static int __serial_getc(struct udevice *dev)
@@ -207,6 +358,9 @@ static int __serial_tstc(struct udevice *dev)
 {
 	struct dm_serial_ops *ops = serial_get_ops(dev);
 
+	/* Waiting for input is a good time to send buffered output */
+	if (serial_tx_buffered(dev))
+		serial_tx_push(dev);
 	if (ops->pending)
 		return ops->pending(dev, true);
 
@@ -289,6 +443,8 @@ void serial_setbrg(void)
 	if (!gd->cur_serial_dev)
 		return;
 
+	/* Send buffered output at the old rate */
+	serial_flush();
 	ops = serial_get_ops(gd->cur_serial_dev);
 	if (ops->setbrg)
 		ops->setbrg(gd->cur_serial_dev, gd->baudrate);
@@ -439,6 +595,8 @@ static int serial_post_probe(struct udevice *dev)
 		ops->getc += gd->reloc_off;
 	if (ops->putc)
 		ops->putc += gd->reloc_off;
+	if (ops->puts)
+		ops->puts += gd->reloc_off;
 	if (ops->pending)
 		ops->pending += gd->reloc_off;
 	if (ops->clear)
@@ -478,6 +636,10 @@ static int serial_post_probe(struct udevice *dev)
 	/* Allocate the RX buffer */
 	upriv->buf = malloc(CONFIG_SERIAL_RX_BUFFER_SIZE);
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* Allocate the TX buffer; without it output is written directly */
+	upriv->tx_buf = malloc(CONFIG_SERIAL_TX_BUFFER_SIZE);
+#endif
 
 	stdio_register_dev(&sdev, &upriv->sdev);
 #endif
@@ -486,12 +648,17 @@ static int serial_post_probe(struct udevice *dev)
 
 static int serial_pre_remove(struct udevice *dev)
 {
-#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
-	struct serial_dev_priv *upriv = dev_get_uclass_priv(dev);
+	struct serial_dev_priv *upriv __maybe_unused = dev_get_uclass_priv(dev);
 
+	serial_tx_flush(dev);
+#if CONFIG_IS_ENABLED(SYS_STDIO_DEREGISTER)
 	if (stdio_deregister_dev(upriv->sdev, true))
 		return -EPERM;
 #endif
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	free(upriv->tx_buf);
+	upriv->tx_buf = NULL;
+#endif
 
 	return 0;
 }
@@ -133,6 +133,8 @@ static int omap_serial_ofdata_to_platdata(struct udevice *dev)
 	}
 
 	plat->fcr = UART_FCR_DEFVAL;
+	/* The OMAP UARTs have a 64-byte FIFO */
+	plat->fifo_size = dev_read_u32_default(dev, "fifo-size", 64);
 
 	return 0;
 }
@@ -0,0 +1,643 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Emulation of a USB Attached SCSI (UAS) flash stick
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <os.h>
+#include <scsi.h>
+#include <usb.h>
+#include <linux/usb/uas.h>
+
+/*
+ * This driver emulates a flash stick using the USB 2.0 form of the UAS
+ * protocol, i.e. without streams. Alternate setting 0 describes Bulk-Only
+ * Transport, as on real devices, but only alternate setting 1 (UAS) is
+ * emulated. It supports only a single logical unit number (LUN 0).
+ *
+ * Queued commands are run newest first, so that the host sees commands
+ * complete out of order.
+ */
+
+enum {
+	SANDBOX_UAS_EP_BOT_OUT		= 1,	/* endpoints */
+	SANDBOX_UAS_EP_BOT_IN		= 2,
+	SANDBOX_UAS_EP_CMD		= 3,
+	SANDBOX_UAS_EP_STATUS		= 4,
+	SANDBOX_UAS_EP_DATA_IN		= 5,
+	SANDBOX_UAS_EP_DATA_OUT		= 6,
+	SANDBOX_UAS_BLOCK_LEN		= 512,
+	SANDBOX_UAS_MAX_CMDS		= 32,
+	SANDBOX_UAS_SENSE_LEN		= 18,
+};
+
+enum cmd_state {
+	CMD_FREE,
+	CMD_QUEUED,	/* waiting to be run */
+	CMD_DATA,	/* Read Ready or Write Ready sent */
+	CMD_STATUS,	/* waiting to send the Sense IU */
+};
+
+enum {
+	STRINGID_MANUFACTURER = 1,
+	STRINGID_PRODUCT,
+	STRINGID_SERIAL,
+
+	STRINGID_COUNT,
+};
+
+/**
+ * struct sandbox_uas_cmd - a command queued on the device
+ *
+ * @state:	State of the command
+ * @tag:	Tag from the Command IU
+ * @seq:	Sequence number, used to find the newest command
+ * @cdb:	SCSI command
+ * @status:	SCSI status to return
+ * @sense_key:	Sense key to return, if @status is S_CHECK_COND
+ * @asc:	Additional sense code to return
+ */
+struct sandbox_uas_cmd {
+	enum cmd_state state;
+	u16 tag;
+	uint seq;
+	u8 cdb[16];
+	u8 status;
+	u8 sense_key;
+	u8 asc;
+};
+
+/**
+ * struct sandbox_uas_priv - private state for this driver
+ *
+ * @alt:	Alternate setting selected by the host
+ * @cmd:	Commands queued on the device
+ * @cur:	Command in its data phase, or NULL if none
+ * @seq:	Sequence number for the next command
+ * @tmf_tag:	Tag of a task-management IU to respond to, or 0 if none
+ * @max_queued:	Largest number of commands queued at once
+ * @fd:		File descriptor of backing file
+ * @file_size:	Size of file in bytes
+ * @buff_used:	Number of bytes in @buff ready to transfer back to host
+ * @buff:	Data buffer for outgoing data, other than blocks
+ */
+struct sandbox_uas_priv {
+	int alt;
+	struct sandbox_uas_cmd cmd[SANDBOX_UAS_MAX_CMDS];
+	struct sandbox_uas_cmd *cur;
+	uint seq;
+	u16 tmf_tag;
+	int max_queued;
+	int fd;
+	loff_t file_size;
+	int buff_used;
+	u8 buff[64];
+};
+
+struct sandbox_uas_plat {
+	const char *pathname;
+	struct usb_string uas_strings[STRINGID_COUNT];
+};
+
+struct scsi_inquiry_resp {
+	u8 type;
+	u8 flags;
+	u8 version;
+	u8 data_format;
+	u8 additional_len;
+	u8 spare[3];
+	char vendor[8];
+	char product[16];
+	char revision[4];
+};
+
+struct scsi_read_capacity_resp {
+	u32 last_block_addr;
+	u32 block_len;
+};
+
+struct __packed scsi_rw10_req {
+	u8 cmd;
+	u8 lun_flags;
+	u32 lba;
+	u8 spare;
+	u16 transfer_len;
+	u8 spare2[3];
+};
+
+static struct usb_device_descriptor uas_device_desc = {
+	.bLength =		sizeof(uas_device_desc),
+	.bDescriptorType =	USB_DT_DEVICE,
+
+	.bcdUSB =		__constant_cpu_to_le16(0x0200),
+
+	.bDeviceClass =		0,
+	.bDeviceSubClass =	0,
+	.bDeviceProtocol =	0,
+
+	.idVendor =		__constant_cpu_to_le16(0x1234),
+	.idProduct =		__constant_cpu_to_le16(0x5679),
+	.iManufacturer =	STRINGID_MANUFACTURER,
+	.iProduct =		STRINGID_PRODUCT,
+	.iSerialNumber =	STRINGID_SERIAL,
+	.bNumConfigurations =	1,
+};
+
+static struct usb_config_descriptor uas_config0 = {
+	.bLength		= sizeof(uas_config0),
+	.bDescriptorType	= USB_DT_CONFIG,
+
+	/* wTotalLength is set up by usb-emul-uclass */
+	.bNumInterfaces		= 1,
+	.bConfigurationValue	= 0,
+	.iConfiguration		= 0,
+	.bmAttributes		= 1 << 7,
+	.bMaxPower		= 50,
+};
+
+static struct usb_interface_descriptor uas_interface0_bot = {
+	.bLength		= sizeof(uas_interface0_bot),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 0,
+	.bNumEndpoints		= 2,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_BULK,
+	.iInterface		= 0,
+};
+
+static struct usb_endpoint_descriptor uas_bot_out = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_BOT_OUT,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_endpoint_descriptor uas_bot_in = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_BOT_IN | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_interface_descriptor uas_interface0_uas = {
+	.bLength		= sizeof(uas_interface0_uas),
+	.bDescriptorType	= USB_DT_INTERFACE,
+
+	.bInterfaceNumber	= 0,
+	.bAlternateSetting	= 1,
+	.bNumEndpoints		= 4,
+	.bInterfaceClass	= USB_CLASS_MASS_STORAGE,
+	.bInterfaceSubClass	= US_SC_SCSI,
+	.bInterfaceProtocol	= US_PR_UAS,
+	.iInterface		= 0,
+};
+
+static struct usb_endpoint_descriptor uas_cmd_out = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_CMD,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_cmd_pipe = {
+	.bLength		= sizeof(uas_cmd_pipe),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= CMD_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor uas_status_in = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_STATUS | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_status_pipe = {
+	.bLength		= sizeof(uas_status_pipe),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= STATUS_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor uas_data_in = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_DATA_IN | USB_ENDPOINT_DIR_MASK,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_data_in_pipe = {
+	.bLength		= sizeof(uas_data_in_pipe),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= DATA_IN_PIPE_ID,
+};
+
+static struct usb_endpoint_descriptor uas_data_out = {
+	.bLength		= USB_DT_ENDPOINT_SIZE,
+	.bDescriptorType	= USB_DT_ENDPOINT,
+
+	.bEndpointAddress	= SANDBOX_UAS_EP_DATA_OUT,
+	.bmAttributes		= USB_ENDPOINT_XFER_BULK,
+	.wMaxPacketSize		= __constant_cpu_to_le16(512),
+	.bInterval		= 0,
+};
+
+static struct usb_pipe_usage_descriptor uas_data_out_pipe = {
+	.bLength		= sizeof(uas_data_out_pipe),
+	.bDescriptorType	= USB_DT_PIPE_USAGE,
+	.bPipeID		= DATA_OUT_PIPE_ID,
+};
+
+static void *uas_desc_list[] = {
+	&uas_device_desc,
+	&uas_config0,
+	&uas_interface0_bot,
+	&uas_bot_out,
+	&uas_bot_in,
+	&uas_interface0_uas,
+	&uas_cmd_out,
+	&uas_cmd_pipe,
+	&uas_status_in,
+	&uas_status_pipe,
+	&uas_data_in,
+	&uas_data_in_pipe,
+	&uas_data_out,
+	&uas_data_out_pipe,
+	NULL,
+};
+
+static int sandbox_uas_control(struct udevice *dev, struct usb_device *udev,
+			       unsigned long pipe, void *buff, int len,
+			       struct devrequest *setup)
+{
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	if (pipe == usb_sndctrlpipe(udev, 0)) {
+		switch (setup->request) {
+		case USB_REQ_SET_INTERFACE:
+			priv->alt = setup->value;
+			return 0;
+		case USB_REQ_CLEAR_FEATURE:
+			return 0;
+		default:
+			debug("request=%x\n", setup->request);
+			break;
+		}
+	}
+	debug("pipe=%lx\n", pipe);
+
+	return -EIO;
+}
+
+static void set_sense(struct sandbox_uas_cmd *cmd, u8 sense_key, u8 asc)
+{
+	cmd->status = S_CHECK_COND;
+	cmd->sense_key = sense_key;
+	cmd->asc = asc;
+}
+
+/*
+ * Check a READ(10) or WRITE(10) command and seek to its first block,
+ * returning the number of bytes to transfer, or 0 on error
+ */
+static int setup_rw(struct sandbox_uas_priv *priv, struct sandbox_uas_cmd *cmd)
+{
+	struct scsi_rw10_req *req = (void *)cmd->cdb;
+	ulong lba = be32_to_cpu(req->lba);
+	ulong blocks = be16_to_cpu(req->transfer_len);
+
+	debug("%s: lba=%lx, blocks=%lx\n", __func__, lba, blocks);
+	if (priv->fd == -1 ||
+	    (lba + blocks) * SANDBOX_UAS_BLOCK_LEN > priv->file_size) {
+		set_sense(cmd, SENSE_MEDIUM_ERROR, 0x11);
+		return 0;
+	}
+	os_lseek(priv->fd, lba * SANDBOX_UAS_BLOCK_LEN, OS_SEEK_SET);
+
+	return blocks * SANDBOX_UAS_BLOCK_LEN;
+}
+
+/*
+ * Start running a command, returning the IU to send: a Read Ready or Write
+ * Ready IU if it has data, else a Sense IU
+ */
+static int start_command(struct sandbox_uas_plat *plat,
+		       struct sandbox_uas_priv *priv,
+		       struct sandbox_uas_cmd *cmd)
+{
+	int iu_id = IU_ID_READ_READY;
+
+	cmd->status = S_GOOD;
+	priv->buff_used = 0;
+	switch (cmd->cdb[0]) {
+	case SCSI_INQUIRY: {
+		struct scsi_inquiry_resp *resp = (void *)priv->buff;
+
+		memset(resp, '\0', sizeof(*resp));
+		resp->data_format = 1;
+		resp->additional_len = 0x1f;
+		strncpy(resp->vendor,
+			plat->uas_strings[STRINGID_MANUFACTURER - 1].s,
+			sizeof(resp->vendor));
+		strncpy(resp->product,
+			plat->uas_strings[STRINGID_PRODUCT - 1].s,
+			sizeof(resp->product));
+		strncpy(resp->revision, "1.0", sizeof(resp->revision));
+		priv->buff_used = min_t(int, cmd->cdb[4], sizeof(*resp));
+		break;
+	}
+	case SCSI_TST_U_RDY:
+		break;
+	case SCSI_RD_CAPAC: {
+		struct scsi_read_capacity_resp *resp = (void *)priv->buff;
+		uint blocks;
+
+		if (priv->file_size)
+			blocks = priv->file_size / SANDBOX_UAS_BLOCK_LEN - 1;
+		else
+			blocks = 0;
+		resp->last_block_addr = cpu_to_be32(blocks);
+		resp->block_len = cpu_to_be32(SANDBOX_UAS_BLOCK_LEN);
+		priv->buff_used = sizeof(*resp);
+		break;
+	}
+	case SCSI_READ10:
+		priv->buff_used = setup_rw(priv, cmd);
+		break;
+	case SCSI_WRITE10:
+		priv->buff_used = setup_rw(priv, cmd);
+		iu_id = IU_ID_WRITE_READY;
+		break;
+	default:
+		debug("Command not supported: %x\n", cmd->cdb[0]);
+		set_sense(cmd, SENSE_ILLEGAL_REQUEST, 0x20);
+		break;
+	}
+	if (!priv->buff_used) {
+		cmd->state = CMD_STATUS;
+		return IU_ID_STATUS;
+	}
+	cmd->state = CMD_DATA;
+	priv->cur = cmd;
+
+	return iu_id;
+}
+
+static struct sandbox_uas_cmd *find_command(struct sandbox_uas_priv *priv,
+					enum cmd_state state)
+{
+	struct sandbox_uas_cmd *cmd, *found = NULL;
+
+	for (cmd = priv->cmd; cmd < priv->cmd + SANDBOX_UAS_MAX_CMDS; cmd++) {
+		if (cmd->state == state && (!found || cmd->seq > found->seq))
+			found = cmd;
+	}
+
+	return found;
+}
+
+static int handle_iu(struct sandbox_uas_priv *priv, const void *buff,
+		     int len)
+{
+	const struct command_iu *iu = buff;
+	struct sandbox_uas_cmd *cmd;
+	int queued, i;
+
+	if (len < sizeof(struct iu))
+		return -EIO;
+	if (iu->iu_id == IU_ID_TASK_MGMT) {
+		/* Any task-management function drops all the commands */
+		memset(priv->cmd, '\0', sizeof(priv->cmd));
+		priv->cur = NULL;
+		priv->tmf_tag = be16_to_cpu(iu->tag);
+		return len;
+	}
+	if (iu->iu_id != IU_ID_COMMAND || len != sizeof(*iu))
+		return -EIO;
+
+	for (i = 0, queued = 0, cmd = NULL; i < SANDBOX_UAS_MAX_CMDS; i++) {
+		if (priv->cmd[i].state == CMD_FREE) {
+			if (!cmd)
+				cmd = &priv->cmd[i];
+		} else if (priv->cmd[i].tag == be16_to_cpu(iu->tag)) {
+			return -EIO;
+		} else {
+			queued++;
+		}
+	}
+	if (!cmd)
+		return -EIO;
+	cmd->state = CMD_QUEUED;
+	cmd->tag = be16_to_cpu(iu->tag);
+	cmd->seq = priv->seq++;
+	memcpy(cmd->cdb, iu->cdb, sizeof(cmd->cdb));
+	if (iu->lun[1])
+		set_sense(cmd, SENSE_ILLEGAL_REQUEST, 0x25);
+	else
+		cmd->status = S_GOOD;
+	priv->max_queued = max(priv->max_queued, queued + 1);
+
+	return len;
+}
+
+static int send_status(struct sandbox_uas_plat *plat,
+		       struct sandbox_uas_priv *priv, void *buff, int len)
+{
+	struct sense_iu *iu = buff;
+	struct sandbox_uas_cmd *cmd;
+	int iu_id, size;
+
+	if (len < sizeof(struct response_iu) || priv->cur)
+		return -EIO;
+	memset(buff, '\0', len);
+	if (priv->tmf_tag) {
+		struct response_iu *resp = buff;
+
+		resp->iu_id = IU_ID_RESPONSE;
+		resp->tag = cpu_to_be16(priv->tmf_tag);
+		resp->response_code = RC_TMF_COMPLETE;
+		priv->tmf_tag = 0;
+		return sizeof(*resp);
+	}
+
+	/* Finish a command before starting another */
+	cmd = find_command(priv, CMD_STATUS);
+	if (cmd) {
+		iu_id = IU_ID_STATUS;
+	} else {
+		cmd = find_command(priv, CMD_QUEUED);
+		if (!cmd)
+			return -EIO;
+		if (cmd->status == S_GOOD)
+			iu_id = start_command(plat, priv, cmd);
+		else
+			iu_id = IU_ID_STATUS;
+	}
+	iu->iu_id = iu_id;
+	iu->tag = cpu_to_be16(cmd->tag);
+	if (iu_id != IU_ID_STATUS)
+		return sizeof(struct iu);
+
+	size = offsetof(struct sense_iu, sense);
+	iu->status = cmd->status;
+	if (cmd->status != S_GOOD) {
+		if (len < size + SANDBOX_UAS_SENSE_LEN)
+			return -EIO;
+		iu->len = cpu_to_be16(SANDBOX_UAS_SENSE_LEN);
+		iu->sense[0] = 0x70;
+		iu->sense[2] = cmd->sense_key;
+		iu->sense[7] = SANDBOX_UAS_SENSE_LEN - 8;
+		iu->sense[12] = cmd->asc;
+		size += SANDBOX_UAS_SENSE_LEN;
+	}
+	cmd->state = CMD_FREE;
+
+	return size;
+}
+
+static int transfer_data(struct sandbox_uas_priv *priv, void *buff, int len,
+			 bool dir_in)
+{
+	struct sandbox_uas_cmd *cmd = priv->cur;
+	bool rw;
+
+	if (!cmd || dir_in != (cmd->cdb[0] != SCSI_WRITE10))
+		return -EIO;
+	rw = cmd->cdb[0] == SCSI_READ10 || cmd->cdb[0] == SCSI_WRITE10;
+	if (rw && len != priv->buff_used)
+		return -EIO;
+	len = min(len, priv->buff_used);
+	if (!rw)
+		memcpy(buff, priv->buff, len);
+	else if (dir_in && os_read(priv->fd, buff, len) != len)
+		return -EIO;
+	else if (!dir_in && os_write(priv->fd, buff, len) != len)
+		return -EIO;
+	cmd->state = CMD_STATUS;
+	priv->cur = NULL;
+
+	return len;
+}
+
+static int sandbox_uas_bulk(struct udevice *dev, struct usb_device *udev,
+			    unsigned long pipe, void *buff, int len)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+	int ep = usb_pipeendpoint(pipe);
+
+	debug("%s: dev=%s, pipe=%lx, ep=%x, len=%x\n", __func__, dev->name,
+	      pipe, ep, len);
+	if (priv->alt != 1)
+		return -EIO;
+	switch (ep) {
+	case SANDBOX_UAS_EP_CMD:
+		return handle_iu(priv, buff, len);
+	case SANDBOX_UAS_EP_STATUS:
+		return send_status(plat, priv, buff, len);
+	case SANDBOX_UAS_EP_DATA_IN:
+		return transfer_data(priv, buff, len, true);
+	case SANDBOX_UAS_EP_DATA_OUT:
+		return transfer_data(priv, buff, len, false);
+	}
+
+	return -EIO;
+}
+
+int sandbox_usb_uas_get_max_queued(struct udevice *dev)
+{
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+	int max_queued = priv->max_queued;
+
+	priv->max_queued = 0;
+
+	return max_queued;
+}
+
+static int sandbox_uas_ofdata_to_platdata(struct udevice *dev)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+
+	plat->pathname = dev_read_string(dev, "sandbox,filepath");
+
+	return 0;
+}
+
+static int sandbox_uas_bind(struct udevice *dev)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+	struct usb_string *fs;
+
+	fs = plat->uas_strings;
+	fs[0].id = STRINGID_MANUFACTURER;
+	fs[0].s = "sandbox";
+	fs[1].id = STRINGID_PRODUCT;
+	fs[1].s = "uas";
+	fs[2].id = STRINGID_SERIAL;
+	fs[2].s = dev->name;
+
+	return usb_emul_setup_device(dev, plat->uas_strings, uas_desc_list);
+}
+
+static int sandbox_uas_probe(struct udevice *dev)
+{
+	struct sandbox_uas_plat *plat = dev_get_platdata(dev);
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	priv->fd = os_open(plat->pathname, OS_O_RDWR);
+	if (priv->fd != -1)
+		return os_get_filesize(plat->pathname, &priv->file_size);
+
+	return 0;
+}
+
+static int sandbox_uas_remove(struct udevice *dev)
+{
+	struct sandbox_uas_priv *priv = dev_get_priv(dev);
+
+	if (priv->fd != -1)
+		os_close(priv->fd);
+
+	return 0;
+}
+
+static const struct dm_usb_ops sandbox_usb_uas_ops = {
+	.control	= sandbox_uas_control,
+	.bulk		= sandbox_uas_bulk,
+};
+
+static const struct udevice_id sandbox_usb_uas_ids[] = {
+	{ .compatible = "sandbox,usb-uas" },
+	{ }
+};
+
+U_BOOT_DRIVER(usb_sandbox_uas) = {
+	.name	= "usb_sandbox_uas",
+	.id	= UCLASS_USB_EMUL,
+	.of_match = sandbox_usb_uas_ids,
+	.bind	= sandbox_uas_bind,
+	.probe	= sandbox_uas_probe,
+	.remove	= sandbox_uas_remove,
+	.ofdata_to_platdata = sandbox_uas_ofdata_to_platdata,
+	.ops	= &sandbox_usb_uas_ops,
+	.priv_auto_alloc_size = sizeof(struct sandbox_uas_priv),
+	.platdata_auto_alloc_size = sizeof(struct sandbox_uas_plat),
+};
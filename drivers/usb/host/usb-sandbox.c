@@ -7,12 +7,54 @@
 #include <common.h>
 #include <dm.h>
 #include <usb.h>
+#include <asm/test.h>
 #include <dm/root.h>
 
+/**
+ * struct sandbox_usb_ctrl - private data for the sandbox USB controller
+ *
+ * @rootdev: USB address of the root hub
+ * @streams: Number of calls to the bulk_stream() method
+ * @stream_xfers: Total number of transfers in those calls
+ * @reset_hub: Hub whose port was reset last
+ * @reset_port: Number of that port (numbered from 1)
+ * @resetting: Number of ports which were reset, with the device on them not
+ *	yet given an address
+ * @max_resetting: Largest value of @resetting seen
+ */
 struct sandbox_usb_ctrl {
 	int rootdev;
+	int streams;
+	int stream_xfers;
+	struct usb_device *reset_hub;
+	int reset_port;
+	int resetting;
+	int max_resetting;
 };
 
+/* Keep track of ports between reset and address assignment */
+static void sandbox_track_reset(struct sandbox_usb_ctrl *ctrl,
+				struct usb_device *udev,
+				struct devrequest *setup)
+{
+	if (setup->requesttype == USB_RT_PORT &&
+	    setup->request == USB_REQ_SET_FEATURE &&
+	    le16_to_cpu(setup->value) == USB_PORT_FEAT_RESET) {
+		/* A port reset is retried if it does not finish in time */
+		if (udev == ctrl->reset_hub &&
+		    le16_to_cpu(setup->index) == ctrl->reset_port)
+			return;
+		ctrl->reset_hub = udev;
+		ctrl->reset_port = le16_to_cpu(setup->index);
+		ctrl->resetting++;
+		ctrl->max_resetting = max(ctrl->max_resetting,
+					  ctrl->resetting);
+	} else if (setup->request == USB_REQ_SET_ADDRESS && ctrl->resetting) {
+		ctrl->reset_hub = NULL;
+		ctrl->resetting--;
+	}
+}
+
 static void usbmon_trace(struct udevice *bus, ulong pipe,
 			 struct devrequest *setup, struct udevice *emul)
 {
@@ -52,6 +94,7 @@ static int sandbox_submit_control(struct udevice *bus,
 	if (ret)
 		return ret;
 
+	sandbox_track_reset(ctrl, udev, setup);
 	if (usb_pipedevice(pipe) == ctrl->rootdev) {
 		if (setup->request == USB_REQ_SET_ADDRESS) {
 			debug("%s: Set root hub's USB address\n", __func__);
@@ -97,6 +140,48 @@ static int sandbox_submit_bulk(struct udevice *bus, struct usb_device *udev,
 	return ret;
 }
 
+static int sandbox_submit_bulk_stream(struct udevice *bus,
+				      struct usb_device *udev,
+				      unsigned long pipe,
+				      struct usb_bulk_xfer *xfer, int count)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	int ret, i;
+
+	ctrl->streams++;
+	ctrl->stream_xfers += count;
+	for (i = 0; i < count; i++) {
+		udev->status = USB_ST_NOT_PROC;
+		ret = sandbox_submit_bulk(bus, udev, pipe, xfer[i].buffer,
+					  xfer[i].length);
+		xfer[i].status = udev->status;
+		xfer[i].act_len = udev->act_len;
+		if (ret < 0)
+			return udev->status == USB_ST_NOT_PROC ? ret : -EIO;
+	}
+
+	return 0;
+}
+
+int sandbox_usb_get_streams(struct udevice *bus, int *xfersp)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+
+	*xfersp = ctrl->stream_xfers;
+
+	return ctrl->streams;
+}
+
+int sandbox_usb_get_max_resetting(struct udevice *bus)
+{
+	struct sandbox_usb_ctrl *ctrl = dev_get_priv(bus);
+	int max_resetting = ctrl->max_resetting;
+
+	ctrl->max_resetting = ctrl->resetting;
+
+	return max_resetting;
+}
+
 static int sandbox_submit_int(struct udevice *bus, struct usb_device *udev,
 			      unsigned long pipe, void *buffer, int length,
 			      int interval)
@@ -138,6 +223,7 @@ static int sandbox_usb_probe(struct udevice *dev)
 static const struct dm_usb_ops sandbox_usb_ops = {
 	.control	= sandbox_submit_control,
 	.bulk		= sandbox_submit_bulk,
+	.bulk_stream	= sandbox_submit_bulk_stream,
 	.interrupt	= sandbox_submit_int,
 	.alloc_device	= sandbox_alloc_device,
 };
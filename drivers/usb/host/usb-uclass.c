@@ -70,11 +70,43 @@ int submit_bulk_msg(struct usb_device *udev, unsigned long pipe, void *buffer,
 {
 	struct udevice *bus = udev->controller_dev;
 	struct dm_usb_ops *ops = usb_get_ops(bus);
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+	ulong start;
+	int ret;
 
 	if (!ops->bulk)
 		return -ENOSYS;
 
-	return ops->bulk(bus, udev, pipe, buffer, length);
+	start = timer_get_us();
+	ret = ops->bulk(bus, udev, pipe, buffer, length);
+	priv->bulk_us += timer_get_us() - start;
+	if (ret >= 0 && !udev->status)
+		priv->bulk_bytes += udev->act_len;
+
+	return ret;
+}
+
+int submit_bulk_stream(struct usb_device *udev, unsigned long pipe,
+		       struct usb_bulk_xfer *xfer, int count)
+{
+	struct udevice *bus = udev->controller_dev;
+	struct dm_usb_ops *ops = usb_get_ops(bus);
+	struct usb_bus_priv *priv = dev_get_uclass_priv(bus);
+	ulong start;
+	int ret, i;
+
+	if (!ops->bulk_stream)
+		return -ENOSYS;
+
+	start = timer_get_us();
+	ret = ops->bulk_stream(bus, udev, pipe, xfer, count);
+	priv->bulk_us += timer_get_us() - start;
+	for (i = 0; i < count; i++) {
+		if (!xfer[i].status)
+			priv->bulk_bytes += xfer[i].act_len;
+	}
+
+	return ret;
 }
 
 struct int_queue *create_int_queue(struct usb_device *udev,
@@ -200,25 +232,47 @@ int usb_stop(void)
 	return err;
 }
 
-static void usb_scan_bus(struct udevice *bus, bool recurse)
+/*
+ * Scan the primary controllers, or their companions. The root hubs are probed
+ * first and their ports are then scanned together, so that the port delays
+ * on each bus overlap.
+ */
+static void usb_scan_buses(struct uclass *uc, bool companion)
 {
 	struct usb_bus_priv *priv;
-	struct udevice *dev;
+	struct udevice *bus, *dev;
 	int ret;
 
-	priv = dev_get_uclass_priv(bus);
+	usb_hub_scan_begin();
+	uclass_foreach_dev(bus, uc) {
+		priv = dev_get_uclass_priv(bus);
+		if (!device_active(bus) || priv->companion != companion)
+			continue;
 
-	assert(recurse);	/* TODO: Support non-recusive */
+		debug("scanning bus %d\n", bus->seq);
+		ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
+		if (ret)
+			printf("scanning bus %d for devices... failed, error %d\n",
+			       bus->seq, ret);
+	}
+	usb_hub_scan_end();
 
-	printf("scanning bus %d for devices... ", bus->seq);
-	debug("\n");
-	ret = usb_scan_device(bus, 0, USB_SPEED_FULL, &dev);
-	if (ret)
-		printf("failed, error %d\n", ret);
-	else if (priv->next_addr == 0)
-		printf("No USB Device found\n");
-	else
-		printf("%d USB Device(s) found\n", priv->next_addr);
+	uclass_foreach_dev(bus, uc) {
+		priv = dev_get_uclass_priv(bus);
+		if (!device_active(bus) || priv->companion != companion)
+			continue;
+
+		/* Skip buses whose root hub failed, reported above */
+		device_find_first_child(bus, &dev);
+		if (!dev || !device_active(dev))
+			continue;
+
+		printf("scanning bus %d for devices... ", bus->seq);
+		if (priv->next_addr == 0)
+			printf("No USB Device found\n");
+		else
+			printf("%d USB Device(s) found\n", priv->next_addr);
+	}
 }
 
 static void remove_inactive_children(struct uclass *uc, struct udevice *bus)
@@ -239,7 +293,6 @@ int usb_init(void)
 {
 	int controllers_initialized = 0;
 	struct usb_uclass_priv *uc_priv;
-	struct usb_bus_priv *priv;
 	struct udevice *bus;
 	struct uclass *uc;
 	int count = 0;
@@ -291,30 +344,15 @@ int usb_init(void)
 	 * lowlevel init done, now scan the bus for devices i.e. search HUBs
 	 * and configure them, first scan primary controllers.
 	 */
-	uclass_foreach_dev(bus, uc) {
-		if (!device_active(bus))
-			continue;
-
-		priv = dev_get_uclass_priv(bus);
-		if (!priv->companion)
-			usb_scan_bus(bus, true);
-	}
+	usb_scan_buses(uc, false);
 
 	/*
 	 * Now that the primary controllers have been scanned and have handed
 	 * over any devices they do not understand to their companions, scan
 	 * the companions if necessary.
 	 */
-	if (uc_priv->companion_device_count) {
-		uclass_foreach_dev(bus, uc) {
-			if (!device_active(bus))
-				continue;
-
-			priv = dev_get_uclass_priv(bus);
-			if (priv->companion)
-				usb_scan_bus(bus, true);
-		}
-	}
+	if (uc_priv->companion_device_count)
+		usb_scan_buses(uc, true);
 
 	debug("scan end\n");
 
@@ -286,10 +286,7 @@ static struct xhci_segment *xhci_segment_alloc(void)
 
 /**
  * Create a new ring with zero or more segments.
- * TODO: current code only uses one-time-allocated single-segment rings
- * of 1KB anyway, so we might as well get rid of all the segment and
- * linking code (and maybe increase the size a bit, e.g. 4KB).
- *
+ * Bulk endpoints use BULK_RING_SEGS segments, all other rings have one.
  *
  * Link each segment together into a ring.
  * Set the end flag and the cycle toggle bit on the last segment.
@@ -310,6 +307,7 @@ struct xhci_ring *xhci_ring_alloc(unsigned int num_segs, bool link_trbs)
 	if (num_segs == 0)
 		return ring;
 
+	ring->num_segs = num_segs;
 	ring->first_seg = xhci_segment_alloc();
 	BUG_ON(!ring->first_seg);
 
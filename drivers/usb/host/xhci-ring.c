@@ -473,6 +473,25 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 	BUG();
 }
 
+/*
+ * Sets the xHC's dequeue pointer for an endpoint to our enqueue pointer,
+ * throwing away all unprocessed TRBs. The endpoint must be stopped.
+ */
+static void set_deq_to_enqueue(struct usb_device *udev, int ep_index)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_ring *ring =  ctrl->devs[udev->slot_id]->eps[ep_index].ring;
+	union xhci_trb *event;
+
+	xhci_queue_command(ctrl, (void *)((uintptr_t)ring->enqueue |
+		ring->cycle_state), udev->slot_id, ep_index, TRB_SET_DEQ);
+	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
+		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
+		event->event_cmd.status)) != COMP_SUCCESS);
+	xhci_acknowledge_event(ctrl);
+}
+
 /*
  * Stops transfer processing for an endpoint and throws away all unprocessed
  * TRBs by setting the xHC's dequeue pointer to our enqueue pointer. The next
@@ -484,7 +503,6 @@ union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected)
 static void abort_td(struct usb_device *udev, int ep_index)
 {
 	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
-	struct xhci_ring *ring =  ctrl->devs[udev->slot_id]->eps[ep_index].ring;
 	union xhci_trb *event;
 	u32 field;
 
@@ -504,13 +522,41 @@ static void abort_td(struct usb_device *udev, int ep_index)
 		event->event_cmd.status)) != COMP_SUCCESS);
 	xhci_acknowledge_event(ctrl);
 
-	xhci_queue_command(ctrl, (void *)((uintptr_t)ring->enqueue |
-		ring->cycle_state), udev->slot_id, ep_index, TRB_SET_DEQ);
-	event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
-	BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
-		!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
-		event->event_cmd.status)) != COMP_SUCCESS);
-	xhci_acknowledge_event(ctrl);
+	set_deq_to_enqueue(udev, ep_index);
+}
+
+/*
+ * Throws away the TDs still queued on an endpoint after one of them failed.
+ * A halted endpoint is reset first, which stops it so that the dequeue
+ * pointer can be moved.
+ */
+static void drop_queued_tds(struct usb_device *udev, int ep_index)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_virt_device *virt_dev = ctrl->devs[udev->slot_id];
+	struct xhci_ep_ctx *ep_ctx;
+	union xhci_trb *event;
+
+	xhci_inval_cache((uintptr_t)virt_dev->out_ctx->bytes,
+			 virt_dev->out_ctx->size);
+	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
+
+	switch (le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK) {
+	case EP_STATE_RUNNING:
+		abort_td(udev, ep_index);
+		break;
+	case EP_STATE_HALTED:
+		xhci_queue_command(ctrl, NULL, udev->slot_id, ep_index,
+				   TRB_RESET_EP);
+		event = xhci_wait_for_event(ctrl, TRB_COMPLETION);
+		BUG_ON(TRB_TO_SLOT_ID(le32_to_cpu(event->event_cmd.flags))
+			!= udev->slot_id || GET_COMP_CODE(le32_to_cpu(
+			event->event_cmd.status)) != COMP_SUCCESS);
+		xhci_acknowledge_event(ctrl);
+		/* fallthrough */
+	default:
+		set_deq_to_enqueue(udev, ep_index);
+	}
 }
 
 static void record_transfer_result(struct usb_device *udev,
@@ -542,19 +588,104 @@ static void record_transfer_result(struct usb_device *udev,
 }
 
 /**** Bulk and Control transfer methods ****/
+
+/**
+ * struct xhci_bulk_td - A bulk TD queued on a transfer ring
+ *
+ * @seg:	Segment holding the first TRB of the TD
+ * @first:	First TRB of the TD
+ * @last:	Last TRB of the TD, which interrupts on completion
+ * @cost:	Number of ring entries set aside for the TD, including any
+ *		link TRBs it may span
+ */
+struct xhci_bulk_td {
+	struct xhci_segment *seg;
+	union xhci_trb *first;
+	union xhci_trb *last;
+	int cost;
+};
+
+/**
+ * Works out the number of TRBs needed for a bulk transfer
+ *
+ * @param buffer	buffer to be read/written
+ * @param length	length of the buffer
+ * @return number of TRBs
+ */
+static int bulk_td_trbs(void *buffer, int length)
+{
+	u64 val_64 = (uintptr_t)buffer;
+	int running_total;
+	int num_trbs = 0;
+
+	/*
+	 * How much data is (potentially) left before the 64KB boundary?
+	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
+	 * that the buffer should not span 64KB boundary. if so
+	 * we send request in more than 1 TRB by chaining them.
+	 */
+	running_total = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
+	running_total &= TRB_MAX_BUFF_SIZE - 1;
+
+	/*
+	 * If there's some data on this 64KB chunk, or we have to send a
+	 * zero-length transfer, we need at least one TRB
+	 */
+	if (running_total != 0 || length == 0)
+		num_trbs++;
+
+	/* How many more 64KB chunks to transfer, how many more TRBs? */
+	while (running_total < length) {
+		num_trbs++;
+		running_total += TRB_MAX_BUFF_SIZE;
+	}
+
+	return num_trbs;
+}
+
+/**
+ * Checks whether a TRB is part of a TD
+ *
+ * @param ctrl	Host controller data structure
+ * @param ring	EP transfer ring holding the TD
+ * @param td	TD to check
+ * @param trb	TRB to look for
+ * @return true if @trb is in @td
+ */
+static bool td_has_trb(struct xhci_ctrl *ctrl, struct xhci_ring *ring,
+		       struct xhci_bulk_td *td, union xhci_trb *trb)
+{
+	struct xhci_segment *seg = td->seg;
+	union xhci_trb *cur = td->first;
+
+	while (cur != trb) {
+		if (cur == td->last)
+			return false;
+		cur++;
+		if (last_trb(ctrl, ring, seg, cur)) {
+			seg = seg->next;
+			cur = seg->trbs;
+		}
+	}
+
+	return true;
+}
+
 /**
- * Queues up the BULK Request
+ * Queues up a bulk TD and rings the doorbell, without waiting for it
  *
  * @param udev		pointer to the USB device structure
  * @param pipe		contains the DIR_IN or OUT , devnum
  * @param length	length of the buffer
  * @param buffer	buffer to be read/written based on the request
- * @return returns 0 if successful else -1 on failure
+ * @param td		returns the position of the TD in the ring
+ * @return 0 if successful else error code on failure
  */
-int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
-			int length, void *buffer)
+static int queue_bulk_td(struct usb_device *udev, unsigned long pipe,
+			 int length, void *buffer, struct xhci_bulk_td *td)
 {
-	int num_trbs = 0;
+	int num_trbs;
 	struct xhci_generic_trb *start_trb;
 	bool first_trb = false;
 	int start_cycle;
@@ -566,7 +697,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	struct xhci_virt_device *virt_dev;
 	struct xhci_ep_ctx *ep_ctx;
 	struct xhci_ring *ring;		/* EP transfer ring */
-	union xhci_trb *event;
+	struct xhci_generic_trb *trb;
 
 	int running_total, trb_buff_len;
 	unsigned int total_packet_count;
@@ -588,35 +719,8 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	ep_ctx = xhci_get_ep_ctx(ctrl, virt_dev->out_ctx, ep_index);
 
 	ring = virt_dev->eps[ep_index].ring;
-	/*
-	 * How much data is (potentially) left before the 64KB boundary?
-	 * XHCI Spec puts restriction( TABLE 49 and 6.4.1 section of XHCI Spec)
-	 * that the buffer should not span 64KB boundary. if so
-	 * we send request in more than 1 TRB by chaining them.
-	 */
-	running_total = TRB_MAX_BUFF_SIZE -
-			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
-	trb_buff_len = running_total;
-	running_total &= TRB_MAX_BUFF_SIZE - 1;
-
-	/*
-	 * If there's some data on this 64KB chunk, or we have to send a
-	 * zero-length transfer, we need at least one TRB
-	 */
-	if (running_total != 0 || length == 0)
-		num_trbs++;
-
-	/* How many more 64KB chunks to transfer, how many more TRBs? */
-	while (running_total < length) {
-		num_trbs++;
-		running_total += TRB_MAX_BUFF_SIZE;
-	}
+	num_trbs = bulk_td_trbs(buffer, length);
 
-	/*
-	 * XXX: Calling routine prepare_ring() called in place of
-	 * prepare_trasfer() as there in 'Linux' since we are not
-	 * maintaining multiple TDs/transfer at the same time.
-	 */
 	ret = prepare_ring(ctrl, ring,
 			   le32_to_cpu(ep_ctx->ep_info) & EP_STATE_MASK);
 	if (ret < 0)
@@ -629,6 +733,8 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	 */
 	start_trb = &ring->enqueue->generic;
 	start_cycle = ring->cycle_state;
+	td->seg = ring->enq_seg;
+	td->first = ring->enqueue;
 
 	running_total = 0;
 	maxpacketsize = usb_maxpacket(udev, pipe);
@@ -643,6 +749,8 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	 * we send request in more than 1 TRB by chaining them.
 	 */
 	addr = val_64;
+	trb_buff_len = TRB_MAX_BUFF_SIZE -
+			(lower_32_bits(val_64) & (TRB_MAX_BUFF_SIZE - 1));
 
 	if (trb_buff_len > length)
 		trb_buff_len = length;
@@ -698,7 +806,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		trb_fields[2] = length_field;
 		trb_fields[3] = field | (TRB_NORMAL << TRB_TYPE_SHIFT);
 
-		queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
+		trb = queue_trb(ctrl, ring, (num_trbs > 1), trb_fields);
 
 		--num_trbs;
 
@@ -708,9 +816,154 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		addr += trb_buff_len;
 		trb_buff_len = min((length - running_total), TRB_MAX_BUFF_SIZE);
 	} while (running_total < length);
+	td->last = (union xhci_trb *)trb;
 
 	giveback_first_trb(udev, ep_index, start_cycle, start_trb);
 
+	return 0;
+}
+
+/**
+ * Carries out a sequence of bulk transfers on one endpoint
+ *
+ * Each transfer is a separate TD. Up to XHCI_MAX_BULK_TDS TDs are queued at
+ * once, as far as there is space in the ring, so that the xHC can start on
+ * the next one as soon as one finishes. The transfers stop at the first one
+ * which fails. A short packet on an IN endpoint ends that transfer, but the
+ * next one still goes ahead. On return udev->status and udev->act_len are
+ * those of the last transfer carried out.
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param xfer		transfers to carry out; the status and act_len of
+ *			each are updated
+ * @param count		number of transfers
+ * @return 0 if all transfers completed, -EIO if one failed, other error
+ *	code if the transfers could not be carried out
+ */
+int xhci_bulk_stream(struct usb_device *udev, unsigned long pipe,
+		     struct usb_bulk_xfer *xfer, int count)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct xhci_bulk_td tds[XHCI_MAX_BULK_TDS];
+	int queued, done, used, avail;
+	struct usb_bulk_xfer *cur;
+	struct xhci_bulk_td *td;
+	struct xhci_ring *ring;		/* EP transfer ring */
+	union xhci_trb *event;
+	union xhci_trb *trb;
+	int ep_index;
+	u32 field;
+	int ret;
+	int i;
+
+	ep_index = usb_pipe_ep_index(pipe);
+	ring = ctrl->devs[udev->slot_id]->eps[ep_index].ring;
+	avail = ring->num_segs * (TRBS_PER_SEGMENT - 1);
+	for (i = 0; i < count; i++) {
+		xfer[i].status = USB_ST_NOT_PROC;
+		xfer[i].act_len = 0;
+	}
+
+	for (queued = 0, done = 0, used = 0; done < count; done++) {
+		/* Keep as many TDs queued as there is space for */
+		while (queued < count && queued - done < XHCI_MAX_BULK_TDS) {
+			td = &tds[queued % XHCI_MAX_BULK_TDS];
+			cur = &xfer[queued];
+			td->cost = bulk_td_trbs(cur->buffer, cur->length);
+			td->cost += td->cost / (TRBS_PER_SEGMENT - 1) + 2;
+			if (queued > done && used + td->cost >= avail)
+				break;
+			ret = queue_bulk_td(udev, pipe, cur->length,
+					    cur->buffer, td);
+			if (ret) {
+				/* Finish the TDs already queued first */
+				if (queued == done)
+					return ret;
+				break;
+			}
+			used += td->cost;
+			queued++;
+		}
+
+		td = &tds[done % XHCI_MAX_BULK_TDS];
+		cur = &xfer[done];
+		for (;;) {
+			event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
+			if (!event)
+				break;
+			field = le32_to_cpu(event->trans_event.flags);
+			BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
+			BUG_ON(TRB_TO_EP_INDEX(field) != ep_index);
+			trb = (union xhci_trb *)(uintptr_t)
+				le64_to_cpu(event->trans_event.buffer);
+			if (td_has_trb(ctrl, ring, td, trb))
+				break;
+
+			/* This is for a TD which already ended short */
+			debug("Skipping event for TRB %p\n", trb);
+			xhci_acknowledge_event(ctrl);
+		}
+		if (!event) {
+			debug("XHCI bulk transfer timed out, aborting...\n");
+			abort_td(udev, ep_index);
+			/* closest thing to a timeout */
+			cur->status = udev->status = USB_ST_NAK_REC;
+			udev->act_len = 0;
+			return -ETIMEDOUT;
+		}
+
+		record_transfer_result(udev, event, cur->length);
+		xhci_acknowledge_event(ctrl);
+		xhci_inval_cache((uintptr_t)cur->buffer, cur->length);
+		cur->status = udev->status;
+		cur->act_len = udev->act_len;
+		used -= td->cost;
+		if (udev->status) {
+			if (queued > done + 1)
+				drop_queued_tds(udev, ep_index);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * Queues up the BULK Request and waits for it to complete
+ *
+ * @param udev		pointer to the USB device structure
+ * @param pipe		contains the DIR_IN or OUT , devnum
+ * @param length	length of the buffer
+ * @param buffer	buffer to be read/written based on the request
+ * @return returns 0 if successful else -1 on failure
+ */
+int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
+			int length, void *buffer)
+{
+	struct xhci_ctrl *ctrl = xhci_get_ctrl(udev);
+	struct usb_bulk_xfer xfer = {
+		.buffer = buffer,
+		.length = length,
+	};
+	struct xhci_bulk_td td;
+	union xhci_trb *event;
+	int ep_index;
+	u32 field;
+	int ret;
+
+	if (IS_ENABLED(CONFIG_USB_XHCI_BULK_STREAM)) {
+		ret = xhci_bulk_stream(udev, pipe, &xfer, 1);
+
+		/* A failed transfer is reported in udev->status */
+		return ret == -EIO ? 0 : ret;
+	}
+
+	ep_index = usb_pipe_ep_index(pipe);
+	ret = queue_bulk_td(udev, pipe, length, buffer, &td);
+	if (ret)
+		return ret;
+
 	event = xhci_wait_for_event(ctrl, TRB_TRANSFER);
 	if (!event) {
 		debug("XHCI bulk transfer timed out, aborting...\n");
@@ -721,7 +974,7 @@ int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 	}
 	field = le32_to_cpu(event->trans_event.flags);
 
-	BUG_ON(TRB_TO_SLOT_ID(field) != slot_id);
+	BUG_ON(TRB_TO_SLOT_ID(field) != udev->slot_id);
 	BUG_ON(TRB_TO_EP_INDEX(field) != ep_index);
 	BUG_ON(*(void **)(uintptr_t)le64_to_cpu(event->trans_event.buffer) -
 		buffer > (size_t)length);
@@ -570,7 +570,9 @@ static int xhci_set_configuration(struct usb_device *udev)
 		ep_ctx[ep_index] = xhci_get_ep_ctx(ctrl, in_ctx, ep_index);
 
 		/* Allocate the ep rings */
-		virt_dev->eps[ep_index].ring = xhci_ring_alloc(1, true);
+		virt_dev->eps[ep_index].ring = xhci_ring_alloc(
+			usb_endpoint_xfer_bulk(endpt_desc) ? BULK_RING_SEGS : 1,
+			true);
 		if (!virt_dev->eps[ep_index].ring)
 			return -ENOMEM;
 
@@ -1384,6 +1386,21 @@ static int xhci_submit_bulk_msg(struct udevice *dev, struct usb_device *udev,
 	return _xhci_submit_bulk_msg(udev, pipe, buffer, length);
 }
 
+#ifdef CONFIG_USB_XHCI_BULK_STREAM
+static int xhci_submit_bulk_stream(struct udevice *dev,
+				   struct usb_device *udev, unsigned long pipe,
+				   struct usb_bulk_xfer *xfer, int count)
+{
+	debug("%s: dev='%s', udev=%p\n", __func__, dev->name, udev);
+	if (usb_pipetype(pipe) != PIPE_BULK) {
+		printf("non-bulk pipe (type=%lu)", usb_pipetype(pipe));
+		return -EINVAL;
+	}
+
+	return xhci_bulk_stream(udev, pipe, xfer, count);
+}
+#endif
+
 static int xhci_submit_int_msg(struct udevice *dev, struct usb_device *udev,
 			       unsigned long pipe, void *buffer, int length,
 			       int interval)
@@ -1472,8 +1489,16 @@ static int xhci_get_max_xfer_size(struct udevice *dev, size_t *size)
 	 * a TRB ring. Each TRB can transfer up to 64K bytes, however data
 	 * buffers referenced by transfer TRBs shall not span 64KB boundaries.
 	 * Hence the maximum number of TRBs we can use in one transfer is 62.
+	 *
+	 * With CONFIG_USB_XHCI_BULK_STREAM, bulk endpoints have BULK_RING_SEGS
+	 * segments instead. A transfer may use up to BULK_TD_MAX_TRBS of
+	 * these, leaving space to queue another while it is in flight, and an
+	 * unaligned buffer needs one more TRB.
 	 */
-	*size = (TRBS_PER_SEGMENT - 2) * TRB_MAX_BUFF_SIZE;
+	if (IS_ENABLED(CONFIG_USB_XHCI_BULK_STREAM))
+		*size = (BULK_TD_MAX_TRBS - 1) * TRB_MAX_BUFF_SIZE;
+	else
+		*size = (TRBS_PER_SEGMENT - 2) * TRB_MAX_BUFF_SIZE;
 
 	return 0;
 }
@@ -1528,6 +1553,9 @@ int xhci_deregister(struct udevice *dev)
 struct dm_usb_ops xhci_usb_ops = {
 	.control = xhci_submit_control_msg,
 	.bulk = xhci_submit_bulk_msg,
+#ifdef CONFIG_USB_XHCI_BULK_STREAM
+	.bulk_stream = xhci_submit_bulk_stream,
+#endif
 	.interrupt = xhci_submit_int_msg,
 	.alloc_device = xhci_alloc_device,
 	.update_hub_device = xhci_update_hub_device,
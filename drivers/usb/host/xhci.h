@@ -999,6 +999,22 @@ typedef enum {
 /* TRB buffer pointers can't cross 64KB boundaries */
 #define TRB_MAX_BUFF_SHIFT	16
 #define TRB_MAX_BUFF_SIZE	(1 << TRB_MAX_BUFF_SHIFT)
+/* Bulk endpoints get larger rings, so that several TDs can be queued */
+#ifdef CONFIG_USB_XHCI_BULK_STREAM
+#define BULK_RING_SEGS		4
+#else
+#define BULK_RING_SEGS		1
+#endif
+/* TRBs in a bulk endpoint ring which can hold transfers, i.e. not links */
+#define BULK_RING_TRBS		(BULK_RING_SEGS * (TRBS_PER_SEGMENT - 1))
+/*
+ * Largest bulk TD, in TRBs. Two of these fit in the ring, allowing for the
+ * link TRBs they may span, so the next TD can be queued while one is in
+ * flight
+ */
+#define BULK_TD_MAX_TRBS	(BULK_RING_TRBS / 2 - 4)
+/* Maximum number of bulk TDs queued at once by xhci_bulk_stream() */
+#define XHCI_MAX_BULK_TDS	8
 
 struct xhci_segment {
 	union xhci_trb		*trbs;
@@ -1253,6 +1269,8 @@ void xhci_queue_command(struct xhci_ctrl *ctrl, u8 *ptr,
 			u32 slot_id, u32 ep_index, trb_type cmd);
 void xhci_acknowledge_event(struct xhci_ctrl *ctrl);
 union xhci_trb *xhci_wait_for_event(struct xhci_ctrl *ctrl, trb_type expected);
+int xhci_bulk_stream(struct usb_device *udev, unsigned long pipe,
+		     struct usb_bulk_xfer *xfer, int count);
 int xhci_bulk_tx(struct usb_device *udev, unsigned long pipe,
 		 int length, void *buffer);
 int xhci_ctrl_tx(struct usb_device *udev, unsigned long pipe,
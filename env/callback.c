@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <environment.h>
+#include <errno.h>
 
 #if defined(CONFIG_NEEDS_MANUAL_RELOC)
 DECLARE_GLOBAL_DATA_PTR;
@@ -119,6 +120,24 @@ static int set_callback(const char *name, const char *value, void *priv)
 	return 0;
 }
 
+int env_callback_attach(const char *name, const char *callback)
+{
+	ENTRY e, *ep;
+
+	e.key	= name;
+	e.data	= NULL;
+	e.callback = NULL;
+	hsearch_r(e, FIND, &ep, &env_htab, 0);
+	if (ep == NULL)
+		return -ENOENT;
+	if (ep->callback)
+		return -EBUSY;
+	if (!find_env_callback(callback))
+		return -ENOSYS;
+
+	return set_callback(name, callback, NULL);
+}
+
 static int on_callbacks(const char *name, const char *value, enum env_op op,
 	int flags)
 {
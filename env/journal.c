@@ -0,0 +1,271 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Journal of changes saved since the environment was last written in full
+ *
+ * Writing the whole environment means erasing and rewriting CONFIG_ENV_SIZE
+ * bytes, even to change a single variable. Instead, each copy of the
+ * environment in storage may be followed by a journal. A 'saveenv' appends a
+ * record holding just the variables which changed. Once the journal is full
+ * the environment is written in full and the journal starts again.
+ */
+
+#include <common.h>
+#include <env_journal.h>
+#include <errno.h>
+#include <malloc.h>
+#include <memalign.h>
+#include <search.h>
+
+uint32_t env_journal_base(const env_t *env)
+{
+	uint32_t base;
+
+	memcpy(&base, &env->crc, sizeof(base));
+#ifdef CONFIG_SYS_REDUNDAND_ENVIRONMENT
+	base = crc32(base, &env->flags, sizeof(env->flags));
+#endif
+
+	return base;
+}
+
+static uint32_t env_journal_crc(const struct env_journal_rec *rec)
+{
+	uint32_t crc;
+
+	crc = crc32(0, (const uchar *)rec,
+		    offsetof(struct env_journal_rec, crc));
+
+	return crc32(crc, (const uchar *)(rec + 1), rec->len);
+}
+
+/* Get the space taken by a record with @len bytes of changes */
+static ulong env_journal_rec_size(struct env_journal *jnl, ulong len)
+{
+	return ALIGN(sizeof(struct env_journal_rec) + len, jnl->align);
+}
+
+static bool env_journal_erased(struct env_journal *jnl, const char *buf,
+			       ulong size)
+{
+	while (size--) {
+		if (*buf++ != (char)jnl->erase_val)
+			return false;
+	}
+
+	return true;
+}
+
+/* Export @htab in the same form as the environment in storage */
+static int env_journal_export(struct hsearch_data *htab, char *buf)
+{
+	if (hexport_r(htab, '\0', 0, &buf, ENV_SIZE, 0, NULL) < 0)
+		return -ENOSPC;
+
+	return 0;
+}
+
+int env_journal_replay(struct env_journal *jnl, struct hsearch_data *htab,
+		       const env_t *env)
+{
+	struct env_journal_rec *rec;
+	ulong offset, size;
+	char *buf;
+	int ret;
+
+	jnl->base = env_journal_base(env);
+	jnl->tail = 0;
+	jnl->seq = 0;
+	jnl->full = true;
+	buf = memalign(ARCH_DMA_MINALIGN, jnl->size);
+	if (!buf)
+		return -ENOMEM;
+	ret = jnl->read(jnl, 0, jnl->size, buf);
+	if (ret)
+		goto out;
+
+	for (offset = 0; offset + sizeof(*rec) <= jnl->size; offset += size) {
+		rec = (struct env_journal_rec *)(buf + offset);
+		if (rec->magic != ENV_JOURNAL_MAGIC || rec->base != jnl->base ||
+		    rec->seq != jnl->seq ||
+		    rec->len > jnl->size - offset - sizeof(*rec) ||
+		    rec->crc != env_journal_crc(rec))
+			break;
+		if (!himport_r(htab, (char *)(rec + 1), rec->len, '\0',
+			       H_NOCLEAR, 0, 0, NULL)) {
+			ret = -EIO;
+			goto out;
+		}
+		size = env_journal_rec_size(jnl, rec->len);
+		jnl->seq++;
+	}
+	jnl->tail = min(offset, jnl->size);
+
+	/* A torn record cannot be written over without an erase */
+	if (jnl->erase_val >= 0 &&
+	    !env_journal_erased(jnl, buf + jnl->tail, jnl->size - jnl->tail))
+		goto out;
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+	if (!jnl->saved)
+		jnl->saved = malloc(ENV_SIZE);
+	if (!jnl->saved) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	ret = env_journal_export(htab, jnl->saved);
+	if (ret)
+		goto out;
+#endif
+	jnl->full = false;
+out:
+	free(buf);
+
+	return ret;
+}
+
+/* Get the length of the name in a "name=value" entry */
+static int env_journal_namelen(const char *entry)
+{
+	return strchrnul(entry, '=') - entry;
+}
+
+/* Compare the names of two entries, in the order used by hexport_r() */
+static int env_journal_namecmp(const char *a, const char *b)
+{
+	int alen = env_journal_namelen(a);
+	int blen = env_journal_namelen(b);
+	int ret;
+
+	ret = strncmp(a, b, min(alen, blen));
+
+	return ret ? ret : alen - blen;
+}
+
+/* Add @len bytes of @entry to a record, returning false if there is no room */
+static bool env_journal_add(char **pp, const char *end, const char *entry,
+			    int len)
+{
+	if (*pp + len + 1 > end)
+		return false;
+	memcpy(*pp, entry, len);
+	(*pp)[len] = '\0';
+	*pp += len + 1;
+
+	return true;
+}
+
+int env_journal_append(struct env_journal *jnl, struct hsearch_data *htab)
+{
+	struct env_journal_rec *rec = NULL;
+	const char *old, *new;
+	char *env, *p, *end;
+	ulong space, size;
+	int cmp, ret;
+
+	if (jnl->full || !jnl->saved || jnl->tail + sizeof(*rec) >= jnl->size)
+		return -ENOSPC;
+	space = jnl->size - jnl->tail;
+	env = malloc(ENV_SIZE);
+	if (env)
+		rec = memalign(ARCH_DMA_MINALIGN, space);
+	if (!rec) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	ret = env_journal_export(htab, env);
+	if (ret)
+		goto out;
+
+	/* Both lists are sorted by name, so walk them together */
+	memset(rec, jnl->erase_val >= 0 ? jnl->erase_val : 0, space);
+	p = (char *)(rec + 1);
+	end = (char *)rec + space;
+	ret = -ENOSPC;
+	for (old = jnl->saved, new = env; *old || *new;) {
+		if (!*new)
+			cmp = -1;
+		else if (!*old)
+			cmp = 1;
+		else
+			cmp = env_journal_namecmp(old, new);
+
+		if (cmp < 0) {
+			/* Deleted */
+			if (!env_journal_add(&p, end, old,
+					     env_journal_namelen(old)))
+				goto out;
+		} else if (cmp > 0 || strcmp(old, new)) {
+			/* Added or changed */
+			if (!env_journal_add(&p, end, new, strlen(new)))
+				goto out;
+		}
+		if (cmp <= 0)
+			old += strlen(old) + 1;
+		if (cmp >= 0)
+			new += strlen(new) + 1;
+	}
+
+	rec->len = p - (char *)(rec + 1);
+	if (!rec->len) {
+		ret = 0;
+		goto out;
+	}
+	size = env_journal_rec_size(jnl, rec->len);
+	if (size > space)
+		goto out;
+	rec->magic = ENV_JOURNAL_MAGIC;
+	rec->base = jnl->base;
+	rec->seq = jnl->seq;
+	rec->crc = env_journal_crc(rec);
+
+	ret = jnl->write(jnl, jnl->tail, size, rec);
+	if (ret) {
+		/* The record may be partly written */
+		jnl->full = true;
+		goto out;
+	}
+	jnl->tail += size;
+	jnl->seq++;
+	memcpy(jnl->saved, env, ENV_SIZE);
+out:
+	free(rec);
+	free(env);
+
+	return ret;
+}
+
+int env_journal_erase(struct env_journal *jnl)
+{
+	char *buf;
+	int ret;
+
+	jnl->full = true;
+	if (jnl->erase_val >= 0)
+		return 0;
+
+	buf = memalign(ARCH_DMA_MINALIGN, jnl->size);
+	if (!buf)
+		return -ENOMEM;
+	memset(buf, '\0', jnl->size);
+	ret = jnl->write(jnl, 0, jnl->size, buf);
+	free(buf);
+
+	return ret;
+}
+
+int env_journal_start(struct env_journal *jnl, const env_t *env)
+{
+	if (!jnl->saved)
+		jnl->saved = malloc(ENV_SIZE);
+	if (!jnl->saved) {
+		jnl->full = true;
+		return -ENOMEM;
+	}
+	memcpy(jnl->saved, env->data, ENV_SIZE);
+	jnl->base = env_journal_base(env);
+	jnl->tail = 0;
+	jnl->seq = 0;
+	jnl->full = false;
+
+	return 0;
+}
@@ -9,6 +9,7 @@
 
 #include <command.h>
 #include <environment.h>
+#include <env_journal.h>
 #include <fdtdec.h>
 #include <linux/stddef.h>
 #include <malloc.h>
@@ -181,6 +182,20 @@ static void fini_mmc_for_env(struct mmc *mmc)
 #endif
 }
 
+static inline int read_env(struct mmc *mmc, unsigned long size,
+			   unsigned long offset, const void *buffer)
+{
+	uint blk_start, blk_cnt, n;
+	struct blk_desc *desc = mmc_get_blk_desc(mmc);
+
+	blk_start	= ALIGN(offset, mmc->read_bl_len) / mmc->read_bl_len;
+	blk_cnt		= ALIGN(size, mmc->read_bl_len) / mmc->read_bl_len;
+
+	n = blk_dread(desc, blk_start, blk_cnt, (uchar *)buffer);
+
+	return (n == blk_cnt) ? 0 : -1;
+}
+
 #if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
 static inline int write_env(struct mmc *mmc, unsigned long size,
 			    unsigned long offset, const void *buffer)
@@ -195,14 +210,93 @@ static inline int write_env(struct mmc *mmc, unsigned long size,
 
 	return (n == blk_cnt) ? 0 : -1;
 }
+#endif /* CONFIG_CMD_SAVEENV && !CONFIG_SPL_BUILD */
+
+#ifdef CONFIG_ENV_JOURNAL
+/* Each copy of the environment is followed by its journal */
+#define ENV_AREA_SIZE	(CONFIG_ENV_SIZE + CONFIG_ENV_JOURNAL_SIZE)
+
+static int env_mmc_journal_read(struct env_journal *jnl, ulong offset,
+				ulong size, void *buf)
+{
+	return read_env(jnl->priv, size, jnl->start + offset, buf) ? -EIO : 0;
+}
 
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+static int env_mmc_journal_write(struct env_journal *jnl, ulong offset,
+				 ulong size, const void *buf)
+{
+	return write_env(jnl->priv, size, jnl->start + offset, buf) ? -EIO : 0;
+}
+#endif
+
+static struct env_journal env_mmc_journal = {
+	.size		= CONFIG_ENV_JOURNAL_SIZE,
+	.erase_val	= -1,
+	.read		= env_mmc_journal_read,
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
+	.write		= env_mmc_journal_write,
+#endif
+};
+
+/*
+ * Point the journal at the one following a copy of the environment. This
+ * fails with -ENOSPC if there is no room for it before the end of the device
+ * or the other copy, whose offset may come from the device tree.
+ */
+static int env_mmc_journal_setup(struct mmc *mmc, int copy)
+{
+	u32 offset;
+#ifdef CONFIG_ENV_OFFSET_REDUND
+	u32 other;
+
+	/* Offsets from the end of the device can only be checked at run time */
+	BUILD_BUG_ON((s64)CONFIG_ENV_OFFSET >= 0 &&
+		     (s64)CONFIG_ENV_OFFSET_REDUND >= 0 &&
+		     ENV_JOURNAL_OVERLAP((s64)CONFIG_ENV_OFFSET,
+					 (s64)CONFIG_ENV_OFFSET_REDUND,
+					 ENV_AREA_SIZE));
+#endif
+
+	if (mmc_get_env_addr(mmc, copy, &offset))
+		return -EIO;
+	if (offset + ENV_AREA_SIZE > mmc->capacity)
+		goto nospace;
+#ifdef CONFIG_ENV_OFFSET_REDUND
+	if (mmc_get_env_addr(mmc, !copy, &other))
+		return -EIO;
+	if (ENV_JOURNAL_OVERLAP(offset, other, ENV_AREA_SIZE))
+		goto nospace;
+#endif
+	env_mmc_journal.priv = mmc;
+	env_mmc_journal.start = offset + CONFIG_ENV_SIZE;
+	env_mmc_journal.align = mmc->write_bl_len;
+
+	return 0;
+nospace:
+	puts("*** Warning - no room for environment journal\n");
+
+	return -ENOSPC;
+}
+
+/* Apply the changes saved since a copy of the environment was loaded */
+static void env_mmc_journal_load(struct mmc *mmc, int copy, const env_t *env)
+{
+	if (env_mmc_journal_setup(mmc, copy))
+		return;
+	if (env_journal_replay(&env_mmc_journal, &env_htab, env))
+		puts("*** Warning - cannot read environment journal\n");
+}
+#endif /* CONFIG_ENV_JOURNAL */
+
+#if defined(CONFIG_CMD_SAVEENV) && !defined(CONFIG_SPL_BUILD)
 static int env_mmc_save(void)
 {
 	ALLOC_CACHE_ALIGN_BUFFER(env_t, env_new, 1);
 	int dev = mmc_get_env_dev();
 	struct mmc *mmc = find_mmc_device(dev);
 	u32	offset;
-	int	ret, copy = 0;
+	int	ret, copy = 0, in_use = 0;
 	const char *errmsg;
 
 	errmsg = init_mmc_for_env(mmc);
@@ -211,15 +305,28 @@ static int env_mmc_save(void)
 		return 1;
 	}
 
-	ret = env_export(env_new);
-	if (ret)
-		goto fini;
-
 #ifdef CONFIG_ENV_OFFSET_REDUND
 	if (gd->env_valid == ENV_VALID)
 		copy = 1;
+	else
+		in_use = 1;
+#endif
+
+#ifdef CONFIG_ENV_JOURNAL
+	/* Try to write just the changes, after the copy in use */
+	if (!env_mmc_journal_setup(mmc, in_use) &&
+	    !env_journal_append(&env_mmc_journal, &env_htab)) {
+		printf("Writing changes to %sMMC(%d)... ",
+		       in_use ? "redundant " : "", dev);
+		ret = 0;
+		goto fini;
+	}
 #endif
 
+	ret = env_export(env_new);
+	if (ret)
+		goto fini;
+
 	if (mmc_get_env_addr(mmc, copy, &offset)) {
 		ret = 1;
 		goto fini;
@@ -234,6 +341,14 @@ static int env_mmc_save(void)
 
 	ret = 0;
 
+#ifdef CONFIG_ENV_JOURNAL
+	/* Start again with an empty journal after the copy just written */
+	if (!env_mmc_journal_setup(mmc, copy) &&
+	    (env_journal_erase(&env_mmc_journal) ||
+	     env_journal_start(&env_mmc_journal, env_new)))
+		puts("*** Warning - cannot clear environment journal\n");
+#endif
+
 #ifdef CONFIG_ENV_OFFSET_REDUND
 	gd->env_valid = gd->env_valid == ENV_REDUND ? ENV_VALID : ENV_REDUND;
 #endif
@@ -244,20 +359,6 @@ fini:
 }
 #endif /* CONFIG_CMD_SAVEENV && !CONFIG_SPL_BUILD */
 
-static inline int read_env(struct mmc *mmc, unsigned long size,
-			   unsigned long offset, const void *buffer)
-{
-	uint blk_start, blk_cnt, n;
-	struct blk_desc *desc = mmc_get_blk_desc(mmc);
-
-	blk_start	= ALIGN(offset, mmc->read_bl_len) / mmc->read_bl_len;
-	blk_cnt		= ALIGN(size, mmc->read_bl_len) / mmc->read_bl_len;
-
-	n = blk_dread(desc, blk_start, blk_cnt, (uchar *)buffer);
-
-	return (n == blk_cnt) ? 0 : -1;
-}
-
 #ifdef CONFIG_ENV_OFFSET_REDUND
 static int env_mmc_load(void)
 {
@@ -293,6 +394,14 @@ static int env_mmc_load(void)
 
 	ret = env_import_redund((char *)tmp_env1, read1_fail, (char *)tmp_env2,
 				read2_fail);
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret) {
+		if (gd->env_valid == ENV_REDUND)
+			env_mmc_journal_load(mmc, 1, tmp_env2);
+		else
+			env_mmc_journal_load(mmc, 0, tmp_env1);
+	}
+#endif
 
 fini:
 	fini_mmc_for_env(mmc);
@@ -334,6 +443,10 @@ static int env_mmc_load(void)
 	}
 
 	ret = env_import(buf, 1);
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret)
+		env_mmc_journal_load(mmc, 0, (env_t *)buf);
+#endif
 
 fini:
 	fini_mmc_for_env(mmc);
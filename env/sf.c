@@ -11,6 +11,7 @@
 #include <common.h>
 #include <dm.h>
 #include <environment.h>
+#include <env_journal.h>
 #include <malloc.h>
 #include <spi.h>
 #include <spi_flash.h>
@@ -46,6 +47,17 @@ static ulong env_new_offset	= CONFIG_ENV_OFFSET_REDUND;
 #define OBSOLETE_FLAG	0
 #endif /* CONFIG_ENV_OFFSET_REDUND */
 
+#ifdef CONFIG_ENV_JOURNAL
+/* Each copy of the environment is followed by its journal */
+#define ENV_AREA_SIZE	(CONFIG_ENV_SIZE + CONFIG_ENV_JOURNAL_SIZE)
+
+/* Saving erases whole sectors, so the journal must not reach the other copy */
+#define ENV_ERASE_SIZE	(DIV_ROUND_UP(ENV_AREA_SIZE, CONFIG_ENV_SECT_SIZE) * \
+			 CONFIG_ENV_SECT_SIZE)
+#else
+#define ENV_AREA_SIZE	CONFIG_ENV_SIZE
+#endif
+
 DECLARE_GLOBAL_DATA_PTR;
 
 static struct spi_flash *env_flash;
@@ -115,6 +127,63 @@ static int spi_flash_read_env(struct spi_flash *flash, u32 offset, size_t len,
 	return 0;
 }
 
+#ifdef CONFIG_ENV_JOURNAL
+static int env_sf_journal_read(struct env_journal *jnl, ulong offset,
+			       ulong size, void *buf)
+{
+	return spi_flash_read(env_flash, jnl->start + offset, size, buf);
+}
+
+#ifdef CMD_SAVEENV
+static int env_sf_journal_write(struct env_journal *jnl, ulong offset,
+				ulong size, const void *buf)
+{
+	return spi_flash_write(env_flash, jnl->start + offset, size, buf);
+}
+#endif
+
+static struct env_journal env_sf_journal = {
+	.size		= CONFIG_ENV_JOURNAL_SIZE,
+	.align		= 4,
+	.erase_val	= 0xff,
+	.read		= env_sf_journal_read,
+#ifdef CMD_SAVEENV
+	.write		= env_sf_journal_write,
+#endif
+};
+
+/* Apply the changes saved since the environment at @offset was loaded */
+static void env_sf_journal_load(u32 offset, const env_t *env)
+{
+	env_sf_journal.start = offset + CONFIG_ENV_SIZE;
+	if (env_journal_replay(&env_sf_journal, &env_htab, env))
+		puts("*** Warning - cannot read environment journal\n");
+}
+
+#ifdef CMD_SAVEENV
+/* Try to write just the changes, after the environment at @offset */
+static int env_sf_journal_save(u32 offset)
+{
+	int ret;
+
+	env_sf_journal.start = offset + CONFIG_ENV_SIZE;
+	ret = env_journal_append(&env_sf_journal, &env_htab);
+	if (!ret)
+		puts("Writing changes to SPI flash...done\n");
+
+	return ret;
+}
+
+/* Start an empty journal after the environment just written at @offset */
+static void env_sf_journal_start(u32 offset, const env_t *env)
+{
+	env_sf_journal.start = offset + CONFIG_ENV_SIZE;
+	if (env_journal_start(&env_sf_journal, env))
+		puts("*** Warning - cannot start environment journal\n");
+}
+#endif /* CMD_SAVEENV */
+#endif /* CONFIG_ENV_JOURNAL */
+
 #if defined(CONFIG_ENV_OFFSET_REDUND)
 #ifdef CMD_SAVEENV
 static int env_sf_save(void)
@@ -128,6 +197,12 @@ static int env_sf_save(void)
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (!env_sf_journal_save(gd->env_valid == ENV_VALID ?
+				 CONFIG_ENV_OFFSET : CONFIG_ENV_OFFSET_REDUND))
+		return 0;
+#endif
+
 	ret = env_export(&env_new);
 	if (ret)
 		return -EIO;
@@ -142,9 +217,9 @@ static int env_sf_save(void)
 	}
 
 	/* Is the sector larger than the env (i.e. embedded) */
-	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
-		saved_size = CONFIG_ENV_SECT_SIZE - CONFIG_ENV_SIZE;
-		saved_offset = env_new_offset + CONFIG_ENV_SIZE;
+	if (CONFIG_ENV_SECT_SIZE > ENV_AREA_SIZE) {
+		saved_size = CONFIG_ENV_SECT_SIZE - ENV_AREA_SIZE;
+		saved_offset = env_new_offset + ENV_AREA_SIZE;
 		saved_buffer = memalign(ARCH_DMA_MINALIGN, saved_size);
 		if (!saved_buffer) {
 			ret = -ENOMEM;
@@ -156,7 +231,7 @@ static int env_sf_save(void)
 			goto done;
 	}
 
-	sector = DIV_ROUND_UP(CONFIG_ENV_SIZE, CONFIG_ENV_SECT_SIZE);
+	sector = DIV_ROUND_UP(ENV_AREA_SIZE, CONFIG_ENV_SECT_SIZE);
 
 	puts("Erasing SPI flash...");
 	ret = spi_flash_erase(env_flash, env_new_offset,
@@ -171,7 +246,7 @@ static int env_sf_save(void)
 	if (ret)
 		goto done;
 
-	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
+	if (CONFIG_ENV_SECT_SIZE > ENV_AREA_SIZE) {
 		ret = spi_flash_write(env_flash, saved_offset,
 					saved_size, saved_buffer);
 		if (ret)
@@ -185,6 +260,10 @@ static int env_sf_save(void)
 
 	puts("done\n");
 
+#ifdef CONFIG_ENV_JOURNAL
+	env_sf_journal_start(env_new_offset, &env_new);
+#endif
+
 	gd->env_valid = gd->env_valid == ENV_REDUND ? ENV_VALID : ENV_REDUND;
 
 	printf("Valid environment: %d\n", (int)gd->env_valid);
@@ -203,6 +282,12 @@ static int env_sf_load(void)
 	int read1_fail, read2_fail;
 	env_t *tmp_env1, *tmp_env2;
 
+#ifdef CONFIG_ENV_JOURNAL
+	BUILD_BUG_ON(ENV_JOURNAL_OVERLAP(CONFIG_ENV_OFFSET,
+					 CONFIG_ENV_OFFSET_REDUND,
+					 ENV_ERASE_SIZE));
+#endif
+
 	tmp_env1 = (env_t *)memalign(ARCH_DMA_MINALIGN,
 			CONFIG_ENV_SIZE);
 	tmp_env2 = (env_t *)memalign(ARCH_DMA_MINALIGN,
@@ -224,6 +309,14 @@ static int env_sf_load(void)
 
 	ret = env_import_redund((char *)tmp_env1, read1_fail, (char *)tmp_env2,
 				read2_fail);
+#ifdef CONFIG_ENV_JOURNAL
+	if (!ret) {
+		if (gd->env_valid == ENV_REDUND)
+			env_sf_journal_load(CONFIG_ENV_OFFSET_REDUND, tmp_env2);
+		else
+			env_sf_journal_load(CONFIG_ENV_OFFSET, tmp_env1);
+	}
+#endif
 
 	spi_flash_free(env_flash);
 	env_flash = NULL;
@@ -246,10 +339,15 @@ static int env_sf_save(void)
 	if (ret)
 		return ret;
 
+#ifdef CONFIG_ENV_JOURNAL
+	if (!env_sf_journal_save(CONFIG_ENV_OFFSET))
+		return 0;
+#endif
+
 	/* Is the sector larger than the env (i.e. embedded) */
-	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
-		saved_size = CONFIG_ENV_SECT_SIZE - CONFIG_ENV_SIZE;
-		saved_offset = CONFIG_ENV_OFFSET + CONFIG_ENV_SIZE;
+	if (CONFIG_ENV_SECT_SIZE > ENV_AREA_SIZE) {
+		saved_size = CONFIG_ENV_SECT_SIZE - ENV_AREA_SIZE;
+		saved_offset = CONFIG_ENV_OFFSET + ENV_AREA_SIZE;
 		saved_buffer = malloc(saved_size);
 		if (!saved_buffer)
 			goto done;
@@ -264,7 +362,7 @@ static int env_sf_save(void)
 	if (ret)
 		goto done;
 
-	sector = DIV_ROUND_UP(CONFIG_ENV_SIZE, CONFIG_ENV_SECT_SIZE);
+	sector = DIV_ROUND_UP(ENV_AREA_SIZE, CONFIG_ENV_SECT_SIZE);
 
 	puts("Erasing SPI flash...");
 	ret = spi_flash_erase(env_flash, CONFIG_ENV_OFFSET,
@@ -278,7 +376,7 @@ static int env_sf_save(void)
 	if (ret)
 		goto done;
 
-	if (CONFIG_ENV_SECT_SIZE > CONFIG_ENV_SIZE) {
+	if (CONFIG_ENV_SECT_SIZE > ENV_AREA_SIZE) {
 		ret = spi_flash_write(env_flash, saved_offset,
 			saved_size, saved_buffer);
 		if (ret)
@@ -288,6 +386,10 @@ static int env_sf_save(void)
 	ret = 0;
 	puts("done\n");
 
+#ifdef CONFIG_ENV_JOURNAL
+	env_sf_journal_start(CONFIG_ENV_OFFSET, &env_new);
+#endif
+
  done:
 	if (saved_buffer)
 		free(saved_buffer);
@@ -319,8 +421,12 @@ static int env_sf_load(void)
 	}
 
 	ret = env_import(buf, 1);
-	if (!ret)
+	if (!ret) {
 		gd->env_valid = ENV_VALID;
+#ifdef CONFIG_ENV_JOURNAL
+		env_sf_journal_load(CONFIG_ENV_OFFSET, (env_t *)buf);
+#endif
+	}
 
 err_read:
 	spi_flash_free(env_flash);
@@ -11,6 +11,7 @@
 #include <ext4fs.h>
 #include <fat.h>
 #include <fs.h>
+#include <tracepoint.h>
 #include <sandboxfs.h>
 #include <ubifs_uboot.h>
 #include <btrfs.h>
@@ -457,11 +458,14 @@ static int fs_read_lmb_check(const char *filename, ulong addr, loff_t offset,
 	lmb_init_and_reserve(&lmb, gd->bd, (void *)gd->fdt_blob);
 	lmb_dump_all(&lmb);
 
-	if (lmb_alloc_addr(&lmb, addr, read_len) == addr)
-		return 0;
+	ret = 0;
+	if (lmb_alloc_addr(&lmb, addr, read_len) != addr) {
+		printf("** Reading file would overwrite reserved memory **\n");
+		ret = -ENOSPC;
+	}
+	lmb_release(&lmb);
 
-	printf("** Reading file would overwrite reserved memory **\n");
-	return -ENOSPC;
+	return ret;
 }
 #endif
 
@@ -470,6 +474,8 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 	void *buf;
+	ulong tp;
+	int span;
 	int ret;
 
 #ifdef CONFIG_LMB
@@ -485,7 +491,11 @@ static int _fs_read(const char *filename, ulong addr, loff_t offset, loff_t len,
 	 * means read the whole file.
 	 */
 	buf = map_sysmem(addr, len);
+	span = bootstage_span_begin("fs", filename);
+	tp = tracepoint_start(TP_FS_READ);
 	ret = info->read(filename, buf, offset, len, actread);
+	tracepoint_end(TP_FS_READ, tp, filename, offset, ret ? 0 : *actread);
+	bootstage_span_end(span);
 	unmap_sysmem(buf);
 
 	/* If we requested a specific number of bytes, check we got it */
@@ -507,10 +517,13 @@ int fs_write(const char *filename, ulong addr, loff_t offset, loff_t len,
 {
 	struct fstype_info *info = fs_get_info(fs_type);
 	void *buf;
+	ulong tp;
 	int ret;
 
 	buf = map_sysmem(addr, len);
+	tp = tracepoint_start(TP_FS_WRITE);
 	ret = info->write(filename, buf, offset, len, actwrite);
+	tracepoint_end(TP_FS_WRITE, tp, filename, offset, ret ? 0 : *actwrite);
 	unmap_sysmem(buf);
 
 	if (ret < 0 && len != *actwrite) {
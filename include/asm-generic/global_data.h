@@ -66,6 +66,12 @@ typedef struct global_data {
 	struct udevice	*dm_root;	/* Root instance for Driver Model */
 	struct udevice	*dm_root_f;	/* Pre-relocation root instance */
 	struct list_head uclass_root;	/* Head of core tree */
+	/* Index of drivers by compatible string */
+	struct lists_compat_index *dm_compat_index;
+	/* Tables for finding uclasses and devices quickly */
+	struct dm_lookup *dm_lookup;
+	/* Arena that devices bound at start-up are allocated from */
+	struct dm_arena *dm_arena;
 #endif
 #ifdef CONFIG_TIMER
 	struct udevice	*timer;		/* Timer instance for Driver Model */
@@ -77,6 +83,9 @@ typedef struct global_data {
 #ifdef CONFIG_OF_LIVE
 	struct device_node *of_root;
 #endif
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+	struct fdtdec_cache *fdt_cache;	/* Speeds up control FDT lookups */
+#endif
 
 #if CONFIG_IS_ENABLED(MULTI_DTB_FIT)
 	const void *multi_dtb_fit;	/* uncompressed multi-dtb FIT image */
@@ -98,6 +107,7 @@ typedef struct global_data {
 	unsigned long malloc_base;	/* base address of early malloc() */
 	unsigned long malloc_limit;	/* limit address */
 	unsigned long malloc_ptr;	/* current address */
+	unsigned long malloc_free;	/* offset of first freed block, or 0 */
 #endif
 #ifdef CONFIG_PCI
 	struct pci_controller *hose;	/* PCI hose for early use */
@@ -120,6 +130,10 @@ typedef struct global_data {
 	struct bootstage_data *bootstage;	/* Bootstage information */
 	struct bootstage_data *new_bootstage;	/* Relocated bootstage info */
 #endif
+#if CONFIG_IS_ENABLED(TRACEPOINT)
+	struct tracepoint_data *tracepoint;	/* Tracepoint records */
+	u32 tracepoint_mask;		/* Events being recorded */
+#endif
 #ifdef CONFIG_LOG
 	int log_drop_count;		/* Number of dropped log messages */
 	int default_log_level;		/* For devices with no filters */
@@ -27,6 +27,8 @@ enum bloblist_tag_t {
 	BLOBLISTT_SPL_HANDOFF,		/* Hand-off info from SPL */
 	BLOBLISTT_VBOOT_CTX,		/* Chromium OS verified boot context */
 	BLOBLISTT_VBOOT_HANDOFF,	/* Chromium OS internal handoff info */
+	BLOBLISTT_TRACEPOINT,		/* Tracepoint records (tracepoint.h) */
+	BLOBLISTT_BOOTSTAGE_JSON,	/* Bootstage report as JSON text */
 };
 
 /**
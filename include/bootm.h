@@ -74,6 +74,106 @@ int bootm_decomp_image(int comp, ulong load, ulong image_start, int type,
 		       void *load_buf, void *image_buf, ulong image_len,
 		       uint unc_len, ulong *load_end);
 
+/**
+ * bootm_prep_in_place() - prepare to decompress an image over itself
+ *
+ * If the decompressed output would overwrite the compressed data, check
+ * whether it can safely be decompressed in place. This is supported for lz4
+ * and lzma images which record their decompressed size. The compressed data
+ * must end a little beyond the end of the output, so that the decompressor
+ * never overwrites data it has not yet read. If it does not, it is moved
+ * there, which is cheaper than moving the whole image out of the way.
+ *
+ * @lmb:	Memory map, which must have the whole region free, or NULL
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @blob_start:	Start of the containing image (e.g. FIT), which must not be
+ *		overwritten except for the compressed data itself
+ * @blob_end:	End of the containing image
+ * @image_startp: Start address of compressed data, updated if it is moved
+ * @image_len:	Number of bytes of compressed data
+ * @return 0 if the image can be decompressed in place, -ENOENT if it does
+ *	not overlap its output or does not record its size, other -ve value
+ *	if in-place decompression is not possible
+ */
+int bootm_prep_in_place(struct lmb *lmb, int comp, ulong load,
+			ulong blob_start, ulong blob_end, ulong *image_startp,
+			ulong image_len);
+
+/**
+ * struct bootm_decomp_block - an independently compressed part of an image
+ *
+ * @src:	Compressed data
+ * @src_len:	Number of bytes of compressed data
+ * @dst:	Place to decompress to
+ * @dst_len:	Space available at @dst. This is updated to the number of
+ *		bytes produced
+ * @ret:	Result from the decompressor, 0 if OK
+ */
+struct bootm_decomp_block {
+	void *src;
+	ulong src_len;
+	void *dst;
+	ulong dst_len;
+	int ret;
+};
+
+/**
+ * bootm_decomp_block() - decompress a single block
+ *
+ * This only uses the memory described by @blk (and malloc() for gzip and
+ * bzip2), so blocks which do not overlap may be decompressed concurrently.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @blk:	Block to decompress
+ * @return 0 if OK, -EPROTONOSUPPORT if @comp is not supported, -EIO if
+ *	decompression failed (see @blk->ret)
+ */
+int bootm_decomp_block(int comp, struct bootm_decomp_block *blk);
+
+/**
+ * arch_decomp_blocks() - decompress a list of independent blocks
+ *
+ * The default implementation decompresses each block in turn on the boot
+ * CPU. Platforms which can run code on secondary CPUs may override this to
+ * spread the blocks across them, returning once all have completed. The
+ * blocks never overlap each other or their source data.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @blocks:	Blocks to decompress
+ * @count:	Number of blocks
+ * @return 0 if OK, -ve on error (as bootm_decomp_block())
+ */
+int arch_decomp_blocks(int comp, struct bootm_decomp_block *blocks,
+		       int count);
+
+/**
+ * bootm_decomp_blocks() - decompress a block-compressed operating system
+ *
+ * The image is made up of @count independently compressed blocks, each of
+ * which expands to @block_size bytes except perhaps the last. The output is
+ * contiguous from @load_buf.
+ *
+ * @comp:	Compression algorithm that is used (IH_COMP_...)
+ * @load:	Destination load address in U-Boot memory
+ * @image_start Image start address (where we are decompressing from)
+ * @type:	OS type (IH_OS_...)
+ * @load_buf:	Place to decompress to
+ * @image_buf:	Address to decompress from
+ * @image_len:	Number of bytes in @image_buf to decompress
+ * @block_size:	Uncompressed size of each block
+ * @offsets:	Offset of each block within @image_buf, as big-endian cells
+ * @count:	Number of blocks
+ * @unc_len:	Available space for decompression
+ * @load_end:	Returns the end address of the decompressed data
+ * @return 0 if OK, -EINVAL if the output would overlap the compressed data,
+ *	other -ve value on error (BOOTM_ERR_...)
+ */
+int bootm_decomp_blocks(int comp, ulong load, ulong image_start, int type,
+			void *load_buf, void *image_buf, ulong image_len,
+			ulong block_size, const fdt32_t *offsets, int count,
+			uint unc_len, ulong *load_end);
+
 /*
  * boards should define this to disable devices when EFI exits from boot
  * services.
@@ -199,6 +199,9 @@ enum bootstage_id {
 	BOOTSTATE_ID_ACCUM_DM_SPL,
 	BOOTSTATE_ID_ACCUM_DM_F,
 	BOOTSTATE_ID_ACCUM_DM_R,
+	BOOTSTAGE_ID_ACCUM_SPL_READ,
+	BOOTSTAGE_ID_ACCUM_SPL_HASH,
+	BOOTSTAGE_ID_ACCUM_CONSOLE,
 
 	/* a few spare for the user, from here */
 	BOOTSTAGE_ID_USER,
@@ -227,6 +230,9 @@ void show_boot_progress(int val);
 #if !defined(USE_HOSTCC)
 #if CONFIG_IS_ENABLED(BOOTSTAGE)
 #define ENABLE_BOOTSTAGE
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+#define ENABLE_BOOTSTAGE_SPANS
+#endif
 #endif
 #endif
 
@@ -352,6 +358,30 @@ int bootstage_get_size(void);
  */
 int bootstage_init(bool first);
 
+/**
+ * bootstage_json() - Write the bootstage information as JSON
+ *
+ * This writes an object with the marks, accumulated times and (with
+ * CONFIG_BOOTSTAGE_SPANS) the spans and statistics about them. The output
+ * is nul-terminated if there is space.
+ *
+ * @buf:	Buffer to write to
+ * @size:	Size of buffer in bytes
+ * @return length of the JSON in bytes, not including the terminator. If
+ *	this is not less than @size, the output was truncated
+ */
+int bootstage_json(char *buf, int size);
+
+/**
+ * bootstage_bloblist_add_report() - Add the bootstage JSON to the bloblist
+ *
+ * This adds the output of bootstage_json() to the bloblist (if enabled) so
+ * that the OS can pick it up.
+ *
+ * @return 0 if OK (or there is no bloblist), -ve on error
+ */
+int bootstage_bloblist_add_report(void);
+
 #else
 static inline ulong bootstage_add_record(enum bootstage_id id,
 		const char *name, int flags, ulong mark)
@@ -423,8 +453,97 @@ static inline int bootstage_init(bool first)
 	return 0;
 }
 
+static inline int bootstage_bloblist_add_report(void)
+{
+	return 0;
+}
+
 #endif /* ENABLE_BOOTSTAGE */
 
+#define BOOTSTAGE_SPAN_NAME_LEN	20
+
+/**
+ * struct bootstage_span - a span of time during boot
+ *
+ * Spans nest: a span started while another is open is inside it. Spans are
+ * kept in the order they start, so each span follows its parent.
+ *
+ * @start_us: Time when the span started
+ * @duration_us: Time the span took, or 0 if it is still open
+ * @bytes: Bytes read from block devices during the span
+ * @cat: Category of the span (e.g. "probe"), used for statistics
+ * @parent: Index of the span this is inside, or -1 if none
+ * @depth: Number of spans this is inside
+ * @open: true if the span has not ended
+ * @name: Name of the span, e.g. a device name
+ */
+struct bootstage_span {
+	uint32_t start_us;
+	uint32_t duration_us;
+	ulong bytes;
+	const char *cat;
+	short parent;
+	short depth;
+	bool open;
+	char name[BOOTSTAGE_SPAN_NAME_LEN];
+};
+
+#ifdef ENABLE_BOOTSTAGE_SPANS
+/**
+ * bootstage_span_begin() - Start a span
+ *
+ * The span is inside the span which is currently open, if any. Spans can
+ * only be recorded after relocation.
+ *
+ * @cat:	Category of the span, which must be a constant string
+ * @name:	Name of the span (copied, so it need not remain valid)
+ * @return span ID to pass to bootstage_span_end(), -ENOSYS if spans cannot
+ *	be recorded yet, -ENOSPC if there is no space for the span
+ */
+int bootstage_span_begin(const char *cat, const char *name);
+
+/**
+ * bootstage_span_end() - End a span
+ *
+ * Any spans inside this one which are still open are ended too.
+ *
+ * @span:	Span ID returned by bootstage_span_begin(). Nothing is done if
+ *	this is an error
+ */
+void bootstage_span_end(int span);
+
+/**
+ * bootstage_span_add_bytes() - Count bytes read in the open spans
+ *
+ * @bytes:	Number of bytes read
+ */
+void bootstage_span_add_bytes(ulong bytes);
+
+/**
+ * bootstage_span_get() - Get a span
+ *
+ * @span:	Span ID
+ * @return the span, or NULL if there is none with that ID
+ */
+const struct bootstage_span *bootstage_span_get(int span);
+
+/** bootstage_span_clear() - Drop all spans, e.g. before timing a command */
+void bootstage_span_clear(void);
+#else
+static inline int bootstage_span_begin(const char *cat, const char *name)
+{
+	return -ENOSYS;
+}
+
+static inline void bootstage_span_end(int span)
+{
+}
+
+static inline void bootstage_span_add_bytes(ulong bytes)
+{
+}
+#endif
+
 /* Helper macro for adding a bootstage to a line of code */
 #define BOOTSTAGE_MARKER()	\
 		bootstage_mark_code(__FILE__, __func__, __LINE__)
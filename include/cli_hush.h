@@ -16,6 +16,35 @@ extern int u_boot_hush_start(void);
 extern int parse_string_outer(const char *, int);
 extern int parse_file_outer(void);
 
+/**
+ * parse_script_outer() - Run the commands held in an environment variable
+ *
+ * This works like parse_string_outer(), but keeps the parsed form of the
+ * commands so that running the same variable again skips the parser. The
+ * cached form is dropped when the variable changes.
+ *
+ * @name: Name of the variable
+ * @s: Value of the variable
+ * @flag: Parser flags (FLAG_...)
+ * @return 0 if OK, 1 on error
+ */
+int parse_script_outer(const char *name, const char *s, int flag);
+
+/**
+ * parse_script_flush() - Drop all commands kept by parse_script_outer()
+ */
+void parse_script_flush(void);
+
+/**
+ * parse_script_count() - Get the number of scripts parsed so far
+ *
+ * This counts each time parse_script_outer() had to parse its commands,
+ * rather than use ones it kept.
+ *
+ * @return number of parses since start-up
+ */
+uint parse_script_count(void);
+
 int set_local_var(const char *s, int flg_export);
 void unset_local_var(const char *name);
 char *get_local_var(const char *s);
@@ -10,7 +10,11 @@
 #ifndef _DM_DEVICE_INTERNAL_H
 #define _DM_DEVICE_INTERNAL_H
 
+#include <malloc.h>
 #include <dm/ofnode.h>
+#include <dm/uclass-id.h>
+#include <linux/errno.h>
+#include <linux/list.h>
 
 struct device_node;
 struct udevice;
@@ -94,6 +98,18 @@ int device_bind_by_name(struct udevice *parent, bool pre_reloc_only,
  */
 int device_probe(struct udevice *dev);
 
+/**
+ * device_probe_start() - Start probing a device without waiting for it
+ *
+ * This is like device_probe() except that if the driver has a probe_wait()
+ * method, it is not called. The probe is finished the next time
+ * device_probe() is called on the device, e.g. by uclass_get_device().
+ *
+ * @dev: Pointer to device to probe
+ * @return 0 if OK, -ve on error
+ */
+int device_probe_start(struct udevice *dev);
+
 /**
  * device_remove() - Remove a device, de-activating it
  *
@@ -184,6 +200,248 @@ fdt_addr_t simple_bus_translate(struct udevice *dev, fdt_addr_t addr);
 #define DM_ROOT_NON_CONST		(((gd_t *)gd)->dm_root)
 #define DM_UCLASS_ROOT_NON_CONST	(((gd_t *)gd)->uclass_root)
 
+/* Hash buckets used to find devices by their device tree node */
+#define DM_LOOKUP_NODE_BITS		8
+#define DM_LOOKUP_NODE_BUCKETS		(1 << DM_LOOKUP_NODE_BITS)
+
+/**
+ * struct dm_lookup - Tables for finding uclasses and devices quickly
+ *
+ * This is held in gd->dm_lookup when CONFIG_DM_LOOKUP_TABLES is enabled.
+ *
+ * @uclass: Each uclass that exists, indexed by its ID
+ * @node_head: Hash table of devices with a device tree node, keyed by node
+ * @uclass_lookups: Number of uclass_find() calls
+ * @node_lookups: Number of times a device has been looked up by its node
+ * @node_hits: Number of node lookups answered from the table. The others
+ *	fall back to searching the device lists
+ */
+struct dm_lookup {
+	struct uclass *uclass[UCLASS_COUNT];
+	struct hlist_head node_head[DM_LOOKUP_NODE_BUCKETS];
+	ulong uclass_lookups;
+	ulong node_lookups;
+	ulong node_hits;
+};
+
+#if CONFIG_IS_ENABLED(DM_LOOKUP_TABLES)
+/**
+ * dm_lookup_init() - Set up the lookup tables for a new driver model
+ *
+ * The tables are allocated the first time this is called once full malloc()
+ * is available, so they are not used before relocation. After that they are
+ * cleared, but the lookup counts are kept.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int dm_lookup_init(void);
+
+/**
+ * dm_lookup_add_uclass() - Add a new uclass to the lookup table
+ *
+ * @uc: Uclass to add
+ */
+void dm_lookup_add_uclass(struct uclass *uc);
+
+/**
+ * dm_lookup_remove_uclass() - Remove a uclass from the lookup table
+ *
+ * @uc: Uclass to remove
+ */
+void dm_lookup_remove_uclass(struct uclass *uc);
+
+/**
+ * dm_lookup_add_dev() - Add a device to the node lookup table
+ *
+ * Nothing is done if the device has no device tree node.
+ *
+ * @dev: Device to add
+ */
+void dm_lookup_add_dev(struct udevice *dev);
+
+/**
+ * dm_lookup_remove_dev() - Remove a device from the node lookup table
+ *
+ * @dev: Device to remove. This need not be in the table
+ */
+void dm_lookup_remove_dev(struct udevice *dev);
+
+/**
+ * dm_lookup_find_by_ofnode() - Find the device for a device tree node
+ *
+ * This only succeeds if there is exactly one matching device, so that the
+ * result is the same as searching the device lists. Otherwise the caller
+ * must search for the device itself.
+ *
+ * @node: Device tree node to look up
+ * @id: Uclass the device must be in, or UCLASS_INVALID for any uclass
+ * @devp: Returns the device found
+ * @return 0 if OK, -EAGAIN if the caller must search for the device
+ */
+int dm_lookup_find_by_ofnode(ofnode node, enum uclass_id id,
+			     struct udevice **devp);
+#else
+static inline int dm_lookup_init(void)
+{
+	return 0;
+}
+
+static inline void dm_lookup_add_uclass(struct uclass *uc)
+{
+}
+
+static inline void dm_lookup_remove_uclass(struct uclass *uc)
+{
+}
+
+static inline void dm_lookup_add_dev(struct udevice *dev)
+{
+}
+
+static inline void dm_lookup_remove_dev(struct udevice *dev)
+{
+}
+
+static inline int dm_lookup_find_by_ofnode(ofnode node, enum uclass_id id,
+					   struct udevice **devp)
+{
+	return -EAGAIN;
+}
+#endif
+
+/* Alignment of each block allocated from the driver-model arena */
+#define DM_ARENA_ALIGN		(2 * sizeof(void *))
+
+/* Arena space allowed for each device node, including its private data */
+#define DM_ARENA_DEV_SIZE	(sizeof(struct udevice) + 128)
+
+/* Size of each further chunk allocated when the arena is full */
+#define DM_ARENA_CHUNK_SIZE	4096
+
+/**
+ * struct dm_arena_chunk - A piece of memory that arena blocks come from
+ *
+ * @next: Next (older) chunk in the arena
+ * @size: Number of bytes in @data
+ * @used: Number of bytes of @data allocated so far
+ * @live: Number of blocks in this chunk not yet freed. A chunk added when the
+ *	arena was full is freed once this drops to 0
+ * @data: Memory for arena blocks
+ */
+struct dm_arena_chunk {
+	struct dm_arena_chunk *next;
+	ulong size;
+	ulong used;
+	uint live;
+	char data[] __aligned(DM_ARENA_ALIGN);
+};
+
+/**
+ * struct dm_arena - Arena for allocating devices bound at start-up
+ *
+ * This is held in gd->dm_arena when CONFIG_DM_ARENA is enabled. Each device
+ * bound by dm_init_and_scan() is allocated from the arena in a single block
+ * which has room for its platform data and private data. The first chunk is
+ * only reused once every device in the arena has been unbound.
+ *
+ * @prev: Arena used by an earlier driver model which still has devices
+ * @chunks: Chunks of memory in the arena, newest first. The first one is
+ *	sized by counting the device tree nodes
+ * @open: true if devices being bound should be allocated from the arena
+ * @live: Number of blocks allocated and not yet freed
+ * @allocs: Total number of blocks allocated
+ */
+struct dm_arena {
+	struct dm_arena *prev;
+	struct dm_arena_chunk *chunks;
+	bool open;
+	uint live;
+	ulong allocs;
+};
+
+#if CONFIG_IS_ENABLED(DM_ARENA)
+/**
+ * dm_arena_init() - Set up the arena for a new driver model
+ *
+ * The arena is sized from the number of nodes in the device tree. If the
+ * previous arena still holds devices it is kept until they are unbound and
+ * a new one is started. Nothing is done before full malloc() is available.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int dm_arena_init(void);
+
+/**
+ * dm_arena_close() - Stop allocating devices from the arena
+ *
+ * This is called when start-up binding is complete. Devices bound after
+ * this are allocated with malloc() as usual.
+ */
+void dm_arena_close(void);
+
+/**
+ * dm_arena_alloc() - Allocate a zeroed block from the arena
+ *
+ * @size: Number of bytes required
+ * @return pointer to the block, or NULL if the arena is closed or full
+ */
+void *dm_arena_alloc(ulong size);
+
+/**
+ * dm_arena_free() - Free a block allocated from the arena
+ *
+ * @ptr: Block to free. If this was not allocated from the arena it is
+ *	passed to free()
+ */
+void dm_arena_free(void *ptr);
+
+/**
+ * dm_arena_owns() - Check if memory is part of an arena block
+ *
+ * @ptr: Pointer to check
+ * @return true if @ptr is inside a block allocated from the arena
+ */
+bool dm_arena_owns(const void *ptr);
+#else
+static inline int dm_arena_init(void)
+{
+	return 0;
+}
+
+static inline void dm_arena_close(void)
+{
+}
+
+static inline void *dm_arena_alloc(ulong size)
+{
+	return NULL;
+}
+
+static inline void dm_arena_free(void *ptr)
+{
+	free(ptr);
+}
+
+static inline bool dm_arena_owns(const void *ptr)
+{
+	return false;
+}
+#endif
+
+/**
+ * dm_arena_free_data() - Free data allocated for a device
+ *
+ * Data for a device allocated from the arena is part of the device's block,
+ * so is freed along with the device.
+ *
+ * @ptr: Data to free
+ */
+static inline void dm_arena_free_data(void *ptr)
+{
+	if (!dm_arena_owns(ptr))
+		free(ptr);
+}
+
 /* device resource management */
 #ifdef CONFIG_DEVRES
 
@@ -61,6 +61,18 @@ struct driver_info;
  */
 #define DM_FLAG_OS_PREPARE		(1 << 10)
 
+/*
+ * Start probing this device early, with dm_probe_async(), rather than when
+ * it is first used. The driver must provide a probe_wait() method
+ */
+#define DM_FLAG_PROBE_ASYNC		(1 << 11)
+
+/* Device probe() has been called but probe_wait() has not yet finished */
+#define DM_FLAG_PROBE_STARTED		(1 << 12)
+
+/* Device and its data were allocated together from the driver-model arena */
+#define DM_FLAG_ARENA			(1 << 13)
+
 /*
  * One or multiple of these flags are passed to device_remove() so that
  * a selective device removal as specified by the remove-stage and the
@@ -123,6 +135,8 @@ enum {
  *		When CONFIG_DEVRES is enabled, devm_kmalloc() and friends will
  *		add to this list. Memory so-allocated will be freed
  *		automatically when the device is removed / unbound
+ * @node_map: Links this device into the table used to find devices by their
+ *		device tree node (CONFIG_DM_LOOKUP_TABLES)
  */
 struct udevice {
 	const struct driver *driver;
@@ -146,6 +160,9 @@ struct udevice {
 #ifdef CONFIG_DEVRES
 	struct list_head devres_head;
 #endif
+#if CONFIG_IS_ENABLED(DM_LOOKUP_TABLES)
+	struct hlist_node node_map;
+#endif
 };
 
 /* Maximum sequence number supported */
@@ -154,17 +171,34 @@ struct udevice {
 /* Returns the operations for a device */
 #define device_get_ops(dev)	(dev->driver->ops)
 
-/* Returns non-zero if the device is active (probed and not removed) */
-#define device_active(dev)	((dev)->flags & DM_FLAG_ACTIVATED)
+/*
+ * Returns non-zero if the device is active (probed and not removed). A device
+ * whose probe was started by device_probe_start() is not active until the
+ * probe has finished.
+ */
+#define device_active(dev)	(((dev)->flags & (DM_FLAG_ACTIVATED | \
+					DM_FLAG_PROBE_STARTED)) == \
+				 DM_FLAG_ACTIVATED)
 
 static inline int dev_of_offset(const struct udevice *dev)
 {
 	return ofnode_to_offset(dev->node);
 }
 
+/**
+ * dev_set_ofnode() - Set the device tree node of a device
+ *
+ * Use this rather than setting dev->node directly, so that the device can
+ * still be found by its node with CONFIG_DM_LOOKUP_TABLES.
+ *
+ * @dev: Device to update
+ * @node: New device tree node for the device
+ */
+void dev_set_ofnode(struct udevice *dev, ofnode node);
+
 static inline void dev_set_of_offset(struct udevice *dev, int of_offset)
 {
-	dev->node = offset_to_ofnode(of_offset);
+	dev_set_ofnode(dev, offset_to_ofnode(of_offset));
 }
 
 static inline bool dev_has_of_node(struct udevice *dev)
@@ -207,6 +241,10 @@ struct udevice_id {
  * for each.
  * @bind: Called to bind a device to its driver
  * @probe: Called to probe a device, i.e. activate it
+ * @probe_wait: Called after probe() to wait for the device to be ready. This
+ * allows slow hardware to be started by probe() and finished later, so that
+ * other devices can be probed in the meantime. It returns 0 when the device
+ * is ready, -EBUSY if it is not ready yet, or another -ve value on error
  * @remove: Called to remove a device, i.e. de-activate it
  * @unbind: Called to unbind a device from its driver
  * @ofdata_to_platdata: Called before probe to decode device tree data
@@ -240,6 +278,7 @@ struct driver {
 	const struct udevice_id *of_match;
 	int (*bind)(struct udevice *dev);
 	int (*probe)(struct udevice *dev);
+	int (*probe_wait)(struct udevice *dev);
 	int (*remove)(struct udevice *dev);
 	int (*unbind)(struct udevice *dev);
 	int (*ofdata_to_platdata)(struct udevice *dev);
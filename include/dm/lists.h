@@ -44,6 +44,21 @@ struct uclass_driver *lists_uclass_lookup(enum uclass_id id);
  */
 int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 
+/**
+ * lists_driver_lookup_compat() - Find the driver for a compatible string
+ *
+ * This finds the first driver in the linker list which has @compat in its
+ * of_match table. With CONFIG_DM_COMPAT_INDEX this uses a hash index, built
+ * on first use, rather than checking every driver.
+ *
+ * @compat: Compatible string to look up
+ * @drvp: Returns the driver
+ * @of_idp: Returns the matching entry in the driver's of_match table
+ * @return 0 if found, -ENOENT if no driver has this compatible string
+ */
+int lists_driver_lookup_compat(const char *compat, struct driver **drvp,
+			       const struct udevice_id **of_idp);
+
 /**
  * lists_bind_fdt() - bind a device tree node
  *
@@ -61,6 +76,27 @@ int lists_bind_drivers(struct udevice *parent, bool pre_reloc_only);
 int lists_bind_fdt(struct udevice *parent, ofnode node, struct udevice **devp,
 		   bool pre_reloc_only);
 
+/**
+ * lists_bind_fdt_compat() - bind a device tree node with a known compatible
+ *
+ * This is like lists_bind_fdt() but the caller supplies the node name and
+ * its list of compatible strings, e.g. from a table generated at build time.
+ *
+ * @parent: parent device (root)
+ * @node: device tree node to bind
+ * @name: name of the node, used as the device name
+ * @compat_list: compatible strings of the node, each nul-terminated
+ * @compat_length: length of @compat_list in bytes
+ * @devp: if non-NULL, returns a pointer to the bound device
+ * @pre_reloc_only: If true, bind only nodes with special devicetree properties,
+ * or drivers with the DM_FLAG_PRE_RELOC flag. If false bind all drivers.
+ * @return 0 if device was bound, other -ve value on error
+ */
+int lists_bind_fdt_compat(struct udevice *parent, ofnode node,
+			  const char *name, const char *compat_list,
+			  int compat_length, struct udevice **devp,
+			  bool pre_reloc_only);
+
 /**
  * device_bind_driver() - bind a device to a driver
  *
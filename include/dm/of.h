@@ -39,6 +39,11 @@ struct property {
  * @parent: Pointer to parent node, or NULL if this is the root node
  * @child: Pointer to head of child node list, or NULL if no children
  * @sibling: Pointer to the next sibling node, or NULL if this is the last
+ * @fdt: Flat tree that the node was built from, if built lazily
+ * @offset: Offset of the node in @fdt
+ * @lazy: OF_LAZY_... flags for the parts of the node not yet built. Use
+ *	of_node_child() and of_node_properties() to read @child and
+ *	@properties, since they may need to be built first
  */
 struct device_node {
 	const char *name;
@@ -50,6 +55,17 @@ struct device_node {
 	struct device_node *parent;
 	struct device_node *child;
 	struct device_node *sibling;
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	const void *fdt;
+	int offset;
+	uint lazy;
+#endif
+};
+
+/* Parts of a lazily built node which are still only in the flat tree */
+enum {
+	OF_LAZY_CHILDREN	= 1 << 0,
+	OF_LAZY_PROPS		= 1 << 1,
 };
 
 #define OF_MAX_PHANDLE_ARGS 16
@@ -104,6 +120,55 @@ static inline bool of_live_active(void)
 
 #define OF_BAD_ADDR	((u64)-1)
 
+/**
+ * of_live_expand() - Build part of a lazily built node
+ *
+ * If there is not enough memory, the part is left unbuilt so that it can be
+ * tried again later. Until then the node appears to have no children or no
+ * properties.
+ *
+ * @np: Node to update
+ * @lazy: OF_LAZY_... flags for the parts to build
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int of_live_expand(struct device_node *np, uint lazy);
+
+/**
+ * of_node_child() - Get the first child of a node
+ *
+ * With CONFIG_OF_LIVE_LAZY this builds the node's children first if needed.
+ *
+ * @np: Node to check
+ * @return first child node, or NULL if none
+ */
+static inline struct device_node *of_node_child(const struct device_node *np)
+{
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if ((np->lazy & OF_LAZY_CHILDREN) &&
+	    of_live_expand((struct device_node *)np, OF_LAZY_CHILDREN))
+		return NULL;
+#endif
+	return np->child;
+}
+
+/**
+ * of_node_properties() - Get the first property of a node
+ *
+ * With CONFIG_OF_LIVE_LAZY this builds the node's properties first if needed.
+ *
+ * @np: Node to check
+ * @return first property, or NULL if none
+ */
+static inline struct property *of_node_properties(const struct device_node *np)
+{
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if ((np->lazy & OF_LAZY_PROPS) &&
+	    of_live_expand((struct device_node *)np, OF_LAZY_PROPS))
+		return NULL;
+#endif
+	return np->properties;
+}
+
 static inline const char *of_node_full_name(const struct device_node *np)
 {
 	return np ? np->full_name : "<no-node>";
@@ -43,4 +43,61 @@ struct driver_info {
 #define U_BOOT_DEVICES(__name)						\
 	ll_entry_declare_list(struct driver_info, __name, driver_info)
 
+/**
+ * struct dm_prebind - A device tree node to bind without scanning the tree
+ *
+ * These are generated by dtoc from the control device tree when
+ * CONFIG_OF_PREBIND is enabled. Each one is a node that dm_scan_fdt() would
+ * bind: an enabled node with a compatible string which is a subnode of the
+ * root, or of a "chosen" or "firmware" node.
+ *
+ * dtoc finds the driver for each node in the U-Boot source, but cannot tell
+ * whether it is built, so @driver is a weak reference which is NULL if not.
+ * The driver is then looked up from @compat, as when scanning the tree.
+ *
+ * @name:	Name of the node, used as the device name
+ * @offset:	Offset of the node in the control device tree
+ * @driver:	Driver to bind to the node, or NULL to look it up
+ * @pre_reloc:	true if the node is marked for binding before relocation
+ * @compat:	Compatible strings of the node, each nul-terminated
+ * @compat_len:	Length of @compat in bytes
+ */
+struct dm_prebind {
+	const char *name;
+	int offset;
+	struct driver *driver;
+	bool pre_reloc;
+	const char *compat;
+	int compat_len;
+};
+
+/* Declare a driver for a prebind table, which need not be linked in */
+#define DM_PREBIND_DRIVER_REF(__name)					\
+	extern struct driver _u_boot_list_2_driver_2_##__name __weak
+
+/* Get a driver declared with DM_PREBIND_DRIVER_REF(), or NULL if not built */
+#define DM_PREBIND_DRIVER(__name)	(&_u_boot_list_2_driver_2_##__name)
+
+/**
+ * struct dm_prebind_table - Table of nodes to bind, generated by dtoc
+ *
+ * The sizes are used to check that the control device tree is the one that
+ * the table was generated from.
+ *
+ * @totalsize:		Total size of the device tree
+ * @size_dt_struct:	Size of the device tree's structure block
+ * @size_dt_strings:	Size of the device tree's strings block
+ * @count:		Number of entries in @entries
+ * @entries:		Nodes to bind, in device tree order
+ */
+struct dm_prebind_table {
+	u32 totalsize;
+	u32 size_dt_struct;
+	u32 size_dt_strings;
+	int count;
+	const struct dm_prebind *entries;
+};
+
+extern const struct dm_prebind_table dm_prebind_table;
+
 #endif
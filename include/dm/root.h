@@ -9,6 +9,7 @@
 #ifndef _DM_ROOT_H_
 #define _DM_ROOT_H_
 
+struct dm_prebind_table;
 struct udevice;
 
 /**
@@ -54,6 +55,24 @@ int dm_scan_platdata(bool pre_reloc_only);
  */
 int dm_scan_fdt(const void *blob, bool pre_reloc_only);
 
+/**
+ * dm_scan_prebind() - Bind devices from a table generated by dtoc
+ *
+ * This binds the same devices as dm_scan_fdt() does for the root node and
+ * any "chosen" or "firmware" node, but uses a table generated at build time
+ * (see CONFIG_OF_PREBIND) instead of scanning the tree. Nothing is bound
+ * unless the device tree matches the table.
+ *
+ * @blob: Pointer to device tree blob
+ * @table: Table of nodes to bind, normally &dm_prebind_table
+ * @pre_reloc_only: If true, bind only nodes with special devicetree properties,
+ * or drivers with the DM_FLAG_PRE_RELOC flag. If false bind all drivers.
+ * @return 0 if OK, -EAGAIN if the table was not generated from @blob, other
+ * -ve on error
+ */
+int dm_scan_prebind(const void *blob, const struct dm_prebind_table *table,
+		    bool pre_reloc_only);
+
 /**
  * dm_extended_scan_fdt() - Scan the device tree and bind drivers
  *
@@ -114,6 +133,22 @@ int dm_init(bool of_live);
  */
 int dm_uninit(void);
 
+/**
+ * dm_probe_async() - Start probing devices which are slow to probe
+ *
+ * This calls probe() for every device whose driver has the
+ * DM_FLAG_PROBE_ASYNC flag, without waiting for the device to be ready. A
+ * device is only started once the devices it depends on (its parent and any
+ * clocks, resets, power domains, PHYs or regulator supplies) have finished
+ * probing, if those are also slow. Each device finishes probing the next time
+ * device_probe() is called on it, e.g. by uclass_get_device().
+ *
+ * Failures are reported but do not stop other devices from being started.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int dm_probe_async(void);
+
 #if CONFIG_IS_ENABLED(DM_DEVICE_REMOVE)
 /**
  * dm_remove_devices_flags - Call remove function of all drivers with
@@ -30,6 +30,12 @@ void dm_dump_all(void);
 /* Dump out a list of uclasses and their devices */
 void dm_dump_uclass(void);
 
+/* Dump out the number of uclass and device lookups done */
+void dm_dump_stats(void);
+
+/* Dump out the memory used by the devices in each uclass, and the arena */
+void dm_dump_mem(void);
+
 #ifdef CONFIG_DEBUG_DEVRES
 /* Dump out a list of device resources */
 void dm_dump_devres(void);
@@ -80,6 +80,20 @@ struct env_clbk_tbl {
 
 void env_callback_init(ENTRY *var_entry);
 
+/**
+ * env_callback_attach() - Bind a callback to a variable which has none
+ *
+ * This lets code which caches something derived from a variable hear when it
+ * changes. The binding lasts until the variable is deleted or ".callbacks" is
+ * changed, so the caller must not rely on it alone.
+ *
+ * @name: Name of the variable
+ * @callback: Name of the callback, as given to U_BOOT_ENV_CALLBACK()
+ * @return 0 if OK, -ENOENT if the variable does not exist, -EBUSY if it
+ *	already has a callback, -ENOSYS if there is no such callback
+ */
+int env_callback_attach(const char *name, const char *callback);
+
 /*
  * Define a callback that can be associated with variables.
  * when associated through the ".callbacks" environment variable, the callback
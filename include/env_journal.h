@@ -0,0 +1,153 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Journal of changes saved since the environment was last written in full
+ */
+
+#ifndef __ENV_JOURNAL_H__
+#define __ENV_JOURNAL_H__
+
+#include <environment.h>
+
+#define ENV_JOURNAL_MAGIC	0x4a564e45	/* "ENVJ" */
+
+/*
+ * Check whether two copies of the environment at offsets @a and @b overlap,
+ * where each takes @size bytes including its journal
+ */
+#define ENV_JOURNAL_OVERLAP(a, b, size)	((a) < (b) + (size) && \
+					 (b) < (a) + (size))
+
+/**
+ * struct env_journal_rec - Header of a record in the journal
+ *
+ * Each 'saveenv' which can be journaled writes one record, holding the
+ * variables which changed in the same '\0'-separated "name=value" form as the
+ * environment itself. A variable which was deleted is recorded as just "name".
+ *
+ * @magic: ENV_JOURNAL_MAGIC
+ * @len: Number of bytes of changes following the header
+ * @base: Identifies the environment which the record applies to (see
+ *	env_journal_base())
+ * @seq: Position of the record in the journal (0 = first)
+ * @crc: CRC32 of the fields above followed by the changes
+ */
+struct env_journal_rec {
+	uint32_t magic;
+	uint32_t len;
+	uint32_t base;
+	uint32_t seq;
+	uint32_t crc;
+};
+
+/**
+ * struct env_journal - Journal following a copy of the environment in storage
+ *
+ * The journal lets 'saveenv' write just the variables which changed. When it
+ * is full, the caller writes the whole environment as usual (compacting the
+ * journal into it) and starts a new journal.
+ *
+ * @size: Size of the journal area in bytes
+ * @align: Each record starts at a multiple of this many bytes, e.g. the block
+ *	size of the device. This must be a power of two, at least 4, and @size
+ *	must be a multiple of it
+ * @erase_val: Value of each byte once erased, if the storage must be erased
+ *	before it is written again (e.g. 0xff for SPI flash), else -1
+ * @read: Read from the journal area
+ *	@jnl: Journal to read
+ *	@offset: Offset to read from, within the journal area
+ *	@size: Number of bytes to read
+ *	@buf: Buffer to read into
+ *	@return 0 if OK, -ve on error
+ * @write: Write to the journal area, with the same arguments as @read
+ * @priv: Private data for @read and @write
+ * @start: Offset of the journal area in the device, set by the caller to
+ *	select the copy of the environment in use
+ * @base: Identifies the environment which the journal applies to
+ * @tail: Offset within the journal area at which the next record is written
+ * @seq: Sequence number of the next record
+ * @full: true if no more records can be written until the environment is
+ *	written in full
+ * @saved: Environment as it now is in storage, in the form written by
+ *	hexport_r(), or NULL if not known
+ */
+struct env_journal {
+	ulong size;
+	ulong align;
+	int erase_val;
+	int (*read)(struct env_journal *jnl, ulong offset, ulong size,
+		    void *buf);
+	int (*write)(struct env_journal *jnl, ulong offset, ulong size,
+		     const void *buf);
+	void *priv;
+	ulong start;
+
+	uint32_t base;
+	ulong tail;
+	uint seq;
+	bool full;
+	char *saved;
+};
+
+/**
+ * env_journal_base() - Get the value which binds records to an environment
+ *
+ * This is the environment's CRC, combined with its flags if there is a
+ * redundant copy. A record is only used with the environment that was in
+ * storage when it was written, so stale records are ignored.
+ *
+ * @env: Environment as read from or written to storage
+ * @return value for the @base field of a record
+ */
+uint32_t env_journal_base(const env_t *env);
+
+/**
+ * env_journal_replay() - Apply the journal to an environment just loaded
+ *
+ * This reads the journal and applies each valid record for @env to @htab in
+ * turn, stopping at the first record which is invalid or belongs to another
+ * environment.
+ *
+ * @jnl: Journal to read
+ * @htab: Hash table into which @env was imported
+ * @env: Environment which was loaded
+ * @return 0 if OK, -ve on error, in which case the next save writes the
+ *	environment in full
+ */
+int env_journal_replay(struct env_journal *jnl, struct hsearch_data *htab,
+		       const env_t *env);
+
+/**
+ * env_journal_append() - Save the changes to an environment in the journal
+ *
+ * This compares @htab with the environment in storage and writes a record
+ * holding the variables which differ, if there are any.
+ *
+ * @jnl: Journal to write
+ * @htab: Hash table holding the environment to save
+ * @return 0 if OK, -ENOSPC if the environment must be written in full,
+ *	other -ve on error
+ */
+int env_journal_append(struct env_journal *jnl, struct hsearch_data *htab);
+
+/**
+ * env_journal_erase() - Clear the journal once the environment is written
+ *
+ * Storage which must be erased before being written (@erase_val >= 0) is not
+ * touched; the caller should erase the journal area along with the
+ * environment.
+ *
+ * @jnl: Journal to clear
+ * @return 0 if OK, -ve on error
+ */
+int env_journal_erase(struct env_journal *jnl);
+
+/**
+ * env_journal_start() - Start a new journal for an environment just written
+ *
+ * @jnl: Journal, which must be empty in storage
+ * @env: Environment which was written
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int env_journal_start(struct env_journal *jnl, const env_t *env);
+
+#endif /* __ENV_JOURNAL_H__ */
@@ -66,6 +66,139 @@ void do_fixup_by_compat(void *fdt, const char *compat,
 			const char *prop, const void *val, int len, int create);
 void do_fixup_by_compat_u32(void *fdt, const char *compat,
 			    const char *prop, u32 val, int create);
+
+/**
+ * struct fdt_fixup_prop - A property change waiting in a batch
+ *
+ * @node: Offset of the node to change
+ * @seq: Position of the change in the batch
+ * @name: Name of the property
+ * @val: Copy of the new value
+ * @len: Length of @val in bytes
+ */
+struct fdt_fixup_prop {
+	int node;
+	int seq;
+	const char *name;
+	void *val;
+	int len;
+};
+
+/**
+ * struct fdt_fixup - A batch of property changes to make to a device tree
+ *
+ * Setting a property moves everything after it in the tree and may run out
+ * of space, so fixups made one at a time must find each node again, check
+ * for space and move the rest of the tree each time. A batch finds all its
+ * nodes before anything changes, then writes the changed tree in one pass.
+ *
+ * The tree must not be changed in other ways while changes are waiting in a
+ * batch, since they refer to nodes by offset.
+ *
+ * @blob: Device tree to change
+ * @props: Changes waiting to be made
+ * @count: Number of changes in @props
+ * @max: Number of changes which @props has space for
+ * @space: Most space in bytes that the changes can need
+ * @err: First error adding a change, or 0
+ */
+struct fdt_fixup {
+	void *blob;
+	struct fdt_fixup_prop *props;
+	int count;
+	int max;
+	int space;
+	int err;
+};
+
+/**
+ * fdt_fixup_start() - Start a batch of property changes
+ *
+ * @fix: Batch to set up
+ * @blob: Device tree to change
+ */
+void fdt_fixup_start(struct fdt_fixup *fix, void *blob);
+
+/**
+ * fdt_fixup_setprop() - Add a property change to a batch
+ *
+ * @fix: Batch to add to
+ * @node: Offset of node to change
+ * @name: Name of the property, which must remain valid until the batch is
+ *	applied
+ * @val: New value, which is copied
+ * @len: Length of @val in bytes
+ * @return 0 if OK, -FDT_ERR_NOSPACE if out of memory, in which case
+ *	fdt_fixup_apply() changes nothing and returns the same error
+ */
+int fdt_fixup_setprop(struct fdt_fixup *fix, int node, const char *name,
+		      const void *val, int len);
+
+static inline int fdt_fixup_setprop_u32(struct fdt_fixup *fix, int node,
+					const char *name, u32 val)
+{
+	fdt32_t tmp = cpu_to_fdt32(val);
+
+	return fdt_fixup_setprop(fix, node, name, &tmp, sizeof(tmp));
+}
+
+static inline int fdt_fixup_setprop_string(struct fdt_fixup *fix, int node,
+					   const char *name, const char *str)
+{
+	return fdt_fixup_setprop(fix, node, name, str, strlen(str) + 1);
+}
+
+/**
+ * fdt_fixup_by_path() - Add a change to the property of a node given by path
+ *
+ * This is the batched form of do_fixup_by_path().
+ *
+ * @fix: Batch to add to
+ * @path: Path of node to change
+ * @prop: Name of the property
+ * @val: New value, which is copied
+ * @len: Length of @val in bytes
+ * @create: 0 to change the property only if the node already has it
+ * @return 0 if OK, -ve if the node was not found or on error
+ */
+int fdt_fixup_by_path(struct fdt_fixup *fix, const char *path,
+		      const char *prop, const void *val, int len, int create);
+
+/**
+ * fdt_fixup_by_compat() - Add a change to every node with a compatible string
+ *
+ * This is the batched form of do_fixup_by_compat().
+ *
+ * @fix: Batch to add to
+ * @compat: Compatible string of nodes to change
+ * @prop: Name of the property
+ * @val: New value, which is copied
+ * @len: Length of @val in bytes
+ * @create: 0 to change the property only in nodes which already have it
+ * @return 0 if OK, -ve on error
+ */
+int fdt_fixup_by_compat(struct fdt_fixup *fix, const char *compat,
+			const char *prop, const void *val, int len, int create);
+
+/**
+ * fdt_fixup_apply() - Make the changes in a batch
+ *
+ * As with fdt_setprop(), the changes must fit within the device tree's total
+ * size, so use fdt_open_into() or fdt_increase_size() first to make room.
+ * New properties are added after those a node already has. If a property is
+ * changed more than once, the last change wins. The batch is emptied, ready
+ * to be used again.
+ *
+ * A batch which grows the tree is written out in a single pass through a
+ * buffer the size of the tree. Changes which need no more space, or a single
+ * change, are made in place with fdt_setprop() instead.
+ *
+ * @fix: Batch to apply
+ * @return 0 if OK, -FDT_ERR_NOSPACE if the changes do not fit (in which case
+ *	the device tree is not changed), or other -FDT_ERR_... on error
+ */
+int fdt_fixup_apply(struct fdt_fixup *fix);
+
 /**
  * Setup the memory node in the DT. Creates one if none was existing before.
  * Calls fdt_fixup_memory_banks() to populate a single reg pair covering the
@@ -102,6 +235,16 @@ static inline int fdt_fixup_memory_banks(void *blob, u64 start[], u64 size[],
 }
 #endif
 
+/**
+ * fdt_fixup_add_ethernet() - Add the MAC addresses of ethernet aliases
+ *
+ * This is the batched form of fdt_fixup_ethernet(). Each node given by an
+ * ethernet<n> alias gets the address in the environment variable
+ * eth<n>addr (ethaddr for the first).
+ *
+ * @fix: Batch to add to
+ */
+void fdt_fixup_add_ethernet(struct fdt_fixup *fix);
 void fdt_fixup_ethernet(void *fdt);
 int fdt_find_and_setprop(void *fdt, const char *node, const char *prop,
 			 const void *val, int len, int create);
@@ -169,6 +312,20 @@ int fdt_find_or_add_subnode(void *fdt, int parentoffset, const char *name);
  */
 int ft_board_setup(void *blob, bd_t *bd);
 
+/**
+ * ft_board_setup_fixup() - Add board-specific property changes to a batch
+ *
+ * This is called just before ft_board_setup(), with the batch which also
+ * holds the MAC-address fixups, so that all the property changes are made
+ * in one pass. Changes which add nodes belong in ft_board_setup() instead.
+ * This function is called if CONFIG_OF_BOARD_SETUP is defined
+ *
+ * @fix: Batch to add to
+ * @bd: Pointer to board data
+ * @return 0 if ok, or -FDT_ERR_... on error
+ */
+int ft_board_setup_fixup(struct fdt_fixup *fix, bd_t *bd);
+
 /*
  * The keystone2 SOC requires all 32 bit aliased addresses to be converted
  * to their 36 physical format. This has to happen after all fdt nodes
@@ -287,6 +444,7 @@ int fdt_setup_simplefb_node(void *fdt, int node, u64 base_address, u32 width,
 			    u32 height, u32 stride, const char *format);
 
 int fdt_overlay_apply_verbose(void *fdt, void *fdto);
+int fdt_overlay_apply_index_verbose(struct fdt_overlay_index *idx, void *fdto);
 
 /**
  * fdt_get_cells_len() - Get the length of a type of cell in top-level nodes
@@ -660,6 +660,34 @@ int fdtdec_get_chosen_node(const void *blob, const char *name);
  */
 const char *fdtdec_get_compatible(enum fdt_compat_id id);
 
+/**
+ * fdtdec_node_offset_by_phandle() - Find the node with a given phandle
+ *
+ * This is the same as fdt_node_offset_by_phandle(). For the control FDT
+ * (gd->fdt_blob) with CONFIG_OF_LOOKUP_CACHE, a table of phandles is built on
+ * first use so that the whole tree is not searched on each call. The table is
+ * rebuilt if the FDT moves or its structure block changes size.
+ *
+ * @blob:	FDT blob
+ * @phandle:	Phandle to look up
+ * @return node offset if found, -ve FDT_ERR_... error code on error
+ */
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle);
+
+/**
+ * fdtdec_path_offset() - Find the node with a given path or alias
+ *
+ * This is the same as fdt_path_offset(). For the control FDT with
+ * CONFIG_OF_LOOKUP_CACHE, the nodes for the last few short full paths are
+ * remembered until the FDT moves or its structure block changes size. Each
+ * remembered node is checked against the path before it is used.
+ *
+ * @blob:	FDT blob
+ * @path:	Full path of the node, or an alias
+ * @return node offset if found, -ve FDT_ERR_... error code on error
+ */
+int fdtdec_path_offset(const void *blob, const char *path);
+
 /* Look up a phandle and follow it to its node. Then return the offset
  * of that node.
  *
@@ -668,6 +668,32 @@ int fit_image_load(bootm_headers_t *images, ulong addr,
 		   enum fit_load_op load_op, ulong *datap, ulong *lenp);
 
 #ifndef USE_HOSTCC
+/**
+ * fit_load_file() - read a FIT from a filesystem, only as far as needed
+ *
+ * This reads the FIT structure, selects a configuration and then reads the
+ * external data of just the images which that configuration uses. Each is
+ * placed where it would be if the whole file were loaded to @addr, so the
+ * FIT can then be booted as normal. This avoids reading the images for all
+ * the other configurations in a FIT which supports many boards.
+ *
+ * @ifname:	Interface name (e.g. "mmc")
+ * @dev_part:	Device and partition (e.g. "0:1")
+ * @fstype:	Filesystem type (FS_TYPE_...)
+ * @filename:	Name of the file holding the FIT
+ * @addr:	Address to load the FIT to
+ * @conf_uname:	Configuration to use, or NULL for the default
+ * @sizep:	Returns the size of the FIT in memory, up to the end of the
+ *		last image read
+ * @bytes_readp: Returns the number of bytes actually read
+ * @return 0 if OK, -EINVAL if the FIT is invalid or refers to data beyond the
+ *	end of the file, -ENOSPC if it would overwrite reserved memory, other
+ *	-ve on error
+ */
+int fit_load_file(const char *ifname, const char *dev_part, int fstype,
+		  const char *filename, ulong addr, const char *conf_uname,
+		  ulong *sizep, loff_t *bytes_readp);
+
 /**
  * fit_get_node_from_config() - Look up an image a FIT by type
  *
@@ -921,6 +947,8 @@ int booti_setup(ulong image, ulong *relocated_addr, ulong *size,
 #define FIT_TYPE_PROP		"type"
 #define FIT_OS_PROP		"os"
 #define FIT_COMP_PROP		"compression"
+#define FIT_COMP_BLOCK_SIZE_PROP	"compression-block-size"
+#define FIT_COMP_BLOCKS_PROP	"compression-blocks"
 #define FIT_ENTRY_PROP		"entry"
 #define FIT_LOAD_PROP		"load"
 
@@ -1002,6 +1030,25 @@ int fit_image_get_data_size(const void *fit, int noffset, int *data_size);
 int fit_image_get_data_and_size(const void *fit, int noffset,
 				const void **data, size_t *size);
 
+/**
+ * fit_image_get_comp_blocks() - get the block layout of a compressed image
+ *
+ * A block-compressed image is made up of independently compressed blocks,
+ * each of which expands to @block_size bytes (the last may be shorter).
+ * This allows the blocks to be decompressed in any order, or in parallel.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @noffset:	Component image node offset
+ * @block_size:	Returns the uncompressed size of each block
+ * @offsets:	Returns the offset of each block within the image data, as
+ *		big-endian 32-bit cells
+ * @count:	Returns the number of blocks
+ * @return 0 if OK, -ENOENT if the image is not block-compressed, -EINVAL
+ *	if the block properties are malformed
+ */
+int fit_image_get_comp_blocks(const void *fit, int noffset, ulong *block_size,
+			      const fdt32_t **offsets, int *count);
+
 int fit_image_hash_get_algo(const void *fit, int noffset, char **algo);
 int fit_image_hash_get_value(const void *fit, int noffset, uint8_t **value,
 				int *value_len);
@@ -1033,6 +1080,20 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 			      const char *comment, int require_keys,
 			      const char *engine_id, const char *cmdname);
 
+/**
+ * fit_add_comp_blocks() - index block-compressed images in a FIT
+ *
+ * For each component image which has a compression-block-size property but
+ * no compression-blocks property, walk the image data (a sequence of lz4
+ * frames, or of gzip members carrying a BGZF 'BC' extra field) and add the
+ * offset of each block.
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @return 0 if OK, -ENOSPC if the FIT ran out of space, other -ve value on
+ *	error
+ */
+int fit_add_comp_blocks(void *fit);
+
 int fit_image_verify_with_data(const void *fit, int image_noffset,
 			       const void *data, size_t size);
 int fit_image_verify(const void *fit, int noffset);
@@ -1075,14 +1136,17 @@ int calculate_hash(const void *data, int data_len, const char *algo,
 # ifdef USE_HOSTCC
 #  define IMAGE_ENABLE_SIGN	1
 #  define IMAGE_ENABLE_VERIFY	1
+#  define IMAGE_ENABLE_ECDSA	1
 # include  <openssl/evp.h>
 #else
 #  define IMAGE_ENABLE_SIGN	0
 #  define IMAGE_ENABLE_VERIFY	1
+#  define IMAGE_ENABLE_ECDSA	CONFIG_IS_ENABLED(ECDSA)
 # endif
 #else
 # define IMAGE_ENABLE_SIGN	0
 # define IMAGE_ENABLE_VERIFY	0
+# define IMAGE_ENABLE_ECDSA	0
 #endif
 
 #ifdef USE_HOSTCC
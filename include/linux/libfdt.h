@@ -305,6 +305,120 @@ int fdt_next_region(const void *fdt,
  */
 int fdt_add_alias_regions(const void *fdt, struct fdt_region *region, int count,
 			  int max_regions, struct fdt_region_state *info);
+
+/**
+ * struct fdt_overlay_phandle - a phandle in the base tree
+ *
+ * @phandle:	Phandle of the node
+ * @offset:	Offset of the node with this phandle
+ */
+struct fdt_overlay_phandle {
+	uint32_t phandle;
+	int offset;
+};
+
+/**
+ * struct fdt_overlay_symbol - a symbol in the /__symbols__ node
+ *
+ * @name:	Name of the symbol, allocated along with @path
+ * @path:	Path of the node which the symbol refers to
+ * @phandle:	Phandle of that node, or 0 if not yet looked up
+ */
+struct fdt_overlay_symbol {
+	char *name;
+	const char *path;
+	uint32_t phandle;
+};
+
+/**
+ * struct fdt_overlay_index - indexes for applying overlays to a base tree
+ *
+ * fdt_overlay_apply() walks the base tree to find each symbol, phandle and
+ * fragment target. This index holds them instead, and is kept up to date
+ * as overlays change the base tree, so that a series of overlays can be
+ * applied without walking the tree each time.
+ *
+ * @fdt:		Base device tree
+ * @phandles:		Node offsets of phandles, sorted by phandle
+ * @phandle_count:	Number of entries in @phandles
+ * @phandle_max:	Number of entries allocated for @phandles
+ * @symbols:		Symbols, sorted by name
+ * @symbol_count:	Number of entries in @symbols
+ * @symbol_max:		Number of entries allocated for @symbols
+ * @symbols_node:	Offset of /__symbols__, or -FDT_ERR_NOTFOUND
+ * @max_phandle:	Highest phandle in the base tree
+ */
+struct fdt_overlay_index {
+	void *fdt;
+	struct fdt_overlay_phandle *phandles;
+	int phandle_count;
+	int phandle_max;
+	struct fdt_overlay_symbol *symbols;
+	int symbol_count;
+	int symbol_max;
+	int symbols_node;
+	uint32_t max_phandle;
+};
+
+/**
+ * fdt_overlay_index_init() - build the indexes of a base tree
+ *
+ * @idx:	Index to set up
+ * @fdt:	Base device tree, which must then only be changed by
+ *		fdt_overlay_apply_index() and fdt_overlay_index_resize() until
+ *		fdt_overlay_index_free()
+ * @return 0 if OK, -FDT_ERR_NOSPACE if out of memory, other -ve FDT_ERR_...
+ * if the tree is not valid
+ */
+int fdt_overlay_index_init(struct fdt_overlay_index *idx, void *fdt);
+
+/**
+ * fdt_overlay_index_free() - free the memory used by an index
+ *
+ * @idx:	Index to free
+ */
+void fdt_overlay_index_free(struct fdt_overlay_index *idx);
+
+/**
+ * fdt_overlay_index_resize() - change the space available for an indexed tree
+ *
+ * The tree is opened out in place. Since it is already in the order that
+ * fdt_open_into() produces, nothing in it moves and the index stays valid.
+ *
+ * @idx:	Index of the base tree
+ * @size:	New space available for the base tree
+ * @return 0 if OK, -FDT_ERR_NOSPACE if @size is too small for the tree, other
+ * -ve FDT_ERR_... on error
+ */
+int fdt_overlay_index_resize(struct fdt_overlay_index *idx, int size);
+
+/**
+ * fdt_overlay_apply_index() - apply an overlay to an indexed base tree
+ *
+ * This works like fdt_overlay_apply() and updates the index as the base
+ * tree changes. As there, the overlay is damaged in any case and the base
+ * tree is damaged on error.
+ *
+ * @idx:	Index of the base tree
+ * @fdto:	Overlay to apply
+ * @return 0 if OK, -ve FDT_ERR_... on error
+ */
+int fdt_overlay_apply_index(struct fdt_overlay_index *idx, void *fdto);
+
+/**
+ * fdt_overlay_apply_batch() - apply a series of overlays to a base tree
+ *
+ * The base tree is opened out to @size once and then all the overlays are
+ * applied in turn using one index. The base tree is not packed afterwards.
+ *
+ * @fdt:	Base device tree
+ * @size:	Space available for the base tree
+ * @fdtos:	Overlays to apply, in order
+ * @count:	Number of overlays in @fdtos
+ * @return 0 if OK, -ve FDT_ERR_... on error
+ */
+int fdt_overlay_apply_batch(void *fdt, int size, void *const fdtos[],
+			    int count);
 #endif /* SWIG */
 
 extern struct fdt_header *working_fdt;  /* Pointer to the working fdt */
@@ -19,18 +19,41 @@ struct lmb_property {
 	phys_size_t size;
 };
 
+/*
+ * The regions are kept sorted by base address and never overlap. They start
+ * out in @initial and move to an array from malloc() if there are more than
+ * MAX_LMB_REGIONS, which lmb_release() frees.
+ */
 struct lmb_region {
 	unsigned long cnt;
+	unsigned long max;
 	phys_size_t size;
-	struct lmb_property region[MAX_LMB_REGIONS+1];
+	struct lmb_property *region;
+	struct lmb_property initial[MAX_LMB_REGIONS];
+};
+
+/**
+ * enum lmb_alloc_policy - Where lmb_alloc() and friends place a block
+ *
+ * @LMB_ALLOC_TOP_DOWN: As high as possible (the default)
+ * @LMB_ALLOC_BOTTOM_UP: As low as possible
+ * @LMB_ALLOC_BEST_FIT: At the top of the smallest free area that holds it,
+ *	keeping larger areas for later allocations
+ */
+enum lmb_alloc_policy {
+	LMB_ALLOC_TOP_DOWN,
+	LMB_ALLOC_BOTTOM_UP,
+	LMB_ALLOC_BEST_FIT,
 };
 
 struct lmb {
 	struct lmb_region memory;
 	struct lmb_region reserved;
+	enum lmb_alloc_policy policy;
 };
 
 extern void lmb_init(struct lmb *lmb);
+extern void lmb_release(struct lmb *lmb);
 extern void lmb_init_and_reserve(struct lmb *lmb, bd_t *bd, void *fdt_blob);
 extern void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 				       phys_size_t size, void *fdt_blob);
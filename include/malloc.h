@@ -914,6 +914,18 @@ int initf_malloc(void);
 
 /* Simple versions which can be used when space is tight */
 void *malloc_simple(size_t size);
+void *memalign_simple(size_t alignment, size_t bytes);
+void free_simple(void *ptr);
+
+/* Slabs for small blocks, used by malloc() if CONFIG_SYS_MALLOC_SLAB is set */
+#define MALLOC_SLAB_MAX		256
+
+void *malloc_slab(size_t bytes);
+void free_slab(void *ptr);
+int malloc_slab_owns(const void *ptr);
+size_t malloc_slab_usable_size(const void *ptr);
+void malloc_slab_adjust_info(struct mallinfo *info);
+void malloc_slab_stats(void);
 
 #pragma GCC visibility push(hidden)
 # if __STD_C
@@ -52,6 +52,8 @@
  * @reg_width:		IO accesses size of registers (in bytes)
  * @reg_shift:		Shift size of registers (0=byte, 1=16bit, 2=32bit...)
  * @clock:		UART base clock speed in Hz
+ * @fcr:		Value to write to the FIFO control register
+ * @fifo_size:		Number of characters the TX FIFO holds (0 for 1)
  */
 struct ns16550_platdata {
 	unsigned long base;
@@ -60,6 +62,7 @@ struct ns16550_platdata {
 	int reg_offset;
 	int clock;
 	u32 fcr;
+	int fifo_size;
 };
 
 struct udevice;
@@ -20,4 +20,38 @@ struct device_node;
  */
 int of_live_build(const void *fdt_blob, struct device_node **rootp);
 
+/**
+ * of_live_unflatten() - build a live tree without scanning its aliases
+ *
+ * A lazy tree starts with just the root node. The children and properties of
+ * each node are built from @fdt_blob on first use, so @fdt_blob must not be
+ * changed or moved while the tree is in use.
+ *
+ * @fdt_blob: Input tree to convert
+ * @lazy: true to build the tree on demand (needs CONFIG_OF_LIVE_LAZY)
+ * @rootp: Returns live tree that was created
+ * @return 0 if OK, -ENOSYS if @lazy is not supported, other -ve on error
+ */
+int of_live_unflatten(const void *fdt_blob, bool lazy,
+		      struct device_node **rootp);
+
+/**
+ * of_live_free() - free a live tree built by of_live_unflatten()
+ *
+ * @root: Root node of the tree
+ */
+void of_live_free(struct device_node *root);
+
+/**
+ * of_live_find_offset() - find the node built from a flat-tree node
+ *
+ * This only builds the nodes on the path from @root to the node, and only
+ * looks at their subnodes to find it.
+ *
+ * @root: Root node of a lazily built tree
+ * @offset: Offset of the node in the flat tree
+ * @return node, or NULL if not found
+ */
+struct device_node *of_live_find_offset(struct device_node *root, int offset);
+
 #endif
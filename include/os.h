@@ -326,6 +326,24 @@ void os_localtime(struct rtc_time *rt);
  */
 void os_abort(void);
 
+/**
+ * os_run_parallel() - Call a function for a number of items on host threads
+ *
+ * This starts up to @max_threads host threads, which call @func for each
+ * index from 0 to @count - 1 between them, and waits for them all to finish.
+ * @func must not use anything in U-Boot which is not thread-safe, such as
+ * malloc() or the console.
+ *
+ * @count:	Number of items
+ * @max_threads: Maximum number of threads to start
+ * @func:	Function to call for each item
+ * @ctx:	Context pointer to pass to @func
+ * @return number of threads which were started. If this is 0 the items
+ *	were handled on the calling thread
+ */
+int os_run_parallel(int count, int max_threads,
+		    void (*func)(void *ctx, int index), void *ctx);
+
 /**
  * os_mprotect_allow() - Remove write-protection on a region of memory
  *
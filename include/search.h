@@ -52,6 +52,17 @@ struct hsearch_data {
 	struct _ENTRY *table;
 	unsigned int size;
 	unsigned int filled;
+/*
+ * Statistics showing how well the keys are spread: the number of searches,
+ * the total and largest number of slots looked at by a search, and how often
+ * the table has grown
+ */
+	unsigned long searches;
+	unsigned long probes;
+	unsigned int max_probes;
+	unsigned int resizes;
+/* Non-zero while callbacks run, since the table must not move under them */
+	int busy;
 /*
  * Callback function which will check whether the given change for variable
  * "__item" to "newval" may be applied or not, and possibly apply such change.
@@ -189,6 +189,23 @@ struct dm_serial_ops {
 	 * @return 0 if OK, -ve on error
 	 */
 	int (*putc)(struct udevice *dev, const char ch);
+	/**
+	 * puts() - Write a run of characters
+	 *
+	 * This method is optional. Drivers which can take more than one
+	 * character at a time (e.g. by filling a FIFO) should provide it,
+	 * since it avoids waiting for the UART after each character.
+	 *
+	 * The characters are written as they are; the uclass deals with
+	 * adding a '\r' before each '\n'.
+	 *
+	 * @dev: Device pointer
+	 * @s: Characters to write
+	 * @len: Number of characters to write (at least 1)
+	 * @return number of characters written, which may be fewer than
+	 *	@len, or -EAGAIN if none can be written yet, other -ve on error
+	 */
+	int (*puts)(struct udevice *dev, const char *s, int len);
 	/**
 	 * pending() - Check if input/output characters are waiting
 	 *
@@ -268,6 +285,10 @@ struct dm_serial_ops {
  * @buf:	Pointer to the RX buffer
  * @rd_ptr:	Read pointer in the RX buffer
  * @wr_ptr:	Write pointer in the RX buffer
+ *
+ * @tx_buf:	Pointer to the TX buffer, or NULL to write output directly
+ * @tx_rd:	Read pointer in the TX buffer
+ * @tx_wr:	Write pointer in the TX buffer
  */
 struct serial_dev_priv {
 	struct stdio_dev *sdev;
@@ -275,11 +296,28 @@ struct serial_dev_priv {
 	char *buf;
 	int rd_ptr;
 	int wr_ptr;
+
+	char *tx_buf;
+	int tx_rd;
+	int tx_wr;
 };
 
 /* Access the serial operations for a device */
 #define serial_get_ops(dev)	((struct dm_serial_ops *)(dev)->driver->ops)
 
+/**
+ * serial_flush() - Wait until buffered output has gone to the console UART
+ *
+ * With CONFIG_SERIAL_TX_BUFFER, output is held in a buffer until the UART
+ * can take it. This must be called before anything which stops U-Boot from
+ * draining the buffer, such as booting an OS.
+ */
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+void serial_flush(void);
+#else
+static inline void serial_flush(void) {}
+#endif
+
 /**
  * serial_getconfig() - Get the uart configuration
  * (parity, 5/6/7/8 bits word length, stop bits)
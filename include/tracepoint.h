@@ -0,0 +1,215 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * Tracepoints record I/O and probe events as small binary records in a ring
+ * buffer, so that they can be left enabled in production builds. The records
+ * can be shown with the 'tracepoint' command, stashed in memory, or passed to
+ * the OS in the bloblist. Use tools/tracepoint.py to convert them into a
+ * trace which can be loaded into Chrome (chrome://tracing) or Perfetto.
+ *
+ * See doc/README.tracepoint for details.
+ */
+
+#ifndef __TRACEPOINT_H
+#define __TRACEPOINT_H
+
+#include <common.h>
+#include <linux/bitops.h>
+
+/*
+ * Events which can be recorded. The values are part of the binary format, so
+ * new events must be added at the end and the names added to tracepoint.c
+ * and tools/tracepoint.py
+ */
+enum tracepoint_id {
+	TP_DM_PROBE,		/* arg0: uclass ID, arg1: return value */
+	TP_BLK_READ,		/* arg0: start block, arg1: blocks read */
+	TP_BLK_WRITE,		/* arg0: start block, arg1: blocks written */
+	TP_MMC_CMD,		/* arg0: command index, arg1: return value */
+	TP_NET_SEND,		/* arg0: length, arg1: return value */
+	TP_NET_RECV,		/* arg0: length */
+	TP_FS_READ,		/* arg0: offset, arg1: bytes read */
+	TP_FS_WRITE,		/* arg0: offset, arg1: bytes written */
+
+	TP_COUNT,
+};
+
+#define TRACEPOINT_MAGIC	0x50637254	/* 'TrcP' */
+#define TRACEPOINT_VERSION	1
+#define TRACEPOINT_NAME_LEN	12
+
+/**
+ * struct tracepoint_rec - a record of a single event
+ *
+ * @start_us: Time when the event started, from timer_get_boot_us()
+ * @duration_us: Time taken by the event
+ * @id: Event ID (enum tracepoint_id)
+ * @spare: Space for future use (zero)
+ * @arg: Values which depend on the event (see enum tracepoint_id)
+ * @name: Name of the device or file, which is not nul-terminated if it fills
+ *	the field
+ */
+struct tracepoint_rec {
+	u32 start_us;
+	u32 duration_us;
+	u16 id;
+	u16 spare;
+	u32 arg[2];
+	char name[TRACEPOINT_NAME_LEN];
+};
+
+/**
+ * struct tracepoint_hdr - header for stashed tracepoint records
+ *
+ * This is followed by @count records, oldest first. All values are in the
+ * byte order of the machine which recorded them.
+ *
+ * @magic: TRACEPOINT_MAGIC
+ * @version: TRACEPOINT_VERSION
+ * @rec_size: Size of each record, sizeof(struct tracepoint_rec)
+ * @count: Number of records which follow
+ * @dropped: Number of older records which were overwritten
+ */
+struct tracepoint_hdr {
+	u32 magic;
+	u16 version;
+	u16 rec_size;
+	u32 count;
+	u32 dropped;
+};
+
+#if CONFIG_IS_ENABLED(TRACEPOINT)
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/**
+ * tracepoint_on() - Check if an event is being recorded
+ *
+ * This is a single test of a mask in global_data, which is zero until the
+ * tracepoint buffer is set up.
+ *
+ * @id: Event to check (enum tracepoint_id)
+ * @return true if the event is recorded
+ */
+static inline bool tracepoint_on(enum tracepoint_id id)
+{
+	return gd->tracepoint_mask & BIT(id);
+}
+
+/**
+ * tracepoint_add() - Add a record of an event
+ *
+ * Normally tracepoint_end() is used instead.
+ *
+ * @id: Event to record
+ * @start_us: Time when the event started
+ * @name: Name of the device or file. Any directory is dropped and only the
+ *	first TRACEPOINT_NAME_LEN characters are kept
+ * @arg0: First value for the record (see enum tracepoint_id)
+ * @arg1: Second value for the record
+ */
+void tracepoint_add(enum tracepoint_id id, ulong start_us, const char *name,
+		    ulong arg0, ulong arg1);
+
+/**
+ * tracepoint_start() - Note the start of an event
+ *
+ * @id: Event which is starting
+ * @return start time to pass to tracepoint_end(), or 0 if the event is not
+ *	being recorded
+ */
+static inline ulong tracepoint_start(enum tracepoint_id id)
+{
+	return tracepoint_on(id) ? timer_get_boot_us() : 0;
+}
+
+/**
+ * tracepoint_end() - Record an event which has finished
+ *
+ * @id: Event which has finished
+ * @start_us: Value returned by tracepoint_start(); nothing is recorded if
+ *	this is 0
+ * @name: Name of the device or file
+ * @arg0: First value for the record (see enum tracepoint_id)
+ * @arg1: Second value for the record
+ */
+static inline void tracepoint_end(enum tracepoint_id id, ulong start_us,
+				  const char *name, ulong arg0, ulong arg1)
+{
+	if (start_us)
+		tracepoint_add(id, start_us, name, arg0, arg1);
+}
+
+/**
+ * tracepoint_set_mask() - Select which events are recorded
+ *
+ * @mask: Mask of events to record, with bit n set for event n
+ * @return 0 if OK, -ENOSPC if there is no tracepoint buffer
+ */
+int tracepoint_set_mask(u32 mask);
+
+/** tracepoint_clear() - Drop all records */
+void tracepoint_clear(void);
+
+/**
+ * tracepoint_stash() - Write the records in the binary format
+ *
+ * This writes a struct tracepoint_hdr followed by the records, oldest first.
+ *
+ * @buf: Buffer to write to
+ * @size: Size of buffer in bytes
+ * @return number of bytes written, or -ENOSPC if the buffer is too small
+ */
+int tracepoint_stash(void *buf, int size);
+
+/**
+ * tracepoint_export() - Add the records to the bloblist for the OS
+ *
+ * This does nothing if there is no bloblist.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int tracepoint_export(void);
+
+/** tracepoint_report() - Print the records */
+void tracepoint_report(void);
+
+/**
+ * tracepoint_init() - Set up the tracepoint buffer
+ *
+ * This is called after relocation, once malloc() is available. All events
+ * in CONFIG_TRACEPOINT_MASK are then recorded.
+ *
+ * @return 0 if OK, -ENOMEM if out of memory
+ */
+int tracepoint_init(void);
+
+#else
+
+static inline bool tracepoint_on(enum tracepoint_id id)
+{
+	return false;
+}
+
+static inline ulong tracepoint_start(enum tracepoint_id id)
+{
+	return 0;
+}
+
+static inline void tracepoint_end(enum tracepoint_id id, ulong start_us,
+				  const char *name, ulong arg0, ulong arg1)
+{
+}
+
+static inline int tracepoint_export(void)
+{
+	return 0;
+}
+
+static inline int tracepoint_init(void)
+{
+	return 0;
+}
+
+#endif /* CONFIG_IS_ENABLED(TRACEPOINT) */
+
+#endif /* __TRACEPOINT_H */
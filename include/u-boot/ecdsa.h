@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: GPL-2.0+ */
+/*
+ * ECDSA signing and verification for FIT images
+ */
+
+#ifndef _ECDSA_H
+#define _ECDSA_H
+
+#include <errno.h>
+#include <image.h>
+
+struct image_sign_info;
+
+#if IMAGE_ENABLE_SIGN
+/**
+ * ecdsa_sign() - calculate and return signature for given input data
+ *
+ * @info:	Specifies key and FIT information
+ * @region:	List of regions to sign
+ * @region_count: Number of regions
+ * @sigp:	Set to an allocated buffer holding the signature
+ * @sig_len:	Set to length of the calculated signature
+ *
+ * The signature is returned as the raw big endian values r || s, each of
+ * them padded to the size of the curve. The caller should free *sigp.
+ *
+ * @return: 0, on success, -ve on error
+ */
+int ecdsa_sign(struct image_sign_info *info,
+	       const struct image_region region[],
+	       int region_count, uint8_t **sigp, uint *sig_len);
+
+/**
+ * ecdsa_add_verify_data() - Add verification information to FDT
+ *
+ * Add the public key (curve name and point coordinates) to the FDT node,
+ * suitable for verification at run-time.
+ *
+ * @info:	Specifies key and FIT information
+ * @keydest:	Destination FDT blob for public key data
+ * @return: 0, on success, -ENOSPC if the keydest FDT blob ran out of space,
+ *	    other -ve value on error
+ */
+int ecdsa_add_verify_data(struct image_sign_info *info, void *keydest);
+#else
+static inline int ecdsa_sign(struct image_sign_info *info,
+		const struct image_region region[], int region_count,
+		uint8_t **sigp, uint *sig_len)
+{
+	return -ENXIO;
+}
+
+static inline int ecdsa_add_verify_data(struct image_sign_info *info,
+					void *keydest)
+{
+	return -ENXIO;
+}
+#endif
+
+#if IMAGE_ENABLE_VERIFY
+/**
+ * ecdsa_verify() - Verify a signature against some data
+ *
+ * @info:	Specifies key and FIT information
+ * @region:	List of regions to verify
+ * @region_count: Number of regions
+ * @sig:	Signature, as r || s
+ * @sig_len:	Number of bytes in signature
+ * @return 0 if verified, -ve on error
+ */
+int ecdsa_verify(struct image_sign_info *info,
+		 const struct image_region region[], int region_count,
+		 uint8_t *sig, uint sig_len);
+
+/**
+ * ecdsa_verify_hash() - Verify an ECDSA signature over a message digest
+ *
+ * @curve:	Curve name, "prime256v1" or "secp384r1"
+ * @qx:		Public key X coordinate, big endian, curve-size bytes
+ * @qy:		Public key Y coordinate, big endian, curve-size bytes
+ * @hash:	Message digest
+ * @hash_len:	Number of bytes in the digest
+ * @sig:	Signature, as r || s with each value curve-size bytes
+ * @sig_len:	Number of bytes in signature
+ * @return 0 if verified, -EACCES if the signature does not match, other
+ *	   -ve value if the key or signature is malformed
+ */
+int ecdsa_verify_hash(const char *curve, const uint8_t *qx,
+		      const uint8_t *qy, const uint8_t *hash, int hash_len,
+		      const uint8_t *sig, int sig_len);
+
+/**
+ * ecdsa_curve_bytes() - Get the size of a curve's field elements
+ *
+ * @curve:	Curve name
+ * @return number of bytes, or -ENOENT if the curve is not supported
+ */
+int ecdsa_curve_bytes(const char *curve);
+#else
+static inline int ecdsa_verify(struct image_sign_info *info,
+		const struct image_region region[], int region_count,
+		uint8_t *sig, uint sig_len)
+{
+	return -ENXIO;
+}
+#endif
+
+#define ECDSA256_BYTES	(256 / 8)
+#define ECDSA384_BYTES	(384 / 8)
+
+/* This is the largest curve we support, in bytes */
+#define ECDSA_MAX_BYTES	ECDSA384_BYTES
+
+/* This is the largest message digest we support, in bytes */
+#define ECDSA_MAX_HASH_BYTES	64
+
+#endif
@@ -179,8 +179,26 @@ int usb_reset_root_port(struct usb_device *dev);
 #define usb_reset_root_port(dev)
 #endif
 
+/**
+ * struct usb_bulk_xfer - One transfer in a stream of bulk transfers
+ *
+ * @buffer:	Buffer to read into / write from. This should be DMA-aligned
+ * @length:	Number of bytes to transfer
+ * @act_len:	Number of bytes actually transferred, set on completion
+ * @status:	Status of the transfer (USB_ST_...), set on completion. This is
+ *		USB_ST_NOT_PROC if the transfer was not carried out
+ */
+struct usb_bulk_xfer {
+	void *buffer;
+	int length;
+	int act_len;
+	unsigned long status;
+};
+
 int submit_bulk_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len);
+int submit_bulk_stream(struct usb_device *dev, unsigned long pipe,
+		       struct usb_bulk_xfer *xfer, int count);
 int submit_control_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
 			int transfer_len, struct devrequest *setup);
 int submit_int_msg(struct usb_device *dev, unsigned long pipe, void *buffer,
@@ -261,6 +279,8 @@ int usb_control_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, unsigned short size, int timeout);
 int usb_bulk_msg(struct usb_device *dev, unsigned int pipe,
 			void *data, int len, int *actual_length, int timeout);
+int usb_bulk_stream(struct usb_device *dev, unsigned int pipe,
+		    struct usb_bulk_xfer *xfer, int count, int timeout);
 int usb_submit_int_msg(struct usb_device *dev, unsigned long pipe,
 			void *buffer, int transfer_len, int interval);
 int usb_disable_asynch(int disable);
@@ -644,11 +664,15 @@ struct usb_dev_platdata {
  *		so this will be false.
  * @companion:  True if this is a companion controller to another USB
  *		controller
+ * @bulk_bytes:	Number of bytes transferred by bulk messages on this bus
+ * @bulk_us:	Time taken by bulk messages on this bus, in microseconds
  */
 struct usb_bus_priv {
 	int next_addr;
 	bool desc_before_addr;
 	bool companion;
+	u64 bulk_bytes;
+	u64 bulk_us;
 };
 
 /**
@@ -699,6 +723,25 @@ struct dm_usb_ops {
 	 */
 	int (*bulk)(struct udevice *bus, struct usb_device *udev,
 		    unsigned long pipe, void *buffer, int length);
+	/**
+	 * bulk_stream() - Send a sequence of bulk messages
+	 *
+	 * The controller queues as many of the messages as it can, so that it
+	 * can start each one as soon as the one before has finished. They are
+	 * carried out in order, stopping at the first one which fails. A short
+	 * IN transfer is not a failure. @udev->status and @udev->act_len are
+	 * set as for the last message carried out.
+	 *
+	 * Most parameters are as above. This method is optional.
+	 *
+	 * @xfer: Messages to send. The status and act_len of each is updated
+	 * @count: Number of messages
+	 * @return 0 if all messages completed, -EIO if one failed, other -ve
+	 *	value if the messages could not be sent
+	 */
+	int (*bulk_stream)(struct udevice *bus, struct usb_device *udev,
+			   unsigned long pipe, struct usb_bulk_xfer *xfer,
+			   int count);
 	/**
 	 * interrupt() - Send an interrupt message
 	 *
@@ -834,6 +877,25 @@ bool usb_hub_is_root_hub(struct udevice *hub);
  */
 int usb_hub_scan(struct udevice *hub);
 
+/**
+ * usb_hub_scan_begin() - Start scanning several hubs together
+ *
+ * Until usb_hub_scan_end() is called, hubs which are probed power on their
+ * ports and add them to the scanning list, but do not scan them. This allows
+ * the port delays of hubs on different buses to overlap.
+ */
+void usb_hub_scan_begin(void);
+
+/**
+ * usb_hub_scan_end() - Scan the hubs probed since usb_hub_scan_begin()
+ *
+ * This scans the ports of all the hubs, including those of any hubs which
+ * are found, until all devices are set up.
+ *
+ * @return 0 if OK, -ve on error
+ */
+int usb_hub_scan_end(void);
+
 /**
  * usb_scan_device() - Scan a device on a bus
  *
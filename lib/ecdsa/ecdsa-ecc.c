@@ -0,0 +1,608 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Software ECDSA signature verification for the NIST P-256 and P-384 curves
+ *
+ * Field and scalar arithmetic use Montgomery multiplication on little endian
+ * arrays of 32-bit words, points are kept in Jacobian coordinates. Only
+ * public data is handled here, so no attempt is made to be constant-time.
+ */
+
+#ifndef USE_HOSTCC
+#include <common.h>
+#include <linux/errno.h>
+#else
+#include "mkimage.h"
+#endif
+#include <u-boot/ecdsa.h>
+
+#define ECC_MAX_WORDS	(ECDSA_MAX_BYTES / 4)
+
+/**
+ * struct ecc_mont - a modulus prepared for Montgomery multiplication
+ *
+ * @len:	Number of 32-bit words in the modulus
+ * @mod:	Modulus as little endian word array
+ * @n0inv:	-1 / mod[0] mod 2^32
+ * @rr:		R^2 mod modulus, where R = 2^(32 * len)
+ */
+struct ecc_mont {
+	uint len;
+	const uint32_t *mod;
+	uint32_t n0inv;
+	uint32_t rr[ECC_MAX_WORDS];
+};
+
+/**
+ * struct ecc_curve - short Weierstrass curve y^2 = x^3 - 3x + b
+ *
+ * @name:	Curve name as used in the 'ecdsa,curve' key property
+ * @len:	Number of 32-bit words per field element / scalar
+ * @p:		Field prime
+ * @n:		Group order
+ * @b:		Curve constant b
+ * @gx:		Base point X coordinate
+ * @gy:		Base point Y coordinate
+ */
+struct ecc_curve {
+	const char *name;
+	uint len;
+	const uint32_t *p;
+	const uint32_t *n;
+	const uint32_t *b;
+	const uint32_t *gx;
+	const uint32_t *gy;
+};
+
+/* A point in Jacobian coordinates; Z == 0 is the point at infinity */
+struct ecc_point {
+	uint32_t x[ECC_MAX_WORDS];
+	uint32_t y[ECC_MAX_WORDS];
+	uint32_t z[ECC_MAX_WORDS];
+};
+
+/* NIST P-256 (prime256v1), little endian words */
+static const uint32_t p256_p[] = {
+	0xffffffff, 0xffffffff, 0xffffffff, 0x00000000,
+	0x00000000, 0x00000000, 0x00000001, 0xffffffff,
+};
+
+static const uint32_t p256_n[] = {
+	0xfc632551, 0xf3b9cac2, 0xa7179e84, 0xbce6faad,
+	0xffffffff, 0xffffffff, 0x00000000, 0xffffffff,
+};
+
+static const uint32_t p256_b[] = {
+	0x27d2604b, 0x3bce3c3e, 0xcc53b0f6, 0x651d06b0,
+	0x769886bc, 0xb3ebbd55, 0xaa3a93e7, 0x5ac635d8,
+};
+
+static const uint32_t p256_gx[] = {
+	0xd898c296, 0xf4a13945, 0x2deb33a0, 0x77037d81,
+	0x63a440f2, 0xf8bce6e5, 0xe12c4247, 0x6b17d1f2,
+};
+
+static const uint32_t p256_gy[] = {
+	0x37bf51f5, 0xcbb64068, 0x6b315ece, 0x2bce3357,
+	0x7c0f9e16, 0x8ee7eb4a, 0xfe1a7f9b, 0x4fe342e2,
+};
+
+/* NIST P-384 (secp384r1), little endian words */
+static const uint32_t p384_p[] = {
+	0xffffffff, 0x00000000, 0x00000000, 0xffffffff,
+	0xfffffffe, 0xffffffff, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+};
+
+static const uint32_t p384_n[] = {
+	0xccc52973, 0xecec196a, 0x48b0a77a, 0x581a0db2,
+	0xf4372ddf, 0xc7634d81, 0xffffffff, 0xffffffff,
+	0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff,
+};
+
+static const uint32_t p384_b[] = {
+	0xd3ec2aef, 0x2a85c8ed, 0x8a2ed19d, 0xc656398d,
+	0x5013875a, 0x0314088f, 0xfe814112, 0x181d9c6e,
+	0xe3f82d19, 0x988e056b, 0xe23ee7e4, 0xb3312fa7,
+};
+
+static const uint32_t p384_gx[] = {
+	0x72760ab7, 0x3a545e38, 0xbf55296c, 0x5502f25d,
+	0x82542a38, 0x59f741e0, 0x8ba79b98, 0x6e1d3b62,
+	0xf320ad74, 0x8eb1c71e, 0xbe8b0537, 0xaa87ca22,
+};
+
+static const uint32_t p384_gy[] = {
+	0x90ea0e5f, 0x7a431d7c, 0x1d7e819d, 0x0a60b1ce,
+	0xb5f0b8c0, 0xe9da3113, 0x289a147c, 0xf8f41dbd,
+	0x9292dc29, 0x5d9e98bf, 0x96262c6f, 0x3617de4a,
+};
+
+static const struct ecc_curve ecc_curves[] = {
+	{
+		.name = "prime256v1",
+		.len = 8,
+		.p = p256_p,
+		.n = p256_n,
+		.b = p256_b,
+		.gx = p256_gx,
+		.gy = p256_gy,
+	},
+	{
+		.name = "secp384r1",
+		.len = 12,
+		.p = p384_p,
+		.n = p384_n,
+		.b = p384_b,
+		.gx = p384_gx,
+		.gy = p384_gy,
+	},
+};
+
+static void bn_copy(uint32_t *r, const uint32_t *a, uint len)
+{
+	memcpy(r, a, len * sizeof(uint32_t));
+}
+
+static void bn_zero(uint32_t *r, uint len)
+{
+	memset(r, '\0', len * sizeof(uint32_t));
+}
+
+static bool bn_is_zero(const uint32_t *a, uint len)
+{
+	uint32_t acc = 0;
+	uint i;
+
+	for (i = 0; i < len; i++)
+		acc |= a[i];
+
+	return !acc;
+}
+
+/* Returns -1, 0 or 1 as a is less than, equal to or greater than b */
+static int bn_cmp(const uint32_t *a, const uint32_t *b, uint len)
+{
+	int i;
+
+	for (i = (int)len - 1; i >= 0; i--) {
+		if (a[i] != b[i])
+			return a[i] > b[i] ? 1 : -1;
+	}
+
+	return 0;
+}
+
+/* r = a + b, returning the carry */
+static uint32_t bn_add(uint32_t *r, const uint32_t *a, const uint32_t *b,
+		       uint len)
+{
+	uint64_t acc = 0;
+	uint i;
+
+	for (i = 0; i < len; i++) {
+		acc += (uint64_t)a[i] + b[i];
+		r[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+
+	return (uint32_t)acc;
+}
+
+/* r = a - b, returning the borrow */
+static uint32_t bn_sub(uint32_t *r, const uint32_t *a, const uint32_t *b,
+		       uint len)
+{
+	int64_t acc = 0;
+	uint i;
+
+	for (i = 0; i < len; i++) {
+		acc += (int64_t)a[i] - b[i];
+		r[i] = (uint32_t)acc;
+		acc >>= 32;
+	}
+
+	return acc ? 1 : 0;
+}
+
+/* Convert a big endian byte string of len words into a word array */
+static void bn_from_bytes(uint32_t *r, const uint8_t *buf, uint len)
+{
+	uint i;
+
+	for (i = 0; i < len; i++) {
+		const uint8_t *p = buf + (len - 1 - i) * 4;
+
+		r[i] = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+		       (uint32_t)p[2] << 8 | p[3];
+	}
+}
+
+static bool bn_test_bit(const uint32_t *a, uint bit)
+{
+	return (a[bit / 32] >> (bit % 32)) & 1;
+}
+
+static void mod_add(uint32_t *r, const uint32_t *a, const uint32_t *b,
+		    const struct ecc_mont *m)
+{
+	uint32_t carry = bn_add(r, a, b, m->len);
+
+	if (carry || bn_cmp(r, m->mod, m->len) >= 0)
+		bn_sub(r, r, m->mod, m->len);
+}
+
+static void mod_sub(uint32_t *r, const uint32_t *a, const uint32_t *b,
+		    const struct ecc_mont *m)
+{
+	if (bn_sub(r, a, b, m->len))
+		bn_add(r, r, m->mod, m->len);
+}
+
+/**
+ * mont_mul() - Montgomery multiplication
+ *
+ * Computes r = a * b / R mod m. r may alias a or b.
+ */
+static void mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b,
+		     const struct ecc_mont *m)
+{
+	uint32_t t[ECC_MAX_WORDS + 2];
+	uint len = m->len;
+	uint64_t acc;
+	uint32_t q;
+	uint i, j;
+
+	bn_zero(t, len + 2);
+	for (i = 0; i < len; i++) {
+		acc = 0;
+		for (j = 0; j < len; j++) {
+			acc += (uint64_t)a[j] * b[i] + t[j];
+			t[j] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		acc += t[len];
+		t[len] = (uint32_t)acc;
+		t[len + 1] = (uint32_t)(acc >> 32);
+
+		q = t[0] * m->n0inv;
+		acc = (uint64_t)q * m->mod[0] + t[0];
+		acc >>= 32;
+		for (j = 1; j < len; j++) {
+			acc += (uint64_t)q * m->mod[j] + t[j];
+			t[j - 1] = (uint32_t)acc;
+			acc >>= 32;
+		}
+		acc += t[len];
+		t[len - 1] = (uint32_t)acc;
+		t[len] = t[len + 1] + (uint32_t)(acc >> 32);
+	}
+
+	if (t[len] || bn_cmp(t, m->mod, len) >= 0)
+		bn_sub(t, t, m->mod, len);
+	bn_copy(r, t, len);
+}
+
+/* Set up Montgomery constants for an odd modulus */
+static void mont_init(struct ecc_mont *m, const uint32_t *mod, uint len)
+{
+	uint32_t inv = 1;
+	uint i;
+
+	m->len = len;
+	m->mod = mod;
+
+	/* Newton iteration: each step doubles the number of correct bits */
+	for (i = 0; i < 5; i++)
+		inv *= 2 - mod[0] * inv;
+	m->n0inv = -inv;
+
+	/* R^2 mod m by doubling 1 a total of 2 * 32 * len times */
+	bn_zero(m->rr, len);
+	m->rr[0] = 1;
+	for (i = 0; i < 64 * len; i++)
+		mod_add(m->rr, m->rr, m->rr, m);
+}
+
+static void mont_to(uint32_t *r, const uint32_t *a, const struct ecc_mont *m)
+{
+	mont_mul(r, a, m->rr, m);
+}
+
+static void mont_from(uint32_t *r, const uint32_t *a, const struct ecc_mont *m)
+{
+	uint32_t one[ECC_MAX_WORDS];
+
+	bn_zero(one, m->len);
+	one[0] = 1;
+	mont_mul(r, a, one, m);
+}
+
+/**
+ * mont_inv() - Modular inverse of a Montgomery-form value
+ *
+ * Uses Fermat's little theorem, r = a^(m - 2), so the modulus must be prime.
+ */
+static void mont_inv(uint32_t *r, const uint32_t *a, const struct ecc_mont *m)
+{
+	uint32_t exp[ECC_MAX_WORDS], two[ECC_MAX_WORDS];
+	uint32_t acc[ECC_MAX_WORDS];
+	int bit;
+
+	bn_zero(two, m->len);
+	two[0] = 2;
+	bn_sub(exp, m->mod, two, m->len);
+
+	/* acc = 1 in Montgomery form */
+	bn_zero(acc, m->len);
+	acc[0] = 1;
+	mont_to(acc, acc, m);
+
+	for (bit = m->len * 32 - 1; bit >= 0; bit--) {
+		mont_mul(acc, acc, acc, m);
+		if (bn_test_bit(exp, bit))
+			mont_mul(acc, acc, a, m);
+	}
+	bn_copy(r, acc, m->len);
+}
+
+/* r = 2 * p, using the a = -3 doubling formula */
+static void ecc_point_double(struct ecc_point *r, const struct ecc_point *p,
+			     const struct ecc_mont *f)
+{
+	uint32_t delta[ECC_MAX_WORDS], gamma[ECC_MAX_WORDS];
+	uint32_t beta[ECC_MAX_WORDS], alpha[ECC_MAX_WORDS];
+	uint32_t t1[ECC_MAX_WORDS], t2[ECC_MAX_WORDS];
+	uint len = f->len;
+
+	if (bn_is_zero(p->z, len)) {
+		*r = *p;
+		return;
+	}
+
+	mont_mul(delta, p->z, p->z, f);
+	mont_mul(gamma, p->y, p->y, f);
+	mont_mul(beta, p->x, gamma, f);
+
+	/* alpha = 3 * (x - delta) * (x + delta) */
+	mod_sub(t1, p->x, delta, f);
+	mod_add(t2, p->x, delta, f);
+	mont_mul(t1, t1, t2, f);
+	mod_add(alpha, t1, t1, f);
+	mod_add(alpha, alpha, t1, f);
+
+	/* z3 = (y + z)^2 - gamma - delta */
+	mod_add(t1, p->y, p->z, f);
+	mont_mul(t1, t1, t1, f);
+	mod_sub(t1, t1, gamma, f);
+	mod_sub(r->z, t1, delta, f);
+
+	/* x3 = alpha^2 - 8 * beta */
+	mod_add(beta, beta, beta, f);
+	mod_add(beta, beta, beta, f);
+	mod_add(t2, beta, beta, f);
+	mont_mul(t1, alpha, alpha, f);
+	mod_sub(r->x, t1, t2, f);
+
+	/* y3 = alpha * (4 * beta - x3) - 8 * gamma^2 */
+	mod_sub(t1, beta, r->x, f);
+	mont_mul(t1, alpha, t1, f);
+	mont_mul(gamma, gamma, gamma, f);
+	mod_add(gamma, gamma, gamma, f);
+	mod_add(gamma, gamma, gamma, f);
+	mod_add(gamma, gamma, gamma, f);
+	mod_sub(r->y, t1, gamma, f);
+}
+
+/* r = p + q; r may alias p or q */
+static void ecc_point_add(struct ecc_point *r, const struct ecc_point *p,
+			  const struct ecc_point *q, const struct ecc_mont *f)
+{
+	uint32_t z1z1[ECC_MAX_WORDS], z2z2[ECC_MAX_WORDS];
+	uint32_t u1[ECC_MAX_WORDS], u2[ECC_MAX_WORDS];
+	uint32_t s1[ECC_MAX_WORDS], s2[ECC_MAX_WORDS];
+	uint32_t h[ECC_MAX_WORDS], rr[ECC_MAX_WORDS];
+	uint32_t h2[ECC_MAX_WORDS], h3[ECC_MAX_WORDS];
+	uint32_t t[ECC_MAX_WORDS];
+	uint len = f->len;
+
+	if (bn_is_zero(p->z, len)) {
+		*r = *q;
+		return;
+	}
+	if (bn_is_zero(q->z, len)) {
+		*r = *p;
+		return;
+	}
+
+	mont_mul(z1z1, p->z, p->z, f);
+	mont_mul(z2z2, q->z, q->z, f);
+	mont_mul(u1, p->x, z2z2, f);
+	mont_mul(u2, q->x, z1z1, f);
+	mont_mul(s1, p->y, q->z, f);
+	mont_mul(s1, s1, z2z2, f);
+	mont_mul(s2, q->y, p->z, f);
+	mont_mul(s2, s2, z1z1, f);
+
+	mod_sub(h, u2, u1, f);
+	mod_sub(rr, s2, s1, f);
+	if (bn_is_zero(h, len)) {
+		if (bn_is_zero(rr, len)) {
+			ecc_point_double(r, p, f);
+		} else {
+			/* p == -q */
+			bn_zero(r->x, len);
+			bn_zero(r->y, len);
+			bn_zero(r->z, len);
+		}
+		return;
+	}
+
+	mont_mul(h2, h, h, f);
+	mont_mul(h3, h, h2, f);
+	mont_mul(u1, u1, h2, f);
+
+	/* z3 = z1 * z2 * h */
+	mont_mul(t, p->z, q->z, f);
+	mont_mul(r->z, t, h, f);
+
+	/* x3 = rr^2 - h^3 - 2 * u1 * h^2 */
+	mont_mul(t, rr, rr, f);
+	mod_sub(t, t, h3, f);
+	mod_sub(t, t, u1, f);
+	mod_sub(r->x, t, u1, f);
+
+	/* y3 = rr * (u1 * h^2 - x3) - s1 * h^3 */
+	mod_sub(t, u1, r->x, f);
+	mont_mul(t, rr, t, f);
+	mont_mul(s1, s1, h3, f);
+	mod_sub(r->y, t, s1, f);
+}
+
+/* Load an affine point into Montgomery-form Jacobian coordinates */
+static void ecc_point_load(struct ecc_point *r, const uint32_t *x,
+			   const uint32_t *y, const struct ecc_mont *f)
+{
+	mont_to(r->x, x, f);
+	mont_to(r->y, y, f);
+	bn_zero(r->z, f->len);
+	r->z[0] = 1;
+	mont_to(r->z, r->z, f);
+}
+
+/* Check that the affine point (x, y) satisfies y^2 = x^3 - 3x + b */
+static bool ecc_point_on_curve(const struct ecc_curve *curve,
+			       const uint32_t *x, const uint32_t *y,
+			       const struct ecc_mont *f)
+{
+	uint32_t xm[ECC_MAX_WORDS], lhs[ECC_MAX_WORDS];
+	uint32_t rhs[ECC_MAX_WORDS], t[ECC_MAX_WORDS];
+	uint len = curve->len;
+
+	if (bn_cmp(x, curve->p, len) >= 0 || bn_cmp(y, curve->p, len) >= 0)
+		return false;
+
+	mont_to(t, y, f);
+	mont_mul(lhs, t, t, f);
+
+	mont_to(xm, x, f);
+	mont_mul(rhs, xm, xm, f);
+	mont_mul(rhs, rhs, xm, f);
+	mod_sub(rhs, rhs, xm, f);
+	mod_sub(rhs, rhs, xm, f);
+	mod_sub(rhs, rhs, xm, f);
+	mont_to(t, curve->b, f);
+	mod_add(rhs, rhs, t, f);
+
+	return !bn_cmp(lhs, rhs, len);
+}
+
+static const struct ecc_curve *ecc_find_curve(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ecc_curves); i++) {
+		if (!strcmp(ecc_curves[i].name, name))
+			return &ecc_curves[i];
+	}
+
+	return NULL;
+}
+
+int ecdsa_curve_bytes(const char *curve_name)
+{
+	const struct ecc_curve *curve = ecc_find_curve(curve_name);
+
+	return curve ? curve->len * 4 : -ENOENT;
+}
+
+int ecdsa_verify_hash(const char *curve_name, const uint8_t *qx,
+		      const uint8_t *qy, const uint8_t *hash, int hash_len,
+		      const uint8_t *sig, int sig_len)
+{
+	uint32_t x[ECC_MAX_WORDS], y[ECC_MAX_WORDS];
+	uint32_t r[ECC_MAX_WORDS], s[ECC_MAX_WORDS];
+	uint32_t e[ECC_MAX_WORDS], w[ECC_MAX_WORDS];
+	uint32_t u1[ECC_MAX_WORDS], u2[ECC_MAX_WORDS];
+	uint8_t ebuf[ECDSA_MAX_BYTES];
+	struct ecc_point g, q, gq, acc;
+	const struct ecc_curve *curve;
+	struct ecc_mont f, n;
+	uint len, nbytes;
+	int bit;
+
+	curve = ecc_find_curve(curve_name);
+	if (!curve) {
+		debug("%s: Unsupported curve '%s'\n", __func__, curve_name);
+		return -ENOENT;
+	}
+	len = curve->len;
+	nbytes = len * 4;
+	if (sig_len != 2 * nbytes) {
+		debug("%s: Signature is of incorrect length %d\n", __func__,
+		      sig_len);
+		return -EINVAL;
+	}
+
+	mont_init(&f, curve->p, len);
+	mont_init(&n, curve->n, len);
+
+	bn_from_bytes(x, qx, len);
+	bn_from_bytes(y, qy, len);
+	if (!ecc_point_on_curve(curve, x, y, &f)) {
+		debug("%s: Public key is not on curve %s\n", __func__,
+		      curve->name);
+		return -EINVAL;
+	}
+
+	/* 0 < r, s < n */
+	bn_from_bytes(r, sig, len);
+	bn_from_bytes(s, sig + nbytes, len);
+	if (bn_is_zero(r, len) || bn_cmp(r, curve->n, len) >= 0 ||
+	    bn_is_zero(s, len) || bn_cmp(s, curve->n, len) >= 0)
+		return -EACCES;
+
+	/* e is the leftmost bits of the hash, reduced once modulo n */
+	memset(ebuf, '\0', nbytes);
+	if (hash_len >= nbytes)
+		memcpy(ebuf, hash, nbytes);
+	else
+		memcpy(ebuf + nbytes - hash_len, hash, hash_len);
+	bn_from_bytes(e, ebuf, len);
+	if (bn_cmp(e, curve->n, len) >= 0)
+		bn_sub(e, e, curve->n, len);
+
+	/* w = s^-1, u1 = e * w, u2 = r * w (all mod n) */
+	mont_to(w, s, &n);
+	mont_inv(w, w, &n);
+	mont_mul(u1, e, w, &n);
+	mont_mul(u2, r, w, &n);
+
+	/* acc = u1 * G + u2 * Q, using Shamir's trick */
+	ecc_point_load(&g, curve->gx, curve->gy, &f);
+	ecc_point_load(&q, x, y, &f);
+	ecc_point_add(&gq, &g, &q, &f);
+	bn_zero(acc.z, len);
+	for (bit = len * 32 - 1; bit >= 0; bit--) {
+		bool b1 = bn_test_bit(u1, bit), b2 = bn_test_bit(u2, bit);
+
+		ecc_point_double(&acc, &acc, &f);
+		if (b1 && b2)
+			ecc_point_add(&acc, &acc, &gq, &f);
+		else if (b1)
+			ecc_point_add(&acc, &acc, &g, &f);
+		else if (b2)
+			ecc_point_add(&acc, &acc, &q, &f);
+	}
+	if (bn_is_zero(acc.z, len))
+		return -EACCES;
+
+	/* x = X / Z^2, then compare x mod n against r */
+	mont_inv(w, acc.z, &f);
+	mont_mul(w, w, w, &f);
+	mont_mul(x, acc.x, w, &f);
+	mont_from(x, x, &f);
+	if (bn_cmp(x, curve->n, len) >= 0)
+		bn_sub(x, x, curve->n, len);
+
+	return bn_cmp(x, r, len) ? -EACCES : 0;
+}
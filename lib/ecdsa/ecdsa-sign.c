@@ -0,0 +1,401 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * ECDSA signing of FIT images, using OpenSSL
+ */
+
+#include "mkimage.h"
+#include <stdio.h>
+#include <string.h>
+#include <image.h>
+#include <openssl/bn.h>
+#include <openssl/ec.h>
+#include <openssl/ecdsa.h>
+#include <openssl/pem.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <u-boot/ecdsa.h>
+
+#if OPENSSL_VERSION_NUMBER < 0x10100000L || \
+	(defined(LIBRESSL_VERSION_NUMBER) && LIBRESSL_VERSION_NUMBER < 0x02070000fL)
+static void ECDSA_SIG_get0(const ECDSA_SIG *sig, const BIGNUM **pr,
+			   const BIGNUM **ps)
+{
+	if (pr != NULL)
+		*pr = sig->r;
+	if (ps != NULL)
+		*ps = sig->s;
+}
+#endif
+
+static int ecdsa_err(const char *msg)
+{
+	unsigned long sslErr = ERR_get_error();
+
+	fprintf(stderr, "%s", msg);
+	fprintf(stderr, ": %s\n",
+		ERR_error_string(sslErr, 0));
+
+	return -1;
+}
+
+/**
+ * ecdsa_check_curve() - check that a key matches the selected algorithm
+ *
+ * @info:	Specifies key and FIT information
+ * @ec:		Key to check
+ * @curvep:	Returns the short name of the key's curve
+ * @return 0 if ok, -ve on error
+ */
+static int ecdsa_check_curve(struct image_sign_info *info, const EC_KEY *ec,
+			     const char **curvep)
+{
+	const EC_GROUP *group = EC_KEY_get0_group(ec);
+	const char *curve;
+
+	if (!group)
+		return -EINVAL;
+	curve = OBJ_nid2sn(EC_GROUP_get_curve_name(group));
+	if (!curve || ecdsa_curve_bytes(curve) != info->crypto->key_len) {
+		fprintf(stderr, "Key '%s' uses curve %s, not suitable for %s\n",
+			info->keyname, curve ? curve : "(unknown)",
+			info->crypto->name);
+		return -EINVAL;
+	}
+	*curvep = curve;
+
+	return 0;
+}
+
+/**
+ * ecdsa_pem_get_pub_key() - read a public key from a .crt file
+ *
+ * @keydir:	Directory containing the key
+ * @name	Name of key file (will have a .crt extension)
+ * @ecp		Returns EC_KEY object, or NULL on failure
+ * @return 0 if ok, -ve on error (in which case *ecp will be set to NULL)
+ */
+static int ecdsa_pem_get_pub_key(const char *keydir, const char *name,
+				 EC_KEY **ecp)
+{
+	char path[1024];
+	EVP_PKEY *key;
+	X509 *cert;
+	EC_KEY *ec;
+	FILE *f;
+	int ret;
+
+	*ecp = NULL;
+	snprintf(path, sizeof(path), "%s/%s.crt", keydir, name);
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Couldn't open ECDSA certificate: '%s': %s\n",
+			path, strerror(errno));
+		return -EACCES;
+	}
+
+	cert = NULL;
+	if (!PEM_read_X509(f, &cert, NULL, NULL)) {
+		ecdsa_err("Couldn't read certificate");
+		ret = -EINVAL;
+		goto err_cert;
+	}
+
+	key = X509_get_pubkey(cert);
+	if (!key) {
+		ecdsa_err("Couldn't read public key\n");
+		ret = -EINVAL;
+		goto err_pubkey;
+	}
+
+	ec = EVP_PKEY_get1_EC_KEY(key);
+	if (!ec) {
+		ecdsa_err("Couldn't convert to an EC style key");
+		ret = -EINVAL;
+		goto err_ec;
+	}
+	fclose(f);
+	EVP_PKEY_free(key);
+	X509_free(cert);
+	*ecp = ec;
+
+	return 0;
+
+err_ec:
+	EVP_PKEY_free(key);
+err_pubkey:
+	X509_free(cert);
+err_cert:
+	fclose(f);
+	return ret;
+}
+
+/**
+ * ecdsa_pem_get_priv_key() - read a private key from a .key file
+ *
+ * @keydir:	Directory containing the key
+ * @name	Name of key file (will have a .key extension)
+ * @ecp		Returns EC_KEY object, or NULL on failure
+ * @return 0 if ok, -ve on error (in which case *ecp will be set to NULL)
+ */
+static int ecdsa_pem_get_priv_key(const char *keydir, const char *name,
+				  EC_KEY **ecp)
+{
+	char path[1024];
+	EC_KEY *ec;
+	FILE *f;
+
+	*ecp = NULL;
+	snprintf(path, sizeof(path), "%s/%s.key", keydir, name);
+	f = fopen(path, "r");
+	if (!f) {
+		fprintf(stderr, "Couldn't open ECDSA private key: '%s': %s\n",
+			path, strerror(errno));
+		return -ENOENT;
+	}
+
+	ec = PEM_read_ECPrivateKey(f, 0, NULL, path);
+	if (!ec) {
+		ecdsa_err("Failure reading private key");
+		fclose(f);
+		return -EPROTO;
+	}
+	fclose(f);
+	*ecp = ec;
+
+	return 0;
+}
+
+/**
+ * ecdsa_bn_to_bytes() - write a bignum as a fixed-size big endian value
+ */
+static int ecdsa_bn_to_bytes(const BIGNUM *num, uint8_t *buf, int len)
+{
+	int bytes = BN_num_bytes(num);
+
+	if (bytes > len)
+		return -EINVAL;
+	memset(buf, '\0', len - bytes);
+	BN_bn2bin(num, buf + len - bytes);
+
+	return 0;
+}
+
+static int ecdsa_sign_with_key(EC_KEY *ec, struct checksum_algo *checksum_algo,
+			       int key_len, const struct image_region region[],
+			       int region_count, uint8_t **sigp, uint *sig_size)
+{
+	const unsigned char *der_ptr;
+	const BIGNUM *r, *s;
+	EVP_MD_CTX *context;
+	uint8_t *der, *sig;
+	ECDSA_SIG *ecsig;
+	EVP_PKEY *key;
+	size_t size;
+	int ret = 0;
+	int i;
+
+	key = EVP_PKEY_new();
+	if (!key)
+		return ecdsa_err("EVP_PKEY object creation failed");
+
+	if (!EVP_PKEY_set1_EC_KEY(key, ec)) {
+		ret = ecdsa_err("EVP key setup failed");
+		goto err_set;
+	}
+
+	size = EVP_PKEY_size(key);
+	der = malloc(size);
+	sig = malloc(key_len * 2);
+	if (!der || !sig) {
+		fprintf(stderr, "Out of memory for signature (%zu bytes)\n",
+			size);
+		ret = -ENOMEM;
+		goto err_alloc;
+	}
+
+	context = EVP_MD_CTX_create();
+	if (!context) {
+		ret = ecdsa_err("EVP context creation failed");
+		goto err_alloc;
+	}
+	EVP_MD_CTX_init(context);
+
+	if (EVP_DigestSignInit(context, NULL, checksum_algo->calculate_sign(),
+			       NULL, key) <= 0) {
+		ret = ecdsa_err("Signer setup failed");
+		goto err_sign;
+	}
+
+	for (i = 0; i < region_count; i++) {
+		if (!EVP_DigestSignUpdate(context, region[i].data,
+					  region[i].size)) {
+			ret = ecdsa_err("Signing data failed");
+			goto err_sign;
+		}
+	}
+
+	if (!EVP_DigestSignFinal(context, der, &size)) {
+		ret = ecdsa_err("Could not obtain signature");
+		goto err_sign;
+	}
+
+	/* Convert from DER to the raw r || s form used in the FIT */
+	der_ptr = der;
+	ecsig = d2i_ECDSA_SIG(NULL, &der_ptr, size);
+	if (!ecsig) {
+		ret = ecdsa_err("Could not decode signature");
+		goto err_sign;
+	}
+	ECDSA_SIG_get0(ecsig, &r, &s);
+	ret = ecdsa_bn_to_bytes(r, sig, key_len);
+	if (!ret)
+		ret = ecdsa_bn_to_bytes(s, sig + key_len, key_len);
+	ECDSA_SIG_free(ecsig);
+	if (ret) {
+		fprintf(stderr, "Signature value too large\n");
+		goto err_sign;
+	}
+
+	EVP_MD_CTX_destroy(context);
+	EVP_PKEY_free(key);
+	free(der);
+
+	*sigp = sig;
+	*sig_size = key_len * 2;
+	debug("Got signature: %d bytes\n", *sig_size);
+
+	return 0;
+
+err_sign:
+	EVP_MD_CTX_destroy(context);
+err_alloc:
+	free(sig);
+	free(der);
+err_set:
+	EVP_PKEY_free(key);
+	return ret;
+}
+
+int ecdsa_sign(struct image_sign_info *info,
+	       const struct image_region region[], int region_count,
+	       uint8_t **sigp, uint *sig_len)
+{
+	const char *curve;
+	EC_KEY *ec;
+	int ret;
+
+	if (info->engine_id) {
+		fprintf(stderr, "Engines are not supported for ECDSA keys\n");
+		return -ENOTSUP;
+	}
+
+	ret = ecdsa_pem_get_priv_key(info->keydir, info->keyname, &ec);
+	if (ret)
+		return ret;
+	ret = ecdsa_check_curve(info, ec, &curve);
+	if (!ret)
+		ret = ecdsa_sign_with_key(ec, info->checksum,
+					  info->crypto->key_len, region,
+					  region_count, sigp, sig_len);
+	EC_KEY_free(ec);
+
+	return ret;
+}
+
+int ecdsa_add_verify_data(struct image_sign_info *info, void *keydest)
+{
+	uint8_t x[ECDSA_MAX_BYTES], y[ECDSA_MAX_BYTES];
+	int key_len = info->crypto->key_len;
+	BIGNUM *bn_x = NULL, *bn_y = NULL;
+	const EC_POINT *point;
+	int parent, node;
+	const char *curve;
+	char name[100];
+	EC_KEY *ec;
+	int ret;
+
+	debug("%s: Getting verification data\n", __func__);
+	if (info->engine_id) {
+		fprintf(stderr, "Engines are not supported for ECDSA keys\n");
+		return -ENOTSUP;
+	}
+	ret = ecdsa_pem_get_pub_key(info->keydir, info->keyname, &ec);
+	if (ret)
+		return ret;
+	ret = ecdsa_check_curve(info, ec, &curve);
+	if (ret)
+		goto err_get_params;
+
+	bn_x = BN_new();
+	bn_y = BN_new();
+	point = EC_KEY_get0_public_key(ec);
+	if (!bn_x || !bn_y || !point ||
+	    !EC_POINT_get_affine_coordinates_GFp(EC_KEY_get0_group(ec), point,
+						 bn_x, bn_y, NULL) ||
+	    ecdsa_bn_to_bytes(bn_x, x, key_len) ||
+	    ecdsa_bn_to_bytes(bn_y, y, key_len)) {
+		ret = ecdsa_err("Couldn't get public key coordinates");
+		goto err_get_params;
+	}
+
+	parent = fdt_subnode_offset(keydest, 0, FIT_SIG_NODENAME);
+	if (parent == -FDT_ERR_NOTFOUND) {
+		parent = fdt_add_subnode(keydest, 0, FIT_SIG_NODENAME);
+		if (parent < 0) {
+			ret = parent;
+			if (ret != -FDT_ERR_NOSPACE) {
+				fprintf(stderr, "Couldn't create signature node: %s\n",
+					fdt_strerror(parent));
+			}
+		}
+	}
+	if (ret)
+		goto done;
+
+	/* Either create or overwrite the named key node */
+	snprintf(name, sizeof(name), "key-%s", info->keyname);
+	node = fdt_subnode_offset(keydest, parent, name);
+	if (node == -FDT_ERR_NOTFOUND) {
+		node = fdt_add_subnode(keydest, parent, name);
+		if (node < 0) {
+			ret = node;
+			if (ret != -FDT_ERR_NOSPACE) {
+				fprintf(stderr, "Could not create key subnode: %s\n",
+					fdt_strerror(node));
+			}
+		}
+	} else if (node < 0) {
+		fprintf(stderr, "Cannot select keys parent: %s\n",
+			fdt_strerror(node));
+		ret = node;
+	}
+
+	if (!ret) {
+		ret = fdt_setprop_string(keydest, node, "key-name-hint",
+					 info->keyname);
+	}
+	if (!ret)
+		ret = fdt_setprop_string(keydest, node, "ecdsa,curve", curve);
+	if (!ret)
+		ret = fdt_setprop(keydest, node, "ecdsa,x-point", x, key_len);
+	if (!ret)
+		ret = fdt_setprop(keydest, node, "ecdsa,y-point", y, key_len);
+	if (!ret) {
+		ret = fdt_setprop_string(keydest, node, FIT_ALGO_PROP,
+					 info->name);
+	}
+	if (!ret && info->require_keys) {
+		ret = fdt_setprop_string(keydest, node, "required",
+					 info->require_keys);
+	}
+done:
+	if (ret)
+		ret = ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+err_get_params:
+	BN_free(bn_x);
+	BN_free(bn_y);
+	EC_KEY_free(ec);
+
+	return ret;
+}
@@ -11,6 +11,7 @@
 #include <errno.h>
 #include <fdtdec.h>
 #include <fdt_support.h>
+#include <malloc.h>
 #include <mapmem.h>
 #include <linux/libfdt.h>
 #include <serial.h>
@@ -398,7 +399,7 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 	int i, j;
 
 	/* find the alias node if present */
-	alias_node = fdt_path_offset(blob, "/aliases");
+	alias_node = fdtdec_path_offset(blob, "/aliases");
 
 	/*
 	 * start with nothing, and we can assume that the root node can't
@@ -429,7 +430,7 @@ int fdtdec_add_aliases_for_id(const void *blob, const char *name,
 		prop = fdt_get_property_by_offset(blob, offset, NULL);
 		path = fdt_string(blob, fdt32_to_cpu(prop->nameoff));
 		if (prop->len && 0 == strncmp(path, name, name_len))
-			node = fdt_path_offset(blob, prop->data);
+			node = fdtdec_path_offset(blob, prop->data);
 		if (node <= 0)
 			continue;
 
@@ -512,7 +513,7 @@ int fdtdec_get_alias_seq(const void *blob, const char *base, int offset,
 	find_name = fdt_get_name(blob, offset, &find_namelen);
 	debug("Looking for '%s' at %d, name %s\n", base, offset, find_name);
 
-	aliases = fdt_path_offset(blob, "/aliases");
+	aliases = fdtdec_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
@@ -551,7 +552,7 @@ int fdtdec_get_alias_highest_id(const void *blob, const char *base)
 
 	debug("Looking for highest alias id for '%s'\n", base);
 
-	aliases = fdt_path_offset(blob, "/aliases");
+	aliases = fdtdec_path_offset(blob, "/aliases");
 	for (prop_offset = fdt_first_property_offset(blob, aliases);
 	     prop_offset > 0;
 	     prop_offset = fdt_next_property_offset(blob, prop_offset)) {
@@ -581,7 +582,7 @@ const char *fdtdec_get_chosen_prop(const void *blob, const char *name)
 
 	if (!blob)
 		return NULL;
-	chosen_node = fdt_path_offset(blob, "/chosen");
+	chosen_node = fdtdec_path_offset(blob, "/chosen");
 	return fdt_getprop(blob, chosen_node, name, NULL);
 }
 
@@ -592,7 +593,7 @@ int fdtdec_get_chosen_node(const void *blob, const char *name)
 	prop = fdtdec_get_chosen_prop(blob, name);
 	if (!prop)
 		return -FDT_ERR_NOTFOUND;
-	return fdt_path_offset(blob, prop);
+	return fdtdec_path_offset(blob, prop);
 }
 
 int fdtdec_check_fdt(void)
@@ -633,6 +634,181 @@ int fdtdec_prepare_fdt(void)
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LOOKUP_CACHE)
+enum {
+	FDT_PATH_MEMO_COUNT	= 8,
+	FDT_PATH_MEMO_LEN	= 32,
+};
+
+/**
+ * struct fdtdec_cache - Speeds up lookups in the control FDT
+ *
+ * @blob: FDT this cache is for
+ * @struct_size: Size of the FDT structure block when the cache was set up.
+ *	Adding or removing nodes or properties changes this, which tells us
+ *	that node offsets may have moved
+ * @phandles_done: true if @phandle_offset has been set up
+ * @max_phandle: Largest phandle in @phandle_offset
+ * @phandle_offset: Offset of the node with each phandle, or -1 if none. This
+ *	is NULL if the phandles are too sparse for a table to be worthwhile
+ * @path_next: Next entry in @path to replace
+ * @path: Recently looked-up paths and the resulting node offset
+ */
+struct fdtdec_cache {
+	const void *blob;
+	int struct_size;
+	bool phandles_done;
+	uint max_phandle;
+	int *phandle_offset;
+	int path_next;
+	struct {
+		char path[FDT_PATH_MEMO_LEN];
+		int offset;
+	} path[FDT_PATH_MEMO_COUNT];
+};
+
+static struct fdtdec_cache *fdtdec_cache_get(const void *blob)
+{
+	struct fdtdec_cache *cache = gd->fdt_cache;
+
+	if (!blob || blob != gd->fdt_blob)
+		return NULL;
+	if (!cache) {
+		cache = calloc(1, sizeof(*cache));
+		if (!cache)
+			return NULL;
+		gd->fdt_cache = cache;
+	}
+	if (cache->blob != blob ||
+	    cache->struct_size != fdt_size_dt_struct(blob)) {
+		free(cache->phandle_offset);
+		memset(cache, '\0', sizeof(*cache));
+		cache->blob = blob;
+		cache->struct_size = fdt_size_dt_struct(blob);
+	}
+
+	return cache;
+}
+
+static void fdtdec_cache_phandles(struct fdtdec_cache *cache)
+{
+	const void *blob = cache->blob;
+	uint phandle, max = 0;
+	int count = 0;
+	int offset;
+
+	cache->phandles_done = true;
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle) {
+			max = max(max, phandle);
+			count++;
+		}
+	}
+
+	/* dtc allocates phandles in sequence, so they are normally dense */
+	if (!count || max > count * 4 + 64)
+		return;
+	cache->phandle_offset = malloc((max + 1) * sizeof(int));
+	if (!cache->phandle_offset)
+		return;
+	memset(cache->phandle_offset, 0xff, (max + 1) * sizeof(int));
+	cache->max_phandle = max;
+
+	/* fdt_node_offset_by_phandle() finds the first node with a phandle */
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (phandle && cache->phandle_offset[phandle] < 0)
+			cache->phandle_offset[phandle] = offset;
+	}
+}
+
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	int offset;
+
+	if (cache && !cache->phandles_done)
+		fdtdec_cache_phandles(cache);
+	if (cache && cache->phandle_offset && phandle &&
+	    phandle <= cache->max_phandle) {
+		offset = cache->phandle_offset[phandle];
+
+		/* Check the node, in case a property was changed in place */
+		if (offset >= 0 && fdt_get_phandle(blob, offset) == phandle)
+			return offset;
+	}
+
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+/**
+ * fdtdec_path_memo_ok() - Check that a node matches the end of a path
+ *
+ * Only exact matches are remembered, so this fails for a path which omits a
+ * unit address, as well as for an offset which no longer points to the node.
+ *
+ * @blob: FDT blob
+ * @offset: Node offset, or -ve error
+ * @path: Full path of the node
+ * @return true if @offset is a node whose name is the last part of @path
+ */
+static bool fdtdec_path_memo_ok(const void *blob, int offset,
+				const char *path)
+{
+	const char *name;
+
+	if (offset < 0)
+		return false;
+	name = fdt_get_name(blob, offset, NULL);
+
+	return name && !strcmp(name, strrchr(path, '/') + 1);
+}
+
+int fdtdec_path_offset(const void *blob, const char *path)
+{
+	struct fdtdec_cache *cache = fdtdec_cache_get(blob);
+	int offset;
+	int i;
+
+	if (!cache || *path != '/' || strlen(path) >= FDT_PATH_MEMO_LEN)
+		return fdt_path_offset(blob, path);
+	for (i = 0; i < FDT_PATH_MEMO_COUNT; i++) {
+		if (strcmp(cache->path[i].path, path))
+			continue;
+
+		/* Check the node, in case it was renamed in place */
+		offset = cache->path[i].offset;
+		if (fdtdec_path_memo_ok(blob, offset, path))
+			return offset;
+		cache->path[i].path[0] = '\0';
+		break;
+	}
+
+	offset = fdt_path_offset(blob, path);
+	if (!fdtdec_path_memo_ok(blob, offset, path))
+		return offset;
+	i = cache->path_next;
+	strcpy(cache->path[i].path, path);
+	cache->path[i].offset = offset;
+	cache->path_next = (i + 1) % FDT_PATH_MEMO_COUNT;
+
+	return offset;
+}
+#else
+int fdtdec_node_offset_by_phandle(const void *blob, uint32_t phandle)
+{
+	return fdt_node_offset_by_phandle(blob, phandle);
+}
+
+int fdtdec_path_offset(const void *blob, const char *path)
+{
+	return fdt_path_offset(blob, path);
+}
+#endif
+
 int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 {
 	const u32 *phandle;
@@ -643,7 +819,7 @@ int fdtdec_lookup_phandle(const void *blob, int node, const char *prop_name)
 	if (!phandle)
 		return -FDT_ERR_NOTFOUND;
 
-	lookup = fdt_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
+	lookup = fdtdec_node_offset_by_phandle(blob, fdt32_to_cpu(*phandle));
 	return lookup;
 }
 
@@ -774,8 +950,8 @@ int fdtdec_parse_phandle_with_args(const void *blob, int src_node,
 			 * below.
 			 */
 			if (cells_name || cur_index == index) {
-				node = fdt_node_offset_by_phandle(blob,
-								  phandle);
+				node = fdtdec_node_offset_by_phandle(blob,
+								     phandle);
 				if (!node) {
 					debug("%s: could not find phandle\n",
 					      fdt_get_name(blob, src_node,
@@ -900,7 +1076,7 @@ int fdtdec_get_config_int(const void *blob, const char *prop_name,
 	int config_node;
 
 	debug("%s: %s\n", __func__, prop_name);
-	config_node = fdt_path_offset(blob, "/config");
+	config_node = fdtdec_path_offset(blob, "/config");
 	if (config_node < 0)
 		return default_val;
 	return fdtdec_get_int(blob, config_node, prop_name, default_val);
@@ -912,7 +1088,7 @@ int fdtdec_get_config_bool(const void *blob, const char *prop_name)
 	const void *prop;
 
 	debug("%s: %s\n", __func__, prop_name);
-	config_node = fdt_path_offset(blob, "/config");
+	config_node = fdtdec_path_offset(blob, "/config");
 	if (config_node < 0)
 		return 0;
 	prop = fdt_get_property(blob, config_node, prop_name, NULL);
@@ -927,7 +1103,7 @@ char *fdtdec_get_config_string(const void *blob, const char *prop_name)
 	int len;
 
 	debug("%s: %s\n", __func__, prop_name);
-	nodeoffset = fdt_path_offset(blob, "/config");
+	nodeoffset = fdtdec_path_offset(blob, "/config");
 	if (nodeoffset < 0)
 		return NULL;
 
@@ -1093,7 +1269,7 @@ int fdtdec_setup_mem_size_base(void)
 	int ret, mem;
 	struct fdt_resource res;
 
-	mem = fdt_path_offset(gd->fdt_blob, "/memory");
+	mem = fdtdec_path_offset(gd->fdt_blob, "/memory");
 	if (mem < 0) {
 		debug("%s: Missing /memory node\n", __func__);
 		return -EINVAL;
@@ -1355,7 +1531,7 @@ int fdtdec_decode_ram_size(const void *blob, const char *area, int board_id,
 	debug("%s: board_id=%d\n", __func__, board_id);
 	if (!area)
 		area = "/memory";
-	node = fdt_path_offset(blob, area);
+	node = fdtdec_path_offset(blob, area);
 	if (node < 0) {
 		debug("No %s node found\n", area);
 		return -ENOENT;
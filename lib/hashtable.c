@@ -43,6 +43,9 @@
 #define USED_FREE 0
 #define USED_DELETED -1
 
+/* Grow the table when it is fuller than this (percent), to keep probes short */
+#define HTAB_MAX_LOAD	75
+
 #include <env_callback.h>
 #include <env_flags.h>
 #include <search.h>
@@ -68,6 +71,54 @@ typedef struct _ENTRY {
 static void _hdelete(const char *key, struct hsearch_data *htab, ENTRY *ep,
 	int idx);
 
+/*
+ * Callbacks may set other variables. Stop the table moving while they run,
+ * since the caller still refers to entries by index.
+ */
+static int hchange_ok(struct hsearch_data *htab, const ENTRY *ep,
+		      const char *newval, enum env_op op, int flag)
+{
+	int ret;
+
+	if (!htab->change_ok)
+		return 0;
+	htab->busy++;
+	ret = htab->change_ok(ep, newval, op, flag);
+	htab->busy--;
+
+	return ret;
+}
+
+static int hcallback(struct hsearch_data *htab, const ENTRY *ep,
+		     const char *newval, enum env_op op, int flag)
+{
+	int ret;
+
+	if (!ep->callback)
+		return 0;
+	htab->busy++;
+	ret = ep->callback(ep->key, newval, op, flag);
+	htab->busy--;
+
+	return ret;
+}
+
+/*
+ * FNV-1a hash. Unlike a simple shift-and-add, this spreads keys which differ
+ * only slightly, such as "eth1addr" and "eth2addr", across the whole table.
+ */
+static unsigned int hhash(const char *key)
+{
+	unsigned int hval = 2166136261U;
+
+	while (*key) {
+		hval ^= (unsigned char)*key++;
+		hval *= 16777619;
+	}
+
+	return hval;
+}
+
 /*
  * hcreate()
  */
@@ -163,6 +214,64 @@ void hdestroy_r(struct hsearch_data *htab)
 	htab->table = NULL;
 }
 
+/*
+ * First hash function: simply take the modulus but prevent zero.
+ */
+static unsigned int hfirst(const struct hsearch_data *htab, const char *key)
+{
+	unsigned int hval = hhash(key) % htab->size;
+
+	return hval ? hval : 1;
+}
+
+/*
+ * Second hash function, as suggested in [Knuth]: step back from idx by an
+ * amount depending on the first index tried. Because SIZE is prime this
+ * guarantees to step through all available indices.
+ */
+static unsigned int hnext(const struct hsearch_data *htab, unsigned int hval,
+			  unsigned int idx)
+{
+	unsigned int hval2 = 1 + hval % (htab->size - 2);
+
+	if (idx <= hval2)
+		return htab->size + idx - hval2;
+
+	return idx - hval2;
+}
+
+/*
+ * Move the entries to a new table with room for at least nel entries.
+ * Deleted slots are not copied, which also shortens later searches.
+ * Returns 1 on success, 0 if there is not enough memory.
+ */
+static int hresize_r(size_t nel, struct hsearch_data *htab)
+{
+	struct hsearch_data new = { .table = NULL };
+	unsigned int i, hval, idx;
+
+	if (hcreate_r(nel, &new) == 0)
+		return 0;
+
+	for (i = 1; i <= htab->size; ++i) {
+		if (htab->table[i].used <= 0)
+			continue;
+		hval = hfirst(&new, htab->table[i].entry.key);
+		for (idx = hval; new.table[idx].used != USED_FREE;)
+			idx = hnext(&new, hval, idx);
+		new.table[idx].used = hval;
+		new.table[idx].entry = htab->table[i].entry;
+	}
+	debug("hresize: %u -> %u slots for %u entries\n", htab->size,
+	      new.size, htab->filled);
+	free(htab->table);
+	htab->table = new.table;
+	htab->size = new.size;
+	htab->resizes++;
+
+	return 1;
+}
+
 /*
  * hsearch()
  */
@@ -170,9 +279,9 @@ void hdestroy_r(struct hsearch_data *htab)
 /*
  * This is the search function. It uses double hashing with open addressing.
  * The argument item.key has to be a pointer to an zero terminated, most
- * probably strings of chars. The function for generating a number of the
- * strings is simple but fast. It can be replaced by a more complex function
- * like ajw (see [Aho,Sethi,Ullman]) if the needs are shown.
+ * probably strings of chars. The strings are hashed with FNV-1a, and the
+ * table is grown when it is more than HTAB_MAX_LOAD percent full, so that
+ * searches rarely need to look at more than one or two slots.
  *
  * We use an trick to speed up the lookup. The table is created by hcreate
  * with one more element available. This enables us to use the index zero
@@ -233,9 +342,8 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 		/* Overwrite existing value? */
 		if ((action == ENTER) && (item.data != NULL)) {
 			/* check for permission */
-			if (htab->change_ok != NULL && htab->change_ok(
-			    &htab->table[idx].entry, item.data,
-			    env_op_overwrite, flag)) {
+			if (hchange_ok(htab, &htab->table[idx].entry,
+				       item.data, env_op_overwrite, flag)) {
 				debug("change_ok() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EPERM);
@@ -244,9 +352,8 @@ static inline int _compare_and_overwrite_entry(ENTRY item, ACTION action,
 			}
 
 			/* If there is a callback, call it */
-			if (htab->table[idx].entry.callback &&
-			    htab->table[idx].entry.callback(item.key,
-			    item.data, env_op_overwrite, flag)) {
+			if (hcallback(htab, &htab->table[idx].entry,
+				      item.data, env_op_overwrite, flag)) {
 				debug("callback() rejected setting variable "
 					"%s, skipping it!\n", item.key);
 				__set_errno(EINVAL);
@@ -274,38 +381,21 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	      struct hsearch_data *htab, int flag)
 {
 	unsigned int hval;
-	unsigned int count;
-	unsigned int len = strlen(item.key);
+	unsigned int probes = 1;
 	unsigned int idx;
 	unsigned int first_deleted = 0;
 	int ret;
 
-	/* Compute an value for the given string. Perhaps use a better method. */
-	hval = len;
-	count = len;
-	while (count-- > 0) {
-		hval <<= 4;
-		hval += item.key[count];
-	}
-
-	/*
-	 * First hash function:
-	 * simply take the modul but prevent zero.
-	 */
-	hval %= htab->size;
-	if (hval == 0)
-		++hval;
-
 	/* The first index tried. */
+	hval = hfirst(htab, item.key);
 	idx = hval;
+	htab->searches++;
 
 	if (htab->table[idx].used) {
 		/*
 		 * Further action might be required according to the
 		 * action value.
 		 */
-		unsigned hval2;
-
 		if (htab->table[idx].used == USED_DELETED
 		    && !first_deleted)
 			first_deleted = idx;
@@ -313,23 +403,10 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		ret = _compare_and_overwrite_entry(item, action, retval, htab,
 			flag, hval, idx);
 		if (ret != -1)
-			return ret;
-
-		/*
-		 * Second hash function:
-		 * as suggested in [Knuth]
-		 */
-		hval2 = 1 + hval % (htab->size - 2);
+			goto done;
 
 		do {
-			/*
-			 * Because SIZE is prime this guarantees to
-			 * step through all available indices.
-			 */
-			if (idx <= hval2)
-				idx = htab->size + idx - hval2;
-			else
-				idx -= hval2;
+			idx = hnext(htab, hval, idx);
 
 			/*
 			 * If we visited all entries leave the loop
@@ -337,6 +414,7 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 			 */
 			if (idx == hval)
 				break;
+			probes++;
 
 			if (htab->table[idx].used == USED_DELETED
 			    && !first_deleted)
@@ -346,13 +424,27 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 			ret = _compare_and_overwrite_entry(item, action, retval,
 				htab, flag, hval, idx);
 			if (ret != -1)
-				return ret;
+				goto done;
 		}
 		while (htab->table[idx].used != USED_FREE);
 	}
+	htab->probes += probes;
+	if (probes > htab->max_probes)
+		htab->max_probes = probes;
 
 	/* An empty bucket has been found. */
 	if (action == ENTER) {
+		/*
+		 * Grow the table before it gets too full, unless callbacks
+		 * are running. Then search again to find the new slot.
+		 */
+		if (!htab->busy &&
+		    (htab->filled + 1) * 100 > htab->size * HTAB_MAX_LOAD &&
+		    hresize_r(htab->size * 2, htab)) {
+			htab->searches--;
+			return hsearch_r(item, action, retval, htab, flag);
+		}
+
 		/*
 		 * If table is full and another entry should be
 		 * entered return with error.
@@ -388,8 +480,8 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		env_flags_init(&htab->table[idx].entry);
 
 		/* check for permission */
-		if (htab->change_ok != NULL && htab->change_ok(
-		    &htab->table[idx].entry, item.data, env_op_create, flag)) {
+		if (hchange_ok(htab, &htab->table[idx].entry, item.data,
+			       env_op_create, flag)) {
 			debug("change_ok() rejected setting variable "
 				"%s, skipping it!\n", item.key);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
@@ -399,9 +491,8 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 		}
 
 		/* If there is a callback, call it */
-		if (htab->table[idx].entry.callback &&
-		    htab->table[idx].entry.callback(item.key, item.data,
-		    env_op_create, flag)) {
+		if (hcallback(htab, &htab->table[idx].entry, item.data,
+			      env_op_create, flag)) {
 			debug("callback() rejected setting variable "
 				"%s, skipping it!\n", item.key);
 			_hdelete(item.key, htab, &htab->table[idx].entry, idx);
@@ -418,6 +509,13 @@ int hsearch_r(ENTRY item, ACTION action, ENTRY ** retval,
 	__set_errno(ESRCH);
 	*retval = NULL;
 	return 0;
+
+done:
+	htab->probes += probes;
+	if (probes > htab->max_probes)
+		htab->max_probes = probes;
+
+	return ret;
 }
 
 
@@ -461,8 +559,7 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* Check for permission */
-	if (htab->change_ok != NULL &&
-	    htab->change_ok(ep, NULL, env_op_delete, flag)) {
+	if (hchange_ok(htab, ep, NULL, env_op_delete, flag)) {
 		debug("change_ok() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EPERM);
@@ -470,8 +567,8 @@ int hdelete_r(const char *key, struct hsearch_data *htab, int flag)
 	}
 
 	/* If there is a callback, call it */
-	if (htab->table[idx].entry.callback &&
-	    htab->table[idx].entry.callback(key, NULL, env_op_delete, flag)) {
+	if (hcallback(htab, &htab->table[idx].entry, NULL, env_op_delete,
+		      flag)) {
 		debug("callback() rejected deleting variable "
 			"%s, skipping it!\n", key);
 		__set_errno(EINVAL);
@@ -979,15 +1076,17 @@ end:
 int hwalk_r(struct hsearch_data *htab, int (*callback)(ENTRY *))
 {
 	int i;
-	int retval;
+	int retval = 0;
 
+	htab->busy++;
 	for (i = 1; i <= htab->size; ++i) {
 		if (htab->table[i].used > 0) {
 			retval = callback(&htab->table[i].entry);
 			if (retval)
-				return retval;
+				break;
 		}
 	}
+	htab->busy--;
 
-	return 0;
+	return retval;
 }
@@ -1,2 +1,622 @@
+#include <common.h>
+#include <malloc.h>
 #include <linux/libfdt_env.h>
 #include "../../scripts/dtc/libfdt/fdt_overlay.c"
+
+/*
+ * U-Boot own code: apply overlays using indexes of the base tree
+ *
+ * This uses the upstream code above to relocate the phandles inside each
+ * overlay, but looks up symbols, phandles and fragment targets in the base
+ * tree using struct fdt_overlay_index instead of walking the tree each time.
+ * Every change to the base tree goes through index_setprop() or
+ * index_add_subnode(), which move the node offsets in the index along with
+ * the nodes.
+ */
+
+static int index_phandle_cmp(const void *a, const void *b)
+{
+	const struct fdt_overlay_phandle *pa = a, *pb = b;
+
+	if (pa->phandle != pb->phandle)
+		return pa->phandle < pb->phandle ? -1 : 1;
+
+	return pa->offset - pb->offset;
+}
+
+/* Find the position of @phandle in the map, or where it should go */
+static int index_find_phandle(struct fdt_overlay_index *idx, uint32_t phandle)
+{
+	int low = 0, high = idx->phandle_count;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (idx->phandles[mid].phandle < phandle)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+/* Find the position of @name in the symbol table, or where it should go */
+static int index_find_symbol(struct fdt_overlay_index *idx, const char *name)
+{
+	int low = 0, high = idx->symbol_count;
+
+	while (low < high) {
+		int mid = (low + high) / 2;
+
+		if (strcmp(idx->symbols[mid].name, name) < 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+
+	return low;
+}
+
+static int index_grow(void **arrayp, int *maxp, int count, int size)
+{
+	void *array;
+	int max;
+
+	if (count < *maxp)
+		return 0;
+	max = *maxp * 2 + 16;
+	array = realloc(*arrayp, max * size);
+	if (!array)
+		return -FDT_ERR_NOSPACE;
+	*arrayp = array;
+	*maxp = max;
+
+	return 0;
+}
+
+/* Record that @node now has @phandle, dropping any phandle it had before */
+static int index_set_phandle(struct fdt_overlay_index *idx, uint32_t phandle,
+			     int node)
+{
+	struct fdt_overlay_phandle *ph;
+	uint32_t old = 0;
+	int i, ret;
+
+	for (i = 0; i < idx->phandle_count; i++) {
+		ph = &idx->phandles[i];
+		if (ph->offset == node) {
+			old = ph->phandle;
+			memmove(ph, ph + 1,
+				(--idx->phandle_count - i) * sizeof(*ph));
+			break;
+		}
+	}
+	if (old && old != phandle) {
+		for (i = 0; i < idx->symbol_count; i++) {
+			if (idx->symbols[i].phandle == old)
+				idx->symbols[i].phandle = 0;
+		}
+	}
+
+	ret = index_grow((void **)&idx->phandles, &idx->phandle_max,
+			 idx->phandle_count, sizeof(*ph));
+	if (ret)
+		return ret;
+	i = index_find_phandle(idx, phandle);
+	ph = &idx->phandles[i];
+	memmove(ph + 1, ph, (idx->phandle_count++ - i) * sizeof(*ph));
+	ph->phandle = phandle;
+	ph->offset = node;
+	if (phandle > idx->max_phandle)
+		idx->max_phandle = phandle;
+
+	return 0;
+}
+
+/* Add or replace a symbol, which is resolved to a phandle when first used */
+static int index_set_symbol(struct fdt_overlay_index *idx, const char *name,
+			    const char *path)
+{
+	struct fdt_overlay_symbol *sym;
+	int name_len = strlen(name);
+	char *str;
+	int i, ret;
+
+	str = malloc(name_len + 1 + strlen(path) + 1);
+	if (!str)
+		return -FDT_ERR_NOSPACE;
+	strcpy(str, name);
+	strcpy(str + name_len + 1, path);
+
+	i = index_find_symbol(idx, name);
+	sym = &idx->symbols[i];
+	if (i < idx->symbol_count && !strcmp(sym->name, name)) {
+		free(sym->name);
+	} else {
+		ret = index_grow((void **)&idx->symbols, &idx->symbol_max,
+				 idx->symbol_count, sizeof(*sym));
+		if (ret) {
+			free(str);
+			return ret;
+		}
+		sym = &idx->symbols[i];
+		memmove(sym + 1, sym, (idx->symbol_count++ - i) * sizeof(*sym));
+	}
+	sym->name = str;
+	sym->path = str + name_len + 1;
+	sym->phandle = 0;
+
+	return 0;
+}
+
+/* Move the offsets of nodes after @node, which has changed size by @delta */
+static void index_shift(struct fdt_overlay_index *idx, int node, int delta)
+{
+	int i;
+
+	if (!delta)
+		return;
+	for (i = 0; i < idx->phandle_count; i++) {
+		if (idx->phandles[i].offset > node)
+			idx->phandles[i].offset += delta;
+	}
+	if (idx->symbols_node > node)
+		idx->symbols_node += delta;
+}
+
+static int index_setprop(struct fdt_overlay_index *idx, int node,
+			 const char *name, const void *val, int len)
+{
+	int size = fdt_size_dt_struct(idx->fdt);
+	int ret;
+
+	ret = fdt_setprop(idx->fdt, node, name, val, len);
+	if (ret)
+		return ret;
+	index_shift(idx, node, fdt_size_dt_struct(idx->fdt) - size);
+
+	return 0;
+}
+
+static int index_add_subnode(struct fdt_overlay_index *idx, int parent,
+			     const char *name)
+{
+	int size = fdt_size_dt_struct(idx->fdt);
+	int node;
+
+	node = fdt_add_subnode(idx->fdt, parent, name);
+	if (node < 0)
+		return node;
+	index_shift(idx, parent, fdt_size_dt_struct(idx->fdt) - size);
+
+	return node;
+}
+
+int fdt_overlay_index_init(struct fdt_overlay_index *idx, void *fdt)
+{
+	struct fdt_overlay_phandle *ph;
+	const char *path, *name;
+	int node, prop, len, i;
+	uint32_t phandle;
+	int ret;
+
+	FDT_CHECK_HEADER(fdt);
+
+	memset(idx, '\0', sizeof(*idx));
+	idx->fdt = fdt;
+
+	/* One walk of the tree finds all the phandles */
+	for (node = 0; node >= 0; node = fdt_next_node(fdt, node, NULL)) {
+		phandle = fdt_get_phandle(fdt, node);
+		if (!phandle)
+			continue;
+		ret = index_grow((void **)&idx->phandles, &idx->phandle_max,
+				 idx->phandle_count, sizeof(*ph));
+		if (ret)
+			goto err;
+		ph = &idx->phandles[idx->phandle_count++];
+		ph->phandle = phandle;
+		ph->offset = node;
+		if (phandle > idx->max_phandle)
+			idx->max_phandle = phandle;
+	}
+	if (node != -FDT_ERR_NOTFOUND) {
+		ret = node;
+		goto err;
+	}
+	qsort(idx->phandles, idx->phandle_count, sizeof(*ph),
+	      index_phandle_cmp);
+
+	/* Like fdt_node_offset_by_phandle(), use the first node if repeated */
+	for (i = 1; i < idx->phandle_count; i++) {
+		ph = &idx->phandles[i];
+		if (ph->phandle == ph[-1].phandle) {
+			memmove(ph, ph + 1,
+				(--idx->phandle_count - i) * sizeof(*ph));
+			i--;
+		}
+	}
+
+	idx->symbols_node = fdt_subnode_offset(fdt, 0, "__symbols__");
+	if (idx->symbols_node < 0) {
+		if (idx->symbols_node == -FDT_ERR_NOTFOUND)
+			return 0;
+		ret = idx->symbols_node;
+		goto err;
+	}
+	fdt_for_each_property_offset(prop, fdt, idx->symbols_node) {
+		path = fdt_getprop_by_offset(fdt, prop, &name, &len);
+		if (!path) {
+			ret = len;
+			goto err;
+		}
+		ret = index_set_symbol(idx, name, path);
+		if (ret)
+			goto err;
+	}
+
+	return 0;
+
+err:
+	fdt_overlay_index_free(idx);
+
+	return ret;
+}
+
+void fdt_overlay_index_free(struct fdt_overlay_index *idx)
+{
+	int i;
+
+	for (i = 0; i < idx->symbol_count; i++)
+		free(idx->symbols[i].name);
+	free(idx->symbols);
+	free(idx->phandles);
+	idx->symbols = NULL;
+	idx->phandles = NULL;
+	idx->symbol_count = 0;
+	idx->phandle_count = 0;
+}
+
+/* Get the offset of the node with @phandle, like fdt_node_offset_by_phandle */
+static int index_phandle_offset(struct fdt_overlay_index *idx,
+				uint32_t phandle)
+{
+	int i;
+
+	if (!phandle || phandle == (uint32_t)-1)
+		return -FDT_ERR_BADPHANDLE;
+	i = index_find_phandle(idx, phandle);
+	if (i == idx->phandle_count || idx->phandles[i].phandle != phandle)
+		return -FDT_ERR_NOTFOUND;
+
+	return idx->phandles[i].offset;
+}
+
+/* Get the phandle of the node given by a symbol in the base tree */
+static int index_symbol_phandle(struct fdt_overlay_index *idx,
+				const char *name, uint32_t *phandlep)
+{
+	struct fdt_overlay_symbol *sym;
+	int node, i;
+
+	if (idx->symbols_node < 0)
+		return idx->symbols_node;
+	i = index_find_symbol(idx, name);
+	sym = &idx->symbols[i];
+	if (i == idx->symbol_count || strcmp(sym->name, name))
+		return -FDT_ERR_NOTFOUND;
+	if (!sym->phandle) {
+		node = fdt_path_offset(idx->fdt, sym->path);
+		if (node < 0)
+			return node;
+		sym->phandle = fdt_get_phandle(idx->fdt, node);
+		if (!sym->phandle)
+			return -FDT_ERR_NOTFOUND;
+	}
+	*phandlep = sym->phandle;
+
+	return 0;
+}
+
+/* Same as overlay_get_target(), using the index for phandles */
+static int index_get_target(struct fdt_overlay_index *idx, const void *fdto,
+			    int fragment, const char **pathp)
+{
+	const char *path;
+	uint32_t phandle;
+	int len, ret;
+
+	if (pathp)
+		*pathp = NULL;
+	phandle = overlay_get_target_phandle(fdto, fragment);
+	if (phandle == (uint32_t)-1)
+		return -FDT_ERR_BADPHANDLE;
+	if (phandle)
+		return index_phandle_offset(idx, phandle);
+
+	path = fdt_getprop(fdto, fragment, "target-path", &len);
+	if (!path)
+		return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_BADOVERLAY : len;
+	ret = fdt_path_offset(idx->fdt, path);
+	if (ret >= 0 && pathp)
+		*pathp = path;
+
+	return ret;
+}
+
+/* Same as overlay_fixup_phandles(), using the symbol table */
+static int index_fixup_phandles(struct fdt_overlay_index *idx, void *fdto)
+{
+	int fixups, prop, len;
+	const char *label;
+	const char *value;
+
+	fixups = fdt_path_offset(fdto, "/__fixups__");
+	if (fixups == -FDT_ERR_NOTFOUND)
+		return 0;
+	if (fixups < 0)
+		return fixups;
+
+	fdt_for_each_property_offset(prop, fdto, fixups) {
+		uint32_t phandle;
+		int ret;
+
+		value = fdt_getprop_by_offset(fdto, prop, &label, &len);
+		if (!value)
+			return len == -FDT_ERR_NOTFOUND ? -FDT_ERR_INTERNAL :
+				len;
+		ret = index_symbol_phandle(idx, label, &phandle);
+		if (ret)
+			return ret;
+
+		/* Each entry is "<path>:<property>:<offset>" */
+		do {
+			const char *name, *sep, *end;
+			fdt32_t phandle_prop;
+			int path_len, node;
+			char *endptr;
+			ulong poffset;
+
+			end = memchr(value, '\0', len);
+			if (!end)
+				return -FDT_ERR_BADOVERLAY;
+			sep = memchr(value, ':', end - value);
+			if (!sep || sep == value || sep + 1 == end)
+				return -FDT_ERR_BADOVERLAY;
+			path_len = sep - value;
+			name = sep + 1;
+			sep = memchr(name, ':', end - name);
+			if (!sep || sep == name)
+				return -FDT_ERR_BADOVERLAY;
+			poffset = strtoul(sep + 1, &endptr, 10);
+			if (endptr != end || endptr <= sep + 1)
+				return -FDT_ERR_BADOVERLAY;
+
+			node = fdt_path_offset_namelen(fdto, value, path_len);
+			if (node == -FDT_ERR_NOTFOUND)
+				return -FDT_ERR_BADOVERLAY;
+			if (node < 0)
+				return node;
+			phandle_prop = cpu_to_fdt32(phandle);
+			ret = fdt_setprop_inplace_namelen_partial(fdto, node,
+					name, sep - name, poffset,
+					&phandle_prop, sizeof(phandle_prop));
+			if (ret)
+				return ret;
+
+			len -= end - value + 1;
+			value = end + 1;
+		} while (len > 0);
+	}
+
+	return 0;
+}
+
+/* Same as overlay_apply_node(), keeping the index up to date */
+static int index_apply_node(struct fdt_overlay_index *idx, int target,
+			    void *fdto, int node)
+{
+	int prop, subnode;
+
+	fdt_for_each_property_offset(prop, fdto, node) {
+		const char *name;
+		const void *val;
+		int len, ret;
+
+		val = fdt_getprop_by_offset(fdto, prop, &name, &len);
+		if (len == -FDT_ERR_NOTFOUND)
+			return -FDT_ERR_INTERNAL;
+		if (len < 0)
+			return len;
+
+		ret = index_setprop(idx, target, name, val, len);
+		if (ret)
+			return ret;
+		if (len == sizeof(fdt32_t) && (!strcmp(name, "phandle") ||
+					       !strcmp(name, "linux,phandle"))) {
+			ret = index_set_phandle(idx,
+					fdt32_to_cpu(*(const fdt32_t *)val),
+					target);
+			if (ret)
+				return ret;
+		}
+	}
+
+	fdt_for_each_subnode(subnode, fdto, node) {
+		const char *name = fdt_get_name(fdto, subnode, NULL);
+		int nnode, ret;
+
+		nnode = fdt_subnode_offset(idx->fdt, target, name);
+		if (nnode == -FDT_ERR_NOTFOUND)
+			nnode = index_add_subnode(idx, target, name);
+		if (nnode < 0)
+			return nnode;
+
+		ret = index_apply_node(idx, nnode, fdto, subnode);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Same as overlay_merge(), using the index to find targets */
+static int index_merge(struct fdt_overlay_index *idx, void *fdto)
+{
+	int fragment;
+
+	fdt_for_each_subnode(fragment, fdto, 0) {
+		int overlay, target, ret;
+
+		overlay = fdt_subnode_offset(fdto, fragment, "__overlay__");
+		if (overlay == -FDT_ERR_NOTFOUND)
+			continue;
+		if (overlay < 0)
+			return overlay;
+
+		target = index_get_target(idx, fdto, fragment, NULL);
+		if (target < 0)
+			return target;
+
+		ret = index_apply_node(idx, target, fdto, overlay);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Same as overlay_symbol_update(), adding the symbols to the index too */
+static int index_symbol_update(struct fdt_overlay_index *idx, void *fdto)
+{
+	const char *path, *name, *rel_path, *target_path, *s;
+	int ov_sym, prop, path_len, rel_len, fragment, target, len;
+	char *buf;
+	int ret;
+
+	ov_sym = fdt_subnode_offset(fdto, 0, "__symbols__");
+	if (ov_sym < 0)
+		return 0;
+
+	if (idx->symbols_node == -FDT_ERR_NOTFOUND)
+		idx->symbols_node = index_add_subnode(idx, 0, "__symbols__");
+	if (idx->symbols_node < 0)
+		return idx->symbols_node;
+
+	fdt_for_each_property_offset(prop, fdto, ov_sym) {
+		path = fdt_getprop_by_offset(fdto, prop, &name, &path_len);
+		if (!path)
+			return path_len;
+		if (path_len < 1 ||
+		    memchr(path, '\0', path_len) != &path[path_len - 1])
+			return -FDT_ERR_BADVALUE;
+
+		/* Format: /<fragment-name>/__overlay__/<relative-path> */
+		if (*path != '/')
+			return -FDT_ERR_BADVALUE;
+		s = strchr(path + 1, '/');
+		if (!s)
+			return -FDT_ERR_BADOVERLAY;
+		len = sizeof("/__overlay__/") - 1;
+		if (path + path_len - s < len ||
+		    memcmp(s, "/__overlay__/", len))
+			return -FDT_ERR_BADOVERLAY;
+		rel_path = s + len;
+		rel_len = path + path_len - rel_path;
+
+		fragment = fdt_subnode_offset_namelen(fdto, 0, path + 1,
+						      s - path - 1);
+		if (fragment < 0 ||
+		    fdt_subnode_offset(fdto, fragment, "__overlay__") < 0)
+			return -FDT_ERR_BADOVERLAY;
+		target = index_get_target(idx, fdto, fragment, &target_path);
+		if (target < 0)
+			return target;
+
+		len = target_path ? strlen(target_path) :
+			get_path_len(idx->fdt, target);
+		if (len < 0)
+			return len;
+		buf = malloc(len + 1 + rel_len);
+		if (!buf)
+			return -FDT_ERR_NOSPACE;
+		if (target_path) {
+			memcpy(buf, target_path, len + 1);
+		} else if (len > 1) {
+			ret = fdt_get_path(idx->fdt, target, buf, len + 1);
+			if (ret < 0) {
+				free(buf);
+				return ret;
+			}
+		}
+		/* Don't double the '/' if the target is the root */
+		if (len <= 1)
+			len = 0;
+		buf[len] = '/';
+		memcpy(buf + len + 1, rel_path, rel_len);
+
+		ret = index_setprop(idx, idx->symbols_node, name, buf,
+				    len + 1 + rel_len);
+		if (!ret)
+			ret = index_set_symbol(idx, name, buf);
+		free(buf);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+int fdt_overlay_index_resize(struct fdt_overlay_index *idx, int size)
+{
+	return fdt_open_into(idx->fdt, idx->fdt, size);
+}
+
+int fdt_overlay_apply_index(struct fdt_overlay_index *idx, void *fdto)
+{
+	uint32_t delta = idx->max_phandle;
+	int ret;
+
+	FDT_CHECK_HEADER(idx->fdt);
+	FDT_CHECK_HEADER(fdto);
+
+	ret = overlay_adjust_local_phandles(fdto, delta);
+	if (!ret)
+		ret = overlay_update_local_references(fdto, delta);
+	if (!ret)
+		ret = index_fixup_phandles(idx, fdto);
+	if (!ret)
+		ret = index_merge(idx, fdto);
+	if (!ret)
+		ret = index_symbol_update(idx, fdto);
+
+	/* As with fdt_overlay_apply(), the overlay is no longer usable */
+	fdt_set_magic(fdto, ~0);
+	if (ret)
+		fdt_set_magic(idx->fdt, ~0);
+
+	return ret;
+}
+
+int fdt_overlay_apply_batch(void *fdt, int size, void *const fdtos[],
+			    int count)
+{
+	struct fdt_overlay_index idx;
+	int ret, i;
+
+	ret = fdt_open_into(fdt, fdt, size);
+	if (ret)
+		return ret;
+	ret = fdt_overlay_index_init(&idx, fdt);
+	if (ret)
+		return ret;
+	for (i = 0; i < count; i++) {
+		ret = fdt_overlay_apply_index(&idx, fdtos[i]);
+		if (ret)
+			break;
+	}
+	fdt_overlay_index_free(&idx);
+
+	return ret;
+}
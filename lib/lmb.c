@@ -8,6 +8,7 @@
 
 #include <common.h>
 #include <lmb.h>
+#include <malloc.h>
 
 #define LMB_ALLOC_ANYWHERE	0
 
@@ -60,25 +61,72 @@ static long lmb_addrs_adjacent(phys_addr_t base1, phys_size_t size1,
 	return 0;
 }
 
-static long lmb_regions_adjacent(struct lmb_region *rgn, unsigned long r1,
-				 unsigned long r2)
+/* Check whether (base, size) lies just above (> 0) or below (< 0) region r */
+static long lmb_regions_adjacent_to(struct lmb_region *rgn, unsigned long r,
+				    phys_addr_t base, phys_size_t size)
 {
-	phys_addr_t base1 = rgn->region[r1].base;
-	phys_size_t size1 = rgn->region[r1].size;
-	phys_addr_t base2 = rgn->region[r2].base;
-	phys_size_t size2 = rgn->region[r2].size;
+	return lmb_addrs_adjacent(rgn->region[r].base, rgn->region[r].size,
+				  base, size);
+}
 
-	return lmb_addrs_adjacent(base1, size1, base2, size2);
+/*
+ * Find the first region which ends at or above @addr, i.e. the only one which
+ * may hold @addr. Returns rgn->cnt if there is none.
+ */
+static unsigned long lmb_search(struct lmb_region *rgn, phys_addr_t addr)
+{
+	unsigned long lo = 0, hi = rgn->cnt, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (rgn->region[mid].base + rgn->region[mid].size - 1 < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
 }
 
-static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+/* Make room for another region, moving to a larger array if needed */
+static long lmb_grow(struct lmb_region *rgn)
 {
-	unsigned long i;
+	struct lmb_property *region;
+	unsigned long max;
 
-	for (i = r; i < rgn->cnt - 1; i++) {
-		rgn->region[i].base = rgn->region[i + 1].base;
-		rgn->region[i].size = rgn->region[i + 1].size;
-	}
+	if (rgn->cnt < rgn->max)
+		return 0;
+	max = rgn->max * 2;
+	region = malloc(max * sizeof(*region));
+	if (!region)
+		return -1;
+	memcpy(region, rgn->region, rgn->cnt * sizeof(*region));
+	if (rgn->region != rgn->initial)
+		free(rgn->region);
+	rgn->region = region;
+	rgn->max = max;
+
+	return 0;
+}
+
+static long lmb_insert_region(struct lmb_region *rgn, unsigned long r,
+			      phys_addr_t base, phys_size_t size)
+{
+	if (lmb_grow(rgn))
+		return -1;
+	memmove(&rgn->region[r + 1], &rgn->region[r],
+		(rgn->cnt - r) * sizeof(rgn->region[0]));
+	rgn->region[r].base = base;
+	rgn->region[r].size = size;
+	rgn->cnt++;
+
+	return 0;
+}
+
+static void lmb_remove_region(struct lmb_region *rgn, unsigned long r)
+{
+	memmove(&rgn->region[r], &rgn->region[r + 1],
+		(rgn->cnt - r - 1) * sizeof(rgn->region[0]));
 	rgn->cnt--;
 }
 
@@ -90,12 +138,29 @@ static void lmb_coalesce_regions(struct lmb_region *rgn, unsigned long r1,
 	lmb_remove_region(rgn, r2);
 }
 
+static void lmb_init_region(struct lmb_region *rgn)
+{
+	rgn->cnt = 0;
+	rgn->max = MAX_LMB_REGIONS;
+	rgn->size = 0;
+	rgn->region = rgn->initial;
+}
+
 void lmb_init(struct lmb *lmb)
 {
-	lmb->memory.cnt = 0;
-	lmb->memory.size = 0;
-	lmb->reserved.cnt = 0;
-	lmb->reserved.size = 0;
+	lmb_init_region(&lmb->memory);
+	lmb_init_region(&lmb->reserved);
+	lmb->policy = LMB_ALLOC_TOP_DOWN;
+}
+
+/* Free any memory used by the regions, leaving @lmb empty */
+void lmb_release(struct lmb *lmb)
+{
+	if (lmb->memory.region != lmb->memory.initial)
+		free(lmb->memory.region);
+	if (lmb->reserved.region != lmb->reserved.initial)
+		free(lmb->reserved.region);
+	lmb_init(lmb);
 }
 
 static void lmb_reserve_common(struct lmb *lmb, void *fdt_blob)
@@ -141,71 +206,39 @@ void lmb_init_and_reserve_range(struct lmb *lmb, phys_addr_t base,
 /* This routine called with relocation disabled. */
 static long lmb_add_region(struct lmb_region *rgn, phys_addr_t base, phys_size_t size)
 {
-	unsigned long coalesced = 0;
-	long adjacent, i;
-
-	if (rgn->cnt == 0) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-		rgn->cnt = 1;
-		return 0;
-	}
-
-	/* First try and coalesce this LMB with another. */
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
+	unsigned long i;
+	long coalesced = 0;
 
-		if ((rgnbase == base) && (rgnsize == size))
+	/* Only the first region ending above base can overlap it */
+	i = lmb_search(rgn, base);
+	if (i < rgn->cnt && lmb_addrs_overlap(base, size, rgn->region[i].base,
+					      rgn->region[i].size)) {
+		if (rgn->region[i].base == base && rgn->region[i].size == size)
 			/* Already have this region, so we're done */
 			return 0;
+		/* regions overlap */
+		return -1;
+	}
 
-		adjacent = lmb_addrs_adjacent(base, size, rgnbase, rgnsize);
-		if (adjacent > 0) {
+	/* Try and coalesce this LMB with the regions either side. */
+	if (i > 0 && lmb_regions_adjacent_to(rgn, i - 1, base, size) > 0) {
+		rgn->region[i - 1].size += size;
+		coalesced++;
+	}
+	if (i < rgn->cnt && lmb_regions_adjacent_to(rgn, i, base, size) < 0) {
+		if (coalesced) {
+			lmb_coalesce_regions(rgn, i - 1, i);
+		} else {
 			rgn->region[i].base -= size;
 			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (adjacent < 0) {
-			rgn->region[i].size += size;
-			coalesced++;
-			break;
-		} else if (lmb_addrs_overlap(base, size, rgnbase, rgnsize)) {
-			/* regions overlap */
-			return -1;
 		}
-	}
-
-	if ((i < rgn->cnt - 1) && lmb_regions_adjacent(rgn, i, i + 1)) {
-		lmb_coalesce_regions(rgn, i, i + 1);
 		coalesced++;
 	}
-
 	if (coalesced)
 		return coalesced;
-	if (rgn->cnt >= MAX_LMB_REGIONS)
-		return -1;
 
 	/* Couldn't coalesce the LMB, so add it to the sorted table. */
-	for (i = rgn->cnt-1; i >= 0; i--) {
-		if (base < rgn->region[i].base) {
-			rgn->region[i + 1].base = rgn->region[i].base;
-			rgn->region[i + 1].size = rgn->region[i].size;
-		} else {
-			rgn->region[i + 1].base = base;
-			rgn->region[i + 1].size = size;
-			break;
-		}
-	}
-
-	if (base < rgn->region[0].base) {
-		rgn->region[0].base = base;
-		rgn->region[0].size = size;
-	}
-
-	rgn->cnt++;
-
-	return 0;
+	return lmb_insert_region(rgn, i, base, size);
 }
 
 /* This routine may be called with relocation disabled. */
@@ -226,16 +259,14 @@ long lmb_free(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 	rgnbegin = rgnend = 0; /* supress gcc warnings */
 
 	/* Find the region where (base, size) belongs to */
-	for (i = 0; i < rgn->cnt; i++) {
+	i = lmb_search(rgn, base);
+	if (i < rgn->cnt) {
 		rgnbegin = rgn->region[i].base;
 		rgnend = rgnbegin + rgn->region[i].size - 1;
-
-		if ((rgnbegin <= base) && (end <= rgnend))
-			break;
 	}
 
 	/* Didn't find the region */
-	if (i == rgn->cnt)
+	if (i == rgn->cnt || rgnbegin > base || end > rgnend)
 		return -1;
 
 	/* Check to see if we are removing entire region */
@@ -275,16 +306,13 @@ long lmb_reserve(struct lmb *lmb, phys_addr_t base, phys_size_t size)
 static long lmb_overlaps_region(struct lmb_region *rgn, phys_addr_t base,
 				phys_size_t size)
 {
-	unsigned long i;
+	unsigned long i = lmb_search(rgn, base);
 
-	for (i = 0; i < rgn->cnt; i++) {
-		phys_addr_t rgnbase = rgn->region[i].base;
-		phys_size_t rgnsize = rgn->region[i].size;
-		if (lmb_addrs_overlap(base, size, rgnbase, rgnsize))
-			break;
-	}
+	if (i < rgn->cnt && lmb_addrs_overlap(base, size, rgn->region[i].base,
+					      rgn->region[i].size))
+		return i;
 
-	return (i < rgn->cnt) ? i : -1;
+	return -1;
 }
 
 phys_addr_t lmb_alloc(struct lmb *lmb, phys_size_t size, ulong align)
@@ -310,45 +338,88 @@ static phys_addr_t lmb_align_down(phys_addr_t addr, phys_size_t size)
 	return addr & ~(size - 1);
 }
 
+/*
+ * Find where the allocation policy puts @size bytes in the free area from
+ * @start to @last inclusive, updating *@basep and *@wastep if this is the best
+ * place so far. Returns true if no better place can be found.
+ */
+static bool lmb_fit(struct lmb *lmb, phys_addr_t start, phys_addr_t last,
+		    phys_size_t size, ulong align, phys_addr_t *basep,
+		    phys_size_t *wastep)
+{
+	phys_addr_t base;
+	phys_size_t waste;
+
+	if (last - start < size - 1)
+		return false;
+	waste = last - start - (size - 1);
+
+	if (lmb->policy == LMB_ALLOC_BOTTOM_UP) {
+		/* Address 0 means failure, so the lowest aligned block above */
+		base = lmb_align_down(start + align - 1, align);
+		if (!base)
+			base = align;
+		if (!base || base < start || base > last - (size - 1))
+			return false;
+		*basep = base;
+		return true;
+	}
+
+	base = lmb_align_down(last - (size - 1), align);
+	if (!base || base < start)
+		return false;
+	/* Areas are visited from the bottom, so top-down takes the last */
+	if (lmb->policy == LMB_ALLOC_TOP_DOWN || !*basep || waste <= *wastep) {
+		*basep = base;
+		*wastep = waste;
+	}
+
+	return false;
+}
+
 phys_addr_t __lmb_alloc_base(struct lmb *lmb, phys_size_t size, ulong align, phys_addr_t max_addr)
 {
-	long i, rgn;
-	phys_addr_t base = 0;
-	phys_addr_t res_base;
-
-	for (i = lmb->memory.cnt - 1; i >= 0; i--) {
-		phys_addr_t lmbbase = lmb->memory.region[i].base;
-		phys_size_t lmbsize = lmb->memory.region[i].size;
-
-		if (lmbsize < size)
-			continue;
-		if (max_addr == LMB_ALLOC_ANYWHERE)
-			base = lmb_align_down(lmbbase + lmbsize - size, align);
-		else if (lmbbase < max_addr) {
-			base = lmbbase + lmbsize;
-			if (base < lmbbase)
-				base = -1;
-			base = min(base, max_addr);
-			base = lmb_align_down(base - size, align);
-		} else
-			continue;
-
-		while (base && lmbbase <= base) {
-			rgn = lmb_overlaps_region(&lmb->reserved, base, size);
-			if (rgn < 0) {
-				/* This area isn't reserved, take it */
-				if (lmb_add_region(&lmb->reserved, base,
-						   size) < 0)
-					return 0;
-				return base;
+	struct lmb_region *res = &lmb->reserved;
+	phys_addr_t start, last, mem_last, base = 0;
+	phys_size_t waste = 0;
+	unsigned long i, r;
+
+	/* Walk the free areas: memory which is not reserved, below max_addr */
+	for (i = 0; i < lmb->memory.cnt; i++) {
+		start = lmb->memory.region[i].base;
+		mem_last = start + lmb->memory.region[i].size - 1;
+		if (max_addr != LMB_ALLOC_ANYWHERE) {
+			if (start >= max_addr)
+				break;
+			mem_last = min(mem_last, max_addr - 1);
+		}
+
+		for (r = lmb_search(res, start); ; r++) {
+			if (r == res->cnt || res->region[r].base > mem_last) {
+				if (lmb_fit(lmb, start, mem_last, size, align,
+					    &base, &waste))
+					goto found;
+				break;
 			}
-			res_base = lmb->reserved.region[rgn].base;
-			if (res_base < size)
+			if (res->region[r].base > start) {
+				last = res->region[r].base - 1;
+				if (lmb_fit(lmb, start, last, size, align,
+					    &base, &waste))
+					goto found;
+			}
+			last = res->region[r].base + res->region[r].size - 1;
+			if (last >= mem_last)
 				break;
-			base = lmb_align_down(res_base - size, align);
+			start = last + 1;
 		}
 	}
-	return 0;
+	if (!base)
+		return 0;
+found:
+	if (lmb_add_region(res, base, size) < 0)
+		return 0;
+
+	return base;
 }
 
 /*
@@ -386,16 +457,14 @@ phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 	/* check if the requested address is in the memory regions */
 	rgn = lmb_overlaps_region(&lmb->memory, addr, 1);
 	if (rgn >= 0) {
-		for (i = 0; i < lmb->reserved.cnt; i++) {
+		i = lmb_search(&lmb->reserved, addr);
+		if (i < lmb->reserved.cnt) {
 			if (addr < lmb->reserved.region[i].base) {
 				/* first reserved range > requested address */
 				return lmb->reserved.region[i].base - addr;
 			}
-			if (lmb->reserved.region[i].base +
-			    lmb->reserved.region[i].size > addr) {
-				/* requested addr is in this reserved range */
-				return 0;
-			}
+			/* requested addr is in this reserved range */
+			return 0;
 		}
 		/* if we come here: no reserved ranges above requested addr */
 		return lmb->memory.region[lmb->memory.cnt - 1].base +
@@ -406,15 +475,7 @@ phys_size_t lmb_get_free_size(struct lmb *lmb, phys_addr_t addr)
 
 int lmb_is_reserved(struct lmb *lmb, phys_addr_t addr)
 {
-	int i;
-
-	for (i = 0; i < lmb->reserved.cnt; i++) {
-		phys_addr_t upper = lmb->reserved.region[i].base +
-			lmb->reserved.region[i].size - 1;
-		if ((addr >= lmb->reserved.region[i].base) && (addr <= upper))
-			return 1;
-	}
-	return 0;
+	return lmb_overlaps_region(&lmb->reserved, addr, 1) >= 0;
 }
 
 __weak void board_lmb_reserve(struct lmb *lmb)
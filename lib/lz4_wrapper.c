@@ -110,7 +110,7 @@ int ulz4fn(const void *src, size_t srcn, void *dst, size_t *dstn)
 
 		if (b.not_compressed) {
 			size_t size = min((ptrdiff_t)b.size, end - out);
-			memcpy(out, in, size);
+			memmove(out, in, size);	/* may overlap if in-place */
 			out += size;
 			if (size < b.size) {
 				ret = -ENOBUFS;	/* output overrun */
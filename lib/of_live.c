@@ -314,12 +314,248 @@ static int unflatten_device_tree(const void *blob,
 	return 0;
 }
 
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+/**
+ * of_live_new_node() - Create a node without its properties or children
+ *
+ * The name, type and phandle are set up, since they are used when searching
+ * the tree. The rest of the node is built by of_live_expand() when needed.
+ *
+ * @fdt: Flat tree containing the node
+ * @offset: Offset of the node in @fdt
+ * @dad: Parent node, or NULL for the root node
+ * @return new node, or NULL if out of memory or @offset is invalid
+ */
+static struct device_node *of_live_new_node(const void *fdt, int offset,
+					    struct device_node *dad)
+{
+	const char *unit, *pname, *name = NULL, *type = "<NULL>";
+	int len, size, prop, name_len = 0;
+	struct device_node *np;
+	phandle handle = 0;
+	const __be32 *p;
+	char *fn;
+
+	unit = fdt_get_name(fdt, offset, &len);
+	if (!unit)
+		return NULL;
+
+	/* Pick out the properties needed now in one pass, as they are few */
+	fdt_for_each_property_offset(prop, fdt, offset) {
+		p = fdt_getprop_by_offset(fdt, prop, &pname, NULL);
+		if (!p)
+			break;
+		if (!strcmp(pname, "name"))
+			name = (const char *)p;
+		else if (!strcmp(pname, "device_type"))
+			type = (const char *)p;
+		else if (!strcmp(pname, "ibm,phandle") ||
+			 (!handle && (!strcmp(pname, "phandle") ||
+				      !strcmp(pname, "linux,phandle"))))
+			handle = be32_to_cpup(p);
+	}
+
+	/* Same as unflatten_dt_node(): the full path then the name if needed */
+	size = len + 2;
+	if (dad && dad->parent)
+		size += strlen(dad->full_name);
+	if (!name) {
+		name_len = strchrnul(unit, '@') - unit;
+		size += name_len + 1;
+	}
+	np = calloc(1, sizeof(*np) + size);
+	if (!np)
+		return NULL;
+
+	fn = (char *)(np + 1);
+	np->full_name = fn;
+	if (dad && dad->parent) {
+		strcpy(fn, dad->full_name);
+		fn += strlen(fn);
+	}
+	*fn++ = '/';
+	strcpy(fn, unit);
+	if (!name) {
+		fn += len + 1;
+		memcpy(fn, unit, name_len);
+		name = fn;
+	}
+	np->name = name;
+	np->type = type;
+	np->phandle = handle;
+	np->parent = dad;
+	np->fdt = fdt;
+	np->offset = offset;
+	np->lazy = OF_LAZY_CHILDREN | OF_LAZY_PROPS;
+
+	return np;
+}
+
+static int of_live_add_children(struct device_node *np)
+{
+	struct device_node *child, **prevp = &np->child;
+	int offset;
+
+	fdt_for_each_subnode(offset, np->fdt, np->offset) {
+		child = of_live_new_node(np->fdt, offset, np);
+		if (!child)
+			goto err;
+		*prevp = child;
+		prevp = &child->sibling;
+	}
+
+	return 0;
+err:
+	/* New nodes have nothing else allocated, so are simple to drop */
+	while (np->child) {
+		child = np->child;
+		np->child = child->sibling;
+		free(child);
+	}
+
+	return -ENOMEM;
+}
+
+static int of_live_add_props(struct device_node *np)
+{
+	struct property *pp, *props;
+	const char *pname;
+	bool has_name = false;
+	int offset, count = 0;
+
+	fdt_for_each_property_offset(offset, np->fdt, np->offset)
+		count++;
+
+	/* Leave room to add a "name" property, as unflatten_dt_node() does */
+	props = calloc(count + 1, sizeof(*props));
+	if (!props)
+		return -ENOMEM;
+	pp = props;
+	fdt_for_each_property_offset(offset, np->fdt, np->offset) {
+		pp->value = (void *)fdt_getprop_by_offset(np->fdt, offset,
+							  &pname, &pp->length);
+		if (!pp->value)
+			break;
+		pp->name = (char *)pname;
+		if (!strcmp(pname, "name"))
+			has_name = true;
+		pp->next = pp + 1;
+		pp++;
+	}
+	if (!has_name) {
+		pp->name = "name";
+		pp->value = (void *)np->name;
+		pp->length = strlen(np->name) + 1;
+		pp++;
+	}
+	pp[-1].next = NULL;
+	np->properties = props;
+
+	return 0;
+}
+
+int of_live_expand(struct device_node *np, uint lazy)
+{
+	int ret;
+
+	if (np->lazy & lazy & OF_LAZY_CHILDREN) {
+		ret = of_live_add_children(np);
+		if (ret) {
+			debug("%s: Cannot add children: err=%d\n",
+			      np->full_name, ret);
+			return ret;
+		}
+		np->lazy &= ~OF_LAZY_CHILDREN;
+	}
+	if (np->lazy & lazy & OF_LAZY_PROPS) {
+		ret = of_live_add_props(np);
+		if (ret) {
+			debug("%s: Cannot add properties: err=%d\n",
+			      np->full_name, ret);
+			return ret;
+		}
+		np->lazy &= ~OF_LAZY_PROPS;
+	}
+
+	return 0;
+}
+
+struct device_node *of_live_find_offset(struct device_node *root, int offset)
+{
+	struct device_node *np = root, *child, *next;
+
+	/*
+	 * Build only the nodes on the path down to @offset. Subnodes follow
+	 * their parent in the flat tree and siblings come in order, so the
+	 * subtree holding @offset is the last child which starts at or before
+	 * it. This avoids scanning the flat tree to find the ancestors.
+	 */
+	while (np && np->offset != offset) {
+		child = of_node_child(np);
+		if (!child || child->offset > offset)
+			return NULL;
+		for (next = child->sibling; next && next->offset <= offset;
+		     next = next->sibling)
+			child = next;
+		np = child;
+	}
+
+	return np;
+}
+
+static void of_live_free_node(struct device_node *np)
+{
+	struct device_node *child, *next;
+
+	if (!(np->lazy & OF_LAZY_CHILDREN)) {
+		for (child = np->child; child; child = next) {
+			next = child->sibling;
+			of_live_free_node(child);
+		}
+	}
+	if (!(np->lazy & OF_LAZY_PROPS))
+		free(np->properties);
+	free(np);
+}
+#endif /* OF_LIVE_LAZY */
+
+int of_live_unflatten(const void *fdt_blob, bool lazy,
+		      struct device_node **rootp)
+{
+	if (!lazy)
+		return unflatten_device_tree(fdt_blob, rootp);
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if (!fdt_blob || fdt_check_header(fdt_blob))
+		return -EINVAL;
+	*rootp = of_live_new_node(fdt_blob, 0, NULL);
+	if (!*rootp)
+		return -ENOMEM;
+
+	return 0;
+#else
+	return -ENOSYS;
+#endif
+}
+
+void of_live_free(struct device_node *root)
+{
+#if CONFIG_IS_ENABLED(OF_LIVE_LAZY)
+	if (root->fdt) {
+		of_live_free_node(root);
+		return;
+	}
+#endif
+	/* unflatten_device_tree() puts the whole tree in one allocation */
+	free(root);
+}
+
 int of_live_build(const void *fdt_blob, struct device_node **rootp)
 {
 	int ret;
 
 	debug("%s: start\n", __func__);
-	ret = unflatten_device_tree(fdt_blob, rootp);
+	ret = of_live_unflatten(fdt_blob, CONFIG_IS_ENABLED(OF_LIVE_LAZY),
+				rootp);
 	if (ret) {
 		debug("Failed to create live tree: err=%d\n", ret);
 		return ret;
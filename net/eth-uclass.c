@@ -9,6 +9,7 @@
 #include <dm.h>
 #include <environment.h>
 #include <net.h>
+#include <tracepoint.h>
 #include <dm/device-internal.h>
 #include <dm/uclass-internal.h>
 #include "eth_internal.h"
@@ -330,6 +331,7 @@ int eth_is_active(struct udevice *dev)
 int eth_send(void *packet, int length)
 {
 	struct udevice *current;
+	ulong tp;
 	int ret;
 
 	current = eth_get_dev();
@@ -339,7 +341,9 @@ int eth_send(void *packet, int length)
 	if (!eth_is_active(current))
 		return -EINVAL;
 
+	tp = tracepoint_start(TP_NET_SEND);
 	ret = eth_get_ops(current)->send(current, packet, length);
+	tracepoint_end(TP_NET_SEND, tp, current->name, length, ret);
 	if (ret < 0) {
 		/* We cannot completely return the error at present */
 		debug("%s: send() returned error %d\n", __func__, ret);
@@ -351,6 +355,7 @@ int eth_rx(void)
 {
 	struct udevice *current;
 	uchar *packet;
+	ulong tp;
 	int flags;
 	int ret;
 	int i;
@@ -365,10 +370,13 @@ int eth_rx(void)
 	/* Process up to 32 packets at one time */
 	flags = ETH_RECV_CHECK_DEVICE;
 	for (i = 0; i < 32; i++) {
+		tp = tracepoint_start(TP_NET_RECV);
 		ret = eth_get_ops(current)->recv(current, flags, &packet);
 		flags = 0;
-		if (ret > 0)
+		if (ret > 0) {
+			tracepoint_end(TP_NET_RECV, tp, current->name, ret, 0);
 			net_process_received_packet(packet, ret);
+		}
 		if (ret >= 0 && eth_get_ops(current)->free_pkt)
 			eth_get_ops(current)->free_pkt(current, packet, ret);
 		if (ret <= 0)
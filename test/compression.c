@@ -6,9 +6,12 @@
 #include <common.h>
 #include <bootm.h>
 #include <command.h>
+#include <lmb.h>
 #include <malloc.h>
 #include <mapmem.h>
 #include <asm/io.h>
+#include <asm/test.h>
+#include <asm/unaligned.h>
 
 #include <u-boot/zlib.h>
 #include <bzlib.h>
@@ -117,6 +120,47 @@ static const char lz4_compressed[] =
 	"\x9d\x12\x8c\x9d";
 static const unsigned long lz4_compressed_size = 276;
 
+/* lz4 -z --content-size /tmp/plain.txt > /tmp/plain.lz4 */
+static const char lz4_sized_compressed[] =
+	"\x04\x22\x4d\x18\x6c\x40\x5e\x01\x00\x00\x00\x00\x00\x00\x0c\x01"
+	"\x01\x00\x00\xff\x19\x49\x20\x61\x6d\x20\x61\x20\x68\x69\x67\x68"
+	"\x6c\x79\x20\x63\x6f\x6d\x70\x72\x65\x73\x73\x61\x62\x6c\x65\x20"
+	"\x62\x69\x74\x20\x6f\x66\x20\x74\x65\x78\x74\x2e\x0a\x28\x00\x3d"
+	"\xf1\x25\x54\x68\x65\x72\x65\x20\x61\x72\x65\x20\x6d\x61\x6e\x79"
+	"\x20\x6c\x69\x6b\x65\x20\x6d\x65\x2c\x20\x62\x75\x74\x20\x74\x68"
+	"\x69\x73\x20\x6f\x6e\x65\x20\x69\x73\x20\x6d\x69\x6e\x65\x2e\x0a"
+	"\x49\x66\x20\x49\x20\x77\x32\x00\xd1\x6e\x79\x20\x73\x68\x6f\x72"
+	"\x74\x65\x72\x2c\x20\x74\x45\x00\xf4\x0b\x77\x6f\x75\x6c\x64\x6e"
+	"\x27\x74\x20\x62\x65\x20\x6d\x75\x63\x68\x20\x73\x65\x6e\x73\x65"
+	"\x20\x69\x6e\x0a\xcf\x00\x50\x69\x6e\x67\x20\x6d\x12\x00\x00\x32"
+	"\x00\xf0\x11\x20\x66\x69\x72\x73\x74\x20\x70\x6c\x61\x63\x65\x2e"
+	"\x20\x41\x74\x20\x6c\x65\x61\x73\x74\x20\x77\x69\x74\x68\x20\x6c"
+	"\x7a\x6f\x2c\x63\x00\xf5\x14\x77\x61\x79\x2c\x0a\x77\x68\x69\x63"
+	"\x68\x20\x61\x70\x70\x65\x61\x72\x73\x20\x74\x6f\x20\x62\x65\x68"
+	"\x61\x76\x65\x20\x70\x6f\x6f\x72\x6c\x79\x4e\x00\x30\x61\x63\x65"
+	"\x27\x01\x01\x95\x00\x01\x2d\x01\xb0\x0a\x6d\x65\x73\x73\x61\x67"
+	"\x65\x73\x2e\x0a\x00\x00\x00\x00\x9d\x12\x8c\x9d";
+static const unsigned long lz4_sized_compressed_size = 284;
+
+/* As lzma_compressed, but with the uncompressed size in the header */
+static const char lzma_sized_compressed[] =
+	"\x5d\x00\x00\x01\x00\x5e\x01\x00\x00\x00\x00\x00\x00\x00\x24\x88"
+	"\x08\x26\xd8\x41\xff\x99\xc8\xcf\x66\x3d\x80\xac\xba\x17\xf1\xc8"
+	"\xb9\xdf\x49\x37\xb1\x68\xa0\x2a\xdd\x63\xd1\xa7\xa3\x66\xf8\x15"
+	"\xef\xa6\x67\x8a\x14\x18\x80\xcb\xc7\xb1\xcb\x84\x6a\xb2\x51\x16"
+	"\xa1\x45\xa0\xd6\x3e\x55\x44\x8a\x5c\xa0\x7c\xe5\xa8\xbd\x04\x57"
+	"\x8f\x24\xfd\xb9\x34\x50\x83\x2f\xf3\x46\x3e\xb9\xb0\x00\x1a\xf5"
+	"\xd3\x86\x7e\x8f\x77\xd1\x5d\x0e\x7c\xe1\xac\xde\xf8\x65\x1f\x4d"
+	"\xce\x7f\xa7\x3d\xaa\xcf\x26\xa7\x58\x69\x1e\x4c\xea\x68\x8a\xe5"
+	"\x89\xd1\xdc\x4d\xc7\xe0\x07\x42\xbf\x0c\x9d\x06\xd7\x51\xa2\x0b"
+	"\x7c\x83\x35\xe1\x85\xdf\xee\xfb\xa3\xee\x2f\x47\x5f\x8b\x70\x2b"
+	"\xe1\x37\xf3\x16\xf6\x27\x54\x8a\x33\x72\x49\xea\x53\x7d\x60\x0b"
+	"\x21\x90\x66\xe7\x9e\x56\x61\x5d\xd8\xdc\x59\xf0\xac\x2f\xd6\x49"
+	"\x6b\x85\x40\x08\x1f\xdf\x26\x25\x3b\x72\x44\xb0\xb8\x21\x2f\xb3"
+	"\xd7\x9b\x24\x30\x78\x26\x44\x07\xc3\x33\xd1\x4d\x03\x1b\xe1\xff"
+	"\xfd\xf5\x50\x8d\xca";
+static const unsigned long lzma_sized_compressed_size = 229;
+
 
 #define TEST_BUFFER_SIZE	512
 
@@ -532,6 +576,267 @@ static int compression_test_bootm_none(struct unit_test_state *uts)
 }
 COMPRESSION_TEST(compression_test_bootm_none, 0);
 
+/**
+ * run_bootm_in_place_test() - Run tests on decompressing an image over itself
+ *
+ * @comp_type:	Compression type to test
+ * @sized:	Compressed data, which records its uncompressed size
+ * @sized_size:	Number of bytes in @sized
+ * @unsized:	Compressed data, which does not record its uncompressed size
+ * @unsized_size: Number of bytes in @unsized
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_bootm_in_place_test(struct unit_test_state *uts, int comp_type,
+				   const char *sized, ulong sized_size,
+				   const char *unsized, ulong unsized_size)
+{
+	const ulong load_addr = 0x1000;
+	ulong unc_len = strlen(plain);
+	ulong image_start, load_end;
+	struct lmb lmb;
+
+	printf("Testing: %s in place\n", genimg_get_comp_name(comp_type));
+	lmb_init(&lmb);
+	lmb_add(&lmb, 0, 0x100000);
+
+	/* An image which does not overlap its output is left alone */
+	image_start = 0x80000;
+	memcpy(map_sysmem(image_start, 0), sized, sized_size);
+	ut_asserteq(-ENOENT, bootm_prep_in_place(&lmb, comp_type, load_addr,
+						 image_start,
+						 image_start + sized_size,
+						 &image_start, sized_size));
+	ut_asserteq(0x80000, image_start);
+
+	/* An image at the load address is moved to the end of the output */
+	image_start = load_addr;
+	memcpy(map_sysmem(image_start, 0), sized, sized_size);
+	ut_assertok(bootm_prep_in_place(&lmb, comp_type, load_addr,
+					image_start, image_start + sized_size,
+					&image_start, sized_size));
+	ut_assert(image_start > load_addr);
+	ut_assert(image_start + sized_size > load_addr + unc_len);
+	ut_assertok(bootm_decomp_image(comp_type, load_addr, image_start,
+				       IH_TYPE_KERNEL,
+				       map_sysmem(load_addr, 0),
+				       map_sysmem(image_start, 0), sized_size,
+				       0x100000, &load_end));
+	ut_asserteq(load_addr + unc_len, load_end);
+	ut_assertok(memcmp(plain, map_sysmem(load_addr, 0), unc_len));
+
+	/* The rest of the containing image must not be overwritten */
+	image_start = load_addr + 0x10;
+	memcpy(map_sysmem(image_start, 0), sized, sized_size);
+	ut_asserteq(-EBUSY, bootm_prep_in_place(&lmb, comp_type, load_addr,
+						load_addr,
+						image_start + sized_size,
+						&image_start, sized_size));
+	ut_asserteq(load_addr + 0x10, image_start);
+
+	/* Nor may reserved memory */
+	lmb_reserve(&lmb, load_addr + unc_len, 0x10);
+	ut_asserteq(-ENOSPC, bootm_prep_in_place(&lmb, comp_type, load_addr,
+						 image_start,
+						 image_start + sized_size,
+						 &image_start, sized_size));
+
+	/* The uncompressed size must be known */
+	image_start = load_addr;
+	memcpy(map_sysmem(image_start, 0), unsized, unsized_size);
+	ut_asserteq(-ENOENT, bootm_prep_in_place(NULL, comp_type, load_addr,
+						 image_start,
+						 image_start + unsized_size,
+						 &image_start, unsized_size));
+
+	return 0;
+}
+
+static int compression_test_bootm_in_place_lzma(struct unit_test_state *uts)
+{
+	return run_bootm_in_place_test(uts, IH_COMP_LZMA, lzma_sized_compressed,
+				       lzma_sized_compressed_size,
+				       lzma_compressed, lzma_compressed_size);
+}
+COMPRESSION_TEST(compression_test_bootm_in_place_lzma, 0);
+
+static int compression_test_bootm_in_place_lz4(struct unit_test_state *uts)
+{
+	return run_bootm_in_place_test(uts, IH_COMP_LZ4, lz4_sized_compressed,
+				       lz4_sized_compressed_size,
+				       lz4_compressed, lz4_compressed_size);
+}
+COMPRESSION_TEST(compression_test_bootm_in_place_lz4, 0);
+
+#ifdef CONFIG_FIT_COMP_BLOCKS
+#define TEST_BLOCK_SIZE		128
+#define TEST_MAX_BLOCKS		DIV_ROUND_UP(sizeof(plain) - 1, TEST_BLOCK_SIZE)
+
+/*
+ * There is no lz4 compression in u-boot, and the canned data only covers the
+ * whole of the plain text, so write an lz4 frame holding one compressed block
+ * which is a single run of literals. ulz4fn() does not check the header
+ * checksum, so that is left as zero.
+ */
+static int compress_using_lz4_literals(struct unit_test_state *uts,
+				       void *in, unsigned long in_size,
+				       void *out, unsigned long out_max,
+				       unsigned long *out_size)
+{
+	static const u8 frame_header[] = {
+		0x04, 0x22, 0x4d, 0x18,	/* magic */
+		0x60,			/* version 1, independent blocks */
+		0x40,			/* blocks of up to 64KB */
+		0x00,			/* header checksum */
+	};
+	u8 *block, *p = out;
+	unsigned long left;
+
+	/* Header, block size, token, literal length, literals, end mark */
+	if (sizeof(frame_header) + 4 + 1 + in_size / 255 + 1 + in_size + 4 >
+	    out_max)
+		return -1;
+	memcpy(p, frame_header, sizeof(frame_header));
+	p += sizeof(frame_header);
+	block = p;
+	p += 4;
+	if (in_size < 15) {
+		*p++ = in_size << 4;
+	} else {
+		*p++ = 0xf0;
+		for (left = in_size - 15; left >= 255; left -= 255)
+			*p++ = 255;
+		*p++ = left;
+	}
+	memcpy(p, in, in_size);
+	p += in_size;
+	put_unaligned_le32(p - block - 4, block);
+	put_unaligned_le32(0, p);
+	p += 4;
+	*out_size = p - (u8 *)out;
+
+	return 0;
+}
+
+/**
+ * run_bootm_blocks_test() - Run tests on bootm block decompression
+ *
+ * This compresses the plain text as a sequence of independent blocks and
+ * checks that the output matches the original.
+ *
+ * @comp_type:	Compression type to test
+ * @compress:	Our function to compress data
+ * @return 0 if OK, non-zero on failure
+ */
+static int run_bootm_blocks_test(struct unit_test_state *uts, int comp_type,
+				 mutate_func compress)
+{
+	fdt32_t offsets[TEST_MAX_BLOCKS];
+	const ulong image_start = 0;
+	const ulong load_addr = 0x1000;
+	ulong unc_len = strlen(plain);
+	ulong image_len, pos, size;
+	void *compress_buff;
+	void *load_buf;
+	ulong load_end;
+	int count;
+	u32 save;
+
+	printf("Testing: %s blocks\n", genimg_get_comp_name(comp_type));
+	compress_buff = map_sysmem(image_start, 0);
+	load_buf = map_sysmem(load_addr, 0);
+	for (pos = 0, count = 0, image_len = 0; pos < unc_len;
+	     pos += TEST_BLOCK_SIZE, count++) {
+		size = load_addr - image_len;
+		offsets[count] = cpu_to_fdt32(image_len);
+		ut_assertok(compress(uts, (void *)plain + pos,
+				     min(unc_len - pos, (ulong)TEST_BLOCK_SIZE),
+				     compress_buff + image_len, size, &size));
+		image_len += size;
+	}
+	ut_asserteq(TEST_MAX_BLOCKS, count);
+
+	memset(load_buf, '\0', unc_len);
+	ut_assertok(bootm_decomp_blocks(comp_type, load_addr, image_start,
+					IH_TYPE_KERNEL, load_buf,
+					compress_buff, image_len,
+					TEST_BLOCK_SIZE, offsets, count,
+					0x10000, &load_end));
+	ut_asserteq(load_addr + unc_len, load_end);
+	ut_assertok(memcmp(plain, load_buf, unc_len));
+
+	/* On sandbox, blocks not needing malloc() are done on several threads */
+	if (comp_type == IH_COMP_GZIP) {
+		ut_asserteq(0, sandbox_decomp_get_threads());
+	} else {
+		ut_assert(sandbox_decomp_get_threads() > 1);
+	}
+
+	/* Not enough space for the last block */
+	ut_assert(bootm_decomp_blocks(comp_type, load_addr, image_start,
+				      IH_TYPE_KERNEL, load_buf,
+				      compress_buff, image_len,
+				      TEST_BLOCK_SIZE, offsets, count,
+				      unc_len - 1, &load_end));
+
+	/* Blocks which do not fill the block size would leave gaps */
+	ut_assert(bootm_decomp_blocks(comp_type, load_addr, image_start,
+				      IH_TYPE_KERNEL, load_buf,
+				      compress_buff, image_len,
+				      TEST_BLOCK_SIZE * 2, offsets, count,
+				      0x10000, &load_end));
+
+	/* Offsets must be in order */
+	save = offsets[1];
+	offsets[1] = offsets[0];
+	ut_assert(bootm_decomp_blocks(comp_type, load_addr, image_start,
+				      IH_TYPE_KERNEL, load_buf,
+				      compress_buff, image_len,
+				      TEST_BLOCK_SIZE, offsets, count,
+				      0x10000, &load_end));
+	offsets[1] = save;
+
+	/* The output must not overlap the input */
+	ut_asserteq(-EINVAL,
+		    bootm_decomp_blocks(comp_type, image_start, image_start,
+					IH_TYPE_KERNEL, compress_buff,
+					compress_buff, image_len,
+					TEST_BLOCK_SIZE, offsets, count,
+					0x10000, &load_end));
+
+	/* We can't detect corruption when not decompressing */
+	if (comp_type == IH_COMP_NONE)
+		return 0;
+	memset(compress_buff + fdt32_to_cpu(offsets[count - 1]), '\x49',
+	       image_len - fdt32_to_cpu(offsets[count - 1]));
+	ut_assert(bootm_decomp_blocks(comp_type, load_addr, image_start,
+				      IH_TYPE_KERNEL, load_buf,
+				      compress_buff, image_len,
+				      TEST_BLOCK_SIZE, offsets, count,
+				      0x10000, &load_end));
+
+	return 0;
+}
+
+static int compression_test_bootm_blocks_gzip(struct unit_test_state *uts)
+{
+	return run_bootm_blocks_test(uts, IH_COMP_GZIP, compress_using_gzip);
+}
+COMPRESSION_TEST(compression_test_bootm_blocks_gzip, 0);
+
+static int compression_test_bootm_blocks_lz4(struct unit_test_state *uts)
+{
+	return run_bootm_blocks_test(uts, IH_COMP_LZ4,
+				     compress_using_lz4_literals);
+}
+COMPRESSION_TEST(compression_test_bootm_blocks_lz4, 0);
+
+static int compression_test_bootm_blocks_none(struct unit_test_state *uts)
+{
+	return run_bootm_blocks_test(uts, IH_COMP_NONE, compress_using_none);
+}
+COMPRESSION_TEST(compression_test_bootm_blocks_none, 0);
+#endif /* CONFIG_FIT_COMP_BLOCKS */
+
 int do_ut_compression(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for bootstage spans
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <bootstage.h>
+#include <dm.h>
+#include <malloc.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+/* Check that @inner is inside @outer, in both nesting and time */
+static int check_inside(struct unit_test_state *uts, int outer, int inner)
+{
+	const struct bootstage_span *out, *in;
+
+	out = bootstage_span_get(outer);
+	in = bootstage_span_get(inner);
+	ut_assertnonnull(out);
+	ut_assertnonnull(in);
+	ut_asserteq(outer, in->parent);
+	ut_asserteq(out->depth + 1, in->depth);
+	ut_assert(in->start_us >= out->start_us);
+	ut_assert(in->start_us + in->duration_us <=
+		  out->start_us + out->duration_us);
+
+	return 0;
+}
+
+/* Test that spans nest and that probes and block reads are recorded */
+static int dm_test_bootstage_span(struct unit_test_state *uts)
+{
+	const struct bootstage_span *span;
+	int bootm, load, decomp, verify;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char buf[512];
+
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+	blkcache_invalidate(desc->if_type, desc->devnum);
+	bootstage_span_clear();
+
+	bootm = bootstage_span_begin("bootm", "bootm");
+	ut_asserteq(0, bootm);
+	load = bootstage_span_begin("load", "os");
+	ut_asserteq(1, load);
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+	decomp = bootstage_span_begin("decompress", "gzip");
+	ut_asserteq(2, decomp);
+	bootstage_span_end(decomp);
+	verify = bootstage_span_begin("verify", "kernel");
+	ut_asserteq(3, verify);
+
+	/* Probing a device adds a span inside the open one */
+	ut_assertok(uclass_get_device_by_name(UCLASS_TEST_FDT, "a-test", &dev));
+	span = bootstage_span_get(4);
+	ut_assertnonnull(span);
+	ut_asserteq_str("probe", span->cat);
+	ut_asserteq_str("a-test", span->name);
+	ut_asserteq(verify, span->parent);
+	ut_assert(!span->open);
+
+	/* Ending the outer span ends those still open inside it */
+	span = bootstage_span_get(verify);
+	ut_assert(span->open);
+	bootstage_span_end(load);
+	ut_assert(!span->open);
+	ut_assert(bootstage_span_get(bootm)->open);
+	bootstage_span_end(bootm);
+
+	ut_assertok(check_inside(uts, bootm, load));
+	ut_assertok(check_inside(uts, load, decomp));
+	ut_assertok(check_inside(uts, load, verify));
+	ut_assertok(check_inside(uts, verify, 4));
+	ut_asserteq(-1, bootstage_span_get(bootm)->parent);
+
+	/* The bytes read are counted in each span that was open */
+	ut_asserteq(desc->blksz, bootstage_span_get(bootm)->bytes);
+	ut_asserteq(desc->blksz, bootstage_span_get(load)->bytes);
+	ut_asserteq(0, bootstage_span_get(decomp)->bytes);
+	ut_assertnull(bootstage_span_get(5));
+
+	/* A new span is not inside any of the ended ones */
+	ut_asserteq(5, bootstage_span_begin("test", "after"));
+	ut_asserteq(-1, bootstage_span_get(5)->parent);
+	bootstage_span_end(5);
+	bootstage_span_clear();
+
+	return 0;
+}
+DM_TEST(dm_test_bootstage_span, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that the JSON output shows the spans as a tree */
+static int dm_test_bootstage_json(struct unit_test_state *uts)
+{
+	char *buf;
+	int len, outer;
+
+	bootstage_span_clear();
+	outer = bootstage_span_begin("test", "outer");
+	bootstage_span_end(bootstage_span_begin("test", "inner"));
+	bootstage_span_end(outer);
+	bootstage_span_end(bootstage_span_begin("test", "next\""));
+
+	len = bootstage_json(NULL, 0);
+	ut_assert(len > 0);
+	buf = malloc(len + 1);
+	ut_assertnonnull(buf);
+
+	/* The output is truncated if there is not enough space */
+	ut_asserteq(len, bootstage_json(buf, len));
+	ut_asserteq(len - 1, strlen(buf));
+	ut_asserteq(len, bootstage_json(buf, len + 1));
+	ut_asserteq(len, strlen(buf));
+
+	ut_asserteq('{', buf[0]);
+	ut_asserteq('}', buf[len - 1]);
+	ut_assertnonnull(strstr(buf, "\"marks\":[{"));
+	ut_assertnonnull(strstr(buf,
+		"\"spans\":[{\"name\":\"outer\",\"cat\":\"test\""));
+	ut_assertnonnull(strstr(buf, "\"children\":[{\"name\":\"inner\""));
+	ut_assertnonnull(strstr(buf, "]},{\"name\":\"next\\\"\""));
+	ut_assertnonnull(strstr(buf, "\"span_stats\":{\"test\":{\"count\":3,"));
+	free(buf);
+	bootstage_span_clear();
+
+	return 0;
+}
+DM_TEST(dm_test_bootstage_json, 0);
@@ -905,3 +905,105 @@ static int dm_test_inactive_child(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_inactive_child, DM_TESTF_SCAN_PDATA);
+
+/* Check that the lookup tables give the same results as the device lists */
+static int dm_test_lookup_tables(struct unit_test_state *uts)
+{
+	struct udevice *dev, *other, *found;
+	ulong hits = 0;
+	struct uclass *uc;
+	ofnode node;
+
+	if (CONFIG_IS_ENABLED(DM_LOOKUP_TABLES)) {
+		ut_assertnonnull(gd->dm_lookup);
+		hits = gd->dm_lookup->node_hits;
+	}
+
+	list_for_each_entry(uc, &gd->uclass_root, sibling_node) {
+		ut_asserteq_ptr(uc, uclass_find(uc->uc_drv->id));
+
+		uclass_foreach_dev(dev, uc) {
+			if (!dev_has_of_node(dev))
+				continue;
+
+			/* The first device in the uclass with this node wins */
+			uclass_foreach_dev(other, uc) {
+				if (ofnode_equal(dev_ofnode(other),
+						 dev_ofnode(dev)))
+					break;
+			}
+			ut_assertok(uclass_find_device_by_ofnode(uc->uc_drv->id,
+								 dev_ofnode(dev),
+								 &found));
+			ut_asserteq_ptr(other, found);
+		}
+	}
+
+	/* An unbound device must not be found */
+	ut_assertok(uclass_get_device_by_name(UCLASS_TEST_FDT, "a-test",
+					      &dev));
+	node = dev_ofnode(dev);
+	ut_assertok(device_find_global_by_ofnode(node, &found));
+	ut_asserteq_ptr(dev, found);
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(-ENODEV, uclass_find_device_by_ofnode(UCLASS_TEST_FDT, node,
+							  &found));
+	ut_asserteq(-ENOENT, device_find_global_by_ofnode(node, &found));
+
+	if (CONFIG_IS_ENABLED(DM_LOOKUP_TABLES)) {
+		ut_assert(gd->dm_lookup->node_hits > hits);
+		ut_assert(gd->dm_lookup->uclass_lookups > 0);
+	}
+
+	return 0;
+}
+DM_TEST(dm_test_lookup_tables, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+#if CONFIG_IS_ENABLED(DM_ARENA)
+/* Check that devices bound at start-up are allocated along with their data */
+static int dm_test_arena(struct unit_test_state *uts)
+{
+	struct udevice *dev, *other;
+	uint live;
+	void *priv;
+
+	/* Only dm_init_and_scan() closes the arena, so it is open here */
+	ut_assertok(uclass_get_device_by_name(UCLASS_TEST_FDT, "a-test",
+					      &dev));
+	ut_assert(dev->flags & DM_FLAG_ARENA);
+	ut_assert(dm_arena_owns(dev));
+	ut_assert(dm_arena_owns(dev_get_platdata(dev)));
+	priv = dev_get_priv(dev);
+	ut_assert(dm_arena_owns(priv));
+
+	/* Probing the device again uses the same space */
+	live = gd->dm_arena->live;
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertnull(dev_get_priv(dev));
+	ut_assertok(device_probe(dev));
+	ut_asserteq_ptr(priv, dev_get_priv(dev));
+	ut_asserteq(live, gd->dm_arena->live);
+
+	/* Once the arena is closed, devices are allocated as usual */
+	dm_arena_close();
+	ut_assertok(device_bind_ofnode(dm_root(), DM_GET_DRIVER(testfdt_drv),
+				       "arena-test", 0, dev_ofnode(dev),
+				       &other));
+	ut_assert(!(other->flags & DM_FLAG_ARENA));
+	ut_assert(!dm_arena_owns(other));
+	ut_assertok(device_probe(other));
+	ut_assert(!dm_arena_owns(dev_get_priv(other)));
+	ut_assertok(device_remove(other, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(other));
+	ut_asserteq(live, gd->dm_arena->live);
+
+	/* Unbinding a device frees its block */
+	ut_assertok(device_remove(dev, DM_REMOVE_NORMAL));
+	ut_assertok(device_unbind(dev));
+	ut_asserteq(live - 1, gd->dm_arena->live);
+
+	return 0;
+}
+DM_TEST(dm_test_arena, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
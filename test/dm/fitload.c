@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for reading the parts of a FIT which a configuration needs
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <fs.h>
+#include <image.h>
+#include <mapmem.h>
+#include <os.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define FIT_FNAME	"fitload_test.fit"
+#define FIT_DATA_POS	0x200		/* Start of the external data */
+#define FIT_DATA_LEN	0x10		/* Size of each image */
+#define FIT_LOAD_ADDR	0x100000
+
+DECLARE_GLOBAL_DATA_PTR;
+
+/*
+ * Write a FIT with two kernels, each used by one configuration, with their
+ * data after the FIT structure. The second kernel's data is at @pos2.
+ */
+static int write_fit(struct unit_test_state *uts, int pos2, int totalsize)
+{
+	char buf[FIT_DATA_POS + FIT_DATA_LEN * 2];
+	void *fit = buf;
+
+	memset(buf, '\0', sizeof(buf));
+	ut_assertok(fdt_create(fit, FIT_DATA_POS));
+	ut_assertok(fdt_finish_reservemap(fit));
+	ut_assertok(fdt_begin_node(fit, ""));
+	ut_assertok(fdt_property_string(fit, FIT_DESC_PROP, "fitload test"));
+	ut_assertok(fdt_property_u32(fit, FIT_TIMESTAMP_PROP, 0));
+
+	ut_assertok(fdt_begin_node(fit, "images"));
+	ut_assertok(fdt_begin_node(fit, "kernel-1"));
+	ut_assertok(fdt_property_u32(fit, FIT_DATA_POSITION_PROP,
+				     FIT_DATA_POS));
+	ut_assertok(fdt_property_u32(fit, FIT_DATA_SIZE_PROP, FIT_DATA_LEN));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_begin_node(fit, "kernel-2"));
+	ut_assertok(fdt_property_u32(fit, FIT_DATA_POSITION_PROP, pos2));
+	ut_assertok(fdt_property_u32(fit, FIT_DATA_SIZE_PROP, FIT_DATA_LEN));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+
+	ut_assertok(fdt_begin_node(fit, FIT_CONFS_PATH + 1));
+	ut_assertok(fdt_property_string(fit, FIT_DEFAULT_PROP, "conf-1"));
+	ut_assertok(fdt_begin_node(fit, "conf-1"));
+	ut_assertok(fdt_property_string(fit, FIT_KERNEL_PROP, "kernel-1"));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_begin_node(fit, "conf-2"));
+	ut_assertok(fdt_property_string(fit, FIT_KERNEL_PROP, "kernel-2"));
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_end_node(fit));
+
+	ut_assertok(fdt_end_node(fit));
+	ut_assertok(fdt_finish(fit));
+	if (totalsize)
+		fdt_set_totalsize(fit, totalsize);
+
+	memset(buf + FIT_DATA_POS, 'a', FIT_DATA_LEN);
+	memset(buf + FIT_DATA_POS + FIT_DATA_LEN, 'b', FIT_DATA_LEN);
+	ut_assertok(os_write_file(FIT_FNAME, buf, sizeof(buf)));
+
+	return 0;
+}
+
+/* Call fit_load_file() on the test file */
+static int load_fit(ulong addr, const char *conf, ulong *sizep,
+		    loff_t *bytes_readp)
+{
+	return fit_load_file("hostfs", "-", FS_TYPE_ANY, FIT_FNAME, addr,
+			     conf, sizep, bytes_readp);
+}
+
+/* Test that only the images used by the configuration are read */
+static int dm_test_fitload(struct unit_test_state *uts)
+{
+	const int pos2 = FIT_DATA_POS + FIT_DATA_LEN;
+	loff_t bytes_read;
+	char *buf;
+	ulong size;
+
+	ut_assertok(write_fit(uts, pos2, 0));
+	buf = map_sysmem(FIT_LOAD_ADDR, FIT_DATA_POS + FIT_DATA_LEN * 2);
+	memset(buf, '\0', FIT_DATA_POS + FIT_DATA_LEN * 2);
+	ut_assertok(load_fit(FIT_LOAD_ADDR, "conf-2", &size, &bytes_read));
+	ut_asserteq(pos2 + FIT_DATA_LEN, size);
+	ut_asserteq(fdt_totalsize(buf) + FIT_DATA_LEN, bytes_read);
+	ut_asserteq('\0', buf[FIT_DATA_POS]);
+	ut_asserteq('b', buf[pos2]);
+	ut_asserteq('b', buf[pos2 + FIT_DATA_LEN - 1]);
+
+	/* The default configuration uses the first kernel */
+	ut_assertok(load_fit(FIT_LOAD_ADDR, NULL, &size, &bytes_read));
+	ut_asserteq(FIT_DATA_POS + FIT_DATA_LEN, size);
+	ut_asserteq('a', buf[FIT_DATA_POS]);
+	unmap_sysmem(buf);
+
+	/* Image data must be inside the file */
+	ut_assertok(write_fit(uts, pos2 + 1, 0));
+	ut_asserteq(-EINVAL, load_fit(FIT_LOAD_ADDR, "conf-2", &size,
+				      &bytes_read));
+	ut_assertok(write_fit(uts, 0x7fffffff, 0));
+	ut_asserteq(-EINVAL, load_fit(FIT_LOAD_ADDR, "conf-2", &size,
+				      &bytes_read));
+
+	/* So must the FIT structure */
+	ut_assertok(write_fit(uts, pos2, 0x10000));
+	ut_asserteq(-EINVAL, load_fit(FIT_LOAD_ADDR, NULL, &size,
+				      &bytes_read));
+
+	/* Nothing may be read outside the available memory */
+	ut_assertok(write_fit(uts, pos2, 0));
+	ut_asserteq(-ENOSPC, load_fit(gd->ram_size - FIT_DATA_POS, NULL,
+				      &size, &bytes_read));
+	ut_assertok(os_unlink(FIT_FNAME));
+
+	return 0;
+}
+DM_TEST(dm_test_fitload, 0);
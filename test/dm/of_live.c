@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for building the live tree on demand
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <malloc.h>
+#include <of_live.h>
+#include <dm/of_access.h>
+#include <dm/test.h>
+#include <linux/libfdt.h>
+#include <test/ut.h>
+
+/* A tree like a large SoC's, where only one device in five is enabled */
+#define SOC_DEVICES		1000
+#define SOC_ENABLED_EVERY	5
+#define SOC_PORTS		4
+#define SOC_FDT_SIZE		(512 << 10)
+
+static int make_soc_fdt(struct unit_test_state *uts, void *fdt)
+{
+	char name[20];
+	int i, j;
+
+	ut_assertok(fdt_create(fdt, SOC_FDT_SIZE));
+	ut_assertok(fdt_finish_reservemap(fdt));
+	ut_assertok(fdt_begin_node(fdt, ""));
+	ut_assertok(fdt_property_u32(fdt, "#address-cells", 1));
+	ut_assertok(fdt_property_u32(fdt, "#size-cells", 1));
+	ut_assertok(fdt_begin_node(fdt, "soc"));
+	ut_assertok(fdt_property_string(fdt, "compatible", "simple-bus"));
+	for (i = 0; i < SOC_DEVICES; i++) {
+		snprintf(name, sizeof(name), "dev@%x", i * 0x1000);
+		ut_assertok(fdt_begin_node(fdt, name));
+		ut_assertok(fdt_property_string(fdt, "compatible",
+						"vendor,soc-dev"));
+		ut_assertok(fdt_property_u32(fdt, "reg", i * 0x1000));
+		ut_assertok(fdt_property_u32(fdt, "interrupts", i));
+		ut_assertok(fdt_property_u32(fdt, "phandle", i + 1));
+		ut_assertok(fdt_property_string(fdt, "status",
+				i % SOC_ENABLED_EVERY ? "disabled" : "okay"));
+		for (j = 0; j < SOC_PORTS; j++) {
+			snprintf(name, sizeof(name), "port@%d", j);
+			ut_assertok(fdt_begin_node(fdt, name));
+			ut_assertok(fdt_property_u32(fdt, "reg", j));
+			ut_assertok(fdt_end_node(fdt));
+		}
+		ut_assertok(fdt_end_node(fdt));
+	}
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_end_node(fdt));
+	ut_assertok(fdt_finish(fdt));
+
+	return 0;
+}
+
+/* Visit the nodes that driver model would bind, returning how many */
+static int scan_tree(struct device_node *parent)
+{
+	struct device_node *np;
+	int count = 0;
+
+	for (np = of_node_child(parent); np; np = np->sibling) {
+		if (of_device_is_available(np))
+			count += 1 + scan_tree(np);
+	}
+
+	return count;
+}
+
+/*
+ * Build and scan a tree, returning the time taken and memory used. The tree is
+ * left built so that the caller can check it.
+ */
+static int build_tree(struct unit_test_state *uts, const void *fdt, bool lazy,
+		      struct device_node **rootp, int *countp, ulong *usp,
+		      ulong *bytesp)
+{
+	ulong start_bytes = mallinfo().uordblks;
+	ulong start = timer_get_us();
+
+	ut_assertok(of_live_unflatten(fdt, lazy, rootp));
+	*countp = scan_tree(*rootp);
+	*usp = timer_get_us() - start;
+	*bytesp = mallinfo().uordblks - start_bytes;
+
+	return 0;
+}
+
+/* Test that a lazy tree matches a full one but uses less memory */
+static int dm_test_of_live_lazy(struct unit_test_state *uts)
+{
+	struct device_node *full, *lazy, *np;
+	ulong full_us, lazy_us, full_bytes, lazy_bytes;
+	int full_count, lazy_count, offset;
+	void *fdt;
+
+	fdt = malloc(SOC_FDT_SIZE);
+	ut_assertnonnull(fdt);
+	ut_assertok(make_soc_fdt(uts, fdt));
+
+	ut_assertok(build_tree(uts, fdt, false, &full, &full_count, &full_us,
+			       &full_bytes));
+	ut_assertok(build_tree(uts, fdt, true, &lazy, &lazy_count, &lazy_us,
+			       &lazy_bytes));
+	debug("of_live: %d of %d devices enabled: full tree %lu us %lu bytes, lazy tree %lu us %lu bytes\n",
+	      SOC_DEVICES / SOC_ENABLED_EVERY, SOC_DEVICES, full_us,
+	      full_bytes, lazy_us, lazy_bytes);
+	ut_asserteq(1 + SOC_DEVICES / SOC_ENABLED_EVERY * (1 + SOC_PORTS),
+		    full_count);
+	ut_asserteq(full_count, lazy_count);
+	ut_assert(lazy_bytes < full_bytes);
+
+	/* The subnodes of a disabled device are built when looked up */
+	np = of_node_child(lazy)->child->sibling->sibling;
+	ut_asserteq_str("/soc/dev@2000", np->full_name);
+	ut_asserteq(OF_LAZY_CHILDREN, np->lazy);
+	ut_assertok(of_live_expand(np, OF_LAZY_CHILDREN));
+	ut_asserteq(0, np->lazy);
+	offset = fdt_path_offset(fdt, "/soc/dev@2000/port@3");
+	np = of_live_find_offset(lazy, offset);
+	ut_assertnonnull(np);
+	ut_asserteq_str("/soc/dev@2000/port@3", np->full_name);
+	ut_asserteq_str("port", np->name);
+	ut_asserteq_str("port", of_get_property(np, "name", NULL));
+
+	/* An offset which is not the start of a node is not found */
+	ut_assertnull(of_live_find_offset(lazy, offset + 4));
+	ut_assertnull(of_live_find_offset(lazy, fdt_first_property_offset(
+		fdt, fdt_path_offset(fdt, "/soc/dev@2000"))));
+
+	/* Phandles and properties match the full tree */
+	offset = fdt_node_offset_by_phandle(fdt, 0x43);
+	np = of_live_find_offset(lazy, offset);
+	ut_assertnonnull(np);
+	ut_asserteq(0x43, np->phandle);
+	ut_asserteq_str("/soc/dev@42000", np->full_name);
+	ut_asserteq_str("dev", np->name);
+	ut_asserteq_str("disabled", of_get_property(np, "status", NULL));
+
+	of_live_free(lazy);
+	of_live_free(full);
+	free(fdt);
+
+	return 0;
+}
+DM_TEST(dm_test_of_live_lazy, 0);
@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for binding devices from a table generated by dtoc
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <fdtdec.h>
+#include <os.h>
+#include <asm/state.h>
+#include <dm/device-internal.h>
+#include <dm/platdata.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <dm/uclass-internal.h>
+#include <dm/util.h>
+#include <linux/libfdt.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+static const char *const prebind_names[] = { "a-test", "junk", "b-test" };
+
+/* Set up a table like the one dtoc generates, for some of the test nodes */
+static int setup_table(struct unit_test_state *uts, const void *blob,
+		       struct dm_prebind_table *table,
+		       struct dm_prebind entries[])
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(prebind_names); i++) {
+		entries[i].name = prebind_names[i];
+		entries[i].offset = fdt_subnode_offset(blob, 0,
+						       prebind_names[i]);
+		ut_assert(entries[i].offset > 0);
+		entries[i].compat = fdt_getprop(blob, entries[i].offset,
+						"compatible",
+						&entries[i].compat_len);
+		ut_assertnonnull(entries[i].compat);
+		entries[i].driver = NULL;
+		entries[i].pre_reloc = dm_ofnode_pre_reloc(
+				offset_to_ofnode(entries[i].offset));
+	}
+	table->totalsize = fdt_totalsize(blob);
+	table->size_dt_struct = fdt_size_dt_struct(blob);
+	table->size_dt_strings = fdt_size_dt_strings(blob);
+	table->count = ARRAY_SIZE(prebind_names);
+	table->entries = entries;
+
+	return 0;
+}
+
+/* Count the devices in the test uclass */
+static int count_test_devices(void)
+{
+	struct udevice *dev;
+	struct uclass *uc;
+	int count = 0;
+
+	if (uclass_get(UCLASS_TEST_FDT, &uc))
+		return -1;
+	uclass_foreach_dev(dev, uc)
+		count++;
+
+	return count;
+}
+
+/* Count the nodes that dm_scan_fdt() would bind in a node */
+static int count_bound_nodes(const void *blob, int parent)
+{
+	const char *name;
+	int node, count = 0;
+
+	fdt_for_each_subnode(node, blob, parent) {
+		name = fdt_get_name(blob, node, NULL);
+		if (!strcmp(name, "chosen") || !strcmp(name, "firmware"))
+			count += count_bound_nodes(blob, node);
+		else if (fdtdec_get_is_enabled(blob, node) &&
+			 fdt_getprop(blob, node, "compatible", NULL))
+			count++;
+	}
+
+	return count;
+}
+
+/* Check a node as dm_ofnode_pre_reloc() does, for a tree other than gd's */
+static bool is_pre_reloc(const void *blob, int node)
+{
+	return fdt_getprop(blob, node, "u-boot,dm-pre-reloc", NULL) ||
+	       fdt_getprop(blob, node, "u-boot,dm-spl", NULL) ||
+	       fdt_getprop(blob, node, "u-boot,dm-tpl", NULL);
+}
+
+/* Test that the table generated by dtoc matches the default device tree */
+static int dm_test_prebind_generated(struct unit_test_state *uts)
+{
+	const struct dm_prebind_table *table = &dm_prebind_table;
+	struct sandbox_state *state = state_get_current();
+	const struct dm_prebind *entry;
+	char fname[256];
+	const void *compat;
+	int size, len, i;
+	void *blob;
+
+	/* This is the file used by the -D option */
+	snprintf(fname, sizeof(fname), "%s.dtb", state->argv[0]);
+	ut_assertok(os_read_file(fname, &blob, &size));
+
+	ut_asserteq(size, table->totalsize);
+	ut_asserteq(fdt_size_dt_struct(blob), table->size_dt_struct);
+	ut_asserteq(fdt_size_dt_strings(blob), table->size_dt_strings);
+	ut_asserteq(count_bound_nodes(blob, 0), table->count);
+	for (i = 0, entry = table->entries; i < table->count; i++, entry++) {
+		ut_asserteq_str(entry->name,
+				fdt_get_name(blob, entry->offset, NULL));
+		compat = fdt_getprop(blob, entry->offset, "compatible", &len);
+		ut_asserteq(len, entry->compat_len);
+		ut_assertok(memcmp(compat, entry->compat, len));
+		ut_asserteq(is_pre_reloc(blob, entry->offset), entry->pre_reloc);
+		if (!strcmp(entry->name, "serial")) {
+			ut_asserteq_ptr(DM_GET_DRIVER(serial_sandbox),
+					entry->driver);
+		}
+	}
+	os_free(blob);
+
+	return 0;
+}
+DM_TEST(dm_test_prebind_generated, 0);
+
+/* Test binding devices from a prebind table */
+static int dm_test_prebind(struct unit_test_state *uts)
+{
+	struct dm_prebind entries[ARRAY_SIZE(prebind_names)];
+	const void *blob = gd->fdt_blob;
+	struct dm_prebind_table table;
+	struct udevice *dev;
+
+	ut_assertok(setup_table(uts, blob, &table, entries));
+	ut_asserteq(0, count_test_devices());
+
+	/* The generated table is for sandbox.dts, not test.dts */
+	ut_assert(dm_prebind_table.count > 0);
+	ut_asserteq(-EAGAIN, dm_scan_prebind(blob, &dm_prebind_table, false));
+
+	/* Nothing is bound if the tree has changed size... */
+	table.size_dt_strings++;
+	ut_asserteq(-EAGAIN, dm_scan_prebind(blob, &table, false));
+	table.size_dt_strings--;
+
+	/* ...or if any node is not where the table says */
+	entries[2].name = "c-test";
+	ut_asserteq(-EAGAIN, dm_scan_prebind(blob, &table, false));
+	ut_asserteq(0, count_test_devices());
+	entries[2].name = prebind_names[2];
+
+	/* Before relocation only the nodes marked for it are bound */
+	ut_assertok(dm_scan_prebind(blob, &table, true));
+	ut_asserteq(1, count_test_devices());
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "a-test",
+					       &dev));
+	ut_asserteq(entries[0].offset, dev_of_offset(dev));
+	ut_asserteq_str("testfdt_drv", dev->driver->name);
+	ut_assertok(device_unbind(dev));
+
+	/* The node with no driver is skipped, as when scanning the tree */
+	ut_assertok(dm_scan_prebind(blob, &table, false));
+	ut_asserteq(2, count_test_devices());
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "b-test",
+					       &dev));
+	ut_asserteq(entries[2].offset, dev_of_offset(dev));
+
+	return 0;
+}
+DM_TEST(dm_test_prebind, DM_TESTF_FLAT_TREE);
+
+/* Test binding devices to the drivers given in a prebind table */
+static int dm_test_prebind_driver(struct unit_test_state *uts)
+{
+	struct dm_prebind entries[ARRAY_SIZE(prebind_names)];
+	const void *blob = gd->fdt_blob;
+	struct dm_prebind_table table;
+	struct udevice *dev;
+
+	ut_assertok(setup_table(uts, blob, &table, entries));
+
+	/* A driver which does not match its node is looked up as usual */
+	entries[0].driver = DM_GET_DRIVER(root_driver);
+	entries[2].driver = DM_GET_DRIVER(testfdt1_drv);
+	entries[2].pre_reloc = true;
+	ut_assertok(dm_scan_prebind(blob, &table, true));
+	ut_asserteq(1, count_test_devices());
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "a-test",
+					       &dev));
+	ut_asserteq_str("testfdt_drv", dev->driver->name);
+	ut_assertok(device_unbind(dev));
+
+	/*
+	 * A driver which matches is bound directly, and the table rather than
+	 * the tree says whether to bind it before relocation
+	 */
+	entries[2].driver = DM_GET_DRIVER(testfdt_drv);
+	ut_assertok(dm_scan_prebind(blob, &table, true));
+	ut_asserteq(2, count_test_devices());
+	ut_assertok(uclass_find_device_by_name(UCLASS_TEST_FDT, "b-test",
+					       &dev));
+	ut_asserteq(entries[2].offset, dev_of_offset(dev));
+	ut_asserteq_str("testfdt_drv", dev->driver->name);
+
+	return 0;
+}
+DM_TEST(dm_test_prebind_driver, DM_TESTF_FLAT_TREE);
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for starting slow devices early with dm_probe_async()
+ */
+
+#include <common.h>
+#include <dm.h>
+#include <dm/device-internal.h>
+#include <dm/root.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+/*
+ * Simulated time in microseconds. Each poll of a device which is not ready
+ * yet moves this on by SLOW_PROBE_POLL_US, so the test does not depend on
+ * how fast the host is.
+ */
+#define SLOW_PROBE_POLL_US	1000
+
+static ulong slow_probe_now;
+
+/**
+ * struct sandbox_slow_probe_priv - Private data for a slow device
+ *
+ * @start_us: Simulated time when probe() was called
+ * @ready_us: Simulated time when probe_wait() found the device ready, or 0
+ */
+struct sandbox_slow_probe_priv {
+	ulong start_us;
+	ulong ready_us;
+};
+
+static int sandbox_slow_probe_probe(struct udevice *dev)
+{
+	struct sandbox_slow_probe_priv *priv = dev_get_priv(dev);
+
+	/* Pretend to start some hardware which takes a while to be ready */
+	priv->start_us = slow_probe_now;
+	priv->ready_us = 0;
+
+	return 0;
+}
+
+static int sandbox_slow_probe_wait(struct udevice *dev)
+{
+	struct sandbox_slow_probe_priv *priv = dev_get_priv(dev);
+
+	if (slow_probe_now - priv->start_us <
+	    dev_read_u32_default(dev, "probe-delay-us", 0)) {
+		slow_probe_now += SLOW_PROBE_POLL_US;
+		return -EBUSY;
+	}
+	priv->ready_us = slow_probe_now;
+
+	return 0;
+}
+
+static const struct udevice_id sandbox_slow_probe_ids[] = {
+	{ .compatible = "sandbox,slow-probe" },
+	{ }
+};
+
+U_BOOT_DRIVER(sandbox_slow_probe) = {
+	.name		= "sandbox_slow_probe",
+	.id		= UCLASS_MISC,
+	.of_match	= sandbox_slow_probe_ids,
+	.probe		= sandbox_slow_probe_probe,
+	.probe_wait	= sandbox_slow_probe_wait,
+	.priv_auto_alloc_size = sizeof(struct sandbox_slow_probe_priv),
+	.flags		= DM_FLAG_PROBE_ASYNC,
+};
+
+static const char *const slow_probe_names[] = {
+	"slow-probe-a", "slow-probe-b", "slow-probe-c",
+};
+
+/* Probe each slow device in turn, returning the simulated time taken */
+static int probe_slow_devices(struct unit_test_state *uts, ulong *usp,
+			      struct udevice *devs[])
+{
+	ulong start = slow_probe_now;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(slow_probe_names); i++) {
+		ut_assertok(uclass_get_device_by_name(UCLASS_MISC,
+						      slow_probe_names[i],
+						      &devs[i]));
+		ut_assert(device_active(devs[i]));
+		ut_assert(!(devs[i]->flags & DM_FLAG_PROBE_STARTED));
+	}
+	*usp = slow_probe_now - start;
+
+	return 0;
+}
+
+/* Test that slow devices are started together, in dependency order */
+static int dm_test_probe_async(struct unit_test_state *uts)
+{
+	struct sandbox_slow_probe_priv *a, *c;
+	struct udevice *devs[3];
+	ulong sync_us, async_us, start;
+	int i;
+
+	/* Without dm_probe_async() each device is waited for in turn */
+	slow_probe_now = 0;
+	ut_assertok(probe_slow_devices(uts, &sync_us, devs));
+	ut_asserteq(60000, sync_us);
+	for (i = 0; i < ARRAY_SIZE(devs); i++)
+		ut_assertok(device_remove(devs[i], DM_REMOVE_NORMAL));
+
+	start = slow_probe_now;
+	ut_assertok(dm_probe_async());
+
+	/* slow-probe-c uses slow-probe-a as a clock so must wait for it */
+	ut_assert(device_active(devs[0]));
+	ut_assert(!(devs[0]->flags & DM_FLAG_PROBE_STARTED));
+
+	/* The others are not active until their probe has finished */
+	ut_assert(devs[1]->flags & DM_FLAG_PROBE_STARTED);
+	ut_assert(devs[2]->flags & DM_FLAG_PROBE_STARTED);
+	ut_assert(!device_active(devs[1]));
+	ut_assert(!device_active(devs[2]));
+
+	ut_assertok(probe_slow_devices(uts, &async_us, devs));
+	async_us = slow_probe_now - start;
+	a = dev_get_priv(devs[0]);
+	c = dev_get_priv(devs[2]);
+	ut_asserteq(a->ready_us, c->start_us);
+
+	/* b waits alongside a, then c on its own */
+	ut_asserteq(40000, async_us);
+
+	return 0;
+}
+DM_TEST(dm_test_probe_async, DM_TESTF_SCAN_FDT);
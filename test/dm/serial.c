@@ -6,6 +6,8 @@
 #include <common.h>
 #include <serial.h>
 #include <dm.h>
+#include <stdio_dev.h>
+#include <asm/test.h>
 #include <dm/test.h>
 #include <test/ut.h>
 
@@ -67,3 +69,47 @@ static int dm_test_serial(struct unit_test_state *uts)
 }
 
 DM_TEST(dm_test_serial, DM_TESTF_SCAN_FDT);
+
+static int dm_test_serial_puts(struct unit_test_state *uts)
+{
+	const char *str = "serial\nputs\n";
+	struct serial_dev_priv *upriv;
+	int start, start_calls, calls;
+	struct stdio_dev *sdev;
+	struct udevice *dev;
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_SERIAL, "serial", &dev));
+	upriv = dev_get_uclass_priv(dev);
+	sdev = upriv->sdev;
+	ut_assertnonnull(sdev);
+
+	/* Each '\n' gains a '\r', and runs are written a FIFO at a time */
+	start = sandbox_serial_get_written(dev, &start_calls);
+	sandbox_serial_set_fifo(dev, 4, false);
+	sdev->puts(sdev, str);
+	ut_asserteq(start + strlen(str) + 2,
+		    sandbox_serial_get_written(dev, &calls));
+	ut_assert(calls - start_calls < strlen(str));
+	ut_assert(calls - start_calls >= (strlen(str) + 2) / 4);
+
+#if CONFIG_IS_ENABLED(SERIAL_TX_BUFFER)
+	/* Output is held while the UART is busy and sent when polled */
+	ut_assertnonnull(upriv->tx_buf);
+	start = sandbox_serial_get_written(dev, &start_calls);
+	sandbox_serial_set_fifo(dev, 4, true);
+	sdev->puts(sdev, str);
+	sdev->putc(sdev, '\n');
+	ut_asserteq(start, sandbox_serial_get_written(dev, &calls));
+	ut_asserteq(start_calls, calls);
+
+	sandbox_serial_set_fifo(dev, 0, false);
+	sdev->tstc(sdev);
+	ut_asserteq(start + strlen(str) + 4,
+		    sandbox_serial_get_written(dev, &calls));
+	ut_asserteq(upriv->tx_rd, upriv->tx_wr);
+#endif
+	sandbox_serial_set_fifo(dev, 0, false);
+
+	return 0;
+}
+DM_TEST(dm_test_serial_puts, DM_TESTF_SCAN_FDT);
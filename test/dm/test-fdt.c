@@ -794,3 +794,177 @@ static int dm_test_read_int(struct unit_test_state *uts)
 	return 0;
 }
 DM_TEST(dm_test_read_int, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Find the driver for a compatible string by checking every driver */
+static int linear_lookup_compat(const char *compat, struct driver **drvp,
+				const struct udevice_id **of_idp)
+{
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const struct udevice_id *of_match;
+	struct driver *entry;
+
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			if (!strcmp(of_match->compatible, compat)) {
+				*drvp = entry;
+				*of_idp = of_match;
+				return 0;
+			}
+		}
+	}
+
+	return -ENOENT;
+}
+
+/* Test that drivers are found by compatible string as a linear search would */
+static int dm_test_fdt_compat_lookup(struct unit_test_state *uts)
+{
+	const struct udevice_id *of_id, *expect_id;
+	struct driver *driver = ll_entry_start(struct driver, driver);
+	const int n_ents = ll_entry_count(struct driver, driver);
+	const void *blob = gd->fdt_blob;
+	struct driver *entry, *drv, *expect_drv;
+	const struct udevice_id *of_match;
+	ulong linear_us, lookup_us, start;
+	int node, depth, len, i;
+	const char *compat;
+	int count = 0;
+	int ret;
+
+	/* Every compatible string of every driver */
+	for (entry = driver; entry != driver + n_ents; entry++) {
+		for (of_match = entry->of_match;
+		     of_match && of_match->compatible; of_match++) {
+			compat = of_match->compatible;
+			ut_assertok(linear_lookup_compat(compat, &expect_drv,
+							 &expect_id));
+			ut_assertok(lists_driver_lookup_compat(compat, &drv,
+							       &of_id));
+			ut_asserteq_ptr(expect_drv, drv);
+			ut_asserteq_ptr(expect_id, of_id);
+		}
+	}
+	ut_asserteq(-ENOENT, lists_driver_lookup_compat("denx,no-such-driver",
+							&drv, &of_id));
+
+	/* Every compatible string in the device tree, timing each method */
+	linear_us = 0;
+	lookup_us = 0;
+	for (node = 0, depth = 0; node >= 0;
+	     node = fdt_next_node(blob, node, &depth)) {
+		compat = fdt_getprop(blob, node, "compatible", &len);
+		for (i = 0; compat && i < len; i += strlen(compat + i) + 1) {
+			start = timer_get_us();
+			ret = linear_lookup_compat(compat + i, &expect_drv,
+						   &expect_id);
+			linear_us += timer_get_us() - start;
+
+			start = timer_get_us();
+			ut_asserteq(ret, lists_driver_lookup_compat(compat + i,
+								    &drv,
+								    &of_id));
+			lookup_us += timer_get_us() - start;
+			if (!ret) {
+				ut_asserteq_ptr(expect_drv, drv);
+				ut_asserteq_ptr(expect_id, of_id);
+			}
+			count++;
+		}
+	}
+	debug("%d compatible strings: linear %lu us, lookup %lu us\n", count,
+	      linear_us, lookup_us);
+
+	/* Check the result for a known driver */
+	ut_assertok(lists_driver_lookup_compat("denx,u-boot-fdt-test", &drv,
+					       &of_id));
+	ut_asserteq_str("testfdt_drv", drv->name);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_compat_lookup, 0);
+
+/* Check each phandle in the control FDT against a search of the tree */
+static int check_phandle_lookups(struct unit_test_state *uts)
+{
+	const void *blob = gd->fdt_blob;
+	int offset;
+	uint phandle;
+	int count = 0;
+
+	for (offset = fdt_next_node(blob, -1, NULL); offset >= 0;
+	     offset = fdt_next_node(blob, offset, NULL)) {
+		phandle = fdt_get_phandle(blob, offset);
+		if (!phandle)
+			continue;
+		ut_asserteq(fdt_node_offset_by_phandle(blob, phandle),
+			    fdtdec_node_offset_by_phandle(blob, phandle));
+		count++;
+	}
+	ut_assert(count > 0);
+	ut_asserteq(fdt_node_offset_by_phandle(blob, 0xfffe),
+		    fdtdec_node_offset_by_phandle(blob, 0xfffe));
+
+	return 0;
+}
+
+/* Check each path against a search of the tree, twice to use the cache */
+static int check_path_lookups(struct unit_test_state *uts, int count,
+			      const char *const paths[])
+{
+	const void *blob = gd->fdt_blob;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		ut_asserteq(fdt_path_offset(blob, paths[i]),
+			    fdtdec_path_offset(blob, paths[i]));
+		ut_asserteq(fdt_path_offset(blob, paths[i]),
+			    fdtdec_path_offset(blob, paths[i]));
+	}
+
+	return 0;
+}
+
+/* Test that phandle and path lookups are right after the tree changes */
+static int dm_test_fdt_lookup_cache(struct unit_test_state *uts)
+{
+	static const char *const paths[] = {
+		"/aliases", "/chosen", "/config", "/a-test", "/b-test",
+		"testfdt8", "/no-such-node",
+	};
+	const void *old_blob = gd->fdt_blob;
+	int size, node;
+	void *blob;
+
+	/* Use a copy of the control FDT, with space to change it */
+	size = fdt_totalsize(old_blob) + 256;
+	blob = malloc(size);
+	ut_assertnonnull(blob);
+	ut_assertok(fdt_open_into(old_blob, blob, size));
+	gd->fdt_blob = blob;
+
+	ut_assertok(check_phandle_lookups(uts));
+	ut_assertok(check_path_lookups(uts, ARRAY_SIZE(paths), paths));
+
+	/* Adding a property to the root node moves every other node */
+	ut_assertok(fdt_setprop_u32(blob, 0, "lookup-cache-test", 1));
+	ut_assertok(check_phandle_lookups(uts));
+	ut_assertok(check_path_lookups(uts, ARRAY_SIZE(paths), paths));
+
+	/* Renaming a node in place leaves the structure block the same size */
+	size = fdt_size_dt_struct(blob);
+	node = fdt_path_offset(blob, "/a-test");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_set_name(blob, node, "x-test"));
+	ut_asserteq(size, fdt_size_dt_struct(blob));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdtdec_path_offset(blob, "/a-test"));
+	ut_asserteq(node, fdtdec_path_offset(blob, "/x-test"));
+	ut_assertok(check_path_lookups(uts, ARRAY_SIZE(paths), paths));
+
+	gd->fdt_blob = old_blob;
+	free(blob);
+
+	return 0;
+}
+DM_TEST(dm_test_fdt_lookup_cache, 0);
@@ -0,0 +1,117 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for tracepoint records
+ */
+
+#include <common.h>
+#include <blk.h>
+#include <dm.h>
+#include <malloc.h>
+#include <tracepoint.h>
+#include <dm/device-internal.h>
+#include <dm/test.h>
+#include <test/ut.h>
+
+#define STASH_SIZE	(sizeof(struct tracepoint_hdr) + \
+			 CONFIG_TRACEPOINT_RECORD_COUNT * \
+			 sizeof(struct tracepoint_rec))
+
+/* Count the records for an event in a stash, returning the first in @recp */
+static int count_recs(struct tracepoint_hdr *hdr, enum tracepoint_id id,
+		      const char *name, struct tracepoint_rec **recp)
+{
+	struct tracepoint_rec *rec = (struct tracepoint_rec *)(hdr + 1);
+	int count = 0;
+	int i;
+
+	*recp = NULL;
+	for (i = 0; i < hdr->count; i++, rec++) {
+		if (rec->id == id &&
+		    !strncmp(rec->name, name, TRACEPOINT_NAME_LEN)) {
+			if (!count++)
+				*recp = rec;
+		}
+	}
+
+	return count;
+}
+
+/* Test that probing and block reads are recorded */
+static int dm_test_tracepoint(struct unit_test_state *uts)
+{
+	struct tracepoint_hdr *hdr;
+	struct tracepoint_rec *rec;
+	struct blk_desc *desc;
+	struct udevice *dev;
+	char buf[512];
+	int ret;
+
+	hdr = malloc(STASH_SIZE);
+	ut_assertnonnull(hdr);
+	tracepoint_clear();
+	ut_assertok(tracepoint_set_mask(BIT(TP_DM_PROBE) | BIT(TP_BLK_READ)));
+
+	ut_assertok(uclass_get_device_by_name(UCLASS_TEST_FDT, "a-test", &dev));
+
+	/* Probing an active device is not recorded */
+	ut_assertok(device_probe(dev));
+
+	ret = tracepoint_stash(hdr, STASH_SIZE);
+	ut_asserteq(sizeof(*hdr) + hdr->count * sizeof(*rec), ret);
+	ut_asserteq(TRACEPOINT_MAGIC, hdr->magic);
+	ut_asserteq(sizeof(*rec), hdr->rec_size);
+	ut_asserteq(0, hdr->dropped);
+	ut_asserteq(1, count_recs(hdr, TP_DM_PROBE, "a-test", &rec));
+	ut_asserteq(UCLASS_TEST_FDT, rec->arg[0]);
+	ut_asserteq(0, rec->arg[1]);
+
+	/* Probing reads the partition table, so drop those records */
+	ut_assertok(blk_get_device_by_str("mmc", "0", &desc));
+	tracepoint_clear();
+	blkcache_invalidate(desc->if_type, desc->devnum);
+	ut_asserteq(1, blk_dread(desc, 1, 1, buf));
+
+	/* MMC commands are not enabled, so are not recorded */
+	ut_assert(tracepoint_stash(hdr, STASH_SIZE) > 0);
+	ut_asserteq(1, hdr->count);
+	ut_asserteq(1, count_recs(hdr, TP_BLK_READ, desc->bdev->name, &rec));
+	ut_asserteq(1, rec->arg[0]);
+	ut_asserteq(1, rec->arg[1]);
+
+	ut_assertok(tracepoint_set_mask(CONFIG_TRACEPOINT_MASK));
+	free(hdr);
+
+	return 0;
+}
+DM_TEST(dm_test_tracepoint, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that the oldest records are dropped when the buffer is full */
+static int dm_test_tracepoint_wrap(struct unit_test_state *uts)
+{
+	struct tracepoint_hdr *hdr;
+	struct tracepoint_rec *rec;
+	int i;
+
+	hdr = malloc(STASH_SIZE);
+	ut_assertnonnull(hdr);
+	tracepoint_clear();
+	for (i = 0; i < CONFIG_TRACEPOINT_RECORD_COUNT + 5; i++)
+		tracepoint_add(TP_FS_READ, timer_get_boot_us(), "/dir/file", i,
+			       0);
+	ut_asserteq(-ENOSPC, tracepoint_stash(hdr, STASH_SIZE - 1));
+	ut_asserteq(STASH_SIZE, tracepoint_stash(hdr, STASH_SIZE));
+	ut_asserteq(CONFIG_TRACEPOINT_RECORD_COUNT, hdr->count);
+	ut_asserteq(5, hdr->dropped);
+
+	/* Records are oldest first and only have the last part of the path */
+	rec = (struct tracepoint_rec *)(hdr + 1);
+	ut_asserteq(5, rec->arg[0]);
+	ut_asserteq_str("file", rec->name);
+	rec += CONFIG_TRACEPOINT_RECORD_COUNT - 1;
+	ut_asserteq(CONFIG_TRACEPOINT_RECORD_COUNT + 4, rec->arg[0]);
+	tracepoint_clear();
+	free(hdr);
+
+	return 0;
+}
+DM_TEST(dm_test_tracepoint_wrap, 0);
@@ -4,8 +4,10 @@
  */
 
 #include <common.h>
+#include <bootstage.h>
 #include <console.h>
 #include <dm.h>
+#include <malloc.h>
 #include <usb.h>
 #include <asm/io.h>
 #include <asm/state.h>
@@ -55,6 +57,96 @@ static int dm_test_usb_flash(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_flash, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* Test that storage reads queue the status phase behind the data */
+static int dm_test_usb_stream(struct unit_test_state *uts)
+{
+	struct blk_desc *dev_desc;
+	struct usb_bus_priv *priv;
+	struct usb_device *udev;
+	struct udevice *dev;
+	int streams, xfers, old_xfers;
+	char cmp[1024];
+	u64 bytes;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+	ut_assertok(blk_get_device_by_str("usb", "0", &dev_desc));
+	udev = dev_get_parent_priv(dev);
+	priv = dev_get_uclass_priv(udev->controller_dev);
+	streams = sandbox_usb_get_streams(udev->controller_dev, &old_xfers);
+	bytes = priv->bulk_bytes;
+
+	/* The CBW is sent on its own, then the data and CSW are streamed */
+	blkcache_invalidate(dev_desc->if_type, dev_desc->devnum);
+	memset(cmp, '\0', sizeof(cmp));
+	ut_asserteq(2, blk_dread(dev_desc, 0, 2, cmp));
+	ut_assertok(strcmp(cmp, "this is a test"));
+	ut_asserteq(streams + 1,
+		    sandbox_usb_get_streams(udev->controller_dev, &xfers));
+	ut_asserteq(old_xfers + 2, xfers);
+
+	/* The emulator reports no bytes transferred for the CBW */
+	ut_asserteq(sizeof(cmp) + UMASS_BBB_CSW_SIZE, priv->bulk_bytes - bytes);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_stream, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Test that a UAS device is used, with several commands queued at once */
+static int dm_test_usb_uas(struct unit_test_state *uts)
+{
+	const int blocks = 100, size = blocks * 512;
+	struct blk_desc *dev_desc;
+	struct udevice *emul;
+	char *buf, *cmp;
+	int i;
+
+	state_set_skip_delays(true);
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device_by_name(UCLASS_USB_EMUL, "uas@4",
+					      &emul));
+	ut_asserteq(3, blk_get_device_by_str("usb", "3", &dev_desc));
+	ut_asserteq_str("uas", dev_desc->product);
+	buf = malloc(size);
+	ut_assertnonnull(buf);
+	cmp = malloc(size);
+	ut_assertnonnull(cmp);
+
+	/* Each command reads at most 20 blocks, so this needs five */
+	sandbox_usb_uas_get_max_queued(emul);
+	memset(buf, '\0', size);
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+	ut_asserteq(CONFIG_USB_UAS_QUEUE_DEPTH,
+		    sandbox_usb_uas_get_max_queued(emul));
+
+	/* Write some data and read it back, then put back the zeroes */
+	for (i = 0; i < size; i++)
+		buf[i] = i;
+	ut_asserteq(blocks, blk_dwrite(dev_desc, 1000, blocks, buf));
+	ut_asserteq(blocks, blk_dread(dev_desc, 1000, blocks, cmp));
+	ut_assertok(memcmp(buf, cmp, size));
+	memset(buf, '\0', size);
+	ut_asserteq(blocks, blk_dwrite(dev_desc, 1000, blocks, buf));
+
+	/*
+	 * The second command runs off the end of the device and fails, even
+	 * though the emulator runs it first
+	 */
+	ut_asserteq(20, blk_dread(dev_desc, dev_desc->lba - 30, 40, buf));
+	ut_asserteq(blocks, blk_dread(dev_desc, 0, blocks, buf));
+	ut_assertok(strcmp(buf, "this is a test"));
+
+	free(cmp);
+	free(buf);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_uas, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 /* test that we can handle multiple storage devices */
 static int dm_test_usb_multi(struct unit_test_state *uts)
 {
@@ -71,6 +163,56 @@ static int dm_test_usb_multi(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_multi, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+#if CONFIG_IS_ENABLED(BOOTSTAGE_SPANS)
+/* Check that @span is inside @outer, directly or not */
+static bool span_is_inside(int span, int outer)
+{
+	const struct bootstage_span *sp;
+
+	for (sp = bootstage_span_get(span); sp; sp = bootstage_span_get(span)) {
+		if (sp->parent == outer)
+			return true;
+		span = sp->parent;
+	}
+
+	return false;
+}
+
+/* test that the devices on all buses are set up in a single scan */
+static int dm_test_usb_scan(struct unit_test_state *uts)
+{
+	const struct bootstage_span *span;
+	struct udevice *dev;
+	int scan = -1, probe = -1;
+	int i;
+
+	state_set_skip_delays(true);
+	bootstage_span_clear();
+	ut_assertok(usb_init());
+	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
+
+	for (i = 0; (span = bootstage_span_get(i)); i++) {
+		if (!strcmp(span->cat, "usb")) {
+			ut_asserteq_str("scan", span->name);
+			ut_asserteq(-1, scan);
+			ut_assert(!span->open);
+			scan = i;
+		} else if (!strcmp(span->cat, "probe") &&
+			   !strcmp(span->name, dev->name)) {
+			probe = i;
+		}
+	}
+	ut_assert(scan >= 0);
+	ut_assert(probe >= 0);
+	ut_assert(span_is_inside(probe, scan));
+	ut_assertok(usb_stop());
+	bootstage_span_clear();
+
+	return 0;
+}
+DM_TEST(dm_test_usb_scan, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+#endif
+
 static int count_usb_devices(void)
 {
 	struct udevice *hub;
@@ -107,7 +249,7 @@ static int dm_test_usb_stop(struct unit_test_state *uts)
 	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 0, &dev));
 	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 1, &dev));
 	ut_assertok(uclass_get_device(UCLASS_MASS_STORAGE, 2, &dev));
-	ut_asserteq(6, count_usb_devices());
+	ut_asserteq(7, count_usb_devices());
 	ut_assertok(usb_stop());
 	ut_asserteq(0, count_usb_devices());
 
@@ -115,6 +257,32 @@ static int dm_test_usb_stop(struct unit_test_state *uts)
 }
 DM_TEST(dm_test_usb_stop, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
 
+/* test that only one port per bus is reset and waiting for an address */
+static int dm_test_usb_reset_one(struct unit_test_state *uts)
+{
+	struct udevice *bus;
+	struct uclass *uc;
+	int buses = 0;
+
+	/* The port resets take time here, so the scan could overlap them */
+	state_set_skip_delays(false);
+	ut_assertok(usb_init());
+	ut_asserteq(7, count_usb_devices());
+
+	ut_assertok(uclass_get(UCLASS_USB, &uc));
+	uclass_foreach_dev(bus, uc) {
+		if (!device_active(bus))
+			continue;
+		ut_asserteq(1, sandbox_usb_get_max_resetting(bus));
+		buses++;
+	}
+	ut_assert(buses > 0);
+	ut_assertok(usb_stop());
+
+	return 0;
+}
+DM_TEST(dm_test_usb_reset_one, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
 static int dm_test_usb_keyb(struct unit_test_state *uts)
 {
 	struct udevice *dev;
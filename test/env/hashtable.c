@@ -6,6 +6,7 @@
 
 #include <common.h>
 #include <command.h>
+#include <malloc.h>
 #include <search.h>
 #include <stdio.h>
 #include <test/env.h>
@@ -13,6 +14,7 @@
 
 #define SIZE 32
 #define ITERATIONS 10000
+#define BENCH_VARS 900
 
 static int htab_fill(struct unit_test_state *uts,
 		     struct hsearch_data *htab, size_t size)
@@ -123,3 +125,58 @@ static int env_test_htab_deletes(struct unit_test_state *uts)
 }
 
 ENV_TEST(env_test_htab_deletes, 0);
+
+/*
+ * Import an environment as large as a provisioning one, check the table grows
+ * to hold it and report the time taken and how long the searches are
+ */
+static int env_test_htab_import(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	ulong start, import_us, find_us;
+	char *env, *p;
+	ENTRY item, *ritem;
+	char key[20];
+	int i;
+
+	env = malloc(BENCH_VARS * 48);
+	ut_assertnonnull(env);
+	for (i = 0, p = env; i < BENCH_VARS; i++)
+		p += sprintf(p, "board_serial_%d=value-%08x", i,
+			     i * 2654435761U) + 1;
+	*p++ = '\0';
+
+	memset(&htab, 0, sizeof(htab));
+	start = timer_get_us();
+	ut_asserteq(1, himport_r(&htab, env, p - env, '\0', 0, 0, 0, NULL));
+	import_us = timer_get_us() - start;
+	ut_asserteq(BENCH_VARS, htab.filled);
+	ut_assert(htab.resizes > 0);
+	ut_assert(htab.filled * 100 <= htab.size * 75);
+
+	htab.searches = 0;
+	htab.probes = 0;
+	htab.max_probes = 0;
+	start = timer_get_us();
+	for (i = 0; i < BENCH_VARS; i++) {
+		sprintf(key, "board_serial_%d", i);
+		item.key = key;
+		item.data = NULL;
+		ut_assert(hsearch_r(item, FIND, &ritem, &htab, 0));
+	}
+	find_us = timer_get_us() - start;
+	debug("hashtable: %d variables in %u slots: import %lu us, find all %lu us, %lu.%02lu probes per search (max %u), %u resizes\n",
+	      BENCH_VARS, htab.size, import_us, find_us,
+	      htab.probes / htab.searches,
+	      htab.probes * 100 / htab.searches % 100, htab.max_probes,
+	      htab.resizes);
+	ut_asserteq(BENCH_VARS, htab.searches);
+	ut_assert(htab.probes < htab.searches * 2);
+
+	hdestroy_r(&htab);
+	free(env);
+
+	return 0;
+}
+
+ENV_TEST(env_test_htab_import, 0);
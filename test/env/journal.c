@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for saving environment changes in a journal
+ */
+
+#include <common.h>
+#include <env_journal.h>
+#include <malloc.h>
+#include <search.h>
+#include <test/env.h>
+#include <test/ut.h>
+
+#define JNL_SIZE	0x400
+#define JNL_ALIGN	16
+
+static char jnl_mem[JNL_SIZE];
+static ulong jnl_written;
+
+static int ram_journal_read(struct env_journal *jnl, ulong offset, ulong size,
+			    void *buf)
+{
+	memcpy(buf, jnl_mem + offset, size);
+
+	return 0;
+}
+
+static int ram_journal_write(struct env_journal *jnl, ulong offset, ulong size,
+			     const void *buf)
+{
+	const char *src = buf;
+	ulong i;
+
+	/* Like flash, erasable storage can only clear bits */
+	for (i = 0; i < size; i++) {
+		if (jnl->erase_val >= 0)
+			jnl_mem[offset + i] &= src[i];
+		else
+			jnl_mem[offset + i] = src[i];
+	}
+	jnl_written += size;
+
+	return 0;
+}
+
+/* Set up a journal in memory, empty in storage, for the environment @env */
+static int ram_journal_init(struct unit_test_state *uts,
+			    struct env_journal *jnl, int erase_val,
+			    const env_t *env)
+{
+	memset(jnl, '\0', sizeof(*jnl));
+	jnl->size = JNL_SIZE;
+	jnl->align = JNL_ALIGN;
+	jnl->erase_val = erase_val;
+	jnl->read = ram_journal_read;
+	jnl->write = ram_journal_write;
+	memset(jnl_mem, erase_val >= 0 ? erase_val : 0, JNL_SIZE);
+	ut_assertok(env_journal_start(jnl, env));
+	jnl_written = 0;
+
+	return 0;
+}
+
+/* Write @htab to @env as 'saveenv' would */
+static int export_env(struct unit_test_state *uts, struct hsearch_data *htab,
+		      env_t *env)
+{
+	char *data = (char *)env->data;
+
+	ut_assert(hexport_r(htab, '\0', 0, &data, ENV_SIZE, 0, NULL) > 0);
+	env->crc = crc32(0, env->data, ENV_SIZE);
+
+	return 0;
+}
+
+/* Load @env into @htab and apply the journal, as at start-up */
+static int load_env(struct unit_test_state *uts, struct hsearch_data *htab,
+		    struct env_journal *jnl, const env_t *env)
+{
+	hdestroy_r(htab);
+	ut_asserteq(1, himport_r(htab, (char *)env->data, ENV_SIZE, '\0', 0, 0,
+				 0, NULL));
+	ut_assertok(env_journal_replay(jnl, htab, env));
+
+	return 0;
+}
+
+static void set_var(struct hsearch_data *htab, const char *name,
+		    const char *value)
+{
+	ENTRY item, *ritem;
+
+	item.key = name;
+	item.data = (char *)value;
+	item.callback = NULL;
+	item.flags = 0;
+	hsearch_r(item, ENTER, &ritem, htab, 0);
+}
+
+static const char *get_var(struct hsearch_data *htab, const char *name)
+{
+	ENTRY item, *ritem;
+
+	item.key = name;
+	item.data = NULL;
+	if (!hsearch_r(item, FIND, &ritem, htab, 0))
+		return NULL;
+
+	return ritem->data;
+}
+
+static const char test_env[] = "bootcmd=run distro_bootcmd\0bootdelay=2\0"
+	"fdtfile=board.dtb\0serial#=1234\0";
+
+/* Test that changes are saved as small records and applied on loading */
+static int env_test_journal(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct env_journal jnl;
+	char value[20];
+	env_t *env;
+	int records;
+
+	env = malloc(sizeof(*env));
+	ut_assertnonnull(env);
+	memset(&htab, '\0', sizeof(htab));
+	ut_asserteq(1, himport_r(&htab, test_env, sizeof(test_env), '\0', 0, 0,
+				 0, NULL));
+	ut_assertok(export_env(uts, &htab, env));
+	ut_assertok(ram_journal_init(uts, &jnl, -1, env));
+
+	/* One record holds all the changes, whatever they are */
+	set_var(&htab, "bootdelay", "0");
+	ut_asserteq(1, hdelete_r("fdtfile", &htab, 0));
+	set_var(&htab, "ipaddr", "10.0.0.2");
+	ut_assertok(env_journal_append(&jnl, &htab));
+	ut_asserteq(ALIGN(sizeof(struct env_journal_rec) +
+			  sizeof("bootdelay=0\0fdtfile\0ipaddr=10.0.0.2"),
+			  JNL_ALIGN), jnl.tail);
+	ut_asserteq(jnl.tail, jnl_written);
+	debug("env journal: 3 changes written in %lu bytes, not %d\n",
+	      jnl_written, CONFIG_ENV_SIZE);
+
+	/* Nothing is written if nothing changed */
+	ut_assertok(env_journal_append(&jnl, &htab));
+	ut_asserteq(jnl.tail, jnl_written);
+	ut_asserteq(1, jnl.seq);
+
+	/* Loading the environment applies the changes */
+	set_var(&htab, "fdtfile", "other.dtb");
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(1, jnl.seq);
+	ut_asserteq_str("0", get_var(&htab, "bootdelay"));
+	ut_asserteq_str("10.0.0.2", get_var(&htab, "ipaddr"));
+	ut_asserteq_str("1234", get_var(&htab, "serial#"));
+	ut_assertnull(get_var(&htab, "fdtfile"));
+
+	/* Fill the journal, then it must be written in full */
+	for (records = 1;; records++) {
+		sprintf(value, "%d", records);
+		set_var(&htab, "bootcount", value);
+		if (env_journal_append(&jnl, &htab) == -ENOSPC)
+			break;
+	}
+	ut_assert(records > 10);
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(records, jnl.seq);
+	sprintf(value, "%d", records - 1);
+	ut_asserteq_str(value, get_var(&htab, "bootcount"));
+
+	/* Records for another environment are ignored */
+	set_var(&htab, "bootcount", "0");
+	ut_assertok(export_env(uts, &htab, env));
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(0, jnl.seq);
+	ut_asserteq(0, jnl.tail);
+	ut_asserteq_str("0", get_var(&htab, "bootcount"));
+
+	/* Records written after it are used, after erasing the old ones */
+	ut_assertok(env_journal_erase(&jnl));
+	ut_asserteq(-ENOSPC, env_journal_append(&jnl, &htab));
+	ut_assertok(env_journal_start(&jnl, env));
+	set_var(&htab, "bootcount", "1");
+	ut_assertok(env_journal_append(&jnl, &htab));
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(1, jnl.seq);
+	ut_asserteq_str("1", get_var(&htab, "bootcount"));
+
+	hdestroy_r(&htab);
+	free(jnl.saved);
+	free(env);
+
+	return 0;
+}
+ENV_TEST(env_test_journal, 0);
+
+/* Test that a partly written record is ignored */
+static int env_test_journal_torn(struct unit_test_state *uts)
+{
+	struct hsearch_data htab;
+	struct env_journal jnl;
+	ulong tail;
+	env_t *env;
+
+	env = malloc(sizeof(*env));
+	ut_assertnonnull(env);
+	memset(&htab, '\0', sizeof(htab));
+	ut_asserteq(1, himport_r(&htab, test_env, sizeof(test_env), '\0', 0, 0,
+				 0, NULL));
+	ut_assertok(export_env(uts, &htab, env));
+	ut_assertok(ram_journal_init(uts, &jnl, 0xff, env));
+
+	set_var(&htab, "bootdelay", "0");
+	ut_assertok(env_journal_append(&jnl, &htab));
+	tail = jnl.tail;
+	set_var(&htab, "bootdelay", "5");
+	ut_assertok(env_journal_append(&jnl, &htab));
+
+	/* Power failed while writing the second record */
+	jnl_mem[jnl.tail - JNL_ALIGN] = '\0';
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(1, jnl.seq);
+	ut_asserteq(tail, jnl.tail);
+	ut_asserteq_str("0", get_var(&htab, "bootdelay"));
+
+	/* Flash cannot be written again without an erase */
+	ut_assert(jnl.full);
+	set_var(&htab, "bootdelay", "5");
+	ut_asserteq(-ENOSPC, env_journal_append(&jnl, &htab));
+
+	/* A block device can just write over it */
+	free(jnl.saved);
+	ut_assertok(ram_journal_init(uts, &jnl, -1, env));
+	set_var(&htab, "bootdelay", "1");
+	ut_assertok(env_journal_append(&jnl, &htab));
+	jnl_mem[jnl.tail - 1] ^= 1;
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(0, jnl.seq);
+	ut_asserteq_str("2", get_var(&htab, "bootdelay"));
+	ut_assert(!jnl.full);
+	set_var(&htab, "bootdelay", "3");
+	ut_assertok(env_journal_append(&jnl, &htab));
+	ut_assertok(load_env(uts, &htab, &jnl, env));
+	ut_asserteq(1, jnl.seq);
+	ut_asserteq_str("3", get_var(&htab, "bootdelay"));
+
+	hdestroy_r(&htab);
+	free(jnl.saved);
+	free(env);
+
+	return 0;
+}
+ENV_TEST(env_test_journal_torn, 0);
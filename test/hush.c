@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for keeping the parsed form of scripts run by the hush shell
+ */
+
+#include <common.h>
+#include <cli_hush.h>
+#include <command.h>
+#include <environment.h>
+#include <test/suites.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+/* Declare a new hush test */
+#define HUSH_TEST(_name, _flags)	UNIT_TEST(_name, _flags, hush_test)
+
+/* Scripts shaped like those in config_distro_bootcmd.h */
+static const char *const distro_env[] = {
+	"boot_targets", "mmc0 mmc1 usb0",
+	"bootcmd_mmc0", "setenv devtype mmc; setenv devnum 0; "
+		"run scan_dev_for_boot_part",
+	"bootcmd_mmc1", "setenv devtype mmc; setenv devnum 1; "
+		"run scan_dev_for_boot_part",
+	"bootcmd_usb0", "setenv devtype usb; setenv devnum 0; "
+		"run scan_dev_for_boot_part",
+	"scan_dev_for_boot_part",
+		"env exists devplist || setenv devplist 1; "
+		"for distro_bootpart in ${devplist}; do "
+			"if test ${distro_bootpart} -eq ${bootpart}; then "
+				"run scan_dev_for_boot; "
+			"fi; "
+		"done",
+	"scan_dev_for_boot",
+		"for prefix in / /boot/; do "
+			"setenv found \"${found} "
+				"${devtype}${devnum}:${distro_bootpart}${prefix}\"; "
+		"done",
+	"distro_bootcmd", "for target in ${boot_targets}; do "
+		"run bootcmd_${target}; done",
+	"devplist", "1 2 3 4",
+	"bootpart", "2",
+};
+
+#define DISTRO_FOUND	" mmc0:2/ mmc0:2/boot/ mmc1:2/ mmc1:2/boot/ " \
+			"usb0:2/ usb0:2/boot/"
+
+static int set_distro_env(struct unit_test_state *uts, bool set)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(distro_env); i += 2)
+		ut_assertok(env_set(distro_env[i], set ? distro_env[i + 1] :
+				    NULL));
+	env_set("devtype", NULL);
+	env_set("devnum", NULL);
+	env_set("found", NULL);
+
+	return 0;
+}
+
+/* Run distro_bootcmd, setting *@parsesp to the number of scripts parsed */
+static int run_distro(struct unit_test_state *uts, bool flush, uint *parsesp)
+{
+	uint start;
+
+	env_set("found", NULL);
+	if (flush)
+		parse_script_flush();
+	start = parse_script_count();
+	/* Nothing is actually booted, so this fails */
+	ut_asserteq(1, run_command("run distro_bootcmd", 0));
+	*parsesp = parse_script_count() - start;
+	ut_asserteq_str(DISTRO_FOUND, env_get("found"));
+
+	return 0;
+}
+
+/* Test that scripts run again are not parsed again, and run the same */
+static int hush_test_script_cache(struct unit_test_state *uts)
+{
+	uint parses;
+
+	ut_assertok(set_distro_env(uts, true));
+
+	/*
+	 * Each script is parsed once: distro_bootcmd, the three bootcmd_...
+	 * scripts, scan_dev_for_boot_part and scan_dev_for_boot
+	 */
+	ut_assertok(run_distro(uts, true, &parses));
+	ut_asserteq(6, parses);
+
+	/* Nothing is parsed the second time */
+	ut_assertok(run_distro(uts, false, &parses));
+	ut_asserteq(0, parses);
+
+	/* A change to any script is seen on the next run */
+	ut_assertok(env_set("bootpart", "3"));
+	ut_assertok(env_set("scan_dev_for_boot",
+			    "setenv found \"${found} ${devnum}\""));
+	env_set("found", NULL);
+	parses = parse_script_count();
+	ut_asserteq(1, run_command("run distro_bootcmd", 0));
+	ut_asserteq(1, parse_script_count() - parses);
+	ut_asserteq_str(" 0 1 0", env_get("found"));
+
+	parse_script_flush();
+	ut_assertok(set_distro_env(uts, false));
+
+	return 0;
+}
+HUSH_TEST(hush_test_script_cache, 0);
+
+/* Test scripts which change or run themselves while running */
+static int hush_test_script_self(struct unit_test_state *uts)
+{
+	/* The change is used by the next run, not the one in progress */
+	ut_assertok(env_set("selfmod", "setenv selfmod 'setenv result two'; "
+			    "setenv result one"));
+	ut_assertok(run_command("run selfmod", 0));
+	ut_asserteq_str("one", env_get("result"));
+	ut_assertok(run_command("run selfmod", 0));
+	ut_asserteq_str("two", env_get("result"));
+
+	/* A loop left early can still be run again */
+	ut_assertok(env_set("early", "for i in 1 2 3; do "
+			    "if test $i -eq 2; then exit; fi; "
+			    "setenv result $i; done"));
+	ut_assertok(env_set("result", NULL));
+	ut_assertok(run_command("run early", 0));
+	ut_asserteq_str("1", env_get("result"));
+	ut_assertok(env_set("result", NULL));
+	ut_assertok(run_command("run early", 0));
+	ut_asserteq_str("1", env_get("result"));
+
+	/* A script running itself does not disturb the outer loop */
+	ut_assertok(env_set("recurse", "for x in a b; do "
+			    "setenv result ${result}${x}; "
+			    "if test ${depth} -eq 0; then "
+			    "setenv depth 1; run recurse; fi; done; "
+			    "setenv depth 1"));
+	ut_assertok(env_set("depth", "0"));
+	ut_assertok(env_set("result", NULL));
+	ut_assertok(run_command("run recurse", 0));
+	ut_asserteq_str("aabb", env_get("result"));
+	ut_assertok(env_set("depth", "1"));
+	ut_assertok(env_set("result", NULL));
+	ut_assertok(run_command("run recurse", 0));
+	ut_asserteq_str("ab", env_get("result"));
+
+	/* A syntax error is reported each time */
+	ut_assertok(env_set("broken", "if true; then echo"));
+	ut_asserteq(1, run_command("run broken", 0));
+	ut_asserteq(1, run_command("run broken", 0));
+
+	parse_script_flush();
+	env_set("selfmod", NULL);
+	env_set("early", NULL);
+	env_set("recurse", NULL);
+	env_set("depth", NULL);
+	env_set("broken", NULL);
+	env_set("result", NULL);
+
+	return 0;
+}
+HUSH_TEST(hush_test_script_self, 0);
+
+int do_ut_hush(cmd_tbl_t *cmdtp, int flag, int argc, char *const argv[])
+{
+	struct unit_test *tests = ll_entry_start(struct unit_test, hush_test);
+	const int n_ents = ll_entry_count(struct unit_test, hush_test);
+
+	return cmd_ut_category("hush", tests, n_ents, argc, argv);
+}
@@ -0,0 +1,226 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for making batches of device-tree fixups
+ */
+
+#include <common.h>
+#include <environment.h>
+#include <fdt_support.h>
+#include <malloc.h>
+#include <net.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+#define FIXUP_NODES	200
+#define FIXUP_SIZE	0x10000
+
+/* Create a tree with /aliases and FIXUP_NODES ethernet nodes in /soc */
+static int make_tree(struct unit_test_state *uts, void *blob)
+{
+	char name[20], path[30];
+	int aliases, soc, node, i;
+
+	ut_assertok(fdt_create_empty_tree(blob, FIXUP_SIZE));
+	ut_assert(fdt_add_subnode(blob, 0, "aliases") >= 0);
+	soc = fdt_add_subnode(blob, 0, "soc");
+	ut_assert(soc >= 0);
+	for (i = FIXUP_NODES - 1; i >= 0; i--) {
+		sprintf(name, "eth@%x", i);
+		node = fdt_add_subnode(blob, soc, name);
+		ut_assert(node >= 0);
+		ut_assertok(fdt_setprop_string(blob, node, "compatible",
+					       i & 1 ? "test,odd" : "test,even"));
+		if (i < 2)
+			ut_assertok(fdt_setprop(blob, node, "mac-address",
+						"\0\0\0\0\0", 6));
+	}
+	/* Adding nodes moved /aliases */
+	aliases = fdt_path_offset(blob, "/aliases");
+	for (i = 1; i >= 0; i--) {
+		sprintf(name, i ? "ethernet%d" : "ethernet", i);
+		sprintf(path, "/soc/eth@%x", i);
+		ut_assertok(fdt_setprop_string(blob, aliases, name, path));
+	}
+	ut_assertok(fdt_pack(blob));
+
+	return 0;
+}
+
+/* Check that two trees with the same nodes have the same properties */
+static int check_same(struct unit_test_state *uts, const void *expect,
+		      const void *blob)
+{
+	const void *expect_data, *data;
+	int expect_node, node, prop, count;
+	const char *name;
+	int len;
+
+	for (expect_node = 0, node = 0; expect_node >= 0;
+	     expect_node = fdt_next_node(expect, expect_node, NULL),
+	     node = fdt_next_node(blob, node, NULL)) {
+		ut_asserteq_str(fdt_get_name(expect, expect_node, NULL),
+				fdt_get_name(blob, node, NULL));
+		count = 0;
+		fdt_for_each_property_offset(prop, expect, expect_node) {
+			expect_data = fdt_getprop_by_offset(expect, prop, &name,
+							   &len);
+			data = fdt_getprop(blob, node, name, &count);
+			ut_assertnonnull(data);
+			ut_asserteq(len, count);
+			ut_assertok(memcmp(expect_data, data, len));
+		}
+		count = 0;
+		fdt_for_each_property_offset(prop, expect, expect_node)
+			count--;
+		fdt_for_each_property_offset(prop, blob, node)
+			count++;
+		ut_asserteq(0, count);
+	}
+	ut_assert(node < 0);
+
+	return 0;
+}
+
+/* Add the same changes as lib_test_fdt_fixup() makes one at a time */
+static int add_fixups(struct unit_test_state *uts, struct fdt_fixup *fix)
+{
+	char path[30];
+	int i;
+
+	for (i = 0; i < FIXUP_NODES; i++) {
+		sprintf(path, "/soc/eth@%x", i);
+		ut_assertok(fdt_fixup_by_path(fix, path, "status", "okay", 5,
+					      1));
+		ut_assertok(fdt_fixup_by_path(fix, path, "reg", &i, sizeof(i),
+					      1));
+	}
+	ut_assertok(fdt_fixup_by_compat(fix, "test,odd", "phy-mode", "\0\0\0\4",
+					4, 1));
+	ut_assertok(fdt_fixup_by_path(fix, "/soc/eth@1", "status", "disabled",
+				      9, 1));
+	ut_asserteq(FIXUP_NODES * 2 + FIXUP_NODES / 2 + 1, fix->count);
+
+	return 0;
+}
+
+/* Test that a batch makes the same changes as fixups made one at a time */
+static int lib_test_fdt_fixup(struct unit_test_state *uts)
+{
+	void *expect, *blob;
+	struct fdt_fixup fix;
+	char path[30];
+	int node, i;
+
+	expect = malloc(FIXUP_SIZE);
+	blob = malloc(FIXUP_SIZE);
+	ut_assert(expect && blob);
+	ut_assertok(make_tree(uts, expect));
+	memcpy(blob, expect, fdt_totalsize(expect));
+
+	/* A packed tree has no space for the changes, so is left alone */
+	fdt_fixup_start(&fix, blob);
+	ut_assertok(add_fixups(uts, &fix));
+	ut_asserteq(-FDT_ERR_NOSPACE, fdt_fixup_apply(&fix));
+	ut_asserteq(0, fix.count);
+	ut_asserteq(fdt_totalsize(expect), fdt_totalsize(blob));
+	ut_assertok(memcmp(expect, blob, fdt_totalsize(expect)));
+
+	/* Nor is it by a single change which needs space */
+	ut_assertok(fdt_fixup_by_path(&fix, "/soc/eth@2", "status", "okay", 5,
+				      1));
+	ut_asserteq(-FDT_ERR_NOSPACE, fdt_fixup_apply(&fix));
+	ut_assertok(memcmp(expect, blob, fdt_totalsize(expect)));
+
+	/* Changes which need no more space are made in place */
+	for (i = 1; i >= 0; i--) {
+		sprintf(path, "/soc/eth@%x", i);
+		ut_assertok(fdt_fixup_by_path(&fix, path, "mac-address",
+					      "\0\0\0\0\0\1", 6, 0));
+		ut_assertok(fdt_find_and_setprop(expect, path, "mac-address",
+						 "\0\0\0\0\0\1", 6, 0));
+	}
+	ut_assertok(fdt_fixup_by_path(&fix, "/soc/eth@1", "mac-address",
+				      "\0\0\0\0\0\2", 6, 0));
+	ut_assertok(fdt_find_and_setprop(expect, "/soc/eth@1", "mac-address",
+					 "\0\0\0\0\0\2", 6, 0));
+	ut_assertok(fdt_fixup_apply(&fix));
+	ut_asserteq(fdt_totalsize(expect), fdt_totalsize(blob));
+	ut_assertok(memcmp(expect, blob, fdt_totalsize(expect)));
+
+	/* Changes made one at a time, making space for each */
+	ut_assertok(fdt_open_into(expect, expect, FIXUP_SIZE));
+	for (i = 0; i < FIXUP_NODES; i++) {
+		sprintf(path, "/soc/eth@%x", i);
+		ut_assertok(fdt_find_and_setprop(expect, path, "status",
+						 "okay", 5, 1));
+		ut_assertok(fdt_find_and_setprop(expect, path, "reg", &i,
+						 sizeof(i), 1));
+	}
+	for (node = fdt_node_offset_by_compatible(expect, -1, "test,odd");
+	     node >= 0;
+	     node = fdt_node_offset_by_compatible(expect, node, "test,odd"))
+		ut_assertok(fdt_setprop_u32(expect, node, "phy-mode", 4));
+	ut_assertok(fdt_find_and_setprop(expect, "/soc/eth@1", "status",
+					 "disabled", 9, 1));
+
+	/* The same changes in a batch, once there is space for them */
+	ut_assertok(fdt_open_into(blob, blob, FIXUP_SIZE));
+	ut_assertok(add_fixups(uts, &fix));
+	ut_assertok(fdt_fixup_apply(&fix));
+	ut_asserteq(0, fix.count);
+	ut_asserteq(FIXUP_SIZE, fdt_totalsize(blob));
+	ut_assertok(check_same(uts, expect, blob));
+
+	/* Properties which are not there are only changed if asked */
+	ut_assertok(fdt_fixup_by_path(&fix, "/soc/eth@2", "mac-address", "",
+				      1, 0));
+	ut_asserteq(-FDT_ERR_NOTFOUND, fdt_fixup_by_path(&fix, "/soc/none",
+							 "status", "", 1, 1));
+	ut_asserteq(0, fix.count);
+	ut_assertok(fdt_fixup_apply(&fix));
+
+	free(blob);
+	free(expect);
+
+	return 0;
+}
+LIB_TEST(lib_test_fdt_fixup, 0);
+
+/* Test that MAC addresses are set in the nodes given by the aliases */
+static int lib_test_fdt_fixup_ethernet(struct unit_test_state *uts)
+{
+	uchar enetaddr[ARP_HLEN];
+	const void *data;
+	void *blob;
+	int node, len;
+
+	blob = malloc(FIXUP_SIZE);
+	ut_assertnonnull(blob);
+	ut_assertok(make_tree(uts, blob));
+	ut_assertok(fdt_open_into(blob, blob, FIXUP_SIZE));
+	fdt_fixup_ethernet(blob);
+
+	/* Only eth0 and eth1 have aliases, and only they get an address */
+	ut_assert(eth_env_get_enetaddr("ethaddr", enetaddr));
+	node = fdt_path_offset(blob, "/soc/eth@0");
+	data = fdt_getprop(blob, node, "mac-address", &len);
+	ut_asserteq(ARP_HLEN, len);
+	ut_assertok(memcmp(enetaddr, data, ARP_HLEN));
+	data = fdt_getprop(blob, node, "local-mac-address", &len);
+	ut_asserteq(ARP_HLEN, len);
+	ut_assertok(memcmp(enetaddr, data, ARP_HLEN));
+
+	ut_assert(eth_env_get_enetaddr("eth1addr", enetaddr));
+	node = fdt_path_offset(blob, "/soc/eth@1");
+	data = fdt_getprop(blob, node, "local-mac-address", &len);
+	ut_asserteq(ARP_HLEN, len);
+	ut_assertok(memcmp(enetaddr, data, ARP_HLEN));
+
+	node = fdt_path_offset(blob, "/soc/eth@2");
+	ut_assertnull(fdt_getprop(blob, node, "local-mac-address", NULL));
+	free(blob);
+
+	return 0;
+}
+LIB_TEST(lib_test_fdt_fixup_ethernet, 0);
@@ -655,3 +655,117 @@ static int lib_test_lmb_get_free_size(struct unit_test_state *uts)
 
 DM_TEST(lib_test_lmb_get_free_size,
 	DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/* Check that there can be more regions than fit in struct lmb itself */
+static int lib_test_lmb_many_regions(struct unit_test_state *uts)
+{
+	const phys_addr_t ram = 0x40000000;
+	const phys_size_t ram_size = 0x20000000;
+	const int count = MAX_LMB_REGIONS * 4;
+	struct lmb lmb;
+	phys_addr_t a;
+	long ret;
+	int i;
+
+	lmb_init(&lmb);
+
+	ret = lmb_add(&lmb, ram, ram_size);
+	ut_asserteq(ret, 0);
+
+	/* reserve every other 64KiB block, highest first */
+	for (i = count - 1; i >= 0; i--) {
+		ret = lmb_reserve(&lmb, ram + i * 0x20000, 0x10000);
+		ut_asserteq(ret, 0);
+	}
+	ut_asserteq(lmb.reserved.cnt, count);
+	for (i = 0; i < count; i++) {
+		ut_asserteq(lmb.reserved.region[i].base, ram + i * 0x20000);
+		ut_asserteq(lmb.reserved.region[i].size, 0x10000);
+	}
+	ut_asserteq(lmb_is_reserved(&lmb, ram + 5 * 0x20000 + 0xffff), 1);
+	ut_asserteq(lmb_is_reserved(&lmb, ram + 5 * 0x20000 + 0x10000), 0);
+	ut_asserteq(lmb_get_free_size(&lmb, ram + 0x10000), 0x10000);
+
+	/* a block filling the highest gap joins two regions */
+	a = lmb_alloc_base(&lmb, 0x10000, 0x10000, ram + count * 0x20000);
+	ut_asserteq(a, ram + count * 0x20000 - 0x10000);
+	ut_asserteq(lmb.reserved.cnt, count);
+
+	/* fill the other gaps, joining everything up */
+	for (i = 0; i < count - 1; i++) {
+		ret = lmb_reserve(&lmb, ram + i * 0x20000 + 0x10000, 0x10000);
+		ut_asserteq(ret, 2);
+	}
+	ASSERT_LMB(&lmb, ram, ram_size, 1, ram, count * 0x20000,
+		   0, 0, 0, 0);
+
+	/* freeing splits it up again */
+	for (i = 0; i < count; i++) {
+		ret = lmb_free(&lmb, ram + i * 0x20000 + 0x10000, 0x10000);
+		ut_asserteq(ret, 0);
+	}
+	ut_asserteq(lmb.reserved.cnt, count);
+	ut_asserteq(lmb.reserved.region[count - 1].base,
+		    ram + (count - 1) * 0x20000);
+
+	lmb_release(&lmb);
+	ut_asserteq(lmb.reserved.cnt, 0);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_many_regions, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
+
+/*
+ * Set up 1 MiB of RAM with three free areas: 128 KiB at 0x40010000, 32 KiB at
+ * 0x40040000 and 64 KiB at 0x400f0000
+ */
+static int init_policy_lmb(struct unit_test_state *uts, struct lmb *lmb,
+			   enum lmb_alloc_policy policy)
+{
+	lmb_init(lmb);
+	lmb->policy = policy;
+	ut_asserteq(lmb_add(lmb, 0x40000000, 0x100000), 0);
+	ut_asserteq(lmb_reserve(lmb, 0x40000000, 0x10000), 0);
+	ut_asserteq(lmb_reserve(lmb, 0x40030000, 0x10000), 0);
+	ut_asserteq(lmb_reserve(lmb, 0x40048000, 0xa8000), 0);
+
+	return 0;
+}
+
+/* Check where each allocation policy puts blocks */
+static int lib_test_lmb_alloc_policy(struct unit_test_state *uts)
+{
+	struct lmb lmb;
+
+	ut_assertok(init_policy_lmb(uts, &lmb, LMB_ALLOC_TOP_DOWN));
+	ut_asserteq(lmb_alloc(&lmb, 0x4000, 0x1000), 0x400fc000);
+	ut_asserteq(lmb_alloc(&lmb, 0x10000, 0x10000), 0x40020000);
+	ut_asserteq(lmb_alloc_base(&lmb, 0x4000, 0x1000, 0x40040000),
+		    0x4001c000);
+
+	ut_assertok(init_policy_lmb(uts, &lmb, LMB_ALLOC_BOTTOM_UP));
+	ut_asserteq(lmb_alloc(&lmb, 0x4000, 0x1000), 0x40010000);
+	ut_asserteq(lmb_alloc(&lmb, 0x10000, 0x20000), 0x40020000);
+	ut_asserteq(lmb_alloc(&lmb, 0x10000, 0x10000), 0x400f0000);
+	ut_asserteq(lmb_alloc(&lmb, 0x8000, 0x1000), 0x40014000);
+	ut_asserteq(__lmb_alloc_base(&lmb, 0x10000, 0x1000, 0), 0);
+
+	/* best fit leaves the 128 KiB area for a large block */
+	ut_assertok(init_policy_lmb(uts, &lmb, LMB_ALLOC_BEST_FIT));
+	ut_asserteq(lmb_alloc(&lmb, 0x4000, 0x1000), 0x40044000);
+	ut_asserteq(lmb_alloc(&lmb, 0x10000, 0x10000), 0x400f0000);
+	ut_asserteq(lmb_alloc(&lmb, 0x4000, 0x1000), 0x40040000);
+	ut_asserteq(lmb_alloc(&lmb, 0x20000, 0x10000), 0x40010000);
+	ut_asserteq(__lmb_alloc_base(&lmb, 0x1000, 0x1000, 0), 0);
+
+	/* address 0 means failure, so bottom-up starts above it */
+	lmb_init(&lmb);
+	lmb.policy = LMB_ALLOC_BOTTOM_UP;
+	ut_asserteq(lmb_add(&lmb, 0, 0x10000), 0);
+	ut_asserteq(lmb_alloc(&lmb, 0x100, 0x100), 0x100);
+
+	return 0;
+}
+
+DM_TEST(lib_test_lmb_alloc_policy, DM_TESTF_SCAN_PDATA | DM_TESTF_SCAN_FDT);
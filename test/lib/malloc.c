@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0+
+/*
+ * Tests for the slab and pre-relocation parts of malloc()
+ */
+
+#include <common.h>
+#include <malloc.h>
+#include <mapmem.h>
+#include <test/lib.h>
+#include <test/test.h>
+#include <test/ut.h>
+
+DECLARE_GLOBAL_DATA_PTR;
+
+#ifdef CONFIG_SYS_MALLOC_SLAB
+/* Test that small blocks come from slabs and act like any other */
+static int lib_test_malloc_slab(struct unit_test_state *uts)
+{
+	int before = mallinfo().uordblks;
+	char *small, *large, *aligned, *ptr;
+	int i;
+
+	small = malloc(20);
+	ut_assert(malloc_slab_owns(small));
+	ut_asserteq(32, malloc_usable_size(small));
+	ut_assertok((ulong)small & 15);
+	large = malloc(MALLOC_SLAB_MAX + 1);
+	ut_assert(!malloc_slab_owns(large));
+	aligned = memalign(64, 16);
+	ut_assert(!malloc_slab_owns(aligned));
+	ut_assertok((ulong)aligned & 63);
+	ut_asserteq(before + 32 + malloc_usable_size(large) +
+		    malloc_usable_size(aligned) + 2 * sizeof(size_t),
+		    mallinfo().uordblks);
+
+	/* A block which is reused is cleared by calloc() */
+	ptr = malloc(200);
+	memset(ptr, 0xff, 200);
+	free(ptr);
+	ptr = calloc(1, 200);
+	for (i = 0; i < 200; i++)
+		ut_asserteq(0, ptr[i]);
+	free(ptr);
+
+	/* realloc() keeps the block while it fits, then moves it */
+	strcpy(small, "slab");
+	ut_asserteq_ptr(small, realloc(small, 32));
+	small = realloc(small, 100);
+	ut_assert(malloc_slab_owns(small));
+	ut_asserteq(128, malloc_usable_size(small));
+	ut_asserteq_str("slab", small);
+	small = realloc(small, 1000);
+	ut_assert(!malloc_slab_owns(small));
+	ut_asserteq_str("slab", small);
+	ptr = realloc(large, 16);
+	ut_asserteq_ptr(large, ptr);
+
+	free(small);
+	free(ptr);
+	free(aligned);
+	ut_asserteq(before, mallinfo().uordblks);
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_slab, 0);
+#endif
+
+#ifdef CONFIG_SYS_MALLOC_F_FREE
+/* Test that memory freed before relocation can be used again */
+static int lib_test_malloc_simple_free(struct unit_test_state *uts)
+{
+	ulong base = gd->malloc_base, limit = gd->malloc_limit;
+	ulong ptr = gd->malloc_ptr, free_list = gd->malloc_free;
+	char *buf, *a, *b, *c, *d, *e;
+	ulong after_b;
+
+	buf = memalign(64, 0x400);
+	ut_assertnonnull(buf);
+	gd->malloc_base = map_to_sysmem(buf);
+	gd->malloc_limit = 0x400;
+	gd->malloc_ptr = 0;
+	gd->malloc_free = 0;
+
+	a = malloc_simple(16);
+	b = malloc_simple(32);
+	after_b = gd->malloc_ptr;
+	c = malloc_simple(16);
+	ut_assert(a && b && c);
+
+	/* The last block is given back */
+	free_simple(c);
+	ut_asserteq(after_b, gd->malloc_ptr);
+
+	/* Others are reused by blocks which fit */
+	free_simple(a);
+	ut_asserteq(after_b, gd->malloc_ptr);
+	e = malloc_simple(20);
+	ut_assert(e > b);
+	d = malloc_simple(8);
+	ut_asserteq_ptr(a, d);
+
+	/* Freeing the last block gives back freed blocks before it */
+	free_simple(e);
+	ut_asserteq(after_b, gd->malloc_ptr);
+	free_simple(d);
+	free_simple(b);
+	ut_asserteq(0, gd->malloc_ptr);
+	ut_asserteq(0, gd->malloc_free);
+
+	d = memalign_simple(64, 10);
+	ut_assertok(map_to_sysmem(d) & 63);
+	free_simple(d);
+	ut_asserteq(0, gd->malloc_ptr);
+
+	gd->malloc_base = base;
+	gd->malloc_limit = limit;
+	gd->malloc_ptr = ptr;
+	gd->malloc_free = free_list;
+	free(buf);
+
+	return 0;
+}
+LIB_TEST(lib_test_malloc_simple_free, 0);
+#endif
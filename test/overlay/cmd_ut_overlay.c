@@ -8,7 +8,9 @@
 #include <command.h>
 #include <errno.h>
 #include <fdt_support.h>
+#include <image.h>
 #include <malloc.h>
+#include <mapmem.h>
 
 #include <linux/sizes.h>
 
@@ -24,6 +26,7 @@ extern u32 __dtb_test_fdt_overlay_begin;
 extern u32 __dtb_test_fdt_overlay_stacked_begin;
 
 static void *fdt;
+static void *fdt_batch;
 
 static int ut_fdt_getprop_u32_by_index(void *fdt, const char *path,
 				    const char *name, int index,
@@ -209,6 +212,260 @@ static int fdt_overlay_stacked(struct unit_test_state *uts)
 }
 OVERLAY_TEST(fdt_overlay_stacked, 0);
 
+/* Check that two trees have the same nodes and properties */
+static int check_same_tree(struct unit_test_state *uts, const void *expect,
+			   const void *tree)
+{
+	int expect_node, node, prop, len, count;
+	const void *expect_data, *data;
+	const char *name;
+
+	for (expect_node = 0, node = 0; expect_node >= 0;
+	     expect_node = fdt_next_node(expect, expect_node, NULL),
+	     node = fdt_next_node(tree, node, NULL)) {
+		ut_assert(node >= 0);
+		ut_asserteq_str(fdt_get_name(expect, expect_node, NULL),
+				fdt_get_name(tree, node, NULL));
+		count = 0;
+		fdt_for_each_property_offset(prop, expect, expect_node) {
+			expect_data = fdt_getprop_by_offset(expect, prop, &name,
+							    &len);
+			data = fdt_getprop(tree, node, name, NULL);
+			ut_assertnonnull(data);
+			/* Symbols may differ in the number of nul terminators */
+			if (!strcmp(fdt_get_name(tree, node, NULL),
+				    "__symbols__")) {
+				ut_asserteq_str(expect_data, data);
+			} else {
+				ut_assertok(memcmp(expect_data, data, len));
+			}
+			count--;
+		}
+		fdt_for_each_property_offset(prop, tree, node)
+			count++;
+		ut_asserteq(0, count);
+	}
+	ut_assert(node < 0);
+
+	return 0;
+}
+
+static int fdt_overlay_batch(struct unit_test_state *uts)
+{
+	ut_assertok(check_same_tree(uts, fdt, fdt_batch));
+
+	return CMD_RET_SUCCESS;
+}
+OVERLAY_TEST(fdt_overlay_batch, 0);
+
+#define MANY_NODES	200
+#define MANY_OVERLAYS	20
+#define MANY_SIZE	(64 * SZ_1K)
+
+/* Create a base tree with MANY_NODES nodes, each with a symbol */
+static int make_many_base(struct unit_test_state *uts, void *base)
+{
+	char name[20], path[30];
+	int soc, symbols, node, i;
+
+	ut_assertok(fdt_create_empty_tree(base, MANY_SIZE));
+	symbols = fdt_add_subnode(base, 0, "__symbols__");
+	ut_assert(symbols >= 0);
+	for (i = 0; i < MANY_NODES; i++) {
+		snprintf(path, sizeof(path), "/soc/node@%x", i);
+		snprintf(name, sizeof(name), "node%d", i);
+		ut_assertok(fdt_setprop_string(base, symbols, name, path));
+	}
+	soc = fdt_add_subnode(base, 0, "soc");
+	ut_assert(soc >= 0);
+	for (i = MANY_NODES - 1; i >= 0; i--) {
+		snprintf(name, sizeof(name), "node@%x", i);
+		node = fdt_add_subnode(base, soc, name);
+		ut_assert(node >= 0);
+		ut_assertok(fdt_setprop_u32(base, node, "phandle", i + 1));
+	}
+	ut_assertok(fdt_pack(base));
+
+	return 0;
+}
+
+/*
+ * Create overlay @seq, which adds a node with a symbol to a base node and
+ * refers to the node added by the overlay before it
+ */
+static int make_many_overlay(struct unit_test_state *uts, void *fdto, int seq)
+{
+	int frag, ov, node, fixups, symbols;
+	char name[20], path[50];
+
+	ut_assertok(fdt_create_empty_tree(fdto, SZ_1K));
+	frag = fdt_add_subnode(fdto, 0, "fragment@0");
+	ut_assert(frag >= 0);
+	ut_assertok(fdt_setprop_u32(fdto, frag, "target", ~0));
+	ov = fdt_add_subnode(fdto, frag, "__overlay__");
+	ut_assert(ov >= 0);
+	snprintf(name, sizeof(name), "ov%d", seq);
+	node = fdt_add_subnode(fdto, ov, name);
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop_u32(fdto, node, "phandle", 1));
+	ut_assertok(fdt_setprop_u32(fdto, node, "ref", ~0));
+
+	symbols = fdt_add_subnode(fdto, 0, "__symbols__");
+	ut_assert(symbols >= 0);
+	snprintf(path, sizeof(path), "/fragment@0/__overlay__/ov%d", seq);
+	ut_assertok(fdt_setprop_string(fdto, symbols, name, path));
+
+	fixups = fdt_add_subnode(fdto, 0, "__fixups__");
+	ut_assert(fixups >= 0);
+	snprintf(name, sizeof(name), "node%d", seq * 7 % MANY_NODES);
+	ut_assertok(fdt_setprop_string(fdto, fixups, name,
+				       "/fragment@0:target:0"));
+	snprintf(name, sizeof(name), seq ? "ov%d" : "node1", seq - 1);
+	snprintf(path, sizeof(path), "/fragment@0/__overlay__/ov%d:ref:0",
+		 seq);
+	ut_assertok(fdt_setprop_string(fdto, fixups, name, path));
+
+	return 0;
+}
+
+/* Test applying many overlays one at a time and in a batch */
+static int fdt_overlay_batch_many(struct unit_test_state *uts)
+{
+	void *fdtos[MANY_OVERLAYS];
+	void *expect, *tree;
+	char path[40];
+	u32 phandle, ref;
+	int len, i;
+
+	expect = malloc(MANY_SIZE);
+	tree = malloc(MANY_SIZE);
+	ut_assert(expect && tree);
+	ut_assertok(make_many_base(uts, expect));
+	memcpy(tree, expect, fdt_totalsize(expect));
+	for (i = 0; i < MANY_OVERLAYS; i++) {
+		fdtos[i] = malloc(SZ_1K);
+		ut_assertnonnull(fdtos[i]);
+	}
+
+	/* One at a time, as each is loaded from a FIT */
+	for (i = 0; i < MANY_OVERLAYS; i++)
+		ut_assertok(make_many_overlay(uts, fdtos[i], i));
+	for (i = 0; i < MANY_OVERLAYS; i++) {
+		len = fdt_totalsize(expect) + fdt_totalsize(fdtos[i]);
+		ut_assertok(fdt_open_into(expect, expect, len));
+		ut_assertok(fdt_overlay_apply(expect, fdtos[i]));
+		ut_assertok(fdt_pack(expect));
+	}
+
+	/* All together, making space once */
+	len = fdt_totalsize(tree);
+	for (i = 0; i < MANY_OVERLAYS; i++) {
+		ut_assertok(make_many_overlay(uts, fdtos[i], i));
+		len += fdt_totalsize(fdtos[i]);
+	}
+	ut_assertok(fdt_overlay_apply_batch(tree, len, fdtos, MANY_OVERLAYS));
+	ut_assertok(fdt_pack(tree));
+	ut_assertok(check_same_tree(uts, expect, tree));
+
+	/* Each added node refers to the one before it */
+	for (i = 1; i < MANY_OVERLAYS; i++) {
+		snprintf(path, sizeof(path), "/soc/node@%x/ov%d",
+			 (i - 1) * 7 % MANY_NODES, i - 1);
+		phandle = fdt_get_phandle(tree, fdt_path_offset(tree, path));
+		ut_assert(phandle > MANY_NODES);
+		snprintf(path, sizeof(path), "/soc/node@%x/ov%d",
+			 i * 7 % MANY_NODES, i);
+		ut_assertok(ut_fdt_getprop_u32(tree, path, "ref", &ref));
+		ut_asserteq(phandle, ref);
+	}
+
+	for (i = 0; i < MANY_OVERLAYS; i++)
+		free(fdtos[i]);
+	free(tree);
+	free(expect);
+
+	return CMD_RET_SUCCESS;
+}
+OVERLAY_TEST(fdt_overlay_batch_many, 0);
+
+#define FIT_SIZE	(16 * SZ_1K)
+#define FIT_BASE_LOAD	0x100000
+#define FIT_OV_LOAD	0x200000
+
+/* Add a device tree to the images in a FIT, loaded at @load */
+static int add_fit_fdt(struct unit_test_state *uts, void *fit, int images,
+		       const char *name, const void *blob, ulong load)
+{
+	int node;
+
+	node = fdt_add_subnode(fit, images, name);
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop(fit, node, FIT_DATA_PROP, blob,
+				fdt_totalsize(blob)));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_TYPE_PROP, "flat_dt"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_ARCH_PROP, "sandbox"));
+	ut_assertok(fdt_setprop_string(fit, node, FIT_COMP_PROP, "none"));
+	ut_assertok(fdt_setprop_u32(fit, node, FIT_LOAD_PROP, load));
+
+	return 0;
+}
+
+/* Test booting a FIT whose overlays share a load address */
+static int fdt_overlay_fit_same_load(struct unit_test_state *uts)
+{
+	static const char fdts[] = "fdt-1\0fdt-2\0fdt-3";
+	const char *uname = NULL, *uconfig = NULL;
+	bootm_headers_t images;
+	int root, node, ret;
+	ulong load, len;
+	void *fit, *tree;
+	const char *str;
+	u32 val = 0;
+
+	fit = malloc(FIT_SIZE);
+	ut_assertnonnull(fit);
+	ut_assertok(fdt_create_empty_tree(fit, FIT_SIZE));
+	ut_assertok(fdt_setprop_string(fit, 0, FIT_DESC_PROP, "overlays"));
+	ut_assertok(fdt_setprop_u32(fit, 0, FIT_TIMESTAMP_PROP, 0));
+	root = fdt_add_subnode(fit, 0, FIT_IMAGES_PATH + 1);
+	ut_assert(root >= 0);
+	ut_assertok(add_fit_fdt(uts, fit, root, "fdt-1",
+				&__dtb_test_fdt_base_begin, FIT_BASE_LOAD));
+	ut_assertok(add_fit_fdt(uts, fit, root, "fdt-2",
+				&__dtb_test_fdt_overlay_begin, FIT_OV_LOAD));
+	ut_assertok(add_fit_fdt(uts, fit, root, "fdt-3",
+				&__dtb_test_fdt_overlay_stacked_begin,
+				FIT_OV_LOAD));
+	root = fdt_add_subnode(fit, 0, FIT_CONFS_PATH + 1);
+	ut_assert(root >= 0);
+	ut_assertok(fdt_setprop_string(fit, root, FIT_DEFAULT_PROP, "conf-1"));
+	node = fdt_add_subnode(fit, root, "conf-1");
+	ut_assert(node >= 0);
+	ut_assertok(fdt_setprop(fit, node, FIT_FDT_PROP, fdts, sizeof(fdts)));
+
+	/* The second overlay replaces the first in memory when loaded */
+	memset(&images, '\0', sizeof(images));
+	ret = boot_get_fdt_fit(&images, map_to_sysmem(fit), &uname, &uconfig,
+			       IH_ARCH_SANDBOX, &load, &len);
+	ut_assert(ret >= 0);
+	ut_asserteq(FIT_BASE_LOAD, load);
+
+	/* Both overlays are applied */
+	tree = map_sysmem(load, len);
+	ut_assertok(fdt_check_header(tree));
+	ut_asserteq(len, fdt_totalsize(tree));
+	ut_assertok(fdt_getprop_str(tree, "/test-node", "test-str-property",
+				    &str));
+	ut_asserteq_str("foobar", str);
+	ut_assertok(ut_fdt_getprop_u32(tree, "/new-local-node",
+				       "stacked-test-int-property", &val));
+	ut_asserteq(43, val);
+	free(fit);
+
+	return CMD_RET_SUCCESS;
+}
+OVERLAY_TEST(fdt_overlay_fit_same_load, 0);
+
 int do_ut_overlay(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 {
 	struct unit_test *tests = ll_entry_start(struct unit_test,
@@ -219,6 +476,7 @@ int do_ut_overlay(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	void *fdt_overlay = &__dtb_test_fdt_overlay_begin;
 	void *fdt_overlay_stacked = &__dtb_test_fdt_overlay_stacked_begin;
 	void *fdt_overlay_copy, *fdt_overlay_stacked_copy;
+	void *overlays[2];
 	int ret = -ENOMEM;
 
 	uts = calloc(1, sizeof(*uts));
@@ -240,6 +498,10 @@ int do_ut_overlay(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	if (!fdt_overlay_stacked_copy)
 		goto err3;
 
+	fdt_batch = malloc(FDT_COPY_SIZE);
+	if (!fdt_batch)
+		goto err4;
+
 	/*
 	 * Resize the FDT to 4k so that we have room to operate on
 	 *
@@ -272,8 +534,21 @@ int do_ut_overlay(cmd_tbl_t *cmdtp, int flag, int argc, char * const argv[])
 	/* Apply the stacked overlay */
 	ut_assertok(fdt_overlay_apply(fdt, fdt_overlay_stacked_copy));
 
+	/* Apply both again, in a batch */
+	ut_assertok(fdt_open_into(fdt_overlay, fdt_overlay_copy,
+				  FDT_COPY_SIZE));
+	ut_assertok(fdt_open_into(fdt_overlay_stacked, fdt_overlay_stacked_copy,
+				  FDT_COPY_SIZE));
+	overlays[0] = fdt_overlay_copy;
+	overlays[1] = fdt_overlay_stacked_copy;
+	ut_assertok(fdt_open_into(fdt_base, fdt_batch, FDT_COPY_SIZE));
+	ut_assertok(fdt_overlay_apply_batch(fdt_batch, FDT_COPY_SIZE,
+					    overlays, ARRAY_SIZE(overlays)));
+
 	ret = cmd_ut_category("overlay", tests, n_ents, argc, argv);
 
+	free(fdt_batch);
+err4:
 	free(fdt_overlay_stacked_copy);
 err3:
 	free(fdt_overlay_copy);
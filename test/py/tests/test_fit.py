@@ -24,7 +24,8 @@ base_its = '''
                         type = "kernel";
                         arch = "sandbox";
                         os = "linux";
-                        compression = "none";
+                        compression = "%(compression)s";
+                        %(kernel_blocks)s
                         load = <0x40000>;
                         entry = <0x8>;
                 };
@@ -221,6 +222,45 @@ def test_fit(u_boot_console):
             print(data, file=fd)
         return fname
 
+    def make_lz4_blocks(filename, block_size):
+        """Compress a file as a series of lz4 frames, one for each block
+
+        U-Boot has no lz4 compressor, so each frame holds a single compressed
+        block which is one run of literals. The frame records the size of its
+        block, so mkimage can check it. U-Boot does not check the header
+        checksum, so that is left as zero.
+
+        Args:
+            filename: Filename of the data to compress
+            block_size: Uncompressed size of each block
+        Returns:
+            Tuple:
+                Filename of the compressed file created
+                List of the offset of each frame within that file
+        """
+        data = read_file(filename)
+        out = b''
+        offsets = []
+        for pos in range(0, len(data), block_size):
+            chunk = data[pos:pos + block_size]
+            if len(chunk) < 15:
+                seq = struct.pack('B', len(chunk) << 4)
+            else:
+                left = len(chunk) - 15
+                seq = (b'\xf0' + b'\xff' * (left // 255) +
+                       struct.pack('B', left % 255))
+            seq += chunk
+            offsets.append(len(out))
+
+            # Magic, version 1 with independent blocks and content size, 64KB
+            # blocks, the content size and the header checksum
+            out += struct.pack('<LBBQB', 0x184d2204, 0x68, 0x40, len(chunk), 0)
+            out += struct.pack('<L', len(seq)) + seq + struct.pack('<L', 0)
+        fname = make_fname(os.path.basename(filename) + '.lz4')
+        with open(fname, 'wb') as fd:
+            fd.write(out)
+        return fname, offsets
+
     def find_matching(text, match):
         """Find a match in a line of text, and return the unmatched line portion
 
@@ -325,6 +365,8 @@ def test_fit(u_boot_console):
             'kernel_out' : kernel_out,
             'kernel_addr' : 0x40000,
             'kernel_size' : filesize(kernel),
+            'compression' : 'none',
+            'kernel_blocks' : '',
 
             'fdt_out' : fdt_out,
             'fdt_addr' : 0x80000,
@@ -417,6 +459,26 @@ def test_fit(u_boot_console):
             check_equal(loadables2, loadables2_out,
                         'Loadables2 (ramdisk) not loaded')
 
+        # A kernel made of lz4 blocks, which mkimage must index
+        config = cons.config.buildconfig
+        if (config.get('config_fit_comp_blocks', 'n') == 'y' and
+                config.get('config_lz4', 'n') == 'y'):
+            with cons.log.section('Block-compressed kernel load'):
+                block_size = 0x400
+                kernel_lz4, offsets = make_lz4_blocks(kernel, block_size)
+                params['kernel'] = kernel_lz4
+                params['compression'] = 'lz4'
+                params['kernel_blocks'] = ('compression-block-size = <%#x>;' %
+                                           block_size)
+                fit = make_fit(mkimage, params)
+                blocks = struct.pack('>%dL' % len(offsets), *offsets)
+                assert blocks in read_file(fit), (
+                       'mkimage did not add the block offsets %s' % offsets)
+                cons.restart_uboot()
+                output = cons.run_command_list(cmd.splitlines())
+                check_equal(kernel, kernel_out,
+                            'Block-compressed kernel not loaded')
+
     cons = u_boot_console
     try:
         # We need to use our own device tree file. Remember to restore it
@@ -21,7 +21,8 @@ For configuration verification:
 - Corrupt the signature
 - Check that image verification no-longer works
 
-Tests run with both SHA1 and SHA256 hashing.
+Tests run with both SHA1 and SHA256 hashing, using RSA keys, and with SHA256
+hashing using an ECDSA P-256 key.
 """
 
 import pytest
@@ -135,6 +136,8 @@ def test_vboot(u_boot_console):
         Args:
             sha_algo: Either 'sha1' or 'sha256', to select the algorithm to
                     use.
+            padding: Suffix of the .its files to use, selecting the padding
+                    or crypto algorithm (e.g. '-pss' or '-ecdsa256').
         """
         # Compile our device tree files for kernel and U-Boot. These are
         # regenerated here since mkimage will modify them (by adding a
@@ -230,6 +233,13 @@ def test_vboot(u_boot_console):
         test_with_algo('sha1','-pss')
         test_with_algo('sha256','')
         test_with_algo('sha256','-pss')
+
+        # Replace the RSA key pair with an ECDSA one
+        util.run_and_log(cons, 'openssl ecparam -name prime256v1 -genkey '
+                         '-noout -out %sdev.key' % tmpdir)
+        util.run_and_log(cons, 'openssl req -batch -new -x509 -key '
+                         '%sdev.key -out %sdev.crt' % (tmpdir, tmpdir))
+        test_with_algo('sha256','-ecdsa256')
     finally:
         # Go back to the original U-Boot with the correct dtb.
         cons.config.dtb = old_dtb
@@ -13,6 +13,8 @@ static data.
 
 import collections
 import copy
+import os
+import re
 import sys
 
 import fdt
@@ -51,6 +53,21 @@ VAL_PREFIX = 'dtv_'
 #     phandles is len(args). This is a list of integers.
 PhandleInfo = collections.namedtuple('PhandleInfo', ['max_args', 'args'])
 
+# Properties which mark a node for binding before relocation in U-Boot proper,
+# as checked by dm_ofnode_pre_reloc()
+PRE_RELOC_PROPS = ['u-boot,dm-pre-reloc', 'u-boot,dm-spl', 'u-boot,dm-tpl']
+
+# Top-level source directories which hold no drivers for the target
+SRC_SKIP_DIRS = ['doc', 'scripts', 'tools']
+
+RE_UDEVICE_IDS = re.compile(
+    r'struct\s+udevice_id\s+(\w+)\s*\[\s*\]\s*=\s*\{(.*?)^\}\s*;',
+    re.M | re.S)
+RE_COMPATIBLE = re.compile(r'\.compatible\s*=\s*"([^"]*)"')
+RE_DRIVER = re.compile(r'^U_BOOT_DRIVER\((\w+)\)\s*=\s*\{(.*?)^\}\s*;',
+                       re.M | re.S)
+RE_OF_MATCH = re.compile(r'\.of_match\s*=\s*(?:of_match_ptr\(\s*)?(\w+)')
+
 
 def conv_name_to_c(name):
     """Convert a device-tree name to a C identifier
@@ -148,6 +165,7 @@ class DtbPlatdata(object):
         self._outfile = None
         self._lines = []
         self._aliases = {}
+        self._compat_drivers = {}
 
     def setup_output(self, fname):
         """Set up the output destination
@@ -545,8 +563,154 @@ class DtbPlatdata(object):
             self.output_node(node)
             nodes_to_output.remove(node)
 
+    def scan_drivers(self, src_dir):
+        """Find the drivers in the U-Boot source for each compatible string
+
+        This looks for U_BOOT_DRIVER() declarations and the udevice_id tables
+        given as their .of_match in the same file. Where several drivers
+        match a string, the one first in the linker list (i.e. with the
+        lowest name) is used, as lists_driver_lookup_compat() does. dtoc
+        cannot tell which drivers are built, so U-Boot checks each one when
+        binding.
+
+        Args:
+            src_dir: Top-level directory of the U-Boot source
+        """
+        drivers = collections.defaultdict(list)
+        for dirpath, dirnames, fnames in os.walk(src_dir):
+            if dirpath == src_dir:
+                dirnames[:] = [name for name in dirnames
+                               if name not in SRC_SKIP_DIRS]
+            dirnames[:] = [name for name in dirnames
+                           if not name.startswith('.')]
+            for fname in fnames:
+                if fname.endswith('.c'):
+                    self.scan_driver_file(os.path.join(dirpath, fname),
+                                          drivers)
+        self._compat_drivers = {compat: min(names)
+                                for compat, names in drivers.items()}
+
+    def scan_driver_file(self, fname, drivers):
+        """Find the compatible strings of the drivers in a source file
+
+        Args:
+            fname: Filename to scan
+            drivers: Dict to update: key: compatible string
+                value: list of names of drivers which match it
+        """
+        with open(fname) as fd:
+            buff = fd.read()
+        if 'U_BOOT_DRIVER' not in buff:
+            return
+        ids = {}
+        for name, body in RE_UDEVICE_IDS.findall(buff):
+            ids[name] = RE_COMPATIBLE.findall(body)
+        for name, body in RE_DRIVER.findall(buff):
+            of_match = RE_OF_MATCH.search(body)
+            if of_match:
+                for compat in ids.get(of_match.group(1), []):
+                    drivers[compat].append(name)
+
+    def get_prebind_driver(self, node):
+        """Get the driver which U-Boot will bind to a node
+
+        This follows lists_bind_fdt(): the first compatible string with a
+        driver chooses it.
+
+        Args:
+            node: Node to check
+
+        Returns:
+            Name of the driver, or None if none is known
+        """
+        compat_list = node.props['compatible'].bytes.rstrip('\0')
+        for compat in compat_list.split('\0'):
+            if compat in self._compat_drivers:
+                return self._compat_drivers[compat]
+        return None
+
+    def scan_prebind_node(self, parent, nodes):
+        """Find the nodes which driver model binds when scanning a node
 
-def run_steps(args, dtb_file, include_disabled, output):
+        This follows dm_scan_fdt_node() in drivers/core/root.c: it looks at
+        each enabled subnode with a compatible string, and at the subnodes of
+        any "chosen" or "firmware" node. As with fdtdec_get_is_enabled(), a
+        node is enabled if it has no status or its status is exactly "okay".
+
+        Args:
+            parent: Node to scan
+            nodes: List of Node objects to add the nodes to
+        """
+        for node in parent.subnodes:
+            if node.name in ['chosen', 'firmware']:
+                self.scan_prebind_node(node, nodes)
+                continue
+            # Compare the status up to its first nul, as strcmp() does
+            status = node.props.get('status')
+            if status and status.bytes.split('\0')[0] != 'okay':
+                continue
+            if 'compatible' in node.props:
+                nodes.append(node)
+
+    def generate_prebind(self):
+        """Generate a table of the nodes bound by driver model
+
+        This writes out a dm_prebind_table which U-Boot proper uses to bind
+        devices without scanning the device tree. The table records the sizes
+        of the device tree so that U-Boot can check that it was generated
+        from the control device tree.
+
+        See the documentation in doc/driver-model/of-plat.txt for more
+        information.
+        """
+        nodes = []
+        self.scan_prebind_node(self._fdt.GetRoot(), nodes)
+        fdt_obj = self._fdt.GetFdtObj()
+
+        drivers = [self.get_prebind_driver(node) for node in nodes]
+
+        self.out_header()
+        self.out('#include <common.h>\n')
+        self.out('#include <dm.h>\n')
+        self.out('\n')
+        for driver in sorted(set(drivers) - set([None])):
+            self.out('DM_PREBIND_DRIVER_REF(%s);\n' % driver)
+        self.out('\n')
+        self.out('static const struct dm_prebind dm_prebind_entries[] = {\n')
+        for node, driver in zip(nodes, drivers):
+            compat = node.props['compatible'].bytes
+            strs = compat.rstrip('\0').split('\0')
+            self.out('\t{\n')
+            self.out('\t\t%s= "%s",\n' % (tab_to(2, '.name'), node.name))
+            self.out('\t\t%s= %#x,\n' % (tab_to(2, '.offset'),
+                                            node.Offset()))
+            if driver:
+                self.out('\t\t%s= DM_PREBIND_DRIVER(%s),\n' %
+                         (tab_to(2, '.driver'), driver))
+            if any(prop in node.props for prop in PRE_RELOC_PROPS):
+                self.out('\t\t%s= true,\n' % tab_to(2, '.pre_reloc'))
+            self.out('\t\t%s= %s,\n' % (tab_to(2, '.compat'),
+                     ' '.join(['"%s\\0"' % c for c in strs[:-1]] +
+                              ['"%s"' % strs[-1]])))
+            self.out('\t\t%s= %d,\n' % (tab_to(2, '.compat_len'),
+                                           len(compat)))
+            self.out('\t},\n')
+        self.out('};\n')
+        self.out('\n')
+        self.out('const struct dm_prebind_table dm_prebind_table = {\n')
+        self.out('\t%s= %#x,\n' % (tab_to(3, '.totalsize'),
+                                    fdt_obj.totalsize()))
+        self.out('\t%s= %#x,\n' % (tab_to(3, '.size_dt_struct'),
+                                    fdt_obj.size_dt_struct()))
+        self.out('\t%s= %#x,\n' % (tab_to(3, '.size_dt_strings'),
+                                    fdt_obj.size_dt_strings()))
+        self.out('\t%s= ARRAY_SIZE(dm_prebind_entries),\n' %
+                 tab_to(3, '.count'))
+        self.out('\t%s= dm_prebind_entries,\n' % tab_to(3, '.entries'))
+        self.out('};\n')
+
+
+def run_steps(args, dtb_file, include_disabled, output, src_dir=None):
     """Run all the steps of the dtoc tool
 
     Args:
@@ -554,23 +718,36 @@ def run_steps(args, dtb_file, include_disabled, output):
         dtb_file: Filename of dtb file to process
         include_disabled: True to include disabled nodes
         output: Name of output file
+        src_dir: Top-level directory of the U-Boot source, used to find the
+            drivers for the prebind table, or None to find none
     """
     if not args:
-        raise ValueError('Please specify a command: struct, platdata')
+        raise ValueError('Please specify a command: struct, platdata, '
+                         'prebind')
 
     plat = DtbPlatdata(dtb_file, include_disabled)
     plat.scan_dtb()
-    plat.scan_tree()
-    plat.scan_reg_sizes()
+    cmds = args[0].split(',')
+    for cmd in cmds:
+        if cmd not in ['struct', 'platdata', 'prebind']:
+            raise ValueError("Unknown command '%s': (use: struct, platdata, "
+                             "prebind)" % cmd)
+
+    # The prebind table does not need the platform-data structures
+    if cmds != ['prebind']:
+        plat.scan_tree()
+        plat.scan_reg_sizes()
+    if 'prebind' in cmds and src_dir:
+        plat.scan_drivers(src_dir)
     plat.setup_output(output)
-    structs = plat.scan_structs()
-    plat.scan_phandles()
+    if cmds != ['prebind']:
+        structs = plat.scan_structs()
+        plat.scan_phandles()
 
-    for cmd in args[0].split(','):
+    for cmd in cmds:
         if cmd == 'struct':
             plat.generate_structs(structs)
         elif cmd == 'platdata':
             plat.generate_tables()
-        else:
-            raise ValueError("Unknown command '%s': (use: struct, platdata)" %
-                             cmd)
+        elif cmd == 'prebind':
+            plat.generate_prebind()
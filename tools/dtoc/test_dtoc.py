@@ -46,6 +46,66 @@ C_HEADER = '''/*
 #include <dt-structs.h>
 '''
 
+# Driver sources for the prebind test, by filename within the source directory
+PREBIND_SOURCES = {
+    'drivers/serial/ns16550.c': '''
+static const struct udevice_id ns16550_serial_ids[] = {
+	{ .compatible = "ns16550", .data = PORT_NS16550 },
+	{ }
+};
+
+U_BOOT_DRIVER(ns16550_serial) = {
+	.name	= "ns16550_serial",
+	.of_match = ns16550_serial_ids,
+};
+
+static const struct udevice_id dw_apb_uart_ids[] = {
+	{ .compatible = "snps,dw-apb-uart" },
+	{ }
+};
+
+U_BOOT_DRIVER(a_dw_apb_uart) = {
+	.name	= "a_dw_apb_uart",
+	.of_match = dw_apb_uart_ids,
+};
+''',
+    'drivers/core/simple-bus.c': '''
+static const struct udevice_id generic_simple_bus_ids[] = {
+	{ .compatible = "simple-bus" },
+	{ .compatible = "simple-mfd" },
+	{ }
+};
+
+U_BOOT_DRIVER(simple_bus_drv) = {
+	.name	= "generic_simple_bus",
+	.of_match = generic_simple_bus_ids,
+};
+
+U_BOOT_DRIVER(generic_simple_bus) = {
+	.name	= "generic_simple_bus",
+	.of_match = of_match_ptr(generic_simple_bus_ids),
+};
+''',
+    'drivers/core/root.c': '''
+U_BOOT_DRIVER(root_driver) = {
+	.name	= "root_driver",
+};
+''',
+    'lib/string.c': '''
+char *strcpy(char *dest, const char *src);
+''',
+    'tools/fw-cfg.c': '''
+static const struct udevice_id fw_cfg_ids[] = {
+	{ .compatible = "test,fw-cfg" },
+	{ }
+};
+
+U_BOOT_DRIVER(fw_cfg) = {
+	.of_match = fw_cfg_ids,
+};
+''',
+}
+
 
 
 def get_dtb_file(dts_fname, capture_stderr=False):
@@ -685,6 +745,70 @@ U_BOOT_DEVICE(spl_test2) = {
 \t.platdata_size\t= sizeof(dtv_spl_test2),
 };
 
+''', data)
+
+    def test_prebind(self):
+        """Test output of the table of nodes for driver model to bind"""
+        dtb_file = get_dtb_file('dtoc_test_prebind.dts')
+        output = tools.GetOutputFilename('output')
+        src_dir = tools.GetOutputFilename('src')
+        for fname, data in PREBIND_SOURCES.items():
+            fname = os.path.join(src_dir, fname)
+            if not os.path.exists(os.path.dirname(fname)):
+                os.makedirs(os.path.dirname(fname))
+            tools.WriteFile(fname, data)
+        dtb_platdata.run_steps(['prebind'], dtb_file, False, output, src_dir)
+        with open(output) as infile:
+            data = infile.read()
+        self._CheckStrings('''/*
+ * DO NOT MODIFY
+ *
+ * This file was generated by dtoc from a .dtb (device tree binary) file.
+ */
+
+#include <common.h>
+#include <dm.h>
+
+DM_PREBIND_DRIVER_REF(generic_simple_bus);
+DM_PREBIND_DRIVER_REF(ns16550_serial);
+
+static const struct dm_prebind dm_prebind_entries[] = {
+\t{
+\t\t.name\t\t= "fw-cfg",
+\t\t.offset\t\t= 0x48,
+\t\t.compat\t\t= "test,fw-cfg",
+\t\t.compat_len\t= 12,
+\t},
+\t{
+\t\t.name\t\t= "psci",
+\t\t.offset\t\t= 0x84,
+\t\t.compat\t\t= "arm,psci-1.0\\0" "arm,psci",
+\t\t.compat_len\t= 22,
+\t},
+\t{
+\t\t.name\t\t= "serial",
+\t\t.offset\t\t= 0xbc,
+\t\t.driver\t\t= DM_PREBIND_DRIVER(ns16550_serial),
+\t\t.pre_reloc\t= true,
+\t\t.compat\t\t= "ns16550\\0" "snps,dw-apb-uart",
+\t\t.compat_len\t= 25,
+\t},
+\t{
+\t\t.name\t\t= "bus@100",
+\t\t.offset\t\t= 0x114,
+\t\t.driver\t\t= DM_PREBIND_DRIVER(generic_simple_bus),
+\t\t.compat\t\t= "simple-bus",
+\t\t.compat_len\t= 11,
+\t},
+};
+
+const struct dm_prebind_table dm_prebind_table = {
+\t.totalsize\t\t= 0x2d1,
+\t.size_dt_struct\t\t= 0x248,
+\t.size_dt_strings\t= 0x51,
+\t.count\t\t\t= ARRAY_SIZE(dm_prebind_entries),
+\t.entries\t\t= dm_prebind_entries,
+};
 ''', data)
 
     def testStdout(self):
@@ -706,5 +830,5 @@ U_BOOT_DEVICE(spl_test2) = {
         output = tools.GetOutputFilename('output')
         with self.assertRaises(ValueError) as e:
             dtb_platdata.run_steps(['invalid-cmd'], dtb_file, False, output)
-        self.assertIn("Unknown command 'invalid-cmd': (use: struct, platdata)",
-                      str(e.exception))
+        self.assertIn("Unknown command 'invalid-cmd': (use: struct, platdata, "
+                      "prebind)", str(e.exception))
@@ -733,6 +733,226 @@ int fit_add_verification_data(const char *keydir, void *keydest, void *fit,
 	return 0;
 }
 
+#define LZ4F_MAGIC		0x184d2204
+#define LZ4F_FLG_VERSION_MASK	0xc0
+#define LZ4F_FLG_VERSION	0x40
+#define LZ4F_FLG_BLOCK_CSUM	0x10
+#define LZ4F_FLG_CONTENT_SIZE	0x08
+#define LZ4F_FLG_CONTENT_CSUM	0x04
+#define LZ4F_FLG_DICT_ID	0x01
+#define LZ4F_BLOCK_SIZE_MASK	0x7fffffff
+
+#define GZIP_FLG_EXTRA		0x04
+#define GZIP_TRAILER_SIZE	8
+
+static uint32_t get_le32(const uint8_t *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint16_t get_le16(const uint8_t *p)
+{
+	return p[0] | p[1] << 8;
+}
+
+/**
+ * fit_lz4_frame_len() - Find the length of an lz4 frame
+ *
+ * @data:	Start of the frame
+ * @size:	Number of bytes available at @data
+ * @unc_len:	Returns the uncompressed size of the frame, or -1 if the frame
+ *		does not record it
+ * @return number of bytes in the frame, or -EINVAL if it is not valid
+ */
+static long fit_lz4_frame_len(const uint8_t *data, size_t size, long *unc_len)
+{
+	size_t pos = 7;
+	uint32_t len;
+	uint8_t flg;
+
+	if (size < pos || get_le32(data) != LZ4F_MAGIC)
+		return -EINVAL;
+	flg = data[4];
+	if ((flg & LZ4F_FLG_VERSION_MASK) != LZ4F_FLG_VERSION)
+		return -EINVAL;
+
+	*unc_len = -1;
+	if (flg & LZ4F_FLG_CONTENT_SIZE) {
+		pos += 8;
+		if (size < pos || get_le32(data + 10))
+			return -EINVAL;
+		*unc_len = get_le32(data + 6);
+	}
+	if (flg & LZ4F_FLG_DICT_ID)
+		pos += 4;
+
+	/* Walk the blocks until the end mark */
+	do {
+		if (size < pos + 4)
+			return -EINVAL;
+		len = get_le32(data + pos) & LZ4F_BLOCK_SIZE_MASK;
+		pos += 4;
+		if (len) {
+			pos += len;
+			if (flg & LZ4F_FLG_BLOCK_CSUM)
+				pos += 4;
+		}
+	} while (len);
+	if (flg & LZ4F_FLG_CONTENT_CSUM)
+		pos += 4;
+	if (size < pos)
+		return -EINVAL;
+
+	return pos;
+}
+
+/**
+ * fit_bgzf_member_len() - Find the length of a gzip member in BGZF format
+ *
+ * The compressed size is held in a 'BC' subfield of the gzip extra field,
+ * as written by bgzip.
+ *
+ * @data:	Start of the member
+ * @size:	Number of bytes available at @data
+ * @unc_len:	Returns the uncompressed size of the member
+ * @return number of bytes in the member, or -EINVAL if it is not valid
+ */
+static long fit_bgzf_member_len(const uint8_t *data, size_t size,
+				long *unc_len)
+{
+	size_t pos, end;
+	uint16_t len;
+
+	if (size < 12 || data[0] != 0x1f || data[1] != 0x8b || data[2] != 8 ||
+	    !(data[3] & GZIP_FLG_EXTRA))
+		return -EINVAL;
+
+	end = 12 + get_le16(data + 10);
+	for (pos = 12; pos + 4 <= end && end <= size; pos += 4 + len) {
+		len = get_le16(data + pos + 2);
+		if (data[pos] != 'B' || data[pos + 1] != 'C' || len != 2)
+			continue;
+		if (pos + 6 > end)
+			break;
+		len = get_le16(data + pos + 4);
+		if ((size_t)len + 1 > size || len + 1 < end + GZIP_TRAILER_SIZE)
+			break;
+		*unc_len = get_le32(data + len + 1 - 4);
+
+		return len + 1;
+	}
+
+	return -EINVAL;
+}
+
+/**
+ * fit_image_add_comp_blocks() - index the blocks of a block-compressed image
+ *
+ * @fit:	Pointer to the FIT format image header
+ * @noffset:	Component image node offset
+ * @return 0 if OK (or not a block-compressed image), -ENOSPC if the FIT ran
+ *	out of space, other -ve value on error
+ */
+static int fit_image_add_comp_blocks(void *fit, int noffset)
+{
+	const char *name = fit_get_name(fit, noffset, NULL);
+	const fdt32_t *val;
+	const uint8_t *data;
+	const void *ptr;
+	fdt32_t *offsets;
+	uint32_t block_size;
+	bool short_block = false;
+	long len, unc_len;
+	size_t size, pos;
+	uint8_t comp;
+	int count;
+	int ret;
+
+	val = fdt_getprop(fit, noffset, FIT_COMP_BLOCK_SIZE_PROP, NULL);
+	if (!val || fdt_getprop(fit, noffset, FIT_COMP_BLOCKS_PROP, NULL))
+		return 0;
+	block_size = fdt32_to_cpu(*val);
+
+	if (fit_image_get_comp(fit, noffset, &comp) ||
+	    (comp != IH_COMP_LZ4 && comp != IH_COMP_GZIP)) {
+		printf("Can't index blocks of '%s': only gzip and lz4 are supported\n",
+		       name);
+		return -EINVAL;
+	}
+	if (fit_image_get_data(fit, noffset, &ptr, &size)) {
+		printf("Can't get image data for '%s'\n", name);
+		return -EINVAL;
+	}
+	data = ptr;
+
+	/* Every block is well over 8 bytes, so this is enough */
+	offsets = malloc((size / 8 + 1) * sizeof(*offsets));
+	if (!offsets)
+		return -ENOMEM;
+
+	for (pos = 0, count = 0; pos < size; pos += len, count++) {
+		if (comp == IH_COMP_LZ4)
+			len = fit_lz4_frame_len(data + pos, size - pos,
+						&unc_len);
+		else
+			len = fit_bgzf_member_len(data + pos, size - pos,
+						  &unc_len);
+		if (len < 0) {
+			printf("Invalid %s block at offset %#zx in '%s'\n",
+			       genimg_get_comp_name(comp), pos, name);
+			ret = -EINVAL;
+			goto err;
+		}
+
+		/* Only the last block may be shorter than the block size */
+		if (short_block || unc_len > (long)block_size) {
+			printf("Block %d of '%s' does not expand to %#x bytes\n",
+			       count - short_block, name, block_size);
+			ret = -EINVAL;
+			goto err;
+		}
+		if (unc_len >= 0 && unc_len != block_size)
+			short_block = true;
+		offsets[count] = cpu_to_fdt32(pos);
+	}
+
+	ret = fdt_setprop(fit, noffset, FIT_COMP_BLOCKS_PROP, offsets,
+			  count * sizeof(*offsets));
+	if (ret) {
+		printf("Can't set '%s' property for '%s' node (%s)\n",
+		       FIT_COMP_BLOCKS_PROP, name, fdt_strerror(ret));
+		ret = ret == -FDT_ERR_NOSPACE ? -ENOSPC : -EIO;
+	}
+err:
+	free(offsets);
+
+	return ret;
+}
+
+int fit_add_comp_blocks(void *fit)
+{
+	int images_noffset;
+	int noffset;
+	int ret;
+
+	images_noffset = fdt_path_offset(fit, FIT_IMAGES_PATH);
+	if (images_noffset < 0) {
+		printf("Can't find images parent node '%s' (%s)\n",
+		       FIT_IMAGES_PATH, fdt_strerror(images_noffset));
+		return images_noffset;
+	}
+
+	for (noffset = fdt_first_subnode(fit, images_noffset);
+	     noffset >= 0;
+	     noffset = fdt_next_subnode(fit, noffset)) {
+		ret = fit_image_add_comp_blocks(fit, noffset);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
 #ifdef CONFIG_FIT_SIGNATURE
 int fit_check_sign(const void *fit, const void *key)
 {
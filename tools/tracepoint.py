@@ -0,0 +1,201 @@
+#!/usr/bin/env python2
+# SPDX-License-Identifier: GPL-2.0+
+#
+# Convert U-Boot tracepoint records into a Chrome / Perfetto trace
+#
+# The input is either a file written from the 'tracepoint stash' command or
+# a bloblist containing a tracepoint record. The output is JSON in the Trace
+# Event Format, which can be loaded into chrome://tracing or
+# https://ui.perfetto.dev
+#
+# See doc/README.tracepoint for details.
+
+from __future__ import print_function
+
+from optparse import OptionParser
+import json
+import struct
+import sys
+
+# These must match include/tracepoint.h
+TRACEPOINT_MAGIC = 0x50637254
+TRACEPOINT_VERSION = 1
+HDR_FORMAT = 'IHHII'
+REC_FORMAT = 'IIHHII12s'
+
+# These must match include/bloblist.h
+BLOBLIST_MAGIC = 0xb00757a3
+BLOBLIST_ALIGN = 16
+BLOBLISTT_TRACEPOINT = 5
+BLOBLIST_HDR_FORMAT = 'IIIIIIII'
+BLOBLIST_REC_FORMAT = 'IIII'
+
+# Name and category of each event, and the names of its two arguments
+EVENTS = [
+    ('probe', 'dm', ['uclass_id', 'ret']),
+    ('blk_read', 'blk', ['start', 'blocks']),
+    ('blk_write', 'blk', ['start', 'blocks']),
+    ('mmc_cmd', 'mmc', ['cmd', 'ret']),
+    ('net_send', 'net', ['len', 'ret']),
+    ('net_recv', 'net', ['len', None]),
+    ('fs_read', 'fs', ['offset', 'bytes']),
+    ('fs_write', 'fs', ['offset', 'bytes']),
+]
+
+def FindRecords(data):
+    """Find the tracepoint records in some data
+
+    If the data is a bloblist, its records are walked to find the one
+    tagged BLOBLISTT_TRACEPOINT. Otherwise the data must start with the
+    tracepoint header, as written by 'tracepoint stash'.
+
+    Args:
+        data: Data to search
+
+    Returns:
+        Tuple:
+            byte-order character for struct ('<' or '>')
+            offset of the header in data
+    """
+    for order in ['<', '>']:
+        if len(data) >= struct.calcsize(order + BLOBLIST_HDR_FORMAT):
+            _, hdr_size, _, magic, size, _, _, _ = struct.unpack_from(
+                order + BLOBLIST_HDR_FORMAT, data)
+            if magic == BLOBLIST_MAGIC:
+                return order, FindBloblistRecord(data, order, hdr_size,
+                                                 min(size, len(data)))
+    for order in ['<', '>']:
+        if len(data) >= 4 and struct.unpack_from(order + 'I', data)[0] == \
+                TRACEPOINT_MAGIC:
+            return order, 0
+    raise ValueError('No tracepoint records found')
+
+def FindBloblistRecord(data, order, pos, end):
+    """Find the tracepoint record in a bloblist
+
+    Args:
+        data: Bloblist data
+        order: Byte-order character for struct ('<' or '>')
+        pos: Offset of the first bloblist record
+        end: Offset of the end of the records
+
+    Returns:
+        offset of the tracepoint header in data
+    """
+    rec_hdr_size = struct.calcsize(order + BLOBLIST_REC_FORMAT)
+    while pos + rec_hdr_size <= end:
+        tag, hdr_size, size, _ = struct.unpack_from(
+            order + BLOBLIST_REC_FORMAT, data, pos)
+        if tag == BLOBLISTT_TRACEPOINT:
+            return pos + hdr_size
+        pos += hdr_size + Align(size, BLOBLIST_ALIGN)
+    raise ValueError('No tracepoint record in bloblist')
+
+def Align(value, align):
+    """Round a value up to a multiple of align"""
+    return (value + align - 1) & ~(align - 1)
+
+def DecodeRecords(data):
+    """Decode tracepoint records
+
+    Args:
+        data: Data containing the records
+
+    Returns:
+        Tuple:
+            number of records which were dropped
+            list of records, each a tuple:
+                start time in microseconds
+                duration in microseconds
+                event ID
+                list of two arguments
+                device or file name
+    """
+    order, pos = FindRecords(data)
+    hdr_size = struct.calcsize(order + HDR_FORMAT)
+    magic, version, rec_size, count, dropped = struct.unpack_from(
+        order + HDR_FORMAT, data, pos)
+    if version != TRACEPOINT_VERSION:
+        raise ValueError('Unknown tracepoint version %d' % version)
+    if rec_size < struct.calcsize(order + REC_FORMAT):
+        raise ValueError('Record size %d is too small' % rec_size)
+    records = []
+    pos += hdr_size
+    for i in range(count):
+        start, duration, event, _, arg0, arg1, name = struct.unpack_from(
+            order + REC_FORMAT, data, pos + i * rec_size)
+        name = name.split(b'\0')[0].decode('utf-8', 'replace')
+        records.append((start, duration, event, [arg0, arg1], name))
+    return dropped, records
+
+def ToChrome(dropped, records):
+    """Convert records to Chrome's Trace Event Format
+
+    Each record becomes a complete ('X') event. All events are on one
+    thread, since U-Boot is single-threaded, and nest by time.
+
+    Args:
+        dropped: Number of records which were dropped
+        records: List of records, as returned by DecodeRecords()
+
+    Returns:
+        dict which can be written out as JSON
+    """
+    events = []
+    for start, duration, event, args, name in records:
+        if event < len(EVENTS):
+            ev_name, cat, arg_names = EVENTS[event]
+        else:
+            ev_name, cat, arg_names = 'event%d' % event, 'unknown', [
+                'arg0', 'arg1']
+        ev_args = {}
+        for arg_name, value in zip(arg_names, args):
+            if arg_name:
+                if arg_name == 'ret' and value & 0x80000000:
+                    value -= 1 << 32
+                ev_args[arg_name] = value
+        events.append({
+            'name': '%s %s' % (ev_name, name) if name else ev_name,
+            'cat': cat,
+            'ph': 'X',
+            'ts': start,
+            'dur': duration,
+            'pid': 0,
+            'tid': 0,
+            'args': ev_args,
+        })
+    return {
+        'traceEvents': events,
+        'displayTimeUnit': 'ms',
+        'otherData': {'source': 'U-Boot tracepoints',
+                      'dropped': dropped},
+    }
+
+def Main(argv):
+    parser = OptionParser(usage='%prog [options] <file>',
+                          description='Convert U-Boot tracepoint records '
+                          'into Chrome / Perfetto trace JSON')
+    parser.add_option('-o', '--output', type='string', default='-',
+                      help='Output file (default stdout)')
+    (options, args) = parser.parse_args(argv)
+    if len(args) != 1:
+        parser.error('Please provide one input file')
+
+    with open(args[0], 'rb') as fd:
+        data = fd.read()
+    try:
+        dropped, records = DecodeRecords(data)
+    except ValueError as e:
+        print('%s: %s' % (args[0], e), file=sys.stderr)
+        return 1
+    out = json.dumps(ToChrome(dropped, records), indent=1, sort_keys=True,
+                     separators=(',', ': '))
+    if options.output == '-':
+        print(out)
+    else:
+        with open(options.output, 'w') as fd:
+            fd.write(out + '\n')
+    return 0
+
+if __name__ == '__main__':
+    sys.exit(Main(sys.argv[1:]))